@@ -0,0 +1,349 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <tacopie/tacopie>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <Winsock2.h>
+#else
+#include <signal.h>
+#endif /* _WIN32 */
+
+//!
+//! helpers shared by the benchmarks
+//!
+//! every benchmark runs its scenario once per (poller backend, number of io_service workers) pair and prints one JSON
+//! object per run on stdout, so that results can be collected with e.g. `tacopie_bench_ping_pong | jq`.
+//!
+//! common command line options:
+//!  * --backends=select,epoll,kqueue,io_uring,iocp: poller backends to be swept (defaults to all the backends of the platform, except io_uring)
+//!  * --workers=1,2,4,8: numbers of io_service workers to be swept
+//!  * --port=N: first port used by the benchmark servers (each run uses its own port)
+//!  * --quick: smaller workloads, for smoke testing
+//!
+namespace benchmark {
+
+//!
+//! benchmark configuration, parsed from the command line
+//!
+struct config {
+  std::vector<tacopie::poller_backend> vctBackends;
+  std::vector<std::size_t>             vctNbWorkers;
+  std::uint32_t                        uPort  = 3100;
+  bool                                 bQuick = false;
+};
+
+//!
+//! \return the name of the given poller backend
+//!
+inline std::string
+get_backend_name(tacopie::poller_backend eBackend) {
+  switch (eBackend) {
+  case tacopie::poller_backend::select: return "select";
+  case tacopie::poller_backend::epoll: return "epoll";
+  case tacopie::poller_backend::kqueue: return "kqueue";
+  case tacopie::poller_backend::io_uring: return "io_uring";
+  case tacopie::poller_backend::iocp: return "iocp";
+  default: return "automatic";
+  }
+}
+
+//!
+//! \return the poller backends available on the current platform
+//!
+inline std::vector<tacopie::poller_backend>
+get_available_backends(void) {
+  std::vector<tacopie::poller_backend> vctBackends = {tacopie::poller_backend::select};
+
+#if defined(__linux__)
+  vctBackends.push_back(tacopie::poller_backend::epoll);
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
+  vctBackends.push_back(tacopie::poller_backend::kqueue);
+#elif defined(_WIN32)
+  vctBackends.push_back(tacopie::poller_backend::iocp);
+#endif /* __linux__ */
+
+  return vctBackends;
+}
+
+//!
+//! \return the comma separated values of the given option
+//!
+inline std::vector<std::string>
+split_option(const std::string& sValue) {
+  std::vector<std::string> vctValues;
+  std::stringstream ss(sValue);
+  std::string sToken;
+
+  while (std::getline(ss, sToken, ',')) {
+    if (!sToken.empty()) { vctValues.push_back(sToken); }
+  }
+
+  return vctValues;
+}
+
+//!
+//! parse the command line and initialize the platform (winsock, SIGPIPE)
+//!
+inline config
+init(int argc, char** argv) {
+#ifdef _WIN32
+  WORD version = MAKEWORD(2, 2);
+  WSADATA data;
+
+  if (WSAStartup(version, &data) != 0) {
+    std::cerr << "WSAStartup() failure" << std::endl;
+    std::exit(-1);
+  }
+#else
+  //! peers closing their connection must not kill the benchmark
+  signal(SIGPIPE, SIG_IGN);
+#endif /* _WIN32 */
+
+  config cfg;
+  cfg.vctBackends  = get_available_backends();
+  cfg.vctNbWorkers = {1, 2, 4, 8};
+
+  for (int i = 1; i < argc; ++i) {
+    std::string sArg = argv[i];
+
+    if (sArg == "--quick") {
+      cfg.bQuick = true;
+    } else if (sArg.compare(0, 11, "--backends=") == 0) {
+      cfg.vctBackends.clear();
+
+      for (const auto& sBackend : split_option(sArg.substr(11))) {
+        if (sBackend == "select") { cfg.vctBackends.push_back(tacopie::poller_backend::select); }
+        else if (sBackend == "epoll") { cfg.vctBackends.push_back(tacopie::poller_backend::epoll); }
+        else if (sBackend == "kqueue") { cfg.vctBackends.push_back(tacopie::poller_backend::kqueue); }
+        else if (sBackend == "io_uring") { cfg.vctBackends.push_back(tacopie::poller_backend::io_uring); }
+        else if (sBackend == "iocp") { cfg.vctBackends.push_back(tacopie::poller_backend::iocp); }
+        else if (sBackend == "automatic") { cfg.vctBackends.push_back(tacopie::poller_backend::automatic); }
+        else {
+          std::cerr << "unknown backend: " << sBackend << std::endl;
+          std::exit(-1);
+        }
+      }
+    } else if (sArg.compare(0, 10, "--workers=") == 0) {
+      cfg.vctNbWorkers.clear();
+
+      for (const auto& sNbWorkers : split_option(sArg.substr(10))) {
+        cfg.vctNbWorkers.push_back(static_cast<std::size_t>(std::strtoul(sNbWorkers.c_str(), nullptr, 10)));
+      }
+    } else if (sArg.compare(0, 7, "--port=") == 0) {
+      cfg.uPort = static_cast<std::uint32_t>(std::strtoul(sArg.c_str() + 7, nullptr, 10));
+    } else {
+      std::cerr << "usage: " << argv[0] << " [--backends=select,epoll,kqueue,io_uring,iocp] [--workers=1,2,4,8] [--port=N] [--quick]" << std::endl;
+      std::exit(-1);
+    }
+  }
+
+  return cfg;
+}
+
+//!
+//! run a scenario once per (backend, number of workers) pair
+//! the default io_service is replaced before each run, so that tcp_server and tcp_client instances created by the
+//! scenario use the swept configuration. the scenario must release all of them before returning.
+//!
+//! \param cfg benchmark configuration
+//! \param scenario scenario, taking the backend, the number of workers and the port to be used as parameters
+//!
+inline void
+sweep(config& cfg, const std::function<void(tacopie::poller_backend, std::size_t, std::uint32_t)>& scenario) {
+  for (auto eBackend : cfg.vctBackends) {
+    for (auto uNbWorkers : cfg.vctNbWorkers) {
+      auto ptrService = std::make_shared<tacopie::io_service>(eBackend);
+      ptrService->set_nb_workers(uNbWorkers);
+      tacopie::set_default_io_service(ptrService);
+
+      scenario(eBackend, uNbWorkers, cfg.uPort++);
+
+      tacopie::set_default_io_service(nullptr);
+    }
+  }
+}
+
+//!
+//! \return a monotonic timestamp, in nanoseconds
+//!
+inline std::uint64_t
+now_nsecs(void) {
+  return static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+//!
+//! \param vctSamples samples, sorted in ascending order
+//! \param dPercentile percentile, between 0 and 100
+//! \return the value of the given percentile (nearest rank), or 0 if there are no samples
+//!
+inline std::uint64_t
+get_percentile(const std::vector<std::uint64_t>& vctSamples, double dPercentile) {
+  if (vctSamples.empty()) { return 0; }
+
+  std::size_t uRank = static_cast<std::size_t>(dPercentile / 100.0 * static_cast<double>(vctSamples.size()));
+
+  return vctSamples[std::min(uRank, vctSamples.size() - 1)];
+}
+
+//!
+//! busy wait (with yields) until the predicate holds or the timeout expires
+//!
+//! \return whether the predicate holds
+//!
+inline bool
+wait_until(const std::function<bool()>& predicate, std::uint32_t uTimeoutMsecs = 30000) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(uTimeoutMsecs);
+
+  while (!predicate()) {
+    if (std::chrono::steady_clock::now() > deadline) { return false; }
+    std::this_thread::yield();
+  }
+
+  return true;
+}
+
+//!
+//! start a server echoing back everything its clients send
+//!
+//! \param server server to be started
+//! \param uPort port to listen on
+//!
+inline void
+start_echo_server(tacopie::tcp_server& server, std::uint32_t uPort) {
+  server.start("127.0.0.1", uPort, [](const std::shared_ptr<tacopie::tcp_client>& client) -> bool {
+    //! the server keeps the client until it disconnects, so a raw pointer can be captured
+    tacopie::tcp_client* pClient = client.get();
+
+    client->start_continuous_read([pClient](tacopie::tcp_client::read_result& res) {
+      if (res.success) { pClient->async_write({std::move(res.buffer), nullptr}); }
+    });
+
+    return false;
+  });
+}
+
+//!
+//! one result line, printed as a JSON object
+//!
+class result {
+public:
+  //!
+  //! ctor
+  //!
+  //! \param sScenario name of the scenario
+  //! \param eBackend poller backend used by the run
+  //! \param uNbWorkers number of io_service workers used by the run
+  //!
+  result(const std::string& sScenario, tacopie::poller_backend eBackend, std::size_t uNbWorkers) {
+    add("scenario", sScenario);
+    add("backend", get_backend_name(eBackend));
+    add("workers", static_cast<double>(uNbWorkers));
+  }
+
+  //!
+  //! ctor, for scenarios that do not involve the io_service
+  //!
+  //! \param sScenario name of the scenario
+  //! \param uNbWorkers number of workers used by the run
+  //!
+  result(const std::string& sScenario, std::size_t uNbWorkers) {
+    add("scenario", sScenario);
+    add("backend", std::string("none"));
+    add("workers", static_cast<double>(uNbWorkers));
+  }
+
+  //!
+  //! add a string field
+  //!
+  result&
+  add(const std::string& sName, const std::string& sValue) {
+    append_name(sName);
+    m_sFields += "\"" + sValue + "\"";
+    return *this;
+  }
+
+  //!
+  //! add a numeric field
+  //!
+  result&
+  add(const std::string& sName, double dValue) {
+    std::ostringstream ss;
+    ss.precision(15);
+    ss << dValue;
+
+    append_name(sName);
+    m_sFields += ss.str();
+    return *this;
+  }
+
+  //!
+  //! add a boolean field
+  //!
+  result&
+  add_flag(const std::string& sName, bool bValue) {
+    append_name(sName);
+    m_sFields += bValue ? "true" : "false";
+    return *this;
+  }
+
+  //!
+  //! print the result on stdout
+  //!
+  void
+  print(void) const {
+    std::cout << "{" << m_sFields << "}" << std::endl;
+  }
+
+private:
+  //!
+  //! append the given field name and the separator preceding it
+  //!
+  void
+  append_name(const std::string& sName) {
+    if (!m_sFields.empty()) { m_sFields += ", "; }
+    m_sFields += "\"" + sName + "\": ";
+  }
+
+private:
+  //!
+  //! formatted fields
+  //!
+  std::string m_sFields;
+};
+
+} // namespace benchmark
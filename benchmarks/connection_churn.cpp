@@ -0,0 +1,94 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "benchmark.hpp"
+
+#include <atomic>
+
+//!
+//! connection churn and accept rate
+//! several threads open connections and close them right away, the server accepts them, tracks them and releases
+//! them on disconnection
+//!
+
+static const std::size_t g_uNbConnectingThreads = 4;
+
+int
+main(int argc, char** argv) {
+  auto cfg = benchmark::init(argc, argv);
+  std::size_t uNbConnectionsPerThread = cfg.bQuick ? 250 : 2500;
+  std::size_t uNbConnections          = uNbConnectionsPerThread * g_uNbConnectingThreads;
+
+  benchmark::sweep(cfg, [&](tacopie::poller_backend eBackend, std::size_t uNbWorkers, std::uint32_t uPort) {
+    std::atomic<std::size_t> uNbAccepted_a(0);
+    std::atomic<std::size_t> uNbFailures_a(0);
+
+    tacopie::tcp_server server;
+    server.start("127.0.0.1", uPort, [&](const std::shared_ptr<tacopie::tcp_client>& client) -> bool {
+      ++uNbAccepted_a;
+
+      //! a pending read is needed to notice the disconnection
+      client->start_continuous_read([](tacopie::tcp_client::read_result&) {});
+      return false;
+    });
+
+    std::uint64_t uStartNsecs = benchmark::now_nsecs();
+
+    std::vector<std::thread> vctThreads;
+    for (std::size_t i = 0; i < g_uNbConnectingThreads; ++i) {
+      vctThreads.push_back(std::thread([&] {
+        for (std::size_t j = 0; j < uNbConnectionsPerThread; ++j) {
+          try {
+            tacopie::tcp_socket client;
+            client.connect("127.0.0.1", uPort);
+            client.close();
+          }
+          catch (const tacopie::tacopie_error&) {
+            ++uNbFailures_a;
+          }
+        }
+      }));
+    }
+
+    for (auto& thread : vctThreads) { thread.join(); }
+
+    bool bCompleted = benchmark::wait_until([&] { return uNbAccepted_a + uNbFailures_a >= uNbConnections; });
+    double dElapsedSecs = static_cast<double>(benchmark::now_nsecs() - uStartNsecs) / 1e9;
+
+    //! time needed by the server to notice the disconnections and release its clients
+    benchmark::wait_until([&] { return server.get_nb_clients() == 0; });
+    double dReleaseSecs = static_cast<double>(benchmark::now_nsecs() - uStartNsecs) / 1e9;
+
+    server.stop(true);
+
+    benchmark::result("connection_churn", eBackend, uNbWorkers)
+        .add_flag("completed", bCompleted)
+        .add("connections", static_cast<double>(uNbConnections))
+        .add("accepted", static_cast<double>(uNbAccepted_a.load()))
+        .add("failures", static_cast<double>(uNbFailures_a.load()))
+        .add("accepts_per_sec", static_cast<double>(uNbAccepted_a.load()) / dElapsedSecs)
+        .add("release_secs", dReleaseSecs)
+        .print();
+  });
+
+  return 0;
+}
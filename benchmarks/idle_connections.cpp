@@ -0,0 +1,131 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "benchmark.hpp"
+
+#include <memory>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <sys/select.h>
+#endif /* _WIN32 */
+
+//!
+//! many idle connections scaling
+//! the ping-pong latency of one active connection is measured while an increasing number of idle connections are
+//! tracked by the io_service, along with the time needed to establish them
+//!
+
+static const std::size_t g_uMessageSize = 64;
+
+//!
+//! \return the number of idle connections that fit in the file descriptor limit (each one uses a client and a server fd)
+//!
+static std::size_t
+get_max_idle_connections(tacopie::poller_backend eBackend) {
+  std::size_t uMaxFds = 1024;
+
+#ifndef _WIN32
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+    //! raise the soft limit as much as allowed
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+    getrlimit(RLIMIT_NOFILE, &limit);
+    uMaxFds = static_cast<std::size_t>(limit.rlim_cur);
+  }
+#endif /* _WIN32 */
+
+  //! select() can not watch fds above FD_SETSIZE
+  if (eBackend == tacopie::poller_backend::select && uMaxFds > FD_SETSIZE) { uMaxFds = FD_SETSIZE; }
+
+  return uMaxFds > 128 ? (uMaxFds - 128) / 2 : 0;
+}
+
+int
+main(int argc, char** argv) {
+  auto cfg = benchmark::init(argc, argv);
+  std::size_t uNbIterations = cfg.bQuick ? 1000 : 10000;
+  std::vector<std::size_t> vctNbIdleConnections = {0, 100, 1000, 10000};
+
+  if (cfg.bQuick) { vctNbIdleConnections = {0, 100}; }
+
+  benchmark::sweep(cfg, [&](tacopie::poller_backend eBackend, std::size_t uNbWorkers, std::uint32_t uPort) {
+    tacopie::tcp_server server;
+    benchmark::start_echo_server(server, uPort);
+
+    std::vector<std::unique_ptr<tacopie::tcp_socket>> vctIdleClients;
+    std::size_t uMaxIdleConnections = get_max_idle_connections(eBackend);
+
+    tacopie::tcp_socket client;
+    client.connect("127.0.0.1", uPort);
+
+    std::vector<char> vctMessage(g_uMessageSize, 'x');
+    std::vector<char> vctReply(g_uMessageSize);
+
+    for (auto uNbIdleConnections : vctNbIdleConnections) {
+      if (uNbIdleConnections > uMaxIdleConnections) { break; }
+
+      //! open the missing idle connections
+      std::uint64_t uConnectStartNsecs = benchmark::now_nsecs();
+      std::size_t uNbNewConnections    = uNbIdleConnections - vctIdleClients.size();
+
+      while (vctIdleClients.size() < uNbIdleConnections) {
+        std::unique_ptr<tacopie::tcp_socket> ptrIdleClient(new tacopie::tcp_socket);
+        ptrIdleClient->connect("127.0.0.1", uPort);
+        vctIdleClients.push_back(std::move(ptrIdleClient));
+      }
+
+      benchmark::wait_until([&] { return server.get_nb_clients() == uNbIdleConnections + 1; });
+      double dConnectSecs = static_cast<double>(benchmark::now_nsecs() - uConnectStartNsecs) / 1e9;
+
+      std::vector<std::uint64_t> vctSamples;
+      vctSamples.reserve(uNbIterations);
+
+      for (std::size_t i = 0; i < uNbIterations; ++i) {
+        std::uint64_t uSendNsecs = benchmark::now_nsecs();
+
+        client.send(vctMessage, vctMessage.size());
+        for (std::size_t uRead = 0; uRead < g_uMessageSize;) { uRead += client.recv(vctReply.data() + uRead, g_uMessageSize - uRead); }
+
+        vctSamples.push_back(benchmark::now_nsecs() - uSendNsecs);
+      }
+
+      std::sort(vctSamples.begin(), vctSamples.end());
+
+      benchmark::result("idle_connections", eBackend, uNbWorkers)
+          .add("idle_connections", static_cast<double>(uNbIdleConnections))
+          .add("connect_secs", dConnectSecs)
+          .add("connects_per_sec", uNbNewConnections ? static_cast<double>(uNbNewConnections) / dConnectSecs : 0.0)
+          .add("p50_usecs", static_cast<double>(benchmark::get_percentile(vctSamples, 50)) / 1e3)
+          .add("p99_usecs", static_cast<double>(benchmark::get_percentile(vctSamples, 99)) / 1e3)
+          .add("p999_usecs", static_cast<double>(benchmark::get_percentile(vctSamples, 99.9)) / 1e3)
+          .print();
+    }
+
+    for (auto& ptrIdleClient : vctIdleClients) { ptrIdleClient->close(); }
+    client.close();
+    server.stop(true);
+  });
+
+  return 0;
+}
@@ -0,0 +1,86 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "benchmark.hpp"
+
+//!
+//! echo server ping-pong latency
+//! a blocking client sends a small message and waits for its echo before sending the next one: each sample is the
+//! round trip through the io_service (poll, dispatch to a worker, read, write)
+//!
+
+static const std::size_t g_uMessageSize = 64;
+
+int
+main(int argc, char** argv) {
+  auto cfg = benchmark::init(argc, argv);
+  std::size_t uNbIterations = cfg.bQuick ? 2000 : 50000;
+
+  benchmark::sweep(cfg, [&](tacopie::poller_backend eBackend, std::size_t uNbWorkers, std::uint32_t uPort) {
+    tacopie::tcp_server server;
+    benchmark::start_echo_server(server, uPort);
+
+    tacopie::tcp_socket client;
+    client.connect("127.0.0.1", uPort);
+
+    std::vector<char> vctMessage(g_uMessageSize, 'x');
+    std::vector<char> vctReply(g_uMessageSize);
+    std::vector<std::uint64_t> vctSamples;
+    vctSamples.reserve(uNbIterations);
+
+    //! warm up
+    for (std::size_t i = 0; i < uNbIterations / 10 + 1; ++i) {
+      client.send(vctMessage, vctMessage.size());
+      for (std::size_t uRead = 0; uRead < g_uMessageSize;) { uRead += client.recv(vctReply.data() + uRead, g_uMessageSize - uRead); }
+    }
+
+    std::uint64_t uStartNsecs = benchmark::now_nsecs();
+
+    for (std::size_t i = 0; i < uNbIterations; ++i) {
+      std::uint64_t uSendNsecs = benchmark::now_nsecs();
+
+      client.send(vctMessage, vctMessage.size());
+      for (std::size_t uRead = 0; uRead < g_uMessageSize;) { uRead += client.recv(vctReply.data() + uRead, g_uMessageSize - uRead); }
+
+      vctSamples.push_back(benchmark::now_nsecs() - uSendNsecs);
+    }
+
+    double dElapsedSecs = static_cast<double>(benchmark::now_nsecs() - uStartNsecs) / 1e9;
+
+    client.close();
+    server.stop(true);
+
+    std::sort(vctSamples.begin(), vctSamples.end());
+
+    benchmark::result("ping_pong", eBackend, uNbWorkers)
+        .add("iterations", static_cast<double>(uNbIterations))
+        .add("message_size", static_cast<double>(g_uMessageSize))
+        .add("round_trips_per_sec", static_cast<double>(uNbIterations) / dElapsedSecs)
+        .add("p50_usecs", static_cast<double>(benchmark::get_percentile(vctSamples, 50)) / 1e3)
+        .add("p99_usecs", static_cast<double>(benchmark::get_percentile(vctSamples, 99)) / 1e3)
+        .add("p999_usecs", static_cast<double>(benchmark::get_percentile(vctSamples, 99.9)) / 1e3)
+        .add("max_usecs", static_cast<double>(vctSamples.back()) / 1e3)
+        .print();
+  });
+
+  return 0;
+}
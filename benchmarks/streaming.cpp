@@ -0,0 +1,89 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "benchmark.hpp"
+
+#include <atomic>
+
+//!
+//! bulk streaming throughput
+//! a tcp_client streams data to a server draining its socket in continuous read mode, keeping a bounded number of
+//! writes in flight
+//!
+
+static const std::size_t g_uChunkSize        = 64 * 1024;
+static const std::size_t g_uNbWritesInFlight = 16;
+
+int
+main(int argc, char** argv) {
+  auto cfg = benchmark::init(argc, argv);
+  std::size_t uTotalBytes = cfg.bQuick ? (64 * 1024 * 1024) : (1024 * 1024 * 1024);
+  std::size_t uNbChunks   = uTotalBytes / g_uChunkSize;
+
+  benchmark::sweep(cfg, [&](tacopie::poller_backend eBackend, std::size_t uNbWorkers, std::uint32_t uPort) {
+    std::atomic<std::size_t> uNbBytesReceived_a(0);
+
+    tacopie::tcp_server server;
+    server.start("127.0.0.1", uPort, [&](const std::shared_ptr<tacopie::tcp_client>& client) -> bool {
+      client->start_continuous_read([&](tacopie::tcp_client::read_result& res) {
+        if (res.success) { uNbBytesReceived_a += res.size; }
+      });
+
+      return false;
+    });
+
+    tacopie::tcp_client client;
+    client.connect("127.0.0.1", uPort);
+
+    auto ptrChunk = std::make_shared<const std::vector<char>>(g_uChunkSize, 'x');
+    std::atomic<std::size_t> uNbChunksSent_a(0);
+
+    std::uint64_t uStartNsecs = benchmark::now_nsecs();
+
+    //! each completed write issues the next one, so that g_uNbWritesInFlight writes stay queued
+    std::function<void(tacopie::tcp_client::write_result&)> callbackWrite = [&](tacopie::tcp_client::write_result& res) {
+      if (!res.success) { return; }
+
+      if (uNbChunksSent_a++ < uNbChunks) { client.async_write({ptrChunk, callbackWrite}); }
+    };
+
+    for (std::size_t i = 0; i < g_uNbWritesInFlight && uNbChunksSent_a++ < uNbChunks; ++i) {
+      client.async_write({ptrChunk, callbackWrite});
+    }
+
+    bool bCompleted = benchmark::wait_until([&] { return uNbBytesReceived_a == uNbChunks * g_uChunkSize; }, 120000);
+    double dElapsedSecs = static_cast<double>(benchmark::now_nsecs() - uStartNsecs) / 1e9;
+
+    client.disconnect(true);
+    server.stop(true);
+
+    benchmark::result("streaming", eBackend, uNbWorkers)
+        .add_flag("completed", bCompleted)
+        .add("bytes", static_cast<double>(uNbBytesReceived_a.load()))
+        .add("chunk_size", static_cast<double>(g_uChunkSize))
+        .add("elapsed_secs", dElapsedSecs)
+        .add("mbytes_per_sec", static_cast<double>(uNbBytesReceived_a.load()) / (1024 * 1024) / dElapsedSecs)
+        .print();
+  });
+
+  return 0;
+}
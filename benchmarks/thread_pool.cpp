@@ -0,0 +1,74 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "benchmark.hpp"
+
+#include <atomic>
+
+//!
+//! thread_pool task dispatch rate
+//! several producers push trivial tasks into a thread_pool: the measure is dominated by the cost of the task queue
+//! (the backend sweep does not apply, only the worker counts are swept)
+//!
+
+static const std::size_t g_uNbProducers = 2;
+
+int
+main(int argc, char** argv) {
+  auto cfg = benchmark::init(argc, argv);
+  std::size_t uNbTasksPerProducer = cfg.bQuick ? 50000 : 1000000;
+  std::size_t uNbTasks            = uNbTasksPerProducer * g_uNbProducers;
+
+  for (auto uNbWorkers : cfg.vctNbWorkers) {
+    tacopie::utils::thread_pool pool(uNbWorkers);
+    std::atomic<std::size_t> uNbExecuted_a(0);
+
+    std::uint64_t uStartNsecs = benchmark::now_nsecs();
+
+    std::vector<std::thread> vctProducers;
+    for (std::size_t i = 0; i < g_uNbProducers; ++i) {
+      vctProducers.push_back(std::thread([&] {
+        for (std::size_t j = 0; j < uNbTasksPerProducer; ++j) {
+          pool.add_task([&] { uNbExecuted_a.fetch_add(1, std::memory_order_relaxed); });
+        }
+      }));
+    }
+
+    for (auto& producer : vctProducers) { producer.join(); }
+    double dSubmitSecs = static_cast<double>(benchmark::now_nsecs() - uStartNsecs) / 1e9;
+
+    bool bCompleted = benchmark::wait_until([&] { return uNbExecuted_a == uNbTasks; }, 120000);
+    double dElapsedSecs = static_cast<double>(benchmark::now_nsecs() - uStartNsecs) / 1e9;
+
+    pool.stop();
+
+    benchmark::result("thread_pool", uNbWorkers)
+        .add_flag("completed", bCompleted)
+        .add("tasks", static_cast<double>(uNbTasks))
+        .add("producers", static_cast<double>(g_uNbProducers))
+        .add("submits_per_sec", static_cast<double>(uNbTasks) / dSubmitSecs)
+        .add("tasks_per_sec", static_cast<double>(uNbExecuted_a.load()) / dElapsedSecs)
+        .print();
+  }
+
+  return 0;
+}
@@ -0,0 +1,798 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+//! optional C++20 interface: only available when coroutines are supported by the compiler (e.g. -std=c++20)
+//! the library itself does not require it
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#define __TACOPIE_HAS_COROUTINES
+#endif /* __cpp_impl_coroutine */
+
+#ifdef __TACOPIE_HAS_COROUTINES
+
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <tacopie/network/io_service.hpp>
+#include <tacopie/network/tcp_client.hpp>
+#include <tacopie/network/tcp_server.hpp>
+#include <tacopie/utils/logger.hpp>
+
+//! smallest size class of the coroutine frame allocator, in bytes (must be a power of 2)
+#ifndef __TACOPIE_CORO_FRAME_MIN_SIZE
+#define __TACOPIE_CORO_FRAME_MIN_SIZE 128
+#endif /* __TACOPIE_CORO_FRAME_MIN_SIZE */
+
+//! number of size classes of the coroutine frame allocator (each class doubles the previous one: 128B to 8KB by default)
+#ifndef __TACOPIE_CORO_FRAME_NB_SIZE_CLASSES
+#define __TACOPIE_CORO_FRAME_NB_SIZE_CLASSES 7
+#endif /* __TACOPIE_CORO_FRAME_NB_SIZE_CLASSES */
+
+//! maximum number of frames kept by each thread cache, per size class
+#ifndef __TACOPIE_CORO_FRAME_CACHE_SIZE
+#define __TACOPIE_CORO_FRAME_CACHE_SIZE 64
+#endif /* __TACOPIE_CORO_FRAME_CACHE_SIZE */
+
+namespace tacopie {
+
+namespace coro {
+
+//!
+//! allocator of coroutine frames
+//!
+//! frames are grouped by power of 2 size. freed frames are kept in a cache local to the freeing thread (no locking)
+//! and reused by the next coroutines of the same size class, so that protocol handlers do not allocate once warmed up.
+//! frames bigger than the biggest size class are not cached.
+//!
+class frame_allocator {
+public:
+  //!
+  //! \param uSize size of the frame
+  //! \return memory for a frame of the given size
+  //!
+  static void*
+  allocate(std::size_t uSize) {
+    std::size_t uSizeClass = get_size_class(uSize);
+
+    if (uSizeClass == __TACOPIE_CORO_FRAME_NB_SIZE_CLASSES) { return ::operator new(uSize); }
+
+    auto& cache = get_thread_cache();
+
+    if (cache.arrFreeFrames[uSizeClass]) {
+      free_frame* pFrame                 = cache.arrFreeFrames[uSizeClass];
+      cache.arrFreeFrames[uSizeClass]    = pFrame->pNext;
+      cache.arrNbFreeFrames[uSizeClass] -= 1;
+      return pFrame;
+    }
+
+    return ::operator new(static_cast<std::size_t>(__TACOPIE_CORO_FRAME_MIN_SIZE) << uSizeClass);
+  }
+
+  //!
+  //! \param pFrame frame previously returned by allocate()
+  //! \param uSize size given to allocate()
+  //!
+  static void
+  deallocate(void* pFrame, std::size_t uSize) {
+    std::size_t uSizeClass = get_size_class(uSize);
+
+    if (uSizeClass == __TACOPIE_CORO_FRAME_NB_SIZE_CLASSES) {
+      ::operator delete(pFrame);
+      return;
+    }
+
+    auto& cache = get_thread_cache();
+
+    if (cache.arrNbFreeFrames[uSizeClass] >= __TACOPIE_CORO_FRAME_CACHE_SIZE) {
+      ::operator delete(pFrame);
+      return;
+    }
+
+    free_frame* pFreeFrame             = static_cast<free_frame*>(pFrame);
+    pFreeFrame->pNext                  = cache.arrFreeFrames[uSizeClass];
+    cache.arrFreeFrames[uSizeClass]    = pFreeFrame;
+    cache.arrNbFreeFrames[uSizeClass] += 1;
+  }
+
+private:
+  //!
+  //! freed frame, linked in the list of its size class
+  //!
+  struct free_frame {
+    free_frame* pNext;
+  };
+
+  //!
+  //! thread cache, frames are freed when the thread exits
+  //!
+  struct thread_cache {
+    free_frame* arrFreeFrames[__TACOPIE_CORO_FRAME_NB_SIZE_CLASSES]   = {};
+    std::size_t arrNbFreeFrames[__TACOPIE_CORO_FRAME_NB_SIZE_CLASSES] = {};
+
+    ~thread_cache(void) {
+      for (auto pFrame : arrFreeFrames) {
+        while (pFrame) {
+          free_frame* pNext = pFrame->pNext;
+          ::operator delete(pFrame);
+          pFrame = pNext;
+        }
+      }
+    }
+  };
+
+  static thread_cache&
+  get_thread_cache(void) {
+    static thread_local thread_cache cache;
+    return cache;
+  }
+
+  //!
+  //! \return smallest size class able to hold uSize bytes, or __TACOPIE_CORO_FRAME_NB_SIZE_CLASSES if too big
+  //!
+  static std::size_t
+  get_size_class(std::size_t uSize) {
+    std::size_t uSizeClass = 0;
+
+    while (uSizeClass < __TACOPIE_CORO_FRAME_NB_SIZE_CLASSES && (static_cast<std::size_t>(__TACOPIE_CORO_FRAME_MIN_SIZE) << uSizeClass) < uSize) {
+      ++uSizeClass;
+    }
+
+    return uSizeClass;
+  }
+};
+
+template <typename T>
+class task;
+
+//!
+//! state shared by the promises of all the tasks
+//!  * hContinuation: coroutine awaiting the task, resumed on completion
+//!  * bDetached: whether the task has been spawned (its frame is then released on completion)
+//!  * ptrException: exception escaping the task, rethrown to the awaiting coroutine
+//!
+class promise_base {
+public:
+  //!
+  //! frames are allocated by the frame_allocator
+  //!
+  static void*
+  operator new(std::size_t uSize) {
+    return frame_allocator::allocate(uSize);
+  }
+
+  static void
+  operator delete(void* pFrame, std::size_t uSize) {
+    frame_allocator::deallocate(pFrame, uSize);
+  }
+
+public:
+  //!
+  //! resumes the awaiting coroutine on completion (symmetric transfer: no stack growth on long chains)
+  //!
+  struct final_awaiter {
+    bool
+    await_ready(void) const noexcept {
+      return false;
+    }
+
+    template <typename Promise>
+    std::coroutine_handle<>
+    await_suspend(std::coroutine_handle<Promise> hCoroutine) noexcept {
+      auto& promise = hCoroutine.promise();
+
+      if (promise.hContinuation) { return promise.hContinuation; }
+      if (promise.bDetached) { hCoroutine.destroy(); }
+
+      return std::noop_coroutine();
+    }
+
+    void
+    await_resume(void) const noexcept {}
+  };
+
+  //!
+  //! tasks are lazy: they start when awaited or spawned
+  //!
+  std::suspend_always
+  initial_suspend(void) const noexcept {
+    return {};
+  }
+
+  final_awaiter
+  final_suspend(void) const noexcept {
+    return {};
+  }
+
+  void
+  unhandled_exception(void) noexcept {
+    //! nobody can catch the exception of a spawned task
+    if (bDetached) {
+      __TACOPIE_LOG(error, "unhandled exception in a spawned coroutine");
+      return;
+    }
+
+    ptrException = std::current_exception();
+  }
+
+public:
+  std::coroutine_handle<> hContinuation;
+  bool                    bDetached = false;
+  std::exception_ptr      ptrException;
+};
+
+//!
+//! promise of task<T>
+//!
+template <typename T>
+class promise : public promise_base {
+public:
+  task<T> get_return_object(void);
+
+  template <typename U>
+  void
+  return_value(U&& value) {
+    optValue.emplace(std::forward<U>(value));
+  }
+
+  T
+  get_result(void) {
+    if (ptrException) { std::rethrow_exception(ptrException); }
+
+    return std::move(*optValue);
+  }
+
+public:
+  std::optional<T> optValue;
+};
+
+template <>
+class promise<void> : public promise_base {
+public:
+  task<void> get_return_object(void);
+
+  void
+  return_void(void) const noexcept {}
+
+  void
+  get_result(void) {
+    if (ptrException) { std::rethrow_exception(ptrException); }
+  }
+};
+
+//!
+//! lazily started coroutine, producing a T
+//!
+//! co_await a task to run it and get its result (exceptions are rethrown to the awaiting coroutine), or spawn() it
+//! to run it in the background. the frame is released with the task, or on completion for spawned tasks.
+//!
+//! \tparam T type of the result
+//!
+template <typename T = void>
+class task {
+public:
+  typedef coro::promise<T> promise_type;
+
+public:
+  //! ctor
+  explicit task(std::coroutine_handle<promise_type> hCoroutine)
+  : m_hCoroutine(hCoroutine) {}
+
+  //! move ctor
+  task(task&& other) noexcept
+  : m_hCoroutine(std::exchange(other.m_hCoroutine, nullptr)) {}
+
+  //! move assignment operator
+  task&
+  operator=(task&& other) noexcept {
+    if (this != &other) {
+      if (m_hCoroutine) { m_hCoroutine.destroy(); }
+      m_hCoroutine = std::exchange(other.m_hCoroutine, nullptr);
+    }
+
+    return *this;
+  }
+
+  //! dtor
+  ~task(void) {
+    if (m_hCoroutine) { m_hCoroutine.destroy(); }
+  }
+
+  //! copy ctor
+  task(const task&) = delete;
+  //! assignment operator
+  task& operator=(const task&) = delete;
+
+public:
+  //!
+  //! awaiter starting the task and resuming the awaiting coroutine once it completes
+  //!
+  struct awaiter {
+    bool
+    await_ready(void) const noexcept {
+      return hCoroutine.done();
+    }
+
+    std::coroutine_handle<>
+    await_suspend(std::coroutine_handle<> hAwaiting) noexcept {
+      hCoroutine.promise().hContinuation = hAwaiting;
+      return hCoroutine;
+    }
+
+    T
+    await_resume(void) {
+      return hCoroutine.promise().get_result();
+    }
+
+    std::coroutine_handle<promise_type> hCoroutine;
+  };
+
+  awaiter
+  operator co_await(void) noexcept {
+    return {m_hCoroutine};
+  }
+
+  //!
+  //! give up the ownership of the coroutine
+  //!
+  //! \return the coroutine handle
+  //!
+  std::coroutine_handle<promise_type>
+  release(void) noexcept {
+    return std::exchange(m_hCoroutine, nullptr);
+  }
+
+private:
+  //!
+  //! coroutine handle
+  //!
+  std::coroutine_handle<promise_type> m_hCoroutine;
+};
+
+template <typename T>
+task<T>
+promise<T>::get_return_object(void) {
+  return task<T>(std::coroutine_handle<promise<T>>::from_promise(*this));
+}
+
+inline task<void>
+promise<void>::get_return_object(void) {
+  return task<void>(std::coroutine_handle<promise<void>>::from_promise(*this));
+}
+
+//!
+//! start a task in the background, its result is discarded and its frame released on completion
+//! the task runs on the calling thread until its first suspension
+//!
+//! \param t task to be started
+//!
+template <typename T>
+void
+spawn(task<T> t) {
+  auto hCoroutine = t.release();
+
+  hCoroutine.promise().bDetached = true;
+  hCoroutine.resume();
+}
+
+//!
+//! awaitables
+//!
+//! coroutines awaiting an I/O operation are resumed from its completion callback, on the thread executing the
+//! callbacks of the client (the reactor thread in io_service::callback_execution_mode::reactor_thread, directly
+//! from the poll loop). a tcp_client must stay alive while an operation on it is being awaited.
+//!
+//! as with callbacks, a coroutine resumed by an operation of a client must not destroy that client (nor disconnect it
+//! waiting for its removal) before leaving the callback context: keep the clients owned outside of such coroutines
+//! (e.g. by the tcp_server), or co_await sleep_for() first.
+//!
+
+//!
+//! awaitable read, returns the tcp_client::read_result
+//!
+class read_awaitable {
+public:
+  //! ctor
+  read_awaitable(tcp_client& client, std::size_t uSize, char* pBuffer)
+  : m_client(client)
+  , m_uSize(uSize)
+  , m_pBuffer(pBuffer) {}
+
+public:
+  bool
+  await_ready(void) const noexcept {
+    return false;
+  }
+
+  void
+  await_suspend(std::coroutine_handle<> hAwaiting) {
+    //! the coroutine might be resumed before async_read returns: nothing must be touched afterwards
+    m_client.async_read({m_uSize, [this, hAwaiting](tcp_client::read_result& result) {
+                           m_result = std::move(result);
+                           hAwaiting.resume();
+                         },
+        m_pBuffer});
+  }
+
+  tcp_client::read_result
+  await_resume(void) {
+    return std::move(m_result);
+  }
+
+private:
+  tcp_client&             m_client;
+  std::size_t             m_uSize;
+  char*                   m_pBuffer;
+  tcp_client::read_result m_result;
+};
+
+//!
+//! awaitable write, returns the tcp_client::write_result
+//!
+class write_awaitable {
+public:
+  //! ctor
+  write_awaitable(tcp_client& client, tcp_client::write_request&& request)
+  : m_client(client)
+  , m_request(std::move(request)) {}
+
+public:
+  bool
+  await_ready(void) const noexcept {
+    return false;
+  }
+
+  void
+  await_suspend(std::coroutine_handle<> hAwaiting) {
+    m_request.callbackAsyncWrite = [this, hAwaiting](tcp_client::write_result& result) {
+      m_result = result;
+      hAwaiting.resume();
+    };
+
+    //! the coroutine might be resumed before async_write returns: nothing must be touched afterwards
+    m_client.async_write(std::move(m_request));
+  }
+
+  tcp_client::write_result
+  await_resume(void) const noexcept {
+    return m_result;
+  }
+
+private:
+  tcp_client&               m_client;
+  tcp_client::write_request m_request;
+  tcp_client::write_result  m_result = {false, 0};
+};
+
+//!
+//! awaitable connection, returns whether the connection succeeded
+//!
+class connect_awaitable {
+public:
+  //! ctor
+  connect_awaitable(tcp_client& client, const std::string& sHost, std::uint32_t uPort, std::uint32_t uTimeoutMsecs)
+  : m_client(client)
+  , m_sHost(sHost)
+  , m_uPort(uPort)
+  , m_uTimeoutMsecs(uTimeoutMsecs) {}
+
+public:
+  bool
+  await_ready(void) const noexcept {
+    return false;
+  }
+
+  void
+  await_suspend(std::coroutine_handle<> hAwaiting) {
+    m_client.async_connect(m_sHost, m_uPort, m_uTimeoutMsecs, [this, hAwaiting](bool bConnected) {
+      m_bConnected = bConnected;
+      hAwaiting.resume();
+    });
+  }
+
+  bool
+  await_resume(void) const noexcept {
+    return m_bConnected;
+  }
+
+private:
+  tcp_client&   m_client;
+  std::string   m_sHost;
+  std::uint32_t m_uPort;
+  std::uint32_t m_uTimeoutMsecs;
+  bool          m_bConnected = false;
+};
+
+//!
+//! awaitable delay, resumed by an io_service timer (on the io_service workers, outside of any client callback)
+//!
+class sleep_awaitable {
+public:
+  //! ctor
+  sleep_awaitable(io_service& service, std::chrono::milliseconds delay)
+  : m_service(service)
+  , m_delay(delay) {}
+
+public:
+  bool
+  await_ready(void) const noexcept {
+    return false;
+  }
+
+  void
+  await_suspend(std::coroutine_handle<> hAwaiting) {
+    m_service.schedule_after(m_delay, [hAwaiting] { hAwaiting.resume(); });
+  }
+
+  void
+  await_resume(void) const noexcept {}
+
+private:
+  io_service&               m_service;
+  std::chrono::milliseconds m_delay;
+};
+
+//!
+//! \param client client to read from
+//! \param uSize maximum number of bytes to read
+//! \param pBuffer caller-supplied buffer of at least uSize bytes (optional, see tcp_client::read_request)
+//! \return awaitable returning the tcp_client::read_result
+//!
+inline read_awaitable
+async_read(tcp_client& client, std::size_t uSize, char* pBuffer = nullptr) {
+  return {client, uSize, pBuffer};
+}
+
+//!
+//! \param client client to write to
+//! \param vctBuffer bytes to be written
+//! \return awaitable returning the tcp_client::write_result
+//!
+inline write_awaitable
+async_write(tcp_client& client, std::vector<char> vctBuffer) {
+  return {client, tcp_client::write_request(std::move(vctBuffer))};
+}
+
+//!
+//! \param client client to write to
+//! \param ptrBuffer ref-counted bytes to be written
+//! \return awaitable returning the tcp_client::write_result
+//!
+inline write_awaitable
+async_write(tcp_client& client, const tcp_client::shared_buffer_t& ptrBuffer) {
+  return {client, tcp_client::write_request(ptrBuffer)};
+}
+
+//!
+//! \param client client to write to
+//! \param pBuffer caller-owned bytes to be written, valid until the write completes
+//! \param uSize number of bytes to be written
+//! \return awaitable returning the tcp_client::write_result
+//!
+inline write_awaitable
+async_write(tcp_client& client, const char* pBuffer, std::size_t uSize) {
+  return {client, tcp_client::write_request(pBuffer, uSize)};
+}
+
+//!
+//! \param client client to be connected
+//! \param sHost host of the remote server
+//! \param uPort port of the remote server
+//! \param uTimeoutMsecs maximum time to connect, 0 for no timeout
+//! \return awaitable returning whether the connection succeeded
+//!
+inline connect_awaitable
+async_connect(tcp_client& client, const std::string& sHost, std::uint32_t uPort, std::uint32_t uTimeoutMsecs = 0) {
+  return {client, sHost, uPort, uTimeoutMsecs};
+}
+
+//!
+//! \param service io_service whose timers resume the coroutine
+//! \param delay time to wait (0 to simply resume the coroutine on the io_service workers)
+//! \return awaitable resuming the coroutine once the delay elapsed
+//!
+inline sleep_awaitable
+sleep_for(io_service& service, std::chrono::milliseconds delay) {
+  return {service, delay};
+}
+
+//!
+//! queue of the connections of a tcp_server, accepted by awaiting accept()
+//!
+//! connections are queued until accepted (and kept by the tcp_server, as if the connection callback returned false).
+//! closing the acceptor resumes the pending accept() with a null client.
+//!
+class acceptor {
+public:
+  //! ctor
+  acceptor(void)
+  : m_ptrState(std::make_shared<state>()) {}
+
+  //! dtor
+  ~acceptor(void) {
+    close();
+  }
+
+  //! copy ctor
+  acceptor(const acceptor&) = delete;
+  //! assignment operator
+  acceptor& operator=(const acceptor&) = delete;
+
+private:
+  class accept_awaitable;
+
+  //!
+  //! state shared with the connection callback of the server
+  //!  * mtxState: state thread safety
+  //!  * dqClients: connections not accepted yet
+  //!  * dqWaiters: accept() being awaited
+  //!  * bClosed: whether the acceptor has been closed
+  //!
+  struct state {
+    std::mutex                              mtxState;
+    std::deque<std::shared_ptr<tcp_client>> dqClients;
+    std::deque<accept_awaitable*>           dqWaiters;
+    bool                                    bClosed = false;
+  };
+
+  //!
+  //! awaitable accept, returns the new client (null once the acceptor is closed)
+  //!
+  class accept_awaitable {
+  public:
+    //! ctor
+    explicit accept_awaitable(const std::shared_ptr<state>& ptrState)
+    : m_ptrState(ptrState) {}
+
+  public:
+    bool
+    await_ready(void) const noexcept {
+      return false;
+    }
+
+    bool
+    await_suspend(std::coroutine_handle<> hAwaiting) {
+      std::lock_guard<std::mutex> lock(m_ptrState->mtxState);
+
+      //! a connection is already queued: do not suspend
+      if (!m_ptrState->dqClients.empty()) {
+        m_ptrClient = std::move(m_ptrState->dqClients.front());
+        m_ptrState->dqClients.pop_front();
+        return false;
+      }
+
+      if (m_ptrState->bClosed) { return false; }
+
+      m_hAwaiting = hAwaiting;
+      m_ptrState->dqWaiters.push_back(this);
+
+      return true;
+    }
+
+    std::shared_ptr<tcp_client>
+    await_resume(void) noexcept {
+      return std::move(m_ptrClient);
+    }
+
+  private:
+    friend class acceptor;
+
+    std::shared_ptr<state>      m_ptrState;
+    std::shared_ptr<tcp_client> m_ptrClient;
+    std::coroutine_handle<>     m_hAwaiting;
+  };
+
+public:
+  //!
+  //! start the server, its new connections being queued by this acceptor
+  //!
+  //! \param server server to be started
+  //! \param sHost host to listen on
+  //! \param uPort port to listen on
+  //!
+  void
+  start(tcp_server& server, const std::string& sHost, std::uint32_t uPort) {
+    std::shared_ptr<state> ptrState = m_ptrState;
+
+    server.start(sHost, uPort, [ptrState](const std::shared_ptr<tcp_client>& client) {
+      push_client(*ptrState, client);
+      return false;
+    });
+  }
+
+  //!
+  //! \return awaitable returning the next connection (null once the acceptor is closed)
+  //!
+  accept_awaitable
+  accept(void) {
+    return accept_awaitable(m_ptrState);
+  }
+
+  //!
+  //! stop accepting: pending accept() are resumed with a null client and queued connections are dropped
+  //! (they stay owned by the server)
+  //!
+  void
+  close(void) {
+    std::deque<accept_awaitable*> dqWaiters;
+
+    {
+      std::lock_guard<std::mutex> lock(m_ptrState->mtxState);
+
+      m_ptrState->bClosed = true;
+      m_ptrState->dqClients.clear();
+      dqWaiters.swap(m_ptrState->dqWaiters);
+    }
+
+    for (auto pWaiter : dqWaiters) { pWaiter->m_hAwaiting.resume(); }
+  }
+
+private:
+  //!
+  //! hand a new connection to the first pending accept(), or queue it
+  //!
+  static void
+  push_client(state& s, const std::shared_ptr<tcp_client>& client) {
+    accept_awaitable* pWaiter = nullptr;
+
+    {
+      std::lock_guard<std::mutex> lock(s.mtxState);
+
+      if (s.bClosed) { return; }
+
+      if (s.dqWaiters.empty()) {
+        s.dqClients.push_back(client);
+        return;
+      }
+
+      pWaiter = s.dqWaiters.front();
+      s.dqWaiters.pop_front();
+    }
+
+    //! resumed without the lock held: the coroutine typically accepts again right away
+    pWaiter->m_ptrClient = client;
+    pWaiter->m_hAwaiting.resume();
+  }
+
+private:
+  //!
+  //! state shared with the connection callback of the server
+  //!
+  std::shared_ptr<state> m_ptrState;
+};
+
+} // namespace coro
+
+} // namespace tacopie
+
+#endif /* __TACOPIE_HAS_COROUTINES */
@@ -0,0 +1,218 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//! default maximum size of a frame, frames announcing or reaching a bigger size are rejected
+#ifndef __TACOPIE_FRAME_CODEC_MAX_FRAME_SIZE
+#define __TACOPIE_FRAME_CODEC_MAX_FRAME_SIZE (16 * 1024 * 1024)
+#endif /* __TACOPIE_FRAME_CODEC_MAX_FRAME_SIZE */
+
+namespace tacopie {
+
+//!
+//! streaming message framing: splits a byte stream into frames and builds the frames to be sent
+//!
+//! supported framings:
+//!  * length_prefix: each frame is preceded by its size, as a big endian integer of 1, 2, 4 or 8 bytes
+//!  * varint_prefix: each frame is preceded by its size, as a LEB128 varint (as used by protobuf)
+//!  * delimiter: each frame is followed by a delimiter (such as "\r\n"), which must not appear in frames
+//!
+//! received bytes are written directly in the receive buffer of the codec (see prepare() and commit()), and decode()
+//! returns views on all the complete frames of the buffer: frames are never copied. the receive buffer is only
+//! compacted when it runs out of space, in which case the bytes of the incomplete frame (if any) are moved to its
+//! beginning. delimiters are searched with SSE2 when available, and bytes are only scanned once.
+//!
+//! this class is not thread-safe.
+//!
+class frame_codec {
+public:
+  //!
+  //! framing used by the codec
+  //!
+  enum class framing {
+    length_prefix,
+    varint_prefix,
+    delimiter
+  };
+
+  //!
+  //! decoded frame: view on the receive buffer of the codec
+  //! valid until consume() or prepare() is called
+  //!
+  struct frame {
+    //!
+    //! frame payload (header or delimiter excluded)
+    //!
+    const char* data;
+    //!
+    //! payload size
+    //!
+    std::size_t size;
+  };
+
+public:
+  //!
+  //! \param uHeaderSize size of the big endian length header: 1, 2, 4 or 8 bytes
+  //! \param uMaxFrameSize maximum payload size
+  //! \return codec for length prefixed frames
+  //!
+  static frame_codec length_prefixed(std::size_t uHeaderSize, std::size_t uMaxFrameSize = __TACOPIE_FRAME_CODEC_MAX_FRAME_SIZE);
+
+  //!
+  //! \param uMaxFrameSize maximum payload size
+  //! \return codec for varint length prefixed frames
+  //!
+  static frame_codec varint_prefixed(std::size_t uMaxFrameSize = __TACOPIE_FRAME_CODEC_MAX_FRAME_SIZE);
+
+  //!
+  //! \param sDelimiter delimiter following each frame (must not be empty)
+  //! \param uMaxFrameSize maximum payload size
+  //! \return codec for delimited frames
+  //!
+  static frame_codec delimited(const std::string& sDelimiter, std::size_t uMaxFrameSize = __TACOPIE_FRAME_CODEC_MAX_FRAME_SIZE);
+
+public:
+  //! dtor
+  ~frame_codec(void);
+
+  //! copy ctor
+  frame_codec(const frame_codec&) = default;
+  //! move ctor
+  frame_codec(frame_codec&&) = default;
+  //! assignment operator
+  frame_codec& operator=(const frame_codec&) = default;
+  //! move assignment operator
+  frame_codec& operator=(frame_codec&&) = default;
+
+public:
+  //!
+  //! reserve space at the end of the receive buffer (compacting or growing it if necessary)
+  //! invalidates the frames returned by decode()
+  //!
+  //! \param uSize minimum number of bytes to be reserved
+  //! \return pointer to the reserved space, get_writable_size() bytes can be written there
+  //!
+  char* prepare(std::size_t uSize);
+
+  //!
+  //! \return the number of bytes that can be written at the pointer returned by prepare()
+  //!
+  std::size_t get_writable_size(void) const;
+
+  //!
+  //! append bytes written in the space returned by prepare() to the received bytes
+  //!
+  //! \param uSize number of bytes written (at most get_writable_size())
+  //!
+  void commit(std::size_t uSize);
+
+  //!
+  //! copy received bytes into the receive buffer (prepare(), copy and commit())
+  //!
+  //! \param pData received bytes
+  //! \param uSize number of received bytes
+  //!
+  void feed(const char* pData, std::size_t uSize);
+
+  //!
+  //! decode all the complete frames of the received bytes that have not been decoded yet
+  //!
+  //! \param vctFrames vector the complete frames are appended to
+  //! \return false if the stream is invalid (frame too big or malformed varint): the codec must not be used anymore
+  //!
+  bool decode(std::vector<frame>& vctFrames);
+
+  //!
+  //! release the decoded frames, invalidating them
+  //!
+  void consume(void);
+
+  //!
+  //! \return the number of received bytes that have not been consumed yet
+  //!
+  std::size_t get_buffered_size(void) const;
+
+public:
+  //!
+  //! build a frame: append the header (or the delimiter) and the payload to the given buffer
+  //!
+  //! \param pData payload
+  //! \param uSize payload size
+  //! \param vctBuffer buffer the frame is appended to
+  //!
+  void encode(const char* pData, std::size_t uSize, std::vector<char>& vctBuffer) const;
+
+  //!
+  //! \return the framing used by this codec
+  //!
+  framing get_framing(void) const;
+
+private:
+  //! ctor
+  frame_codec(framing eFraming, std::size_t uHeaderSize, const std::string& sDelimiter, std::size_t uMaxFrameSize);
+
+private:
+  //!
+  //! decode the next frame of the received bytes
+  //!
+  //! \param vctFrames vector the frame is appended to
+  //! \param bValid set to false if the stream is invalid
+  //! \return whether a frame has been decoded
+  //!
+  bool decode_length_prefixed(std::vector<frame>& vctFrames, bool& bValid);
+  bool decode_varint_prefixed(std::vector<frame>& vctFrames, bool& bValid);
+  bool decode_delimited(std::vector<frame>& vctFrames, bool& bValid);
+
+private:
+  //!
+  //! framing settings
+  //!
+  framing           m_eFraming;
+  std::size_t       m_uHeaderSize;
+  std::string       m_sDelimiter;
+  std::size_t       m_uMaxFrameSize;
+
+  //!
+  //! receive buffer (taken from the utils::buffer_pool)
+  //!
+  std::vector<char> m_vctBuffer;
+
+  //!
+  //! offsets in the receive buffer:
+  //!  * consumed: end of the consumed bytes
+  //!  * decoded: end of the decoded frames
+  //!  * scanned: position from which the next delimiter is searched (delimiter framing)
+  //!  * received: end of the received bytes
+  //!
+  std::size_t       m_uConsumedOffset = 0;
+  std::size_t       m_uDecodedOffset  = 0;
+  std::size_t       m_uScannedOffset  = 0;
+  std::size_t       m_uReceivedOffset = 0;
+};
+
+} // namespace tacopie
@@ -23,40 +23,60 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <thread>
 #include <unordered_map>
 #include <vector>
 
-#ifdef _WIN32
-#include <winsock2.h>
-#else
-#include <sys/select.h>
-#endif /* _WIN32 */
-
+#include <tacopie/network/poller.hpp>
 #include <tacopie/network/self_pipe.hpp>
 #include <tacopie/network/tcp_socket.hpp>
+#include <tacopie/utils/fd_table.hpp>
+#include <tacopie/utils/inplace_function.hpp>
+#include <tacopie/utils/metrics.hpp>
 #include <tacopie/utils/thread_pool.hpp>
+#include <tacopie/utils/timer_wheel.hpp>
 
 #ifndef __TACOPIE_IO_SERVICE_NB_WORKERS
 #define __TACOPIE_IO_SERVICE_NB_WORKERS 1
 #endif /* __TACOPIE_IO_SERVICE_NB_WORKERS */
 
+#ifndef __TACOPIE_IO_SERVICE_NB_REACTORS
+#define __TACOPIE_IO_SERVICE_NB_REACTORS 1
+#endif /* __TACOPIE_IO_SERVICE_NB_REACTORS */
+
+//! number of mutexes protecting the tracked sockets of a reactor (sockets are spread across them by fd)
+//! prime by default so that windows handles, which are multiples of 4, are evenly spread too
+#ifndef __TACOPIE_IO_SERVICE_NB_SOCKET_LOCKS
+#define __TACOPIE_IO_SERVICE_NB_SOCKET_LOCKS 67
+#endif /* __TACOPIE_IO_SERVICE_NB_SOCKET_LOCKS */
+
 namespace tacopie {
 
 //!
 //! service that operates IO Handling.
 //! It polls sockets for input and output, processes read and write operations and calls the appropriate callbacks.
 //!
+//! The io_service runs one or more reactors: each reactor has its own poll thread, poller, self pipe and table of
+//! tracked sockets. Sockets are assigned to a reactor when they get tracked, and stay on it until untracked.
+//! Callbacks of all reactors are executed by the same pool of workers.
+//!
 class io_service {
 public:
   //!
   //! ctor
   //!
-  io_service(void);
+  //! \param eBackend polling backend to be used (defaults to the best one available on the current platform)
+  //! \param uNbReactors number of reactors (poll threads) to run, sockets are sharded across them
+  //!
+  explicit io_service(poller_backend eBackend = poller_backend::automatic,
+      std::size_t uNbReactors = __TACOPIE_IO_SERVICE_NB_REACTORS);
 
   //! dtor
   ~io_service(void);
@@ -76,10 +96,124 @@ public:
   //!
   void set_nb_workers(std::size_t nb_threads);
 
+  //!
+  //! \return the polling backend used by this io_service
+  //!
+  poller_backend get_poller_backend(void) const;
+
+public:
+  //!
+  //! policies used to pick the reactor in charge of a newly tracked socket
+  //!  * round_robin: reactors are picked one after the other
+  //!  * least_load: the reactor currently tracking the fewest sockets is picked
+  //!  * incoming_cpu: the reactor pinned to the CPU that processed the last packet received by the socket
+  //! (SO_INCOMING_CPU, linux only) is picked, which aligns reactors with the NIC receive queues when their IRQs are
+  //! pinned to the same CPUs. falls back to round_robin when no reactor is pinned to that CPU (or when unsupported)
+  //!
+  enum class reactor_assignment_policy {
+    round_robin,
+    least_load,
+    incoming_cpu
+  };
+
+  //!
+  //! \return the number of reactors (poll threads) run by this io_service
+  //!
+  std::size_t get_nb_reactors(void) const;
+
+  //!
+  //! \return whether the calling thread is one of the poll threads or workers of this io_service (callbacks and timers
+  //! are executed by them: blocking there until another callback completes may deadlock)
+  //!
+  bool is_service_thread(void) const;
+
+  //!
+  //! set the policy used to assign newly tracked sockets to a reactor
+  //! sockets already tracked stay on their current reactor
+  //!
+  //! \param ePolicy assignment policy
+  //!
+  void set_reactor_assignment_policy(reactor_assignment_policy ePolicy);
+
+public:
+  //!
+  //! pin the poll thread of a reactor to a set of CPUs
+  //! this can be safely called at runtime: the poll thread is woken up and pins itself.
+  //! once pinned, the poll thread reallocates the event buffers of its reactor so that they are placed on the NUMA
+  //! node of these CPUs (first-touch placement)
+  //!
+  //! \param uReactorIndex index of the reactor (between 0 and get_nb_reactors() - 1)
+  //! \param vctCpus indexes of the CPUs the poll thread is allowed to run on, empty to allow all the CPUs of the process
+  //!
+  void set_reactor_cpu_affinity(std::size_t uReactorIndex, const std::vector<std::size_t>& vctCpus);
+
+  //!
+  //! pin the io_service workers to a set of CPUs
+  //! this can be safely called at runtime: workers apply it in the background (once their current callback completes)
+  //!
+  //! \param vctCpus indexes of the CPUs the workers are allowed to run on, empty to allow all the CPUs of the process
+  //!
+  void set_worker_cpu_affinity(const std::vector<std::size_t>& vctCpus);
+
+  //!
+  //! name the threads of this io_service, for debuggers and profilers (names are truncated to 15 characters on linux)
+  //! poll threads are named "<sName>-io-<reactor index>" and workers "<sName>-wk-<worker index>"
+  //! threads are named "tacopie-*" by default
+  //!
+  //! \param sName name prefix of the threads
+  //!
+  void set_thread_name(const std::string& sName);
+
+public:
+  //!
+  //! structure to store metrics snapshots
+  //!  * time: when the snapshot has been taken, to compute rates (such as the accept rate) between two snapshots
+  //!  * process_metrics: counters and histograms of the whole process (see utils::metrics), empty unless the library
+  //! has been built with __TACOPIE_METRICS_ENABLED
+  //!  * nb_tracked_sockets: number of sockets tracked by the reactors of this io_service
+  //!  * nb_pending_tasks: number of callbacks waiting for an io_service worker (thread pool queue depth)
+  //!  * nb_pending_timers: number of scheduled timers
+  //!
+  struct metrics_snapshot {
+    //!
+    //! when the snapshot has been taken
+    //!
+    std::chrono::steady_clock::time_point time;
+    //!
+    //! metrics of the whole process
+    //!
+    utils::metrics::snapshot              process_metrics;
+    //!
+    //! number of tracked sockets
+    //!
+    std::size_t                           nb_tracked_sockets;
+    //!
+    //! number of callbacks waiting for a worker
+    //!
+    std::size_t                           nb_pending_tasks;
+    //!
+    //! number of scheduled timers
+    //!
+    std::size_t                           nb_pending_timers;
+  };
+
+  //!
+  //! take a snapshot of the metrics
+  //! cheap enough to be called periodically (it does not stop the reactors)
+  //!
+  //! \return the current metrics
+  //!
+  metrics_snapshot get_metrics(void);
+
 public:
   //! callback handler typedef
   //! called on new socket event if register to io_service
-  typedef std::function<void(fd_t)> event_callback_t;
+  //! stored in place (no allocation) and never copied: dispatching an event does not allocate
+  typedef utils::inplace_function<void(fd_t)> event_callback_t;
+
+  //! removal callback typedef
+  //! called once a socket has been effectively removed from tracking
+  typedef utils::inplace_function<void(void)> removal_callback_t;
 
   //!
   //! track socket
@@ -90,8 +224,7 @@ public:
   //! \param rd_callback callback to be executed on read event
   //! \param wr_callback callback to be executed on write event
   //!
-  void track(const tcp_socket& socket, const event_callback_t& rd_callback = nullptr,
-      const event_callback_t& wr_callback = nullptr);
+  void track(const tcp_socket& socket, event_callback_t rd_callback = nullptr, event_callback_t wr_callback = nullptr);
 
   //!
   //! update the read callback
@@ -100,7 +233,7 @@ public:
   //! \param socket socket to be tracked
   //! \param event_callback callback to be executed on read event
   //!
-  void set_rd_callback(const tcp_socket& socket, const event_callback_t& event_callback);
+  void set_rd_callback(const tcp_socket& socket, event_callback_t event_callback);
 
   //!
   //! update the write callback
@@ -109,7 +242,7 @@ public:
   //! \param socket socket to be tracked
   //! \param event_callback callback to be executed on write event
   //!
-  void set_wr_callback(const tcp_socket& socket, const event_callback_t& event_callback);
+  void set_wr_callback(const tcp_socket& socket, event_callback_t event_callback);
 
   //!
   //! remove socket from io_service tracking
@@ -123,25 +256,196 @@ public:
   //!
   void untrack(const tcp_socket& socket);
 
+  //!
+  //! remove socket from io_service tracking, and get notified once it has been effectively removed
+  //! the removal callback is executed by the thread removing the socket, without any lock held: immediately by the
+  //! calling thread if no callback is being executed for that socket, by the thread completing the last one otherwise
+  //! it is executed immediately as well if the socket is not tracked
+  //!
+  //! if the socket is tracked again before being removed, the removal callback is kept until it is eventually removed
+  //!
+  //! \param socket socket to be untracked
+  //! \param removal_callback callback to be executed once the socket has been removed
+  //!
+  void untrack(const tcp_socket& socket, removal_callback_t removal_callback);
+
   //!
   //! wait until the socket has been effectively removed
   //! basically wait until all pending callbacks are executed
+  //! only the calling thread is woken up on removal
   //!
   //! \param socket socket to wait for
   //!
   void wait_for_removal(const tcp_socket& socket);
 
+public:
+  //!
+  //! socket to be untracked by a batch untrack
+  //!  * socket: socket to be untracked
+  //!  * removal_callback: callback to be executed once the socket has been removed (may be empty)
+  //!
+  struct untrack_request {
+    //!
+    //! socket to be untracked
+    //!
+    const tcp_socket*  socket;
+    //!
+    //! callback to be executed once the socket has been removed
+    //!
+    removal_callback_t removal_callback;
+  };
+
+  //!
+  //! remove many sockets from io_service tracking at once, each of them as untrack would
+  //! sockets are grouped by reactor and by socket mutex: each mutex is locked once and each reactor is woken up once
+  //! for the whole batch, instead of once per socket
+  //!
+  //! \param vctRequests sockets to be untracked and their removal callbacks
+  //!
+  void untrack(std::vector<untrack_request>&& vctRequests);
+
+  //!
+  //! wait until many sockets have been effectively removed, behind a single barrier
+  //! sockets are grouped as for the batch untrack
+  //!
+  //! \param vctSockets sockets to wait for
+  //!
+  void wait_for_removal(const std::vector<const tcp_socket*>& vctSockets);
+
+public:
+  //!
+  //! where the read and write callbacks of a socket are executed
+  //!  * worker_pool: callbacks are dispatched to the pool of io_service workers
+  //!  * reactor_thread: callbacks are executed directly by the poll thread of the reactor tracking the socket
+  //!
+  //! reactor_thread avoids the hand-off to the workers and the re-arm of the socket in the poller after every event,
+  //! which makes it suitable for short, latency-sensitive handlers.
+  //! Such handlers must not block: they delay every other socket of the reactor.
+  //! Blocking until a socket is removed (wait_for_removal, disconnect(true)) from them deadlocks.
+  //!
+  enum class callback_execution_mode {
+    worker_pool,
+    reactor_thread
+  };
+
+  //!
+  //! set the callback execution mode applied to sockets tracked from now on
+  //! sockets already tracked keep their current mode
+  //!
+  //! \param eMode callback execution mode
+  //!
+  void set_callback_execution_mode(callback_execution_mode eMode);
+
+  //!
+  //! set the callback execution mode of a tracked socket
+  //! if socket is not tracked yet, track it
+  //! the mode is reset to the io_service default whenever the socket is tracked again with track()
+  //!
+  //! \param socket socket to be updated
+  //! \param eMode callback execution mode
+  //!
+  void set_callback_execution_mode(const tcp_socket& socket, callback_execution_mode eMode);
+
+public:
+  //!
+  //! \return whether the poller of this io_service can receive the data of the sockets by itself (completion based
+  //! receive, io_uring backend only)
+  //!
+  bool supports_recv_completions(void) const;
+
+  //!
+  //! enable or disable the completion based receive of a tracked socket
+  //! once enabled, the read callback is executed once the poller received data for the socket, which is then taken
+  //! with take_received() instead of being read from the socket: the receives of all the sockets of a reactor are
+  //! submitted at once, and reading does not issue any system call
+  //! nothing is done if the socket is not tracked, or if completion based receive is not supported
+  //!
+  //! \param socket socket to be updated
+  //! \param bEnabled whether the poller must receive the data of the socket
+  //! \param uBufferSize maximum number of bytes received at once
+  //!
+  void set_recv_completions(const tcp_socket& socket, bool bEnabled, std::size_t uBufferSize = 0);
+
+  //!
+  //! take the bytes received by the poller for a socket
+  //! must be tried before reading the socket once completion based receive has been enabled for it: the bytes
+  //! received before it got disabled are still taken from here
+  //! meant to be called from the read callback of the socket (the receive is re-armed once the callback completed)
+  //! throws a tacopie_error once all the bytes have been taken if the stream ended (as tcp_socket::recv would)
+  //!
+  //! \param socket socket to be read
+  //! \param pBuffer buffer to be filled
+  //! \param uSizeToRead size of the buffer
+  //! \param uReadSize number of bytes copied into the buffer (0 while a receive is in flight)
+  //! \return false if the socket must be read directly
+  //!
+  bool take_received(const tcp_socket& socket, char* pBuffer, std::size_t uSizeToRead, std::size_t& uReadSize);
+
+public:
+  //!
+  //! timer callback typedef
+  //!
+  typedef std::function<void()> timer_callback_t;
+
+  //!
+  //! handle of a scheduled timer, used to cancel it
+  //! 0 is never used as a handle and can be used as an invalid value
+  //!
+  typedef utils::timer_wheel::handle_t timer_id_t;
+
+  //!
+  //! schedule a callback to be executed once after the given delay
+  //! timers are kept in a hierarchical timer wheel driven by the first reactor: the nearest deadline drives its poll
+  //! timeout, no extra thread is involved. timers have a resolution of 1 millisecond.
+  //! callbacks are executed by the pool of io_service workers
+  //!
+  //! \param delay delay after which the callback is executed
+  //! \param callback callback to be executed
+  //! \return handle of the timer
+  //!
+  timer_id_t schedule_after(std::chrono::milliseconds delay, const timer_callback_t& callback);
+
+  //!
+  //! schedule a callback to be executed periodically, until the timer is cancelled
+  //! an expiry is skipped if the previous execution of the callback has not completed yet
+  //!
+  //! \param period delay between two executions of the callback (the first one happens after one period)
+  //! \param callback callback to be executed
+  //! \return handle of the timer
+  //!
+  timer_id_t schedule_every(std::chrono::milliseconds period, const timer_callback_t& callback);
+
+  //!
+  //! cancel a scheduled timer
+  //! a timer that expired but whose callback has not started yet is cancelled as well
+  //!
+  //! \param id handle of the timer to cancel
+  //! \param bWaitForCompletion when the callback of the timer is being executed by another thread, wait until it has
+  //! completed (ignored when called from the callback itself)
+  //! \return true if the timer was still pending (its callback will not be executed anymore), false otherwise
+  //!
+  bool cancel_timer(timer_id_t id, bool bWaitForCompletion = false);
+
 private:
   //!
   //! struct tracked_socket
   //! contains information about what a current socket is tracking
+  //!  * flags: state of the socket, packed in a single atomic word
+  //!    * executing_rd_callback: whether the rd callback is currently being executed or not
+  //!    * executing_wr_callback: whether the wr callback is currently being executed or not
+  //!    * marked_for_untrack: whether the socket is marked for being untrack
+  //!    (that is, will be untracked whenever all the callback completed their execution)
   //!  * rd_callback: callback to be executed on read availability
-  //!  * is_executing_rd_callback: whether the rd callback is currently being executed or not
+  //!  * pending_rd_callback: callback set while the rd callback was being executed, installed once it completes
   //!  * wr_callback: callback to be executed on write availability
-  //!  * is_executing_wr_callback: whether the wr callback is currently being executed or not
-  //!  * marked_for_untrack: whether the socket is marked for being untrack
-  //! (that is, will be untracked whenever all the callback completed their execution)
+  //!  * pending_wr_callback: callback set while the wr callback was being executed, installed once it completes
+  //!  * polled_events: events currently registered in the poller for that socket
+  //!  * callback_execution_mode: where the callbacks are executed
+  //!  * removal_callbacks: callbacks to be executed once the socket has been removed
   //!
+  //! callbacks are executed in place, without the socket lock: a callback being executed is never replaced or
+  //! destroyed, the replacement is kept pending until the execution completes.
+  //! flags are only modified with the socket lock held, but can be checked without it.
   //!
   struct tracked_socket {
     //! ctor
@@ -149,16 +453,144 @@ private:
     : callbackRead(nullptr)
     , callbackWrite(nullptr) {}
 
+    //! flags
+    enum : std::uint32_t {
+      executing_rd_callback = 0x1,
+      executing_wr_callback = 0x2,
+      marked_for_untrack    = 0x4
+    };
+
+    //!
+    //! \param uFlags flags to be checked
+    //! \return whether any of the given flags is set
+    //!
+    bool
+    is_set(std::uint32_t uFlags) const {
+      return (uFlags_a.load() & uFlags) != 0;
+    }
+
+    //!
+    //! \return whether the socket is marked for untrack and none of its callbacks is being executed
+    //!
+    bool
+    is_removable(void) const {
+      return uFlags_a.load() == marked_for_untrack;
+    }
+
+    //! set the given flags
+    void
+    set(std::uint32_t uFlags) {
+      uFlags_a.fetch_or(uFlags);
+    }
+
+    //! clear the given flags
+    void
+    clr(std::uint32_t uFlags) {
+      uFlags_a.fetch_and(~uFlags);
+    }
+
+    std::atomic<std::uint32_t> uFlags_a = ATOMIC_VAR_INIT(0);
+
     //! rd event
     event_callback_t    callbackRead;
-    std::atomic<bool>   bIsExecutingCallbackRead_a  = ATOMIC_VAR_INIT(false);
+    event_callback_t    callbackReadPending;
+    bool                bHasPendingCallbackRead     = false;
 
     //! wr event
     event_callback_t    callbackWrite;
-    std::atomic<bool>   bIsExecutingCallbackWrite_a = ATOMIC_VAR_INIT(false);
+    event_callback_t    callbackWritePending;
+    bool                bHasPendingCallbackWrite    = false;
+
+    //! events registered in the poller
+    int                 nPolledEvents               = poller_iface::none;
+
+    //! where callbacks are executed
+    callback_execution_mode eCallbackExecutionMode  = callback_execution_mode::worker_pool;
 
-    //! marked for untrack
-    std::atomic<bool>   bMarkedForUntrack_a         = ATOMIC_VAR_INIT(false);
+    //! removal notification
+    std::vector<removal_callback_t> vctRemovalCallbacks;
+  };
+
+  //!
+  //! struct reactor_callback
+  //! callback to be executed by the poll thread once the reactor lock is released
+  //!  * fd: fd for which the event has been reported
+  //!  * bIsRead: whether this is the read or the write callback
+  //!  * socket: tracked socket whose callback is executed (stays valid while the callback is marked as executing)
+  //!
+  struct reactor_callback {
+    fd_t                fd;
+    bool                bIsRead;
+    tracked_socket*     pSocket;
+  };
+
+private:
+  //!
+  //! struct reactor
+  //! an event loop run by its own poll thread, in charge of a subset of the tracked sockets
+  //!  * tableTrackedSockets: sockets tracked by this reactor, indexed by fd
+  //!  * mtxTrackedSockets: tracked sockets table thread safety (lookups, insertions and removals)
+  //!  * arrSocketMutexes: tracked sockets state thread safety, each mutex protects the sockets whose fd maps to it
+  //!  * ptrPoller: polling backend
+  //!  * vctPolledEvents: events reported by the last poll (only accessed by the poll thread)
+  //!  * vctReactorCallbacks: callbacks to be executed by the poll thread for the last poll (only accessed by the poll thread)
+  //!  * vctReplacedCallbacks: callbacks replaced while executed by the poll thread, destroyed without the lock held (only accessed by the poll thread)
+  //!  * vctRemovalCallbacks: removal callbacks of the sockets removed by the poll thread, executed without the lock held (only accessed by the poll thread)
+  //!  * selfPipeNotifier: pipe used to wake up the poll call (unless the poller can be woken up by itself)
+  //!  * nNbTrackedSockets_a: number of tracked sockets, used for load balancing
+  //!  * sThreadName: name of the poll thread (protected by m_mtxPlacement)
+  //!  * vctCpus: CPUs the poll thread is pinned to, when bHasCpuAffinity (protected by m_mtxPlacement)
+  //!  * bPlacementPending_a: whether the poll thread must apply its name and CPU affinity on its next iteration
+  //!  * threadPollWorker: poll thread
+  //!
+  //! the state of a tracked socket is protected by its socket mutex, so that sockets are updated concurrently by the
+  //! poll thread and the workers. mtxTrackedSockets is only held for table accesses, always after the socket mutex.
+  //! entries of the table never move: a tracked_socket stays valid while its socket mutex is held, or while one of
+  //! its callbacks is marked as executing.
+  //!
+  struct reactor {
+    //! ctor
+    explicit reactor(poller_backend eBackend)
+    : ptrPoller(create_poller(eBackend)) {}
+
+    //!
+    //! \param fd fd of a socket
+    //! \return the mutex protecting the state of that socket
+    //!
+    std::mutex&
+    get_socket_mutex(const fd_t& fd) {
+      return arrSocketMutexes[get_socket_mutex_index(fd)];
+    }
+
+    //!
+    //! \param fd fd of a socket
+    //! \return the index of the mutex protecting the state of that socket
+    //!
+    static std::size_t
+    get_socket_mutex_index(const fd_t& fd) {
+      return static_cast<std::size_t>(fd) % __TACOPIE_IO_SERVICE_NB_SOCKET_LOCKS;
+    }
+
+    utils::fd_table<tracked_socket>               tableTrackedSockets;
+    std::mutex                                    mtxTrackedSockets;
+    std::mutex                                    arrSocketMutexes[__TACOPIE_IO_SERVICE_NB_SOCKET_LOCKS];
+
+    std::unique_ptr<poller_iface>                 ptrPoller;
+    std::vector<poller_iface::poll_event>         vctPolledEvents;
+    std::vector<reactor_callback>                 vctReactorCallbacks;
+    std::vector<event_callback_t>                 vctReplacedCallbacks;
+    std::vector<removal_callback_t>               vctRemovalCallbacks;
+
+    tacopie::self_pipe                            selfPipeNotifier;
+
+    std::atomic<std::size_t>                      nNbTrackedSockets_a = ATOMIC_VAR_INIT(0);
+
+    std::string                                   sThreadName;
+    std::vector<std::size_t>                      vctCpus;
+    bool                                          bHasCpuAffinity     = false;
+    std::atomic<bool>                             bPlacementPending_a = ATOMIC_VAR_INIT(true);
+
+    std::thread                                   threadPollWorker;
   };
 
 private:
@@ -166,88 +598,351 @@ private:
   //! poll worker function
   //! main loop of the background thread in charge of the io_service in charge of polling fds
   //!
-  void poll(void);
+  //! \param r reactor run by this thread
+  //!
+  void poll(reactor& r);
 
   //!
-  //! init m_poll_fds_info
-  //! simply initialize m_polled_fds variable based on m_tracked_sockets information
+  //! apply the name and CPU affinity settings of a reactor to the calling poll thread
   //!
-  //! \return maximum fd value polled
+  //! \param r reactor run by this thread
   //!
-  int init_poll_fds_info(void);
+  void apply_reactor_placement(reactor& r);
 
   //!
   //! process poll detected events
   //! called whenever select/poll completed to check read and write availablity
   //!
-  void process_events(void);
+  //! \param r reactor for which events have been reported
+  //!
+  void process_events(reactor& r);
+
+  //!
+  //! process the events reported by the last poll
+  //! each event is processed with its socket lock held: callbacks in reactor_thread mode are only collected
+  //!
+  //! \param r reactor for which events have been reported
+  //!
+  void process_polled_events(reactor& r);
 
   //!
   //! process read event reported by select/poll for a given socket
   //!
+  //! \param r reactor tracking the socket
   //! \param fd fd for which a read event has been reported
   //! \param socket tracked_socket associated to the given fd
   //!
-  void process_rd_event(const fd_t& fd, tracked_socket& socket);
+  void process_rd_event(reactor& r, const fd_t& fd, tracked_socket& socket);
 
   //!
   //! process write event reported by select/poll for a given socket
   //!
+  //! \param r reactor tracking the socket
   //! \param fd fd for which a write event has been reported
   //! \param socket tracked_socket associated to the given fd
   //!
-  void process_wr_event(const fd_t& fd, tracked_socket& socket);
+  void process_wr_event(reactor& r, const fd_t& fd, tracked_socket& socket);
+
+  //!
+  //! execute the callbacks collected by process_events for sockets in reactor_thread mode
+  //! called by the poll thread, without any lock held
+  //!
+  //! \param r reactor for which callbacks have been collected
+  //!
+  void execute_reactor_callbacks(reactor& r);
+
+  //!
+  //! register in the poller the events the socket is currently waiting for
+  //! a socket waits for read (resp. write) events if it has a read (resp. write) callback not being executed
+  //! must be called with the socket lock held whenever any of these information changes
+  //!
+  //! \param r reactor tracking the socket
+  //! \param fd fd of the socket to be updated
+  //! \param socket tracked_socket associated to the given fd
+  //!
+  void update_polled_events(reactor& r, const fd_t& fd, tracked_socket& socket);
+
+  //!
+  //! set the read or write callback of a socket, or keep it pending if the current one is being executed
+  //! must be called with the socket lock held
+  //!
+  //! \param socket tracked_socket to be updated
+  //! \param bIsRead whether the read or the write callback is set
+  //! \param callback new callback
+  //!
+  void set_callback(tracked_socket& socket, bool bIsRead, event_callback_t callback);
+
+  //!
+  //! mark the read or write callback of a socket as executed: install the pending callback if any, then either
+  //! remove the socket if it is marked for untrack or re-arm it in the poller
+  //! must be called with the socket lock held
+  //!
+  //! \param r reactor tracking the socket
+  //! \param fd fd of the socket
+  //! \param socket tracked_socket whose callback has been executed
+  //! \param bIsRead whether the read or the write callback has been executed
+  //! \param vctRemovalCallbacks filled in with the removal callbacks of the socket if it has been removed
+  //! \return the callback replaced by the pending one, to be destroyed once the lock is released
+  //!
+  event_callback_t complete_callback(reactor& r, const fd_t& fd, tracked_socket& socket, bool bIsRead,
+      std::vector<removal_callback_t>& vctRemovalCallbacks);
+
+  //!
+  //! remove socket from tracking and from the poller
+  //! must be called with the socket lock held
+  //!
+  //! \param r reactor tracking the socket
+  //! \param fd fd of the socket
+  //! \param socket tracked socket to be removed
+  //! \param vctRemovalCallbacks filled in with the removal callbacks of the socket, to be executed once the lock is released
+  //!
+  void erase_tracked_socket(reactor& r, const fd_t& fd, tracked_socket& socket,
+      std::vector<removal_callback_t>& vctRemovalCallbacks);
+
+  //!
+  //! execute removal callbacks, then clear them
+  //! must be called without any lock held
+  //!
+  //! \param vctRemovalCallbacks callbacks to be executed
+  //!
+  void execute_removal_callbacks(std::vector<removal_callback_t>& vctRemovalCallbacks);
+
+  //!
+  //! retrieve the tracked_socket associated to the given fd
+  //! must be called with the socket lock held
+  //!
+  //! \param r reactor the socket is assigned to
+  //! \param fd fd of the socket
+  //! \return the tracked_socket associated to the given fd, or nullptr if the socket is not tracked
+  //!
+  tracked_socket* find_tracked_socket(reactor& r, const fd_t& fd);
+
+  //!
+  //! retrieve the tracked_socket associated to the given fd, tracking it if it is not tracked yet
+  //! must be called with the socket lock held
+  //!
+  //! \param r reactor the socket is assigned to
+  //! \param fd fd of the socket
+  //! \return the tracked_socket associated to the given fd
+  //!
+  tracked_socket& get_or_create_tracked_socket(reactor& r, const fd_t& fd);
+
+  //!
+  //! untrack a socket: remove it immediately if none of its callbacks is being executed, mark it for untrack otherwise
+  //! must be called with the socket lock held
+  //!
+  //! \param r reactor the socket is assigned to
+  //! \param fd fd of the socket
+  //! \param callbackRemoval callback to be executed once the socket has been removed, moved out if the socket is tracked
+  //! \param vctRemovalCallbacks filled in with the removal callbacks of the socket if it has been removed
+  //! \return whether the socket was tracked
+  //!
+  bool untrack_tracked_socket(reactor& r, const fd_t& fd, removal_callback_t& callbackRemoval,
+      std::vector<removal_callback_t>& vctRemovalCallbacks);
+
+  //!
+  //! socket of a batch operation
+  //!  * pReactor: reactor the socket is assigned to (nullptr if the socket has never been assigned)
+  //!  * fd: fd of the socket
+  //!  * uIndex: index of the socket in the batch
+  //!
+  struct batch_socket {
+    reactor*    pReactor;
+    fd_t        fd;
+    std::size_t uIndex;
+  };
+
+  //!
+  //! find the reactors of the sockets of a batch (under a single lock) and sort the sockets by reactor and by socket
+  //! mutex, so that the sockets sharing a mutex are processed together
+  //!
+  //! \param vctFds fds of the sockets of the batch
+  //! \return sockets of the batch, in processing order
+  //!
+  std::vector<batch_socket> sort_batch_sockets(const std::vector<fd_t>& vctFds);
+
+  //!
+  //! process the sockets of a batch assigned to a reactor, locking each socket mutex once for all its sockets
+  //! then wake up each reactor once if requested for any of its sockets
+  //!
+  //! \param vctSockets sockets of the batch, as returned by sort_batch_sockets
+  //! \param fnProcess called with the socket lock held, returns whether the reactor must be woken up
+  //!
+  void process_batch_sockets(const std::vector<batch_socket>& vctSockets,
+      const std::function<bool(reactor&, const batch_socket&)>& fnProcess);
+
+  //!
+  //! wake up the poll thread if the poller does not take updates into account while waiting
+  //!
+  //! \param r reactor to be woken up
+  //!
+  void wakeup_poller_on_update(reactor& r);
+
+  //!
+  //! wake up the poll thread of a reactor, through the poller when it supports it or through the self pipe otherwise
+  //!
+  //! \param r reactor to be woken up
+  //!
+  void wakeup_reactor(reactor& r);
+
+  //!
+  //! compute the poll timeout from the next event of the timer wheel
+  //! only the first reactor drives the timers, the other ones always use the default timeout
+  //!
+  //! \param r reactor about to poll
+  //! \param nDefaultTimeoutMsecs timeout to be used when no timer expires earlier (-1 for no timeout)
+  //! \return timeout to be given to the poller
+  //!
+  int get_poll_timeout(reactor& r, int nDefaultTimeoutMsecs);
+
+  //!
+  //! advance the timer wheel and dispatch the callbacks of the expired timers to the workers
+  //! called by the poll thread of the first reactor after each poll
+  //!
+  void process_expired_timers(void);
+
+  //!
+  //! add a timer to the wheel and wake up the first reactor if it has to poll for a shorter time
+  //!
+  //! \param delay delay after which the timer expires
+  //! \param period period of the timer, 0 for one-shot timers
+  //! \param callback callback to be executed
+  //! \return handle of the timer
+  //!
+  timer_id_t add_timer(std::chrono::milliseconds delay, std::chrono::milliseconds period, const timer_callback_t& callback);
+
+  //!
+  //! \param time time point to be converted
+  //! \param bRoundUp whether partial ticks are rounded up (deadlines) or down (current time)
+  //! \return the timer wheel tick matching the given time point (1 tick per millisecond since construction)
+  //!
+  std::uint64_t get_timer_tick(std::chrono::steady_clock::time_point time, bool bRoundUp) const;
 
 private:
   //!
-  //! tracked sockets
+  //! \param fd fd of the socket
+  //! \return the reactor the socket has been assigned to, or nullptr if the socket has never been assigned
   //!
-  std::unordered_map<fd_t, tracked_socket>      m_mapTrackedSockets;
+  reactor* find_reactor(const fd_t& fd);
 
   //!
-  //! whether the worker should stop or not
+  //! pick a reactor according to the assignment policy and assign the socket to it
   //!
-  std::atomic<bool>                             m_bShouldStop_a;
+  //! \param fd fd of the socket
+  //! \return the reactor the socket has been assigned to
+  //!
+  reactor& assign_reactor(const fd_t& fd);
 
   //!
-  //! poll thread
+  //! \param fd fd of the socket
+  //! \return the reactor the socket has been assigned to, assigning one if the socket has never been assigned
   //!
-  std::thread                                   m_threadPollWorker;
+  reactor& find_or_assign_reactor(const fd_t& fd);
 
   //!
-  //! callback workers
+  //! \param fd fd of the socket
+  //! \return index of the reactor pinned to the CPU that processed the last packet received by the socket, or
+  //! m_vctReactors.size() if unknown
   //!
-  utils::thread_pool                            m_threadPoolCallbackWorkers;
+  std::size_t find_incoming_cpu_reactor(const fd_t& fd);
+
+private:
+  //!
+  //! reactors
+  //!
+  std::vector<std::unique_ptr<reactor>>         m_vctReactors;
 
   //!
-  //! thread safety
+  //! reactor each socket has been assigned to (index in m_vctReactors)
+  //! assignments are sticky: a reused fd keeps its reactor unless it is tracked again with track()
+  //! unused when there is only one reactor
   //!
-  std::mutex                                    m_mtxTrackedSockets;
+  utils::fd_table<std::size_t>                  m_tableReactorAssignments;
 
   //!
-  //! data structure given to select (list of fds to poll)
+  //! reactor assignments thread safety
   //!
-  std::vector<fd_t>                             m_vctPolledFds;
+  std::mutex                                    m_mtxReactorAssignments;
 
   //!
-  //! data structure given to select (list of fds to poll for read)
+  //! assignment policy
   //!
-  fd_set                                        m_fdsetRead;
+  std::atomic<reactor_assignment_policy>        m_eReactorAssignmentPolicy_a;
 
   //!
-  //! data structure given to select (list of fds to poll for write)
+  //! next reactor to be picked for round robin assignments
   //!
-  fd_set                                        m_fdsetWrite;
+  std::atomic<std::size_t>                      m_uNextReactor_a;
 
   //!
-  //! condition variable to wait on removal
+  //! reactor pinned to each CPU (index in m_vctReactors, m_vctReactors.size() if none), see incoming_cpu
   //!
-  std::condition_variable                       m_cvWaitForRemoval;
+  std::vector<std::size_t>                      m_vctCpuReactors;
 
   //!
-  //! fd associated to the pipe used to wake up the poll call
+  //! threads name & CPU affinity settings thread safety
+  //!
+  std::mutex                                    m_mtxPlacement;
+
+  //!
+  //! callback execution mode applied to newly tracked sockets
+  //!
+  std::atomic<callback_execution_mode>          m_eCallbackExecutionMode_a;
+
+  //!
+  //! timers (the wheel is advanced by the poll thread of the first reactor)
+  //!
+  utils::timer_wheel                            m_timerWheel;
+
   //!
-  tacopie::self_pipe                            m_selfPipeNotifier;
+  //! expired timer whose callback is queued or being executed
+  //!  * threadId: thread executing the callback (default id until started)
+  //!  * bCancelled: whether the timer has been cancelled before its callback started (it is then not executed)
+  //!
+  struct executing_timer {
+    std::thread::id threadId;
+    bool            bCancelled = false;
+  };
+
+  //!
+  //! expired timers whose callback is queued or being executed
+  //!
+  std::unordered_map<timer_id_t, executing_timer> m_mapExecutingTimers;
+
+  //!
+  //! timers thread safety
+  //!
+  std::mutex                                    m_mtxTimers;
+
+  //!
+  //! condition variable to wait on timer callbacks completion
+  //!
+  std::condition_variable                       m_cvTimers;
+
+  //!
+  //! timers expired during the last advance of the wheel (only accessed by the poll thread of the first reactor)
+  //!
+  std::vector<utils::timer_wheel::expired_timer_t> m_vctExpiredTimers;
+
+  //!
+  //! tick up to which the first reactor is currently polling (protected by m_mtxTimers)
+  //!
+  std::uint64_t                                 m_uTimerWakeupTick;
+
+  //!
+  //! origin of the timer wheel ticks
+  //!
+  std::chrono::steady_clock::time_point         m_timeTimerOrigin;
+
+  //!
+  //! whether the worker should stop or not
+  //!
+  std::atomic<bool>                             m_bShouldStop_a;
+
+  //!
+  //! callback workers
+  //!
+  utils::thread_pool                            m_threadPoolCallbackWorkers;
 };
 
 //!
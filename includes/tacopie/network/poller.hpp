@@ -0,0 +1,621 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <sys/select.h>
+#endif /* _WIN32 */
+
+#include <tacopie/utils/typedefs.hpp>
+
+#if defined(__linux__)
+#define __TACOPIE_HAS_EPOLL
+#endif /* __linux__ */
+
+#if defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__) || defined(__DragonFly__)
+#define __TACOPIE_HAS_KQUEUE
+#endif /* __APPLE__ || BSD */
+
+#if defined(_WIN32)
+#define __TACOPIE_HAS_IOCP
+#endif /* _WIN32 */
+
+#ifdef __TACOPIE_HAS_KQUEUE
+#include <sys/event.h>
+#endif /* __TACOPIE_HAS_KQUEUE */
+
+#ifdef __TACOPIE_HAS_EPOLL
+#include <sys/epoll.h>
+#endif /* __TACOPIE_HAS_EPOLL */
+
+//! io_uring requires the kernel uapi header, the kernel support is checked at runtime
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define __TACOPIE_HAS_IO_URING
+#endif /* __has_include(<linux/io_uring.h>) */
+#endif /* __linux__ && __has_include */
+
+#ifdef __TACOPIE_HAS_IO_URING
+#include <cstdint>
+#include <linux/io_uring.h>
+#endif /* __TACOPIE_HAS_IO_URING */
+
+namespace tacopie {
+
+//!
+//! polling backends that can be used by the io_service
+//!  * automatic: best backend available on the current platform (epoll on linux, kqueue on BSD/macOS, iocp on windows, select otherwise)
+//!  * select: portable fallback, rebuilds the fd_sets on every wakeup and is limited by FD_SETSIZE
+//!  * epoll: linux only
+//!  * kqueue: BSD and macOS only
+//!  * io_uring: linux 5.11+ only, never selected automatically (the poll thread submits all the updates and waits
+//! with a single system call, and receives the data of the continuous read clients itself, which pays off when
+//! callbacks are executed on the reactor thread)
+//!  * iocp: windows only
+//!
+enum class poller_backend {
+  automatic,
+  select,
+  epoll,
+  kqueue,
+  io_uring,
+  iocp
+};
+
+//!
+//! poller_iface
+//! should be inherited by any class intended to be used as a polling backend by the io_service
+//!
+//! interest is registered incrementally: the io_service calls update() whenever the set of events it is waiting for
+//! changes for a given fd, and wait() only reports the events that have been registered
+//!
+class poller_iface {
+public:
+  //!
+  //! events that can be watched for a given fd
+  //! flags can be combined
+  //!
+  enum event_flag {
+    none = 0,
+    rd   = 1,
+    wr   = 2
+  };
+
+  //!
+  //! event reported by wait()
+  //!  * fd: fd for which an event occured
+  //!  * nEvents: combination of event_flag that occured for that fd
+  //!
+  struct poll_event {
+    fd_t  fd;
+    int   nEvents;
+  };
+
+public:
+  //! ctor
+  poller_iface(void) = default;
+  //! dtor
+  virtual ~poller_iface(void) = default;
+
+  //! copy ctor
+  poller_iface(const poller_iface&) = delete;
+  //! assignment operator
+  poller_iface& operator=(const poller_iface&) = delete;
+
+public:
+  //!
+  //! change the events watched for the given fd
+  //! this might be called concurrently with wait()
+  //!
+  //! \param fd fd to be updated
+  //! \param nOldEvents events currently registered for the fd (none if the fd is not registered yet)
+  //! \param nNewEvents events to be registered for the fd (none to stop polling the fd)
+  //!
+  virtual void update(fd_t fd, int nOldEvents, int nNewEvents) = 0;
+
+  //!
+  //! wait for events on the registered fds
+  //!
+  //! \param vctEvents vector filled in with the events that occured (cleared before being filled)
+  //! \param nTimeoutMsecs maximum time to wait for events, -1 to wait indefinitely
+  //!
+  virtual void wait(std::vector<poll_event>& vctEvents, int nTimeoutMsecs) = 0;
+
+  //!
+  //! \return whether wait() must be woken up for update() to be taken into account
+  //! (true when the backend only reads the registered events when wait() starts)
+  //!
+  virtual bool needs_wakeup_on_update(void) const = 0;
+
+  //!
+  //! wake up a pending wait() from another thread
+  //! backends without a wakeup mechanism of their own rely on the self pipe of the io_service
+  //!
+  //! \return whether the poller has been woken up (false if the self pipe must be notified instead)
+  //!
+  virtual bool
+  wakeup(void) {
+    return false;
+  }
+
+  //!
+  //! reallocate the buffers used by wait() from the calling thread
+  //! called by the poll thread once pinned to its CPUs, so that the buffers are placed on its NUMA node (first-touch)
+  //!
+  virtual void
+  reallocate_buffers(void) {}
+
+  //!
+  //! \return whether the poller can receive the data of the registered fds itself (completion based receive)
+  //!
+  virtual bool
+  supports_recv_completions(void) const {
+    return false;
+  }
+
+  //!
+  //! enable or disable the completion based receive of a fd
+  //! once enabled, the poller receives the data of the fd by itself and reports rd once bytes (or the end of the
+  //! stream) are waiting to be taken by take_received(). this might be called concurrently with wait()
+  //!
+  //! \param fd fd to be updated
+  //! \param bEnabled whether the poller must receive the data of the fd
+  //! \param uBufferSize maximum number of bytes received at once
+  //!
+  virtual void
+  set_recv_completions(fd_t, bool, std::size_t) {}
+
+  //!
+  //! take the bytes received by the poller for a fd
+  //! bytes received before the completion based receive got disabled are still taken from here, so that they are
+  //! never delivered out of order
+  //! throws a tacopie_error once all the bytes have been taken if the stream ended (as tcp_socket::recv would)
+  //!
+  //! \param fd fd to be read
+  //! \param pBuffer buffer to be filled
+  //! \param uSizeToRead size of the buffer
+  //! \param uReadSize number of bytes copied into the buffer (0 while a receive is in flight)
+  //! \return false if the fd must be read directly (the poller does not hold any byte nor receive for it)
+  //!
+  virtual bool
+  take_received(fd_t, char*, std::size_t, std::size_t&) {
+    return false;
+  }
+
+  //!
+  //! drop the state kept for a fd that is not tracked anymore (it might be closed and reused right after)
+  //! called after the events of the fd have been unregistered
+  //!
+  //! \param fd fd to be released
+  //!
+  virtual void
+  release(fd_t) {}
+
+  //!
+  //! \return the backend implemented by this poller
+  //!
+  virtual poller_backend get_backend(void) const = 0;
+};
+
+//!
+//! select based poller
+//! portable fallback, rebuilds the fd_sets from the registered events on every wait() call
+//!
+class select_poller : public poller_iface {
+public:
+  //! ctor
+  select_poller(void) = default;
+  //! dtor
+  ~select_poller(void) = default;
+
+public:
+  void update(fd_t fd, int nOldEvents, int nNewEvents);
+  void wait(std::vector<poll_event>& vctEvents, int nTimeoutMsecs);
+  bool needs_wakeup_on_update(void) const;
+  poller_backend get_backend(void) const;
+
+private:
+  //!
+  //! events registered for each fd
+  //!
+  std::unordered_map<fd_t, int>   m_mapRegisteredEvents;
+
+  //!
+  //! registered events thread safety
+  //!
+  std::mutex                      m_mtxRegisteredEvents;
+
+  //!
+  //! list of fds given to select
+  //!
+  std::vector<fd_t>               m_vctPolledFds;
+
+  //!
+  //! data structure given to select (list of fds to poll for read)
+  //!
+  fd_set                          m_fdsetRead;
+
+  //!
+  //! data structure given to select (list of fds to poll for write)
+  //!
+  fd_set                          m_fdsetWrite;
+};
+
+#ifdef __TACOPIE_HAS_EPOLL
+//!
+//! epoll based poller (level-triggered)
+//! interest is kept by the kernel, wait() is O(number of ready fds)
+//!
+class epoll_poller : public poller_iface {
+public:
+  //! ctor
+  epoll_poller(void);
+  //! dtor
+  ~epoll_poller(void);
+
+public:
+  void update(fd_t fd, int nOldEvents, int nNewEvents);
+  void wait(std::vector<poll_event>& vctEvents, int nTimeoutMsecs);
+  bool needs_wakeup_on_update(void) const;
+  void reallocate_buffers(void);
+  poller_backend get_backend(void) const;
+
+private:
+  //!
+  //! epoll instance
+  //!
+  fd_t                            m_fdEpoll;
+
+  //!
+  //! buffer given to epoll_wait, grown whenever it gets filled up entirely
+  //!
+  std::vector<epoll_event>        m_vctEpollEvents;
+};
+#endif /* __TACOPIE_HAS_EPOLL */
+
+#ifdef __TACOPIE_HAS_KQUEUE
+//!
+//! kqueue based poller
+//! interest is kept by the kernel, wait() is O(number of ready fds)
+//!
+class kqueue_poller : public poller_iface {
+public:
+  //! ctor
+  kqueue_poller(void);
+  //! dtor
+  ~kqueue_poller(void);
+
+public:
+  void update(fd_t fd, int nOldEvents, int nNewEvents);
+  void wait(std::vector<poll_event>& vctEvents, int nTimeoutMsecs);
+  bool needs_wakeup_on_update(void) const;
+  void reallocate_buffers(void);
+  poller_backend get_backend(void) const;
+
+private:
+  //!
+  //! kqueue instance
+  //!
+  fd_t                            m_fdKqueue;
+
+  //!
+  //! buffer given to kevent, grown whenever it gets filled up entirely
+  //!
+  std::vector<struct kevent>      m_vctKevents;
+};
+#endif /* __TACOPIE_HAS_KQUEUE */
+
+#ifdef __TACOPIE_HAS_IO_URING
+//!
+//! io_uring based poller (linux 5.11+)
+//! each registered fd has a one-shot poll request in flight, re-armed by wait() while its events stay registered, which
+//! keeps the level-triggered semantics of the other backends.
+//! update() only records the change: changes are submitted by the next wait() together with the wait itself, in a
+//! single io_uring_enter system call (instead of one epoll_ctl per change).
+//!
+//! fds with completion based receive enabled have a receive request in flight instead of a read poll request: the
+//! poller reports rd once the data is received, and take_received() hands it out without any system call. the
+//! receive is re-armed by the next wait() once the data has been taken, so the receives of all the fds of the reactor
+//! are submitted by a single io_uring_enter per loop iteration.
+//!
+class io_uring_poller : public poller_iface {
+public:
+  //! ctor
+  io_uring_poller(void);
+  //! dtor
+  ~io_uring_poller(void);
+
+public:
+  void update(fd_t fd, int nOldEvents, int nNewEvents);
+  void wait(std::vector<poll_event>& vctEvents, int nTimeoutMsecs);
+  bool needs_wakeup_on_update(void) const;
+  bool supports_recv_completions(void) const;
+  void set_recv_completions(fd_t fd, bool bEnabled, std::size_t uBufferSize);
+  bool take_received(fd_t fd, char* pBuffer, std::size_t uSizeToRead, std::size_t& uReadSize);
+  void release(fd_t fd);
+  poller_backend get_backend(void) const;
+
+private:
+  //!
+  //! registration state of a fd
+  //!  * nEvents: events registered by update()
+  //!  * nArmedEvents: events of the poll request in flight (none if no request is in flight)
+  //!  * uArmedId: user data of the poll request in flight
+  //!  * bDirty: whether the fd is in the list of fds whose requests must be updated
+  //!  * bReset: whether the fd has been unregistered since the request in flight was armed (it must be re-armed)
+  //!  * bRecvEnabled: whether completion based receive is enabled
+  //!  * uRecvId: user data of the receive request in flight (0 if no receive is in flight)
+  //!  * vctRecvBuffer: buffer of the receive requests, only accessed by the kernel while a receive is in flight
+  //!  * uRecvBufferSize: size of the buffer of the next receive request
+  //!  * uRecvOffset, uRecvSize: received bytes not taken yet
+  //!  * bRecvDone: whether the stream ended, nRecvResult being 0 if closed by the peer or the negated errno otherwise
+  //!
+  struct registration {
+    //! ctor
+    registration(void)
+    : nEvents(none)
+    , nArmedEvents(none)
+    , uArmedId(0)
+    , bDirty(false)
+    , bReset(false)
+    , bRecvEnabled(false)
+    , uRecvId(0)
+    , uRecvBufferSize(0)
+    , uRecvOffset(0)
+    , uRecvSize(0)
+    , bRecvDone(false)
+    , nRecvResult(0) {}
+
+    //!
+    //! \return whether the reads of the fd go through the poller (the read events come from the receive requests)
+    //!
+    bool
+    owns_recv(void) const {
+      return bRecvEnabled || uRecvId || uRecvSize || bRecvDone;
+    }
+
+    int               nEvents;
+    int               nArmedEvents;
+    std::uint64_t     uArmedId;
+    bool              bDirty;
+    bool              bReset;
+
+    bool              bRecvEnabled;
+    std::uint64_t     uRecvId;
+    std::vector<char> vctRecvBuffer;
+    std::size_t       uRecvBufferSize;
+    std::size_t       uRecvOffset;
+    std::size_t       uRecvSize;
+    bool              bRecvDone;
+    int               nRecvResult;
+  };
+
+private:
+  //!
+  //! mark a fd so that its poll request gets updated by the next wait(), must be called with the lock held
+  //!
+  void mark_dirty(fd_t fd, registration& reg);
+
+  //!
+  //! \return the user data of a new request for the given fd
+  //!
+  std::uint64_t next_user_data(fd_t fd);
+
+  //!
+  //! queue the poll and receive requests (and cancellations) of the dirty fds, must be called with the lock held
+  //! the fds whose received bytes are waiting to be taken are reported right away
+  //!
+  //! \param vctEvents events reported by the current wait()
+  //! \return whether receive requests have been queued
+  //!
+  bool prepare_updates(std::vector<poll_event>& vctEvents);
+
+  //!
+  //! handle a completed receive request, must be called with the lock held
+  //!
+  void handle_recv_completion(fd_t fd, registration& reg, int nResult, std::vector<poll_event>& vctEvents);
+
+  //!
+  //! handle the completed requests, must be called with the lock held
+  //!
+  void reap_completions(std::vector<poll_event>& vctEvents);
+
+  //!
+  //! \return the next free submission queue entry (zeroed), submitting the queued ones if the queue is full
+  //!
+  io_uring_sqe* get_sqe(void);
+
+  //!
+  //! submit the queued entries, and optionally wait for completions
+  //!
+  //! \param bWait whether to wait for at least one completion
+  //! \param nTimeoutMsecs maximum time to wait, -1 to wait indefinitely
+  //!
+  void enter(bool bWait, int nTimeoutMsecs);
+
+private:
+  //!
+  //! io_uring instance
+  //!
+  fd_t                                    m_fdRing;
+
+  //!
+  //! mapped submission queue ring, completion queue ring and submission queue entries
+  //!
+  void*                                   m_pSqRing;
+  std::size_t                             m_uSqRingSize;
+  void*                                   m_pCqRing;
+  std::size_t                             m_uCqRingSize;
+  io_uring_sqe*                           m_pSqes;
+  std::size_t                             m_uSqesSize;
+
+  //!
+  //! submission queue (head is owned by the kernel, tail by the poller)
+  //!
+  unsigned*                               m_pSqHead;
+  unsigned*                               m_pSqTail;
+  unsigned*                               m_pSqArray;
+  unsigned                                m_uSqMask;
+  unsigned                                m_uSqEntries;
+
+  //!
+  //! number of entries queued since the last io_uring_enter
+  //!
+  unsigned                                m_uSqPending;
+
+  //!
+  //! completion queue (head is owned by the poller, tail by the kernel)
+  //!
+  unsigned*                               m_pCqHead;
+  unsigned*                               m_pCqTail;
+  io_uring_cqe*                           m_pCqes;
+  unsigned                                m_uCqMask;
+
+  //!
+  //! generation of the next poll request (part of its user data, so that completions of stale requests are ignored)
+  //!
+  std::uint32_t                           m_uNextGeneration;
+
+  //!
+  //! registration state of each fd
+  //!
+  std::unordered_map<fd_t, registration>  m_mapRegistrations;
+
+  //!
+  //! fds whose requests must be updated by the next wait()
+  //!
+  std::vector<fd_t>                       m_vctDirtyFds;
+
+  //!
+  //! user data of the receive requests to be cancelled by the next wait()
+  //!
+  std::vector<std::uint64_t>              m_vctCancelledRecvIds;
+
+  //!
+  //! buffers of the receive requests still in flight for released fds, kept until their completion
+  //!
+  std::unordered_map<std::uint64_t, std::vector<char>> m_mapReleasedRecvBuffers;
+
+  //!
+  //! registrations thread safety
+  //!
+  std::mutex                              m_mtxRegistrations;
+};
+#endif /* __TACOPIE_HAS_IO_URING */
+
+#ifdef __TACOPIE_HAS_IOCP
+//!
+//! IO completion port based poller (windows)
+//! readiness is obtained by issuing a poll request (IOCTL_AFD_POLL) per registered socket to the AFD driver, completed
+//! on the completion port: no FD_SETSIZE limit, wait() is O(number of ready sockets), and wakeup() posts a completion
+//! packet instead of going through the self pipe.
+//! poll requests are one-shot and re-issued after completion while events stay registered, which keeps the
+//! level-triggered semantics of the other backends.
+//!
+class iocp_poller : public poller_iface {
+public:
+  //! ctor
+  iocp_poller(void);
+  //! dtor
+  ~iocp_poller(void);
+
+public:
+  void update(fd_t fd, int nOldEvents, int nNewEvents);
+  void wait(std::vector<poll_event>& vctEvents, int nTimeoutMsecs);
+  bool needs_wakeup_on_update(void) const;
+  void reallocate_buffers(void);
+  poller_backend get_backend(void) const;
+  bool wakeup(void);
+
+private:
+  //!
+  //! poll state of a socket (defined by the implementation as it depends on NT internal types)
+  //!
+  struct afd_socket;
+
+private:
+  //!
+  //! issue the poll request of a socket, must be called with the lock held
+  //!
+  void submit_poll(afd_socket& socket);
+
+  //!
+  //! cancel the poll request of a socket, must be called with the lock held
+  //!
+  void cancel_poll(afd_socket& socket);
+
+  //!
+  //! handle a completed poll request, must be called with the lock held
+  //!
+  void handle_completion(afd_socket* pSocket, std::vector<poll_event>& vctEvents);
+
+private:
+  //!
+  //! completion port
+  //!
+  HANDLE                                                        m_hCompletionPort;
+
+  //!
+  //! handle to the AFD driver, poll requests are issued on it
+  //!
+  HANDLE                                                        m_hAfd;
+
+  //!
+  //! poll state of the registered sockets
+  //!
+  std::unordered_map<fd_t, std::unique_ptr<afd_socket>>         m_mapSockets;
+
+  //!
+  //! poll state of the unregistered sockets whose poll request is still being cancelled
+  //!
+  std::unordered_map<afd_socket*, std::unique_ptr<afd_socket>>  m_mapReleasedSockets;
+
+  //!
+  //! buffer given to GetQueuedCompletionStatusEx, grown whenever it gets filled up entirely
+  //!
+  std::vector<OVERLAPPED_ENTRY>                                 m_vctCompletionEntries;
+
+  //!
+  //! sockets thread safety
+  //!
+  std::mutex                                                    m_mtxSockets;
+};
+#endif /* __TACOPIE_HAS_IOCP */
+
+//!
+//! create a poller for the requested backend
+//! throws a tacopie_error if the backend is not available on the current platform
+//!
+//! \param eBackend backend to be used
+//! \return the newly created poller
+//!
+std::unique_ptr<poller_iface> create_poller(poller_backend eBackend = poller_backend::automatic);
+
+} // namespace tacopie
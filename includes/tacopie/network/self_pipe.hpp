@@ -22,6 +22,8 @@
 
 #pragma once
 
+#include <atomic>
+
 #include <tacopie/utils/typedefs.hpp>
 
 namespace tacopie {
@@ -29,6 +31,10 @@ namespace tacopie {
 //!
 //! used to force poll to wake up
 //! simply make poll watch for read events on one side of the pipe and write to the other side
+//! an eventfd is used on linux (both sides are the same fd), a loopback UDP socket on windows
+//!
+//! notifications are coalesced: once notified, the pipe is not written to again until clr_buffer() is called, as the
+//! poll thread is then already going to wake up and rescan.
 //!
 class self_pipe {
 public:
@@ -54,12 +60,13 @@ public:
   fd_t get_write_fd(void) const;
 
   //!
-  //! notify the self pipe (basically write to the pipe)
+  //! notify the self pipe (basically write to the pipe, unless a notification is already pending)
   //!
   void notify(void);
 
   //!
-  //! clear the pipe (basically read from the pipe)
+  //! clear the pipe (basically read from the pipe) and allow the next notification
+  //! must be called before the poll thread rescans what notifications are about
   //!
   void clr_buffer(void);
 
@@ -81,10 +88,15 @@ private:
   int               m_nAddrLen;
 #else
   //!
-  //! pipe file descriptors
+  //! pipe file descriptors (both are the same eventfd on linux)
   //!
   fd_t              m_fds[2];
 #endif /* _WIN32 */
+
+  //!
+  //! whether the pipe has been notified since the last clr_buffer()
+  //!
+  std::atomic<bool> m_bNotifyPending_a;
 };
 
 } // namespace tacopie
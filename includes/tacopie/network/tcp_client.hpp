@@ -23,15 +23,40 @@
 #pragma once
 
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <string>
+#include <thread>
+#include <vector>
 
+#include <tacopie/network/frame_codec.hpp>
 #include <tacopie/network/io_service.hpp>
 #include <tacopie/network/tcp_socket.hpp>
+#include <tacopie/utils/inplace_function.hpp>
 #include <tacopie/utils/typedefs.hpp>
 
+#ifndef __TACOPIE_CONTINUOUS_READ_SIZE
+#define __TACOPIE_CONTINUOUS_READ_SIZE 16384
+#endif /* __TACOPIE_CONTINUOUS_READ_SIZE */
+
+#ifndef __TACOPIE_CONTINUOUS_READ_MAX_SIZE
+#define __TACOPIE_CONTINUOUS_READ_MAX_SIZE (1024 * 1024)
+#endif /* __TACOPIE_CONTINUOUS_READ_MAX_SIZE */
+
+//! maximum number of bytes of a file sent on each write event by async_sendfile
+#ifndef __TACOPIE_SENDFILE_MAX_SIZE
+#define __TACOPIE_SENDFILE_MAX_SIZE (1024 * 1024)
+#endif /* __TACOPIE_SENDFILE_MAX_SIZE */
+
+//! capacity requested for the pipe of each async_splice relay (the system default is kept if it can not be set)
+#ifndef __TACOPIE_SPLICE_PIPE_SIZE
+#define __TACOPIE_SPLICE_PIPE_SIZE (256 * 1024)
+#endif /* __TACOPIE_SPLICE_PIPE_SIZE */
+
 namespace tacopie {
 
 //!
@@ -94,6 +119,31 @@ public:
   //!
   void connect(const std::string& host, std::uint32_t port, std::uint32_t timeout_msecs = 0);
 
+  //!
+  //! callback to be called on async connect completion
+  //! takes whether the connection succeeded as a parameter
+  //!
+  typedef std::function<void(bool)> async_connect_callback_t;
+
+  //!
+  //! Connect the socket to the remote server without blocking the calling thread.
+  //! The in-progress connection is monitored by the io_service for writability and the timeout is enforced by the
+  //! io_service timers. The callback is executed by the io_service once the connection succeeded, failed or timed out.
+  //! Host resolution is still synchronous: prefer numeric addresses when connecting many clients at once.
+  //!
+  //! \param host Hostname of the target server
+  //! \param port Port of the target server
+  //! \param timeout_msecs maximum time to connect, 0 for no timeout
+  //! \param callback callback to be executed on connection completion
+  //!
+  void async_connect(const std::string& host, std::uint32_t port, std::uint32_t timeout_msecs,
+      const async_connect_callback_t& callback);
+
+  //!
+  //! \return whether an async connection is currently in progress
+  //!
+  bool is_connecting(void) const;
+
   //!
   //! Disconnect the tcp_client if it was currently connected.
   //!
@@ -102,6 +152,17 @@ public:
   //!
   void disconnect(bool bWaitForRemoval = false);
 
+  //!
+  //! Disconnect many clients at once, as disconnect would for each of them.
+  //! Their sockets are untracked with a single batch for each io_service and, if requested, waited for with a single
+  //! barrier: much faster than disconnecting the clients one by one when there are many of them.
+  //!
+  //! \param vctClients clients to be disconnected
+  //! \param wait_for_removal When sets to true, blocks until all the sockets have been effectively removed from their
+  //! io_service and that all the underlying callbacks have completed.
+  //!
+  static void disconnect_all(const std::vector<std::shared_ptr<tcp_client>>& vctClients, bool bWaitForRemoval = false);
+
   //!
   //! \return whether the client is currently connected or not
   //!
@@ -113,11 +174,46 @@ private:
   //!
   void call_disconnection_handler(void);
 
+  //!
+  //! io service write callback while an async connection is in progress
+  //! complete the connection and call the connect callback
+  //!
+  //! \param fd file description of the socket being connected
+  //!
+  void on_connect_available(fd_t fd);
+
+  //!
+  //! io service timer callback, called when an async connection timed out
+  //!
+  void on_connect_timeout(void);
+
+  //!
+  //! abort the async connection in progress, if any (the connect callback is not called)
+  //!
+  //! \param bWaitForRemoval block until the socket has been removed from the io_service
+  //!
+  void abort_async_connect(bool bWaitForRemoval);
+
+  //!
+  //! mark the end of the completion (success, failure or timeout) of an async connection, whose callback returned
+  //!
+  void end_connect_completion(void);
+
+  //!
+  //! wait until the completion of an async connection has returned from its callback (unless called from it)
+  //! once completed, the connection no longer accesses the client: it can be safely destroyed
+  //!
+  void wait_for_connect_completion(void);
+
 public:
   //!
   //! structure to store read requests result
   //!  * success: Whether the read operation has succeeded or not. If false, the client has been disconnected
-  //!  * buffer: Vector containing the read bytes
+  //!  * buffer: Vector containing the read bytes (left empty when the request supplied its own buffer)
+  //!  * size: Number of bytes read
+  //!
+  //! the buffer comes from the utils::buffer_pool and is given back to it once the callback returns:
+  //! move it out of the result to keep it
   //!
   struct read_result {
     //!
@@ -128,6 +224,29 @@ public:
     //! read bytes
     //!
     std::vector<char> buffer;
+    //!
+    //! number of bytes read
+    //!
+    std::size_t size;
+  };
+
+  //!
+  //! structure to store framed read results
+  //!  * success: Whether the read operation has succeeded or not. If false, the client has been disconnected (or
+  //! has received an invalid frame) and frames is empty
+  //!  * frames: all the complete frames received by the last read event, in order
+  //!
+  //! frames are views on the receive buffer of the codec: they are only valid until the callback returns
+  //!
+  struct frames_result {
+    //!
+    //! whether the operation succeeeded or not
+    //!
+    bool success;
+    //!
+    //! received frames
+    //!
+    std::vector<frame_codec::frame> frames;
   };
 
   //!
@@ -151,13 +270,38 @@ public:
   //! callback to be called on async read completion
   //! takes the read_result as a parameter
   //!
-  typedef std::function<void(read_result&)> async_read_callback_t;
+  //! stored in place (no allocation) for callables capturing a few pointers
+  //! move-only, contrary to the std::function it replaces: copyable callables are still accepted
+  //!
+  typedef utils::inplace_function<void(read_result&)> async_read_callback_t;
+
+  //!
+  //! callback to be called when frames have been received in framed read mode
+  //! takes the frames_result as a parameter
+  //!
+  //! stored in place (no allocation) for callables capturing a few pointers
+  //!
+  typedef utils::inplace_function<void(frames_result&)> async_frames_callback_t;
 
   //!
   //! callback to be called on async write completion
   //! takes the write_result as a parameter
   //!
-  typedef std::function<void(write_result&)> async_write_callback_t;
+  //! stored in place (no allocation) for callables capturing a few pointers
+  //! move-only, contrary to the std::function it replaces: copyable callables are still accepted
+  //!
+  typedef utils::inplace_function<void(write_result&)> async_write_callback_t;
+
+  //!
+  //! ref-counted immutable buffer
+  //! can be shared by several write requests (of the same or different clients) without being copied
+  //!
+  typedef std::shared_ptr<const std::vector<char>> shared_buffer_t;
+
+  //!
+  //! state of a relay started by async_splice (opaque)
+  //!
+  struct splice_relay;
 
 public:
   //!
@@ -165,8 +309,22 @@ public:
   //!  * size: Number of bytes to read
   //!  * async_read_callback: Callback to be called on a read operation completion,
   //! even though the operation read less bytes than requested.
+  //!  * buffer: Optional caller-supplied buffer of at least size bytes. When set, bytes are read directly into it
+  //! and read_result.buffer is left empty. The buffer must stay valid until the callback is called.
   //!
   struct read_request {
+    //!
+    //! ctor
+    //!
+    //! \param nSize number of bytes to read
+    //! \param callback callback to be executed on read operation completion
+    //! \param pBuf caller-supplied buffer of at least nSize bytes (optional)
+    //!
+    read_request(std::size_t nSize = 0, async_read_callback_t callback = nullptr, char* pBuf = nullptr)
+    : nSizeToRead(nSize)
+    , callbackAsyncRead(std::move(callback))
+    , pBuffer(pBuf) {}
+
     //!
     //! number of bytes to read
     //!
@@ -175,15 +333,75 @@ public:
     //! callback to be executed on read operation completion
     //!
     async_read_callback_t   callbackAsyncRead;
+    //!
+    //! caller-supplied buffer (optional)
+    //!
+    char*                   pBuffer;
   };
 
   //!
   //! structure to store write requests information
-  //!  * buffer: Bytes to be written
+  //! the callback is called once all the bytes of the request have been written (or on failure)
+  //! bytes are taken from the first buffer set among buffer, shared_buffer and user_buffer
+  //!  * buffer: Bytes to be written (owned by the request, prefer moving it in).
+  //! It is given back to the utils::buffer_pool once the callback has been called, so it can be acquired from it.
   //!  * async_write_callback: Callback to be called on a write operation completion,
   //! even though the operation wrote less bytes than requested.
+  //!  * shared_buffer: Ref-counted bytes to be written, released once the callback has been called
+  //!  * user_buffer, user_buffer_size: Caller-owned bytes to be written.
+  //! The buffer must stay valid until the callback is called, which is where the caller can release it.
+  //!  * from_file, file, file_offset, file_size: Region of a file to be sent instead (set by async_sendfile).
+  //!  * splice_relay: Relay the bytes are forwarded from instead (set by async_splice).
   //!
   struct write_request {
+    //!
+    //! ctor
+    //!
+    //! \param vctBuf bytes to write (owned by the request)
+    //! \param callback callback to be executed on write operation completion
+    //!
+    write_request(std::vector<char> vctBuf = {}, async_write_callback_t callback = nullptr)
+    : vctBuffer(std::move(vctBuf))
+    , callbackAsyncWrite(std::move(callback))
+    , pUserBuffer(nullptr)
+    , uUserBufferSize(0)
+    , bFromFile(false)
+    , hFile()
+    , uFileOffset(0)
+    , uFileSize(0) {}
+
+    //!
+    //! ctor
+    //!
+    //! \param ptrBuf ref-counted bytes to write
+    //! \param callback callback to be executed on write operation completion
+    //!
+    write_request(const shared_buffer_t& ptrBuf, async_write_callback_t callback = nullptr)
+    : callbackAsyncWrite(std::move(callback))
+    , ptrSharedBuffer(ptrBuf)
+    , pUserBuffer(nullptr)
+    , uUserBufferSize(0)
+    , bFromFile(false)
+    , hFile()
+    , uFileOffset(0)
+    , uFileSize(0) {}
+
+    //!
+    //! ctor
+    //!
+    //! \param pBuf caller-owned bytes to write, must stay valid until the callback is called
+    //! \param uSize number of bytes to write
+    //! \param callback callback to be executed on write operation completion
+    //!
+    write_request(const char* pBuf, std::size_t uSize, async_write_callback_t callback = nullptr)
+    : callbackAsyncWrite(std::move(callback))
+    , pUserBuffer(pBuf)
+    , uUserBufferSize(uSize)
+    , bFromFile(false)
+    , hFile()
+    , uFileOffset(0)
+    , uFileSize(0) {}
+
     //!
     //! bytes to write
     //!
@@ -192,22 +410,350 @@ public:
     //! callback to be executed on write operation completion
     //!
     async_write_callback_t  callbackAsyncWrite;
+    //!
+    //! ref-counted bytes to write (optional)
+    //!
+    shared_buffer_t         ptrSharedBuffer;
+    //!
+    //! caller-owned bytes to write (optional)
+    //!
+    const char*             pUserBuffer;
+    //!
+    //! number of caller-owned bytes to write
+    //!
+    std::size_t             uUserBufferSize;
+    //!
+    //! whether bytes are taken from a file
+    //!
+    bool                    bFromFile;
+    //!
+    //! file to send (caller-owned, must stay open until the callback is called)
+    //!
+    file_handle_t           hFile;
+    //!
+    //! offset of the first byte to send in the file
+    //!
+    std::uint64_t           uFileOffset;
+    //!
+    //! number of bytes of the file to send
+    //!
+    std::size_t             uFileSize;
+    //!
+    //! relay the bytes are forwarded from (optional)
+    //!
+    std::shared_ptr<splice_relay> ptrSpliceRelay;
+
+    //!
+    //! \return whether the bytes are transferred by the kernel (file or relay) instead of being in memory
+    //!
+    bool
+    is_zero_copy(void) const {
+      return bFromFile || ptrSpliceRelay;
+    }
+
+    //!
+    //! \return the bytes to write
+    //!
+    const char*
+    data(void) const {
+      if (is_zero_copy()) { return nullptr; }
+      if (!vctBuffer.empty()) { return vctBuffer.data(); }
+      if (ptrSharedBuffer) { return ptrSharedBuffer->data(); }
+      return pUserBuffer;
+    }
+
+    //!
+    //! \return the number of bytes to write
+    //!
+    std::size_t
+    size(void) const {
+      if (bFromFile) { return uFileSize; }
+      if (!vctBuffer.empty()) { return vctBuffer.size(); }
+      if (ptrSharedBuffer) { return ptrSharedBuffer->size(); }
+      return pUserBuffer ? uUserBufferSize : 0;
+    }
   };
 
 public:
   //!
   //! async read operation
   //!
-  //! \param request read request information
+  //! Requests are move-only (their callback is an inplace_function): there is no const& overload anymore, lvalue
+  //! requests must be passed with std::move (braced initializers are unaffected).
+  //!
+  //! \param request read request information (moved into the queue of pending requests)
   //!
-  void async_read(const read_request& request);
+  void async_read(read_request&& request);
 
   //!
   //! async write operation
   //!
-  //! \param request write request information
+  //! The callback is called with a failed result for the requests still pending when the client is disconnected.
+  //! As for async_read, requests are move-only: lvalue requests must be passed with std::move.
+  //!
+  //! \param request write request information (moved into the queue of pending requests, buffer is not copied)
+  //!
+  void async_write(write_request&& request);
+
+  //!
+  //! async file transfer: send a region of a file without copying it through userspace (see tcp_socket::sendfile)
+  //! the transfer is queued with the write requests (ordered with them and counted by the watermarks), and progresses
+  //! on write events by chunks of at most __TACOPIE_SENDFILE_MAX_SIZE bytes
+  //!
+  //! \param hFile file to be sent, must stay open until the callback is called
+  //! \param uOffset offset of the first byte to send
+  //! \param uSize number of bytes to send
+  //! \param callback callback to be executed once the region has been sent (or on failure)
+  //!
+  void async_sendfile(file_handle_t hFile, std::uint64_t uOffset, std::size_t uSize, async_write_callback_t callback = nullptr);
+
+  //!
+  //! async relay: forward the bytes received by another client to this one through a pipe, without copying them
+  //! through userspace (splice, linux only: an exception is thrown on other platforms)
+  //!
+  //! the relay is queued with the write requests of this client (the pipe is drained on its write events once the
+  //! requests queued before are written). the source is read on its read events while the pipe has room, and stops
+  //! being read while the pipe is full, so that a slow client does not make the relay buffer more than a pipe.
+  //!
+  //! the source must not have pending reads nor be in continuous read mode (nor have been on a connection whose bytes
+  //! are received by the io_service, see io_service::set_recv_completions), and can not be read by other means
+  //! until the callback is called (pause_read and resume_read have no effect on it). it must stay alive until the
+  //! callback is called, but can be disconnected meanwhile (which makes the relay fail).
+  //!
+  //! the callback is called with success once uSize bytes have been relayed, or the source has been closed by the
+  //! remote host, and without success if the source or this client failed (this client is then disconnected).
+  //!
+  //! \param source client the bytes are read from
+  //! \param uSize number of bytes to relay, 0 to relay until the source is closed by the remote host
+  //! \param callback callback to be executed once the relay completed (or on failure)
+  //!
+  void async_splice(tcp_client& source, std::size_t uSize = 0, async_write_callback_t callback = nullptr);
+
+public:
+  //!
+  //! start continuous read mode
+  //! the socket is switched to non-blocking mode and stays monitored for reads until stop_continuous_read is called:
+  //! whenever data is available, the socket is drained until no more data is available (or
+  //! __TACOPIE_CONTINUOUS_READ_MAX_SIZE bytes have been read) into a growable receive buffer and the callback is called
+  //! once with all the bytes read. there is no need to re-arm the read from the callback
+  //! when the io_service supports it (io_uring backend), the bytes are received by the io_service itself, up to
+  //! uReadSize bytes at once, instead of being read from the socket (see io_service::set_recv_completions)
+  //!
+  //! async_read can not be used while continuous read mode is enabled
+  //! the client must be connected and must not have any pending read request
+  //!
+  //! \param callback callback to be executed whenever bytes have been read (or on failure)
+  //! \param uReadSize number of bytes the receive buffer is grown by, at least, before each read
+  //!
+  void start_continuous_read(async_read_callback_t callback, std::size_t uReadSize = __TACOPIE_CONTINUOUS_READ_SIZE);
+
+  //!
+  //! start continuous read mode with framing
+  //! same as start_continuous_read, but the socket is drained directly into the receive buffer of the codec and the
+  //! callback is called once per read event with all the complete frames received (and not called at all if no frame
+  //! has been completed). an invalid frame disconnects the client.
+  //! stop_continuous_read stops framed read mode too, the bytes of an incomplete frame are then dropped
+  //!
+  //! \param codec codec used to split the received bytes into frames
+  //! \param callback callback to be executed whenever frames have been received (or on failure)
+  //! \param uReadSize number of bytes reserved in the receive buffer, at least, before each read
+  //!
+  void start_framed_read(frame_codec codec, async_frames_callback_t callback, std::size_t uReadSize = __TACOPIE_CONTINUOUS_READ_SIZE);
+
+  //!
+  //! stop continuous read mode and switch the socket back to blocking mode
+  //! can be called from the continuous read callback
+  //!
+  void stop_continuous_read(void);
+
+  //!
+  //! \return whether continuous read mode is enabled
+  //!
+  bool is_continuous_read_enabled(void) const;
+
+public:
+  //!
+  //! enable or disable write coalescing
+  //! when enabled, all the pending write requests (up to __TACOPIE_MAX_IO_BUFFERS) are gathered and sent
+  //! in a single system call whenever the socket is writable, instead of one system call per request
+  //! disabled by default
+  //!
+  //! \param bEnabled whether write coalescing should be enabled
+  //!
+  void set_write_coalescing(bool bEnabled);
+
+  //!
+  //! \return whether write coalescing is enabled
+  //!
+  bool is_write_coalescing_enabled(void) const;
+
+public:
+  //!
+  //! set the watermarks of the write queue, in bytes and/or in number of requests (0 disables a watermark)
+  //! once the pending writes reach a high watermark, the high watermark handler is called (and the reads of the paired
+  //! client are paused). once they went back below the low watermarks, the drain handler is called (and the reads of
+  //! the paired client are resumed). disabled by default
+  //!
+  //! \param uHighBytes high watermark in pending bytes
+  //! \param uLowBytes low watermark in pending bytes (must be lower than uHighBytes)
+  //! \param uHighRequests high watermark in pending requests
+  //! \param uLowRequests low watermark in pending requests (must be lower than uHighRequests)
+  //!
+  void set_write_watermarks(std::size_t uHighBytes, std::size_t uLowBytes,
+      std::size_t uHighRequests = 0, std::size_t uLowRequests = 0);
+
+  //!
+  //! bound the write queue: async_write throws if the request would make the pending bytes exceed the limit
+  //! (a request is always accepted when nothing is pending, whatever its size)
+  //!
+  //! \param uMaxBytes maximum number of pending bytes, 0 for an unbounded queue (default)
+  //!
+  void set_max_pending_write_bytes(std::size_t uMaxBytes);
+
+  //!
+  //! \return the number of bytes queued and not written yet
+  //!
+  std::size_t pending_write_bytes(void) const;
+
+  //!
+  //! \return the number of write requests not fully written yet
+  //!
+  std::size_t pending_write_requests(void) const;
+
+  //!
+  //! \return whether the pending writes reached a high watermark and did not drain yet
+  //!
+  bool is_above_high_watermark(void) const;
+
+  //!
+  //! watermark handler
+  //! called when the pending writes reach a high watermark, or drain below the low watermarks
+  //!
+  typedef std::function<void()> watermark_handler_t;
+
+  //!
+  //! set on high watermark handler
+  //! called from the thread calling async_write
+  //!
+  //! \param handlerHighWatermark the handler to be called when a high watermark is reached
+  //!
+  void set_on_high_watermark_handler(const watermark_handler_t& handlerHighWatermark);
+
+  //!
+  //! set on drain handler
+  //! called from the io_service once the write callbacks of the drained requests have been executed
+  //!
+  //! \param handlerDrain the handler to be called when the pending writes went back below the low watermarks
+  //!
+  void set_on_drain_handler(const watermark_handler_t& handlerDrain);
+
+  //!
+  //! set on flush handler
+  //! called from the io_service once the write callbacks of the last pending requests have been executed, or from the
+  //! thread disconnecting the client when pending requests are cleared
+  //!
+  //! \param handlerFlush the handler to be called once no write request is pending anymore
+  //!
+  void set_on_flush_handler(const watermark_handler_t& handlerFlush);
+
+  //!
+  //! pair this client with the client its written bytes come from (proxy mode)
+  //! the reads of the paired client are paused while this client is above its high watermark, so that a slow consumer
+  //! slows down the producer instead of growing the write queue. only a weak reference to the paired client is kept
+  //!
+  //! \param ptrClient paired client (null to unpair)
+  //!
+  void set_paired_client(const std::shared_ptr<tcp_client>& ptrClient);
+
+public:
+  //!
+  //! stop monitoring the socket for reads: bytes stay in the kernel buffer (and the peer is eventually throttled by
+  //! TCP flow control) until resume_read is called. read requests can still be queued in the meantime
+  //! the read timeout does not apply while reads are paused
+  //!
+  void pause_read(void);
+
+  //!
+  //! monitor the socket for reads again, if a read is pending
+  //!
+  void resume_read(void);
+
+  //!
+  //! \return whether reads are paused
+  //!
+  bool is_read_paused(void) const;
+
+public:
+  //!
+  //! set the idle timeout: the client is disconnected if no byte has been read or written for that long
+  //! timeouts are enforced by a single io_service timer per client, the disconnection handler is called on expiry
+  //!
+  //! \param uTimeoutMsecs idle timeout in milliseconds, 0 to disable it (default)
+  //!
+  void set_idle_timeout(std::uint32_t uTimeoutMsecs);
+
+  //!
+  //! \return the idle timeout in milliseconds (0 if disabled)
+  //!
+  std::uint32_t get_idle_timeout(void) const;
+
+  //!
+  //! set the read timeout: the client is disconnected if a read is pending (async_read or continuous read mode)
+  //! and no byte has been received for that long. the delay starts when the read becomes pending
+  //!
+  //! \param uTimeoutMsecs read timeout in milliseconds, 0 to disable it (default)
+  //!
+  void set_read_timeout(std::uint32_t uTimeoutMsecs);
+
+  //!
+  //! \return the read timeout in milliseconds (0 if disabled)
+  //!
+  std::uint32_t get_read_timeout(void) const;
+
+public:
+  //!
+  //! structure to store the I/O statistics of a client
+  //! only maintained when the library is built with __TACOPIE_METRICS_ENABLED (always 0 otherwise)
+  //!  * bytes_read, bytes_written: number of bytes received and sent
+  //!  * read_syscalls, write_syscalls: number of system calls issued to receive and send them
+  //!
+  struct io_statistics {
+    //!
+    //! number of bytes received
+    //!
+    std::uint64_t bytes_read;
+    //!
+    //! number of bytes sent
+    //!
+    std::uint64_t bytes_written;
+    //!
+    //! number of recv system calls
+    //!
+    std::uint64_t read_syscalls;
+    //!
+    //! number of send/writev system calls
+    //!
+    std::uint64_t write_syscalls;
+  };
+
+  //!
+  //! \return the I/O statistics of this client (accumulated across reconnections)
+  //!
+  io_statistics get_io_statistics(void) const;
+
+public:
+  //!
+  //! set the tuning options of the underlying socket (see tacopie::socket_options)
+  //! applied immediately when connected, and on every subsequent connect
+  //!
+  //! \param options socket options
+  //!
+  void set_socket_options(const socket_options& options);
+
+  //!
+  //! \return the tuning options of the underlying socket
   //!
-  void async_write(const write_request& request);
+  const socket_options& get_socket_options(void) const;
 
 public:
   //!
@@ -226,6 +772,14 @@ public:
   //!
   const std::shared_ptr<tacopie::io_service>& get_io_service(void) const;
 
+  //!
+  //! set where the read and write callbacks of this client are executed (see io_service::callback_execution_mode)
+  //! the client must be connected, the io_service default mode applies again after a reconnection
+  //!
+  //! \param eMode callback execution mode
+  //!
+  void set_callback_execution_mode(io_service::callback_execution_mode eMode);
+
 public:
   //!
   //! disconnection handle
@@ -258,6 +812,144 @@ private:
   //!
   void on_write_available(fd_t fd);
 
+  //!
+  //! handle the read availability of the socket, executed by on_read_available
+  //!
+  //! \param bDestroyed set if the client is destroyed by a callback (the client must then be left untouched)
+  //!
+  void process_read_available(bool& bDestroyed);
+
+  //!
+  //! handle the write availability of the socket, executed by on_write_available
+  //!
+  //! \param bDestroyed set if the client is destroyed by a callback (the client must then be left untouched)
+  //!
+  void process_write_available(bool& bDestroyed);
+
+private:
+  //!
+  //! io service timer callback, checks the idle and read timeouts
+  //! disconnects the client on expiry, reschedules itself for the nearest deadline otherwise
+  //!
+  void on_timeout_check(void);
+
+  //!
+  //! (re)schedule the timeout timer according to the current timeouts
+  //! does nothing if the client is not connected or if no timeout is enabled
+  //!
+  void start_timeout_timer(void);
+
+  //!
+  //! cancel the timeout timer, waiting for its callback to complete if it is being executed
+  //!
+  void stop_timeout_timer(void);
+
+  //!
+  //! wait for the timeout check that disconnected the client to complete, if any
+  //!
+  void wait_for_expired_timeout_check(void);
+
+  //!
+  //! reset the idle and read clocks, called on connection
+  //!
+  void reset_timeout_clocks(void);
+
+private:
+  //!
+  //! mark the client as connected: its socket is tracked by the io_service until the next disconnection
+  //!
+  void set_connected(void);
+
+  //!
+  //! removal state of the socket, shared with the removal callback (which may run after the client is destroyed)
+  //!  * bIsRemoved: whether the socket has been removed from the io_service since the last disconnection (true when never connected)
+  //!  * mtx: removal state thread safety
+  //!  * cv: condition variable to wait on removal
+  //!  * ptrSocketPendingClose: socket disconnected before its removal, closed once removed
+  //!
+  struct removal_state {
+    //! the io service may be destroyed without having removed the socket
+    ~removal_state(void) {
+      if (ptrSocketPendingClose) { ptrSocketPendingClose->close(); }
+    }
+
+    bool                        bIsRemoved = true;
+    std::mutex                  mtx;
+    std::condition_variable     cv;
+    std::unique_ptr<tcp_socket> ptrSocketPendingClose;
+  };
+
+  //!
+  //! io service removal callback
+  //! called by the io service once the socket has been removed after a disconnection
+  //!
+  //! \param stateRemoval removal state of the client the socket belongs to
+  //!
+  static void on_removal(removal_state& stateRemoval);
+
+  //!
+  //! close the socket, or hand it to the removal callback when it is not removed yet (disconnection without waiting
+  //! for the removal): its fd can not be reused by a new socket while events are still processed for this one
+  //!
+  //! \param tcpSocket socket of the client, reset to an unopened socket
+  //! \param stateRemoval removal state of the client the socket belongs to
+  //!
+  static void close_socket(tcp_socket& tcpSocket, removal_state& stateRemoval);
+
+  //!
+  //! tcp_server sets its own flush handler on the clients it drains
+  //!
+  friend class tcp_server;
+
+  //!
+  //! set the flush handler of the tcp_server draining the client
+  //! called like the flush handler, which is left untouched
+  //!
+  //! \param handlerServerFlush the handler to be called once no write request is pending anymore
+  //!
+  void set_on_server_flush_handler(const watermark_handler_t& handlerServerFlush);
+
+  //!
+  //! first step of a disconnection: abort the connection in progress and update the state, then stop the timeouts
+  //! and clear the pending requests if this call performs the disconnection
+  //!
+  //! \param bWaitForRemoval when the disconnection is performed by another thread, wait until it completed
+  //! \return whether this call performs the disconnection, in which case the socket must then be untracked and closed
+  //!
+  bool begin_disconnection(bool bWaitForRemoval);
+
+  //!
+  //! wait until the socket has been removed after a disconnection, possibly performed by another thread
+  //! does not wait when called from a read or write callback of the socket: the removal completes once it returned
+  //!
+  void wait_for_removal(void);
+
+  //!
+  //! mark the beginning of the execution of a read or write callback of the socket by the calling thread
+  //!
+  //! \param bIsRead whether this is the read or the write callback
+  //! \param bDestroyed set if the client is destroyed by the callback (the callback must then leave the client untouched)
+  //!
+  void begin_socket_callback(bool bIsRead, bool& bDestroyed);
+
+  //!
+  //! mark the end of the execution of a read or write callback of the socket
+  //!
+  //! \param bIsRead whether this is the read or the write callback
+  //!
+  void end_socket_callback(bool bIsRead);
+
+  //!
+  //! \return whether the calling thread is executing a read or write callback of the socket
+  //!
+  bool is_executing_socket_callback(void);
+
+  //!
+  //! wait until the read and write callbacks of the socket executed by other threads returned
+  //! only needed when destroyed by a callback of the socket: the removal is not awaited in that case
+  //!
+  void wait_for_socket_callbacks(void);
+
 private:
   //!
   //! Clear pending read requests (basically empty the queue of read requests)
@@ -266,6 +958,7 @@ private:
 
   //!
   //! Clear pending write requests (basically empty the queue of write requests)
+  //! The callbacks of the dropped requests are called with a failed result.
   //!
   void clear_write_requests(void);
 
@@ -280,15 +973,162 @@ private:
   //!
   async_read_callback_t process_read(read_result& result);
 
+  //!
+  //! read from the socket, or take the bytes received by the io_service once completion based receive has been
+  //! enabled for the connection
+  //! must be called with the read requests lock held
+  //!
+  //! \param pBuffer buffer to be filled
+  //! \param uSizeToRead size of the buffer
+  //! \return number of bytes read (0 if none is available yet)
+  //!
+  std::size_t receive(char* pBuffer, std::size_t uSizeToRead);
+
+  //!
+  //! enable completion based receive for the continuous read mode, if supported by the io_service
+  //! must be called with the read requests lock held
+  //!
+  void enable_recv_completions(void);
+
+  //!
+  //! state of the framed read mode
+  //!  * codec: codec splitting the received bytes into frames
+  //!  * callbackFrames: callback set in start_framed_read
+  //!  * vctFrames: decoded frames storage, reused across reads
+  //!
+  struct framed_read {
+    frame_codec                     codec;
+    async_frames_callback_t         callbackFrames;
+    std::vector<frame_codec::frame> vctFrames;
+  };
+
+  //!
+  //! process continuous read operations when available
+  //! drain the socket into the receive buffer (or the receive buffer of the codec in framed read mode) and fill in
+  //! the result
+  //!
+  //! \param result result of the read operation (its buffer is left empty in framed read mode)
+  //! \param ptrFramedRead set to the framed read state in framed read mode
+  //! \return the continuous read callback (null if continuous read mode has been stopped or in framed read mode)
+  //!
+  std::shared_ptr<async_read_callback_t> process_continuous_read(read_result& result, std::shared_ptr<framed_read>& ptrFramedRead);
+
+  //!
+  //! io service read callback, continuous read mode
+  //!
+  //! \param bDestroyed set if the client is destroyed by the callback (the client must then be left untouched)
+  //!
+  void on_continuous_read_available(bool& bDestroyed);
+
+  //!
+  //! decode the frames received by the last read and deliver them, framed read mode
+  //!
+  //! \param framedRead framed read state
+  //! \param bSuccess whether the last read succeeded
+  //! \param bDestroyed set if the client is destroyed by the callback (the client must then be left untouched)
+  //!
+  void deliver_frames(framed_read& framedRead, bool bSuccess, bool& bDestroyed);
+
+  //!
+  //! completed write request, waiting for its callback to be executed
+  //!
+  struct write_completion {
+    //!
+    //! callback set in the write request (may be null)
+    //!
+    async_write_callback_t  callbackAsyncWrite;
+    //!
+    //! result of the write operation
+    //!
+    write_result            resultWrite;
+    //!
+    //! bytes of the request, released to the buffer pool once the callback has been called
+    //!
+    std::vector<char>       vctBuffer;
+  };
+
   //!
   //! process write operations when available
   //! basically called whenever on_write_available is called and try to write to the socket
-  //! handle possible case of failure and fill in the result
+  //! progress of partially written requests is kept until they are fully written
+  //! handle possible case of failure and fill in the completions
   //!
-  //! \param result result of the write operation
-  //! \return the callback to be executed (set in the write request) on read completion (may be null)
+  //! \param vctCompletions filled in with the requests that completed (fully written, or failed)
+  //! \param handlerFlush filled in with the flush handler if no write request is pending anymore
+  //! \param handlerServerFlush filled in with the server flush handler if no write request is pending anymore
+  //! \return whether the pending writes went back below the low watermarks
   //!
-  async_write_callback_t process_write(write_result& result);
+  bool process_write(std::vector<write_completion>& vctCompletions, watermark_handler_t& handlerFlush,
+      watermark_handler_t& handlerServerFlush);
+
+  //!
+  //! process the relay at the front of the write queue, must be called with m_mtxWriteRequests locked
+  //! drain the pipe into the socket, and complete the request once the source is done and the pipe is empty
+  //!
+  //! \param vctCompletions filled in with the relay request if it completed
+  //!
+  void process_splice_write(std::vector<write_completion>& vctCompletions);
+
+private:
+  //!
+  //! io service read callback of the source of a relay: move the available bytes into the pipe of the relay
+  //!
+  //! \param ptrRelay relay the source is read for
+  //!
+  static void on_splice_source_readable(const std::shared_ptr<splice_relay>& ptrRelay);
+
+  //!
+  //! schedule the write callback of the client a relay writes to, must be called with the relay locked
+  //!
+  //! \param relay relay whose pipe has bytes to be written (or whose source is done)
+  //!
+  static void wakeup_splice_target(splice_relay& relay);
+
+  //!
+  //! stop reading the source of a relay and release it, must be called with the relay locked
+  //!
+  //! \param relay relay whose source is done
+  //!
+  static void stop_splice_source(splice_relay& relay);
+
+  //!
+  //! abort a relay whose request is not in the write queue anymore (failure or disconnection of the target)
+  //!
+  //! \param relay relay to be aborted
+  //!
+  static void abort_splice(splice_relay& relay);
+
+  //!
+  //! abort the relay reading from this client, if any (disconnection of the source)
+  //!
+  //! \param ptrRelay relay reading from this client (may be null)
+  //!
+  static void detach_splice_source(const std::shared_ptr<splice_relay>& ptrRelay);
+
+private:
+  //!
+  //! update the watermark state after requests have been queued, must be called with m_mtxWriteRequests locked
+  //!
+  //! \return whether a high watermark has just been reached
+  //!
+  bool update_high_watermark(void);
+
+  //!
+  //! update the watermark state after requests have been written, must be called with m_mtxWriteRequests locked
+  //!
+  //! \return whether the pending writes have just drained below the low watermarks
+  //!
+  bool update_low_watermark(void);
+
+  //!
+  //! call the high watermark handler and pause the reads of the paired client
+  //!
+  void on_high_watermark(void);
+
+  //!
+  //! call the drain handler and resume the reads of the paired client
+  //!
+  void on_drain(void);
 
 private:
   //!
@@ -307,6 +1147,52 @@ private:
   //!
   std::atomic<bool>                     m_bIsConnected_a = ATOMIC_VAR_INIT(false);
 
+  //!
+  //! removal state of the socket since the last disconnection
+  //!
+  std::shared_ptr<removal_state>        m_ptrRemovalState = std::make_shared<removal_state>();
+
+  //!
+  //! threads executing the read and write callbacks of the socket (default id if none)
+  //! notified through the condition variable once a callback returned
+  //! the flags are set if the client is destroyed by the callback (the callback must then leave the client untouched)
+  //!
+  std::thread::id                       m_readingThreadId;
+  bool*                                 m_pbDestroyedByReadCallback = nullptr;
+  std::thread::id                       m_writingThreadId;
+  bool*                                 m_pbDestroyedByWriteCallback = nullptr;
+  std::mutex                            m_mtxSocketCallbacks;
+  std::condition_variable               m_cvSocketCallbacks;
+
+  //!
+  //! whether an async connection is in progress
+  //!
+  std::atomic<bool>                     m_bIsConnecting_a = ATOMIC_VAR_INIT(false);
+
+  //!
+  //! callback of the async connection in progress
+  //!
+  async_connect_callback_t              m_callbackConnect;
+
+  //!
+  //! timer enforcing the timeout of the async connection in progress (0 if none)
+  //!
+  io_service::timer_id_t                m_uConnectTimerId = 0;
+
+  //!
+  //! async connection thread safety
+  //!
+  std::mutex                            m_mtxConnect;
+
+  //!
+  //! thread executing the completion of the async connection (default id if none)
+  //! notified through the condition variable once the completion returned from its callback
+  //! the flag is set if the client is destroyed by the callback (the completion must then leave the client untouched)
+  //!
+  std::thread::id                       m_completingConnectThreadId;
+  bool*                                 m_pbDestroyedByConnectCallback = nullptr;
+  std::condition_variable               m_cvConnect;
+
   //!
   //! read requests
   //!
@@ -314,10 +1200,134 @@ private:
   //!
   //! write requests
   //!
-  std::queue<write_request>             m_queWriteRequests;
+  std::deque<write_request>             m_queWriteRequests;
+  //!
+  //! number of bytes of the front write request that have already been written
+  //!
+  std::size_t                           m_uWriteOffset = 0;
+  //!
+  //! completed write requests, reused across write events to avoid reallocations
+  //!
+  std::vector<write_completion>         m_vctWriteCompletions;
+  //!
+  //! whether write coalescing is enabled
+  //!
+  std::atomic<bool>                     m_bWriteCoalescing_a = ATOMIC_VAR_INIT(false);
+
+  //!
+  //! number of bytes queued and not written yet (updated with m_mtxWriteRequests locked)
+  //!
+  std::atomic<std::size_t>              m_uPendingWriteBytes_a = ATOMIC_VAR_INIT(0);
+  //!
+  //! number of write requests not fully written yet (updated with m_mtxWriteRequests locked)
+  //!
+  std::atomic<std::size_t>              m_uPendingWriteRequests_a = ATOMIC_VAR_INIT(0);
+  //!
+  //! write queue watermarks (0 if disabled)
+  //!
+  std::size_t                           m_uHighWatermarkBytes    = 0;
+  std::size_t                           m_uLowWatermarkBytes     = 0;
+  std::size_t                           m_uHighWatermarkRequests = 0;
+  std::size_t                           m_uLowWatermarkRequests  = 0;
+  //!
+  //! maximum number of pending bytes (0 if unbounded)
+  //!
+  std::size_t                           m_uMaxPendingWriteBytes = 0;
+  //!
+  //! whether a high watermark has been reached and the pending writes did not drain yet
+  //!
+  std::atomic<bool>                     m_bAboveHighWatermark_a = ATOMIC_VAR_INIT(false);
+  //!
+  //! high watermark, drain and flush handlers (protected by m_mtxWriteRequests)
+  //!
+  watermark_handler_t                   m_handlerHighWatermark;
+  watermark_handler_t                   m_handlerDrain;
+  watermark_handler_t                   m_handlerFlush;
+  //!
+  //! flush handler of the tcp_server draining the client, independent from the one set by the user (protected by
+  //! m_mtxWriteRequests)
+  //!
+  watermark_handler_t                   m_handlerServerFlush;
+  //!
+  //! client whose reads are paused while this client is above its high watermark (protected by m_mtxWriteRequests)
+  //!
+  std::weak_ptr<tcp_client>             m_ptrPairedClient;
+
+  //!
+  //! whether reads are paused
+  //!
+  std::atomic<bool>                     m_bReadPaused_a = ATOMIC_VAR_INIT(false);
+
+  //!
+  //! I/O statistics (read ones updated with m_mtxReadRequests locked, write ones with m_mtxWriteRequests locked)
+  //!
+  std::atomic<std::uint64_t>            m_uBytesRead_a     = ATOMIC_VAR_INIT(0);
+  std::atomic<std::uint64_t>            m_uBytesWritten_a  = ATOMIC_VAR_INIT(0);
+  std::atomic<std::uint64_t>            m_uReadSyscalls_a  = ATOMIC_VAR_INIT(0);
+  std::atomic<std::uint64_t>            m_uWriteSyscalls_a = ATOMIC_VAR_INIT(0);
+
+  //!
+  //! relay reading from this client (null if none, protected by m_mtxReadRequests), see async_splice
+  //!
+  std::shared_ptr<splice_relay>         m_ptrSpliceRelay;
+
+  //!
+  //! continuous read callback (null when continuous read mode is disabled)
+  //! stored in a shared_ptr so that it can be copied out of the lock without a std::function copy
+  //!
+  std::shared_ptr<async_read_callback_t> m_ptrContinuousReadCallback;
+  //!
+  //! framed read mode state (null unless framed read mode is enabled)
+  //!
+  std::shared_ptr<framed_read>          m_ptrFramedRead;
+  //!
+  //! number of bytes the receive buffer is grown by before each read in continuous read mode
+  //!
+  std::size_t                           m_uContinuousReadSize = __TACOPIE_CONTINUOUS_READ_SIZE;
+  //!
+  //! receive buffer of the continuous read mode, reused across reads when not kept by the callback
+  //!
+  std::vector<char>                     m_vctReceiveBuffer;
+  //!
+  //! whether continuous read mode is enabled
+  //!
+  std::atomic<bool>                     m_bContinuousRead_a = ATOMIC_VAR_INIT(false);
+  //!
+  //! whether completion based receive has been enabled on the connection (the io_service may hold bytes received for it)
+  //!
+  std::atomic<bool>                     m_bRecvCompletions_a = ATOMIC_VAR_INIT(false);
+
+  //!
+  //! idle timeout in milliseconds (0 if disabled)
+  //!
+  std::atomic<std::uint32_t>            m_uIdleTimeoutMsecs_a = ATOMIC_VAR_INIT(0);
+  //!
+  //! read timeout in milliseconds (0 if disabled)
+  //!
+  std::atomic<std::uint32_t>            m_uReadTimeoutMsecs_a = ATOMIC_VAR_INIT(0);
+  //!
+  //! last time bytes have been read or written (steady clock, in milliseconds)
+  //!
+  std::atomic<std::int64_t>             m_nLastActivityMsecs_a = ATOMIC_VAR_INIT(0);
+  //!
+  //! last time bytes have been read, or a read became pending (steady clock, in milliseconds)
+  //!
+  std::atomic<std::int64_t>             m_nLastReadMsecs_a = ATOMIC_VAR_INIT(0);
+  //!
+  //! timer checking the timeouts (0 if none)
+  //!
+  io_service::timer_id_t                m_uTimeoutTimerId = 0;
+  //!
+  //! timer whose check disconnected the client (0 if none), waited for on destruction
+  //!
+  io_service::timer_id_t                m_uExpiredTimeoutTimerId = 0;
+  //!
+  //! timeout timer thread safety
+  //!
+  std::mutex                            m_mtxTimeout;
 
   //!
-  //! read requests thread safety
+  //! read requests thread safety (also protects the continuous read mode state)
   //!
   std::mutex                            m_mtxReadRequests;
   //!
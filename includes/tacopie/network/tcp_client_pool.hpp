@@ -0,0 +1,252 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <tacopie/network/io_service.hpp>
+#include <tacopie/network/tcp_client.hpp>
+
+//! maximum number of endpoints of a tcp_client_pool (the table of endpoints is never reallocated)
+#ifndef __TACOPIE_CLIENT_POOL_MAX_ENDPOINTS
+#define __TACOPIE_CLIENT_POOL_MAX_ENDPOINTS 64
+#endif /* __TACOPIE_CLIENT_POOL_MAX_ENDPOINTS */
+
+//! period of the maintenance of a tcp_client_pool (growth, reconnections and health checks)
+#ifndef __TACOPIE_CLIENT_POOL_MAINTENANCE_PERIOD_MSECS
+#define __TACOPIE_CLIENT_POOL_MAINTENANCE_PERIOD_MSECS 50
+#endif /* __TACOPIE_CLIENT_POOL_MAINTENANCE_PERIOD_MSECS */
+
+namespace tacopie {
+
+//!
+//! pool of outbound connections, keyed by host:port
+//!
+//! for each endpoint, the pool keeps between a minimum and a maximum number of connected tcp_clients:
+//!  * the minimum is connected (with async_connect) as soon as the endpoint is added
+//!  * checkout() hands out the most recently returned connection (LIFO, its state is most likely still in cache)
+//!  * checkout() is lock-free and never connects: when no connection is idle, it returns an empty lease and the pool
+//!    connects more clients in the background, up to the maximum
+//!  * idle connections are health checked periodically, and failed connections are reconnected with an exponential
+//!    backoff (with jitter)
+//!
+//! the background work is done by a periodic timer of the default io_service.
+//! leases must be released before the pool is destroyed, and the pool must not be destroyed from one of its clients
+//! callbacks.
+//!
+class tcp_client_pool {
+private:
+  //!
+  //! connections of an endpoint, defined in the translation unit
+  //!
+  struct endpoint;
+
+public:
+  //!
+  //! exclusive use of a pooled tcp_client, until released (or destroyed)
+  //! the client goes back to the idle connections of its endpoint if it is still connected, or gets reconnected
+  //! otherwise. the client must be left without pending operations (reads, writes, handlers) when released.
+  //!
+  class lease {
+  public:
+    //! ctor (empty lease)
+    lease(void) = default;
+    //! dtor (releases the client)
+    ~lease(void);
+
+    //! copy ctor
+    lease(const lease&) = delete;
+    //! assignment operator
+    lease& operator=(const lease&) = delete;
+
+    //! move ctor
+    lease(lease&& other);
+    //! move assignment operator
+    lease& operator=(lease&& other);
+
+  public:
+    //!
+    //! \return whether the lease holds a client
+    //!
+    explicit operator bool(void) const;
+
+    //!
+    //! \return the leased client (the lease must not be empty)
+    //!
+    tcp_client& operator*(void) const;
+    tcp_client* operator->(void) const;
+
+    //!
+    //! give the client back to the pool, leaving the lease empty
+    //!
+    void release(void);
+
+  private:
+    friend class tcp_client_pool;
+
+    //! ctor
+    lease(endpoint* pEndpoint, std::uint32_t uSlot);
+
+  private:
+    //!
+    //! endpoint and slot of the leased client
+    //!
+    endpoint*     m_pEndpoint = nullptr;
+    std::uint32_t m_uSlot     = 0;
+  };
+
+public:
+  //!
+  //! ctor
+  //!
+  //! \param uMinSize number of connections kept for each endpoint
+  //! \param uMaxSize maximum number of connections of each endpoint
+  //!
+  tcp_client_pool(std::size_t uMinSize, std::size_t uMaxSize);
+
+  //! dtor
+  ~tcp_client_pool(void);
+
+  //! copy ctor
+  tcp_client_pool(const tcp_client_pool&) = delete;
+  //! assignment operator
+  tcp_client_pool& operator=(const tcp_client_pool&) = delete;
+
+public:
+  //!
+  //! \param uTimeoutMsecs maximum time to connect a client, 0 for no timeout
+  //!
+  void set_connect_timeout(std::uint32_t uTimeoutMsecs);
+
+  //!
+  //! \param uIntervalMsecs delay between two health checks of the idle connections, 0 to disable health checks
+  //!
+  void set_health_check_interval(std::uint32_t uIntervalMsecs);
+
+  //!
+  //! the delay before a reconnection doubles after each failed attempt, from the minimum to the maximum
+  //! the first reconnection after a connection failure is immediate
+  //!
+  //! \param uMinBackoffMsecs delay before the second reconnection attempt
+  //! \param uMaxBackoffMsecs maximum delay between two reconnection attempts
+  //!
+  void set_reconnect_backoff(std::uint32_t uMinBackoffMsecs, std::uint32_t uMaxBackoffMsecs);
+
+public:
+  //!
+  //! add an endpoint to the pool and start connecting its minimum number of connections
+  //! does nothing if the endpoint is already part of the pool
+  //!
+  //! \param sHost hostname of the endpoint
+  //! \param uPort port of the endpoint
+  //!
+  void add_endpoint(const std::string& sHost, std::uint32_t uPort);
+
+  //!
+  //! take an idle connection of an endpoint, without blocking nor connecting
+  //!
+  //! \param sHost hostname of the endpoint
+  //! \param uPort port of the endpoint
+  //! \return lease of a connected client, empty if the endpoint is unknown or has no idle connection
+  //!
+  lease checkout(const std::string& sHost, std::uint32_t uPort);
+
+private:
+  //!
+  //! find an endpoint (lock-free)
+  //!
+  //! \return the endpoint, nullptr if unknown
+  //!
+  endpoint* find_endpoint(const std::string& sHost, std::uint32_t uPort) const;
+
+  //!
+  //! give a leased client back to its endpoint
+  //!
+  static void checkin(endpoint* pEndpoint, std::uint32_t uSlot);
+
+private:
+  //!
+  //! periodic maintenance of all the endpoints (growth, reconnections, health checks)
+  //!
+  void on_maintenance(void);
+
+  //!
+  //! maintenance of one endpoint, called with the maintenance mutex locked
+  //!
+  void maintain(const std::shared_ptr<endpoint>& ptrEndpoint, bool bHealthCheck);
+
+  //!
+  //! (re)connect the client of a slot owned by the maintenance
+  //!
+  void connect(const std::shared_ptr<endpoint>& ptrEndpoint, std::uint32_t uSlot);
+
+  //!
+  //! schedule the reconnection of a slot owned by the maintenance, according to its backoff
+  //!
+  void schedule_reconnection(endpoint& ep, std::uint32_t uSlot);
+
+private:
+  //!
+  //! pool sizes
+  //!
+  std::size_t                             m_uMinSize;
+  std::size_t                             m_uMaxSize;
+
+  //!
+  //! settings (read by the maintenance)
+  //!
+  std::atomic<std::uint32_t>              m_uConnectTimeoutMsecs_a;
+  std::atomic<std::uint32_t>              m_uHealthCheckIntervalMsecs_a;
+  std::atomic<std::uint32_t>              m_uMinBackoffMsecs_a;
+  std::atomic<std::uint32_t>              m_uMaxBackoffMsecs_a;
+
+  //!
+  //! endpoints: reserved once, appended under the maintenance mutex and published by the number of endpoints
+  //!
+  std::vector<std::shared_ptr<endpoint>>  m_vctEndpoints;
+  std::atomic<std::size_t>                m_uNbEndpoints_a;
+
+  //!
+  //! serializes the maintenance and the additions of endpoints
+  //! m_rng and m_timeLastHealthCheck are protected by it
+  //!
+  std::mutex                              m_mtxMaintenance;
+  std::minstd_rand                        m_rng;
+  std::chrono::steady_clock::time_point   m_timeLastHealthCheck;
+
+  //!
+  //! io_service running the maintenance timer
+  //!
+  std::shared_ptr<io_service>             m_ptrIOService;
+  io_service::timer_id_t                  m_uMaintenanceTimerId = 0;
+};
+
+} // namespace tacopie
@@ -24,17 +24,20 @@
 
 #include <atomic>
 #include <cstdint>
-#include <list>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <vector>
 
 #include <tacopie/network/io_service.hpp>
 #include <tacopie/network/tcp_client.hpp>
 #include <tacopie/network/tcp_socket.hpp>
+#include <tacopie/utils/slot_map.hpp>
 #include <tacopie/utils/typedefs.hpp>
 
+#ifndef __TACOPIE_CONNECTION_QUEUE_SIZE
 #define __TACOPIE_CONNECTION_QUEUE_SIZE 1024
+#endif /* __TACOPIE_CONNECTION_QUEUE_SIZE */
 
 namespace tacopie {
 
@@ -43,6 +46,11 @@ namespace tacopie {
 //! The tcp_server works entirely asynchronously, waiting for the io_service to notify whenever a new client wished to
 //! connect.
 //!
+//! Listening sockets are non-blocking: whenever one is readable, all its pending connections are accepted at once
+//! (up to __TACOPIE_MAX_ACCEPT_BATCH_SIZE per event).
+//! Several listening sockets can be bound to the same address with SO_REUSEPORT (see set_nb_acceptors): the kernel
+//! load-balances incoming connections between them, and they are spread across the reactors of the io_service.
+//!
 class tcp_server {
 public:
   //! ctor
@@ -100,6 +108,9 @@ public:
   //! blocks until all the underlying TCP client connected to the TCP server have been effectively removed
   //! from the io_service and that all the underlying callbacks have completed.
   //!
+  //! the clients are disconnected in a single batch (see tcp_client::disconnect_all), after having been given the drain
+  //! timeout to flush their pending writes (see set_drain_timeout).
+  //!
   void stop(bool bWaitForRemoval = false, bool bRecursiveWaitForRemoval = true);
 
   //!
@@ -109,12 +120,84 @@ public:
 
 public:
   //!
-  //! \return the tacopie::tcp_socket associated to the server. (non-const version)
+  //! set the number of listening sockets bound to the server address, taken into account on the next start
+  //! when more than one, the sockets are bound with SO_REUSEPORT (not supported on windows)
+  //! the on new connection callback might then be called concurrently for different connections
+  //! unix sockets (port 0) always use a single listening socket
+  //!
+  //! \param uNbAcceptors number of listening sockets, 0 for one per reactor of the io_service (default is 1)
+  //!
+  void set_nb_acceptors(std::size_t uNbAcceptors);
+
+  //!
+  //! \return the number of listening sockets requested (0 for one per reactor of the io_service)
+  //!
+  std::size_t get_nb_acceptors(void) const;
+
+  //!
+  //! set the size of the queue of pending connections of each listening socket, taken into account on the next start
+  //!
+  //! \param uBacklog listen backlog (defaults to __TACOPIE_CONNECTION_QUEUE_SIZE)
+  //!
+  void set_listen_backlog(std::size_t uBacklog);
+
+  //!
+  //! \return the size of the queue of pending connections of each listening socket
+  //!
+  std::size_t get_listen_backlog(void) const;
+
+  //!
+  //! set the time given to the clients to flush their pending writes when the server is stopped
+  //! once the listening sockets are closed, the reads of the clients are paused and stop waits until none of them has
+  //! pending writes (or until the timeout expired) before disconnecting them. the flush handlers of the clients are
+  //! replaced for that purpose (see tcp_client::set_on_flush_handler).
+  //! when stop is called from an io_service thread, which would delay the writes it waits for, the clients are
+  //! disconnected without being drained.
+  //!
+  //! \param uTimeoutMsecs drain timeout, 0 to disconnect the clients immediately (default)
+  //!
+  void set_drain_timeout(std::uint32_t uTimeoutMsecs);
+
+  //!
+  //! \return the time given to the clients to flush their pending writes when the server is stopped
+  //!
+  std::uint32_t get_drain_timeout(void) const;
+
+  //!
+  //! set the tuning options of the listening sockets, taken into account on the next start
+  //! (applied before binding, see tacopie::socket_options)
+  //!
+  //! \param options listening sockets options
+  //!
+  void set_socket_options(const socket_options& options);
+
+  //!
+  //! \return the tuning options of the listening sockets
+  //!
+  const socket_options& get_socket_options(void) const;
+
+  //!
+  //! set the tuning options applied to every accepted connection, before the new connection callback is called
+  //! should be set before the server is started
+  //! connections are kept when some option can not be applied (a warning is logged)
+  //!
+  //! \param options accepted connections options
+  //!
+  void set_client_socket_options(const socket_options& options);
+
+  //!
+  //! \return the tuning options applied to every accepted connection
+  //!
+  const socket_options& get_client_socket_options(void) const;
+
+public:
+  //!
+  //! \return the tacopie::tcp_socket associated to the server (the first listening socket). (non-const version)
   //!
   tcp_socket& get_socket(void);
 
   //!
-  //! \return the tacopie::tcp_socket associated to the server. (const version)
+  //! \return the tacopie::tcp_socket associated to the server (the first listening socket). (const version)
   //!
   const tcp_socket& get_socket(void) const;
 
@@ -126,9 +209,77 @@ public:
 
 public:
   //!
-  //! \return the list of tacopie::tcp_client connected to the server.
+  //! immutable snapshot of the clients handled by the server
+  //!
+  typedef std::shared_ptr<const std::vector<std::shared_ptr<tacopie::tcp_client>>> clients_snapshot_t;
+
+  //!
+  //! \return a copy of the list of tacopie::tcp_client connected to the server (and handled by it).
+  //!
+  std::vector<std::shared_ptr<tacopie::tcp_client>> get_clients(void) const;
+
+  //!
+  //! snapshot of the clients connected to the server (and handled by it), safe to iterate without any lock
+  //! the snapshot is built lazily and shared until the set of clients changes, so that repeated calls
+  //! (e.g. broadcasting to all clients) do not copy the clients again
+  //!
+  //! \return the current snapshot of the clients
+  //!
+  clients_snapshot_t get_clients_snapshot(void) const;
+
+  //!
+  //! \return the number of clients connected to the server (and handled by it)
   //!
-  const std::list<std::shared_ptr<tacopie::tcp_client>>& get_clients(void) const;
+  std::size_t get_nb_clients(void) const;
+
+public:
+  //!
+  //! filter selecting the clients a broadcast is sent to
+  //! takes a client as a parameter and returns whether the buffer should be sent to it
+  //!
+  typedef std::function<bool(const std::shared_ptr<tcp_client>&)> broadcast_filter_t;
+
+  //!
+  //! structure to store broadcast results
+  //!  * nb_clients: Number of clients the buffer has been queued on
+  //!  * nb_succeeded: Number of clients the buffer has been entirely written to
+  //!  * nb_failed: Number of clients for which the write failed, or which were disconnected before it was written
+  //!
+  struct broadcast_result {
+    //!
+    //! number of clients the buffer has been queued on
+    //!
+    std::size_t nb_clients;
+    //!
+    //! number of clients the buffer has been entirely written to
+    //!
+    std::size_t nb_succeeded;
+    //!
+    //! number of clients for which the write failed
+    //!
+    std::size_t nb_failed;
+  };
+
+  //!
+  //! callback to be called once a broadcast completed on all the selected clients
+  //! takes the broadcast_result as a parameter
+  //!
+  typedef std::function<void(broadcast_result&)> broadcast_callback_t;
+
+  //!
+  //! send the same bytes to the clients handled by the server
+  //! a single ref-counted buffer is queued on the write queue of every selected client: it is never copied, and is
+  //! released once written to all of them. Clients with write coalescing enabled gather it with their other pending
+  //! writes in a single system call.
+  //!
+  //! \param buffer bytes to be sent (must not be modified until the broadcast completed)
+  //! \param filter filter selecting the clients (all connected clients when null)
+  //! \param callback callback executed once the buffer has been written to (or failed on) all the selected clients
+  //! (executed from the calling thread when no client has been selected)
+  //! \return the number of clients the buffer has been queued on
+  //!
+  std::size_t broadcast(const tcp_client::shared_buffer_t& buffer, const broadcast_filter_t& filter = nullptr,
+      const broadcast_callback_t& callback = nullptr);
 
 private:
   //!
@@ -138,13 +289,37 @@ private:
   //!
   void on_read_available(fd_t fd);
 
+  //!
+  //! \param fd fd of one of the listening sockets
+  //! \return the listening socket associated to the given fd
+  //!
+  tcp_socket& get_listener(fd_t fd);
+
+  //!
+  //! start listening on the given socket and track it in the io_service
+  //!
+  //! \param socket listening socket, already bound
+  //!
+  void start_listener(tcp_socket& socket);
+
+  //!
+  //! pause the reads of the clients and wait until none of them has pending writes, or until the drain timeout expired
+  //! the clients notify the completion of their pending writes through their flush handler
+  //!
+  void drain_clients(void);
+
+  //!
+  //! handle of a client in the registry of clients
+  //!
+  typedef utils::slot_map<std::shared_ptr<tacopie::tcp_client>>::handle_t client_id_t;
+
   //!
   //! client disconnected
   //! called whenever a client disconnected from the tcp_server
   //!
-  //! \param client disconnected client
+  //! \param uClientId handle of the client in the registry of clients
   //!
-  void on_client_disconnected(const std::shared_ptr<tcp_client>& client);
+  void on_client_disconnected(client_id_t uClientId);
 
 private:
   //!
@@ -158,20 +333,55 @@ private:
   //!
   tacopie::tcp_socket                               m_tcpSocket;
 
+  //!
+  //! additional listening sockets, bound with SO_REUSEPORT
+  //!
+  std::vector<tacopie::tcp_socket>                  m_vctReusePortSockets;
+
+  //!
+  //! number of listening sockets requested (0 for one per reactor)
+  //!
+  std::size_t                                       m_uNbAcceptors;
+
+  //!
+  //! listen backlog
+  //!
+  std::size_t                                       m_uListenBacklog;
+
+  //!
+  //! time given to the clients to flush their pending writes on stop (0 to disconnect them immediately)
+  //!
+  std::uint32_t                                     m_uDrainTimeoutMsecs;
+
+  //!
+  //! listening sockets options
+  //!
+  socket_options                                    m_socketOptions;
+
+  //!
+  //! accepted connections options
+  //!
+  socket_options                                    m_clientSocketOptions;
+
   //!
   //! whether the server is currently running or not
   //!
   std::atomic<bool>                                 m_bIsRunning_a = ATOMIC_VAR_INIT(false);
 
   //!
-  //! clients
+  //! clients, stored contiguously with O(1) insertion and removal
+  //!
+  utils::slot_map<std::shared_ptr<tacopie::tcp_client>> m_mapClients;
+
+  //!
+  //! snapshot of the clients, reset whenever the set of clients changes (built lazily)
   //!
-  std::list<std::shared_ptr<tacopie::tcp_client>>   m_lstClients;
+  mutable clients_snapshot_t                        m_ptrClientsSnapshot;
 
   //!
   //! clients thread safety
   //!
-  std::mutex                                        m_mtxClients;
+  mutable std::mutex                                m_mtxClients;
 
   //!
   //! on new connection callback
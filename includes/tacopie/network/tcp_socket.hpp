@@ -28,8 +28,83 @@
 
 #include <tacopie/utils/typedefs.hpp>
 
+#ifndef __TACOPIE_MAX_IO_BUFFERS
+#define __TACOPIE_MAX_IO_BUFFERS 64
+#endif /* __TACOPIE_MAX_IO_BUFFERS */
+
+#ifndef __TACOPIE_MAX_ACCEPT_BATCH_SIZE
+#define __TACOPIE_MAX_ACCEPT_BATCH_SIZE 256
+#endif /* __TACOPIE_MAX_ACCEPT_BATCH_SIZE */
+
+//! size of the buffer used by sendfile on platforms without a zero-copy primitive
+#ifndef __TACOPIE_SENDFILE_FALLBACK_SIZE
+#define __TACOPIE_SENDFILE_FALLBACK_SIZE 65536
+#endif /* __TACOPIE_SENDFILE_FALLBACK_SIZE */
+
 namespace tacopie {
 
+//!
+//! socket tuning options, applied by tcp_socket::set_options
+//! every option is left to the system default unless set (-1 or 0 depending on the option)
+//! options that are not supported on the current platform make set_options throw when set
+//! tcp and ip level options are ignored for unix sockets
+//!
+struct socket_options {
+  //!
+  //! TCP_NODELAY: disable Nagle's algorithm, so that small writes are sent without waiting (1) or not (0)
+  //!
+  int tcp_nodelay = -1;
+  //!
+  //! SO_SNDBUF: size of the kernel send buffer in bytes (0 for the system default)
+  //!
+  int send_buffer_size = 0;
+  //!
+  //! SO_RCVBUF: size of the kernel receive buffer in bytes (0 for the system default)
+  //! set before connect or listen so that the window scaling negotiated by the kernel takes it into account
+  //!
+  int receive_buffer_size = 0;
+  //!
+  //! SO_KEEPALIVE: send keepalive probes on idle connections (1) or not (0)
+  //!
+  int keepalive = -1;
+  //!
+  //! TCP_KEEPIDLE (TCP_KEEPALIVE on macOS): idle time before the first keepalive probe, in seconds (0 for the system default)
+  //!
+  int keepalive_idle_secs = 0;
+  //!
+  //! TCP_KEEPINTVL: interval between keepalive probes, in seconds (0 for the system default)
+  //!
+  int keepalive_interval_secs = 0;
+  //!
+  //! TCP_KEEPCNT: number of unanswered probes before the connection is dropped (0 for the system default)
+  //!
+  int keepalive_count = 0;
+  //!
+  //! TCP_QUICKACK: acknowledge immediately instead of delaying acks (1) or not (0), linux only
+  //! the kernel might switch back to delayed acks later on, the option is not permanent
+  //!
+  int tcp_quickack = -1;
+  //!
+  //! SO_BUSY_POLL: time to busy poll the device queue on blocking reads, in microseconds (0 for the system default),
+  //! linux only (might require CAP_NET_ADMIN to be raised)
+  //!
+  int busy_poll_usecs = 0;
+  //!
+  //! TCP_FASTOPEN: send data in the SYN (0 for disabled)
+  //! for server sockets, length of the queue of pending fast open requests (TCP_FASTOPEN, before listen)
+  //! for client sockets, any non 0 value enables fast open on connect (TCP_FASTOPEN_CONNECT, linux only), ignored once connected
+  //!
+  int tcp_fastopen = 0;
+  //!
+  //! TCP_CORK (TCP_NOPUSH on BSD and macOS): only send full segments until the option is cleared (1) or not (0)
+  //!
+  int tcp_cork = -1;
+  //!
+  //! IP_TOS (IPV6_TCLASS for ipv6 sockets): type of service / traffic class of the packets sent (-1 for the system default)
+  //!
+  int ip_tos = -1;
+};
+
 //!
 //! tacopie::tcp_socket is the class providing low-level TCP socket features.
 //! The tcp_socket provides a simple but convenient abstraction to unix and windows sockets.
@@ -50,6 +125,22 @@ public:
     UNKNOWN
   };
 
+  //!
+  //! buffer description used for scatter-gather operations
+  //!  * pData: bytes of the buffer
+  //!  * uSize: number of bytes of the buffer
+  //!
+  struct io_buffer {
+    //!
+    //! bytes of the buffer
+    //!
+    const char* pData;
+    //!
+    //! number of bytes of the buffer
+    //!
+    std::size_t uSize;
+  };
+
 public:
   //! ctor
   tcp_socket(void);
@@ -96,10 +187,21 @@ public:
   //! the socket type will be set to client.
   //!
   //! \param size_to_read Number of bytes to read (might read less than requested)
-  //! \return Returns the read bytes
+  //! \return Returns the read bytes (empty if the socket is non-blocking and no data is available)
   //!
   std::vector<char> recv(std::size_t uSizeToRead);
 
+  //!
+  //! Read data synchronously from the underlying socket into a caller-supplied buffer.
+  //! The socket must be of type client to process this operation. If the type of the socket is unknown,
+  //! the socket type will be set to client.
+  //!
+  //! \param pBuffer Buffer to be filled in, must be able to hold at least uSizeToRead bytes
+  //! \param uSizeToRead Number of bytes to read (might read less than requested)
+  //! \return Returns the number of bytes read (0 if the socket is non-blocking and no data is available)
+  //!
+  std::size_t recv(char* pBuffer, std::size_t uSizeToRead);
+
   //!
   //! Send data synchronously to the underlying socket.
   //! The socket must be of type client to process this operation. If the type of the socket is unknown,
@@ -111,6 +213,66 @@ public:
   //!
   std::size_t send(const std::vector<char>& vctData, std::size_t uSizeToWrite);
 
+  //!
+  //! Send data synchronously to the underlying socket from a caller-supplied buffer.
+  //! The socket must be of type client to process this operation. If the type of the socket is unknown,
+  //! the socket type will be set to client.
+  //!
+  //! \param pData Buffer containing bytes to be written
+  //! \param uSizeToWrite Number of bytes to send
+  //! \return Returns the number of bytes that were effectively sent (0 if the socket is non-blocking and would block).
+  //!
+  std::size_t send(const char* pData, std::size_t uSizeToWrite);
+
+  //!
+  //! Send several buffers synchronously to the underlying socket in a single system call (writev / WSASend).
+  //! The socket must be of type client to process this operation. If the type of the socket is unknown,
+  //! the socket type will be set to client.
+  //!
+  //! \param pBuffers Buffers to be sent, in order
+  //! \param uNbBuffers Number of buffers (only the first __TACOPIE_MAX_IO_BUFFERS are sent)
+  //! \return Returns the number of bytes that were effectively sent (might be less than the total size of the buffers,
+  //! 0 if the socket is non-blocking and would block).
+  //!
+  std::size_t sendv(const io_buffer* pBuffers, std::size_t uNbBuffers);
+
+  //!
+  //! Send a region of a file synchronously to the underlying socket, without copying it through userspace
+  //! (sendfile on linux and macOS, TransmitFile on windows, pread and send elsewhere).
+  //! The socket must be of type client to process this operation. If the type of the socket is unknown,
+  //! the socket type will be set to client.
+  //!
+  //! \param hFile Regular file to be sent, opened for reading
+  //! \param uOffset Offset of the first byte to send in the file (the file position is left unchanged on unix)
+  //! \param uSize Number of bytes to send
+  //! \return Returns the number of bytes that were effectively sent (0 if the socket is non-blocking and would block).
+  //! An exception is thrown if the file ends before uOffset.
+  //!
+  std::size_t sendfile(file_handle_t hFile, std::uint64_t uOffset, std::size_t uSize);
+
+  //!
+  //! Move bytes received on the underlying socket into a pipe, without copying them through userspace (linux only).
+  //! The socket must be of type client to process this operation. If the type of the socket is unknown,
+  //! the socket type will be set to client.
+  //!
+  //! \param fdPipe Write end of the pipe (non-blocking)
+  //! \param uSize Maximum number of bytes to move
+  //! \param bEndOfStream Set to true if the socket has been closed by the remote host
+  //! \return Returns the number of bytes that were effectively moved (0 if no data is available or the pipe is full).
+  //!
+  std::size_t splice_to_pipe(fd_t fdPipe, std::size_t uSize, bool& bEndOfStream);
+
+  //!
+  //! Send bytes stored in a pipe to the underlying socket, without copying them through userspace (linux only).
+  //! The socket must be of type client to process this operation. If the type of the socket is unknown,
+  //! the socket type will be set to client.
+  //!
+  //! \param fdPipe Read end of the pipe (non-blocking)
+  //! \param uSize Maximum number of bytes to send (bytes available in the pipe)
+  //! \return Returns the number of bytes that were effectively sent (0 if the socket is non-blocking and would block).
+  //!
+  std::size_t splice_from_pipe(fd_t fdPipe, std::size_t uSize);
+
   //!
   //! Connect the socket to the remote server.
   //! The socket must be of type client to process this operation. If the type of the socket is unknown,
@@ -123,6 +285,27 @@ public:
   //!
   void connect(const std::string& host, std::uint32_t port, std::uint32_t timeout_msecs = 0);
 
+  //!
+  //! Start connecting the socket to the remote server without blocking.
+  //! The socket is switched to non-blocking mode: once it is reported as writable, finish_connect must be called
+  //! to check the connection status (it must be called too if the connection completed immediately).
+  //! The socket must be of type client to process this operation. If the type of the socket is unknown,
+  //! the socket type will be set to client.
+  //! Host resolution (getaddrinfo) is still synchronous.
+  //!
+  //! \param host Hostname of the target server
+  //! \param port Port of the target server
+  //! \return whether the connection completed immediately
+  //!
+  bool connect_non_blocking(const std::string& host, std::uint32_t port);
+
+  //!
+  //! Complete a connection started by connect_non_blocking: check the connection status and switch the socket back
+  //! to blocking mode. An exception is thrown if the connection failed: the socket is left open, so that it can be
+  //! removed from the io_service before being closed.
+  //!
+  void finish_connect(void);
+
   //!
   //! Binds the socket to the given host and port.
   //! The socket must be of type server to process this operation. If the type of the socket is unknown,
@@ -130,8 +313,10 @@ public:
   //!
   //! \param host Hostname to be bind to
   //! \param port Port to be bind to
+  //! \param bReusePort whether SO_REUSEPORT is set before binding, so that several sockets can listen on the same
+  //! address and have the kernel load-balance incoming connections between them (not supported on windows)
   //!
-  void bind(const std::string& host, std::uint32_t port);
+  void bind(const std::string& host, std::uint32_t port, bool bReusePort = false);
 
   //!
   //! Make the socket listen for incoming connections.
@@ -151,11 +336,52 @@ public:
   //!
   tcp_socket accept(void);
 
+  //!
+  //! Accept the pending incoming connections, until none is pending or uMaxConnections have been accepted.
+  //! The socket must be in non-blocking mode (see set_non_blocking) and of type server to process this operation.
+  //! If the type of the socket is unknown, the socket type will be set to server.
+  //! Accepted sockets are close-on-exec (accept4 on linux) and in blocking mode.
+  //!
+  //! \param uMaxConnections maximum number of connections to accept
+  //! \return Return the tcp_sockets associated to the newly accepted connections (empty if none was pending).
+  //!
+  std::vector<tcp_socket> accept_batch(std::size_t uMaxConnections = __TACOPIE_MAX_ACCEPT_BATCH_SIZE);
+
   //!
   //! Close the underlying socket.
   //!
   void close(void);
 
+  //!
+  //! Set the underlying socket in non-blocking (or back in blocking) mode.
+  //! Once non-blocking, recv and send return 0 instead of blocking when no progress can be made.
+  //!
+  //! \param bNonBlocking whether the socket should be non-blocking
+  //!
+  void set_non_blocking(bool bNonBlocking);
+
+  //!
+  //! Check, without blocking nor consuming any data, whether the peer closed the connection (or the connection failed).
+  //! Meant to check the health of idle connections: pending data is not considered as a failure.
+  //!
+  //! \return whether the connection has been closed by the peer or is in error
+  //!
+  bool is_peer_closed(void) const;
+
+  //!
+  //! Set the tuning options of the socket.
+  //! Options are kept and applied once the type of the socket is known: immediately for accepted and connected
+  //! sockets, by connect and bind otherwise (before connecting or binding the underlying socket).
+  //!
+  //! \param options options to be applied (replace the previous ones)
+  //!
+  void set_options(const socket_options& options);
+
+  //!
+  //! \return the tuning options of the socket
+  //!
+  const socket_options& get_options(void) const;
+
 public:
   //!
   //! \return the hostname associated with the underlying socket.
@@ -199,6 +425,13 @@ private:
   //!
   void create_socket_if_necessary(void);
 
+  //!
+  //! apply the tuning options to the underlying socket
+  //!
+  //! \param bIsConnecting whether the socket is about to be connected (client fast open is only enabled then)
+  //!
+  void apply_options(bool bIsConnecting);
+
   //!
   //! check whether the current socket has an approriate type for that kind of operation
   //! if current type is UNKNOWN, update internal type with given type
@@ -226,6 +459,11 @@ private:
   //! type of the socket
   //!
   type              m_eType;
+
+  //!
+  //! tuning options
+  //!
+  socket_options    m_options;
 };
 
 } // namespace tacopie
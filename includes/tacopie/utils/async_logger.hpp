@@ -0,0 +1,258 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <tacopie/utils/logger.hpp>
+
+//! number of messages each thread can buffer before messages get dropped (must be a power of 2)
+#ifndef __TACOPIE_ASYNC_LOGGER_RING_SIZE
+#define __TACOPIE_ASYNC_LOGGER_RING_SIZE 256
+#endif /* __TACOPIE_ASYNC_LOGGER_RING_SIZE */
+
+//! maximum size of a buffered message, longer messages are truncated
+#ifndef __TACOPIE_ASYNC_LOGGER_MESSAGE_SIZE
+#define __TACOPIE_ASYNC_LOGGER_MESSAGE_SIZE 200
+#endif /* __TACOPIE_ASYNC_LOGGER_MESSAGE_SIZE */
+
+//! maximum size of a buffered file name, longer file names are truncated from the left
+#ifndef __TACOPIE_ASYNC_LOGGER_FILE_SIZE
+#define __TACOPIE_ASYNC_LOGGER_FILE_SIZE 48
+#endif /* __TACOPIE_ASYNC_LOGGER_FILE_SIZE */
+
+//! interval between two flushes of the buffered messages, in milliseconds
+#ifndef __TACOPIE_ASYNC_LOGGER_FLUSH_INTERVAL
+#define __TACOPIE_ASYNC_LOGGER_FLUSH_INTERVAL 10
+#endif /* __TACOPIE_ASYNC_LOGGER_FLUSH_INTERVAL */
+
+namespace tacopie {
+
+//!
+//! asynchronous logger
+//! same output as tacopie::logger, without blocking the logging threads
+//!
+//! each logging thread copies its messages into its own lock-free ring buffer (single producer, single consumer) of
+//! fixed-size entries: logging neither locks nor allocates. a background thread formats the buffered messages and writes
+//! them in batches, flushing the output once per batch instead of once per line.
+//! when the ring buffer of a thread is full, its messages are dropped (and counted) rather than blocking the thread.
+//!
+class async_logger : public logger_iface {
+public:
+  //!
+  //! ctor
+  //! starts the background flush thread
+  //!
+  //! \param level maximum level of the logged messages
+  //!
+  explicit async_logger(log_level level = log_level::info);
+
+  //!
+  //! dtor
+  //! writes the messages still buffered and stops the background flush thread
+  //!
+  ~async_logger(void);
+
+  //! copy ctor
+  async_logger(const async_logger&) = delete;
+  //! assignment operator
+  async_logger& operator=(const async_logger&) = delete;
+
+public:
+  //!
+  //! \param level log level
+  //! \return whether messages of the given level are logged
+  //!
+  bool is_enabled(log_level level) const;
+
+  //!
+  //! set the maximum level of the logged messages
+  //!
+  //! \param level log level
+  //!
+  void set_level(log_level level);
+
+  //!
+  //! block until the messages logged so far have been written
+  //!
+  void flush(void);
+
+  //!
+  //! \return the number of messages dropped because a ring buffer was full
+  //!
+  std::uint64_t get_nb_dropped_messages(void) const;
+
+public:
+  //!
+  //! debug logging
+  //!
+  //! \param msg message to be logged
+  //! \param file file from which the message is coming
+  //! \param line line in the file of the message
+  //!
+  void debug(const std::string& msg, const std::string& file, std::size_t line);
+
+  //!
+  //! info logging
+  //!
+  //! \param msg message to be logged
+  //! \param file file from which the message is coming
+  //! \param line line in the file of the message
+  //!
+  void info(const std::string& msg, const std::string& file, std::size_t line);
+
+  //!
+  //! warn logging
+  //!
+  //! \param msg message to be logged
+  //! \param file file from which the message is coming
+  //! \param line line in the file of the message
+  //!
+  void warn(const std::string& msg, const std::string& file, std::size_t line);
+
+  //!
+  //! error logging
+  //!
+  //! \param msg message to be logged
+  //! \param file file from which the message is coming
+  //! \param line line in the file of the message
+  //!
+  void error(const std::string& msg, const std::string& file, std::size_t line);
+
+public:
+  //!
+  //! buffered message, formatted by the flush thread
+  //!
+  struct entry {
+    log_level     eLevel;
+    std::size_t   uLine;
+    std::uint32_t uFileSize;
+    std::uint32_t uMessageSize;
+    char          arrFile[__TACOPIE_ASYNC_LOGGER_FILE_SIZE];
+    char          arrMessage[__TACOPIE_ASYNC_LOGGER_MESSAGE_SIZE];
+  };
+
+  //!
+  //! ring buffer of a logging thread
+  //! shared by the thread (producer) and the logger (consumer), released once both are done with it
+  //!
+  struct ring {
+    //! ctor
+    ring(void)
+    : vctEntries(__TACOPIE_ASYNC_LOGGER_RING_SIZE) {}
+
+    std::vector<entry>         vctEntries;
+    std::atomic<std::size_t>   uHead_a      = ATOMIC_VAR_INIT(0);
+    std::atomic<std::size_t>   uTail_a      = ATOMIC_VAR_INIT(0);
+    std::atomic<std::uint64_t> uNbDropped_a = ATOMIC_VAR_INIT(0);
+    std::atomic<bool>          bOrphaned_a  = ATOMIC_VAR_INIT(false);
+  };
+
+private:
+  //!
+  //! copy a message into the ring buffer of the calling thread
+  //!
+  void push(log_level level, const std::string& msg, const std::string& file, std::size_t line);
+
+  //!
+  //! \return the ring buffer of the calling thread, created and registered on first use
+  //!
+  ring& get_thread_ring(void);
+
+  //!
+  //! flush thread main loop
+  //!
+  void run(void);
+
+  //!
+  //! format and write the buffered messages of all the threads
+  //!
+  void write_entries(void);
+
+private:
+  //!
+  //! maximum level of the logged messages
+  //!
+  std::atomic<log_level>               m_eLevel_a;
+
+  //!
+  //! unique identifier of this logger, used to find the ring buffers of the calling thread
+  //!
+  std::uint64_t                        m_uId;
+
+  //!
+  //! ring buffers of the logging threads
+  //!
+  std::vector<std::shared_ptr<ring>>   m_vctRings;
+
+  //!
+  //! ring buffers thread safety
+  //!
+  mutable std::mutex                   m_mtxRings;
+
+  //!
+  //! messages dropped by the ring buffers released so far
+  //!
+  std::atomic<std::uint64_t>           m_uNbDropped_a;
+
+  //!
+  //! dropped messages already reported by the flush thread
+  //!
+  std::uint64_t                        m_uNbReportedDrops;
+
+  //!
+  //! number of flushes requested, and completed (protected by m_mtxFlush)
+  //!
+  std::uint64_t                        m_uNbFlushRequests;
+  std::uint64_t                        m_uNbFlushesDone;
+
+  //!
+  //! flush requests thread safety
+  //!
+  std::mutex                           m_mtxFlush;
+
+  //!
+  //! condition variable used to wake up the flush thread, and to wait for flushes completion
+  //!
+  std::condition_variable              m_cvFlush;
+
+  //!
+  //! whether the flush thread should stop
+  //!
+  bool                                 m_bShouldStop;
+
+  //!
+  //! flush thread
+  //!
+  std::thread                          m_threadFlusher;
+};
+
+} // namespace tacopie
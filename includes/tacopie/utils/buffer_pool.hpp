@@ -0,0 +1,136 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+//! smallest size class of the buffer pool, in bytes (must be a power of 2)
+#ifndef __TACOPIE_BUFFER_POOL_MIN_SIZE
+#define __TACOPIE_BUFFER_POOL_MIN_SIZE 256
+#endif /* __TACOPIE_BUFFER_POOL_MIN_SIZE */
+
+//! number of size classes of the buffer pool (each class doubles the previous one: 256B to 1MB by default)
+#ifndef __TACOPIE_BUFFER_POOL_NB_SIZE_CLASSES
+#define __TACOPIE_BUFFER_POOL_NB_SIZE_CLASSES 13
+#endif /* __TACOPIE_BUFFER_POOL_NB_SIZE_CLASSES */
+
+//! maximum number of bytes kept by each thread cache, per size class (at least one buffer is always kept)
+#ifndef __TACOPIE_BUFFER_POOL_THREAD_CACHE_BYTES
+#define __TACOPIE_BUFFER_POOL_THREAD_CACHE_BYTES (256 * 1024)
+#endif /* __TACOPIE_BUFFER_POOL_THREAD_CACHE_BYTES */
+
+//! maximum number of bytes kept by the shared cache, per size class (at least one buffer is always kept)
+#ifndef __TACOPIE_BUFFER_POOL_SHARED_CACHE_BYTES
+#define __TACOPIE_BUFFER_POOL_SHARED_CACHE_BYTES (4 * 1024 * 1024)
+#endif /* __TACOPIE_BUFFER_POOL_SHARED_CACHE_BYTES */
+
+namespace tacopie {
+
+namespace utils {
+
+//!
+//! size-classed pool of byte buffers used on the I/O path (tcp_socket reads, tcp_client read results and write requests)
+//!
+//! buffers are grouped by power of 2 capacity. released buffers are first kept in a cache local to the releasing thread
+//! (no locking), then in a shared cache protected by a mutex per size class, and are freed once both caches are full.
+//! requests bigger than the biggest size class are not pooled.
+//!
+//! any thread can acquire and release buffers, a buffer does not need to be released by the thread that acquired it.
+//!
+class buffer_pool {
+public:
+  //!
+  //! buffer typedef
+  //!
+  typedef std::vector<char> buffer_t;
+
+public:
+  //!
+  //! \return the buffer pool instance
+  //!
+  static buffer_pool& get_instance(void);
+
+  //! dtor
+  ~buffer_pool(void) = default;
+
+  //! copy ctor
+  buffer_pool(const buffer_pool&) = delete;
+  //! assignment operator
+  buffer_pool& operator=(const buffer_pool&) = delete;
+
+public:
+  //!
+  //! acquire a buffer of the given size
+  //! memory is reused from a previously released buffer when possible, without being filled again: the bytes of a
+  //! reused buffer are left as written by its previous user (only the bytes beyond them are zero-filled)
+  //!
+  //! \param uSize size of the buffer
+  //! \return buffer of size uSize, with unspecified contents
+  //!
+  buffer_t acquire(std::size_t uSize);
+
+  //!
+  //! give a buffer back to the pool
+  //! buffers that were not acquired from the pool can be released too (they are pooled if their capacity fits a size class)
+  //! buffers released with their full size are reused without touching their bytes
+  //!
+  //! \param buffer buffer to be released
+  //!
+  void release(buffer_t buffer);
+
+public:
+  //!
+  //! \return the capacity of the buffers of the given size class
+  //!
+  static std::size_t get_size_class_capacity(std::size_t uSizeClass);
+
+private:
+  //! ctor
+  buffer_pool(void) = default;
+
+private:
+  //!
+  //! buffers of a given size class kept by the shared cache
+  //!
+  struct size_class {
+    //!
+    //! available buffers
+    //!
+    std::vector<buffer_t> vctBuffers;
+    //!
+    //! available buffers thread safety
+    //!
+    std::mutex            mtxBuffers;
+  };
+
+  //!
+  //! shared cache, one entry per size class
+  //!
+  size_class m_arrSizeClasses[__TACOPIE_BUFFER_POOL_NB_SIZE_CLASSES];
+};
+
+} // namespace utils
+
+} // namespace tacopie
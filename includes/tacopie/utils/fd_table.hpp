@@ -0,0 +1,219 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+#ifdef _WIN32
+#include <unordered_map>
+#endif /* _WIN32 */
+
+#include <tacopie/utils/error.hpp>
+#include <tacopie/utils/typedefs.hpp>
+
+//! number of entries allocated at once by fd_table
+#ifndef __TACOPIE_FD_TABLE_PAGE_SIZE
+#define __TACOPIE_FD_TABLE_PAGE_SIZE 256
+#endif /* __TACOPIE_FD_TABLE_PAGE_SIZE */
+
+namespace tacopie {
+
+namespace utils {
+
+//!
+//! table of values indexed by file descriptor
+//!
+//! on POSIX, fds are small dense integers: values are stored in a flat array indexed by fd, allocated by pages of
+//! __TACOPIE_FD_TABLE_PAGE_SIZE entries so that the table grows without ever moving its values. lookups are a couple of
+//! array accesses, without hashing, and pointers to the values stay valid until they are erased.
+//! on Windows, sockets are arbitrary handles: entries are found through a hash map, with the same guarantees.
+//!
+//! each entry carries a generation, incremented whenever its value is erased, so that the removal of a value can be
+//! detected even when the fd has been reused in the meantime.
+//!
+//! this class is not thread-safe.
+//!
+//! \tparam T type of the stored values, must be default constructible
+//!
+template <typename T>
+class fd_table {
+public:
+  //! ctor
+  fd_table(void)
+  : m_uSize(0) {}
+
+  //! dtor
+  ~fd_table(void) = default;
+
+  //! copy ctor
+  fd_table(const fd_table&) = delete;
+  //! assignment operator
+  fd_table& operator=(const fd_table&) = delete;
+
+public:
+  //!
+  //! \param fd file descriptor
+  //! \return the value stored for the given fd, or nullptr if there is none
+  //!
+  T*
+  find(fd_t fd) {
+    entry* pEntry = find_entry(fd, false);
+
+    return pEntry && pEntry->bUsed ? &pEntry->value : nullptr;
+  }
+
+  //!
+  //! \param fd file descriptor
+  //! \param bInserted set to whether the value has been inserted by this call
+  //! \return the value stored for the given fd, default constructed if there was none
+  //!
+  T&
+  find_or_insert(fd_t fd, bool& bInserted) {
+    entry* pEntry = find_entry(fd, true);
+
+    if (!pEntry) { __TACOPIE_THROW(error, "invalid fd"); }
+
+    bInserted = !pEntry->bUsed;
+
+    if (bInserted) {
+      pEntry->bUsed = true;
+      ++m_uSize;
+    }
+
+    return pEntry->value;
+  }
+
+  //!
+  //! erase the value stored for the given fd (the entry is reset to a default constructed value)
+  //!
+  //! \param fd file descriptor
+  //! \return false if there was no value for the given fd
+  //!
+  bool
+  erase(fd_t fd) {
+    entry* pEntry = find_entry(fd, false);
+
+    if (!pEntry || !pEntry->bUsed) { return false; }
+
+    pEntry->value.~T();
+    new (&pEntry->value) T();
+
+    pEntry->bUsed = false;
+    ++pEntry->uGeneration;
+    --m_uSize;
+
+    return true;
+  }
+
+  //!
+  //! \param fd file descriptor
+  //! \return the number of values erased so far for the given fd
+  //!
+  std::uint64_t
+  get_generation(fd_t fd) {
+    entry* pEntry = find_entry(fd, false);
+
+    return pEntry ? pEntry->uGeneration : 0;
+  }
+
+  //!
+  //! \return the number of stored values
+  //!
+  std::size_t
+  size(void) const {
+    return m_uSize;
+  }
+
+private:
+  //!
+  //! struct entry
+  //!  * value: stored value (default constructed when unused)
+  //!  * generation: number of values erased from this entry
+  //!  * used: whether a value is stored
+  //!
+  struct entry {
+    T             value;
+    std::uint64_t uGeneration = 0;
+    bool          bUsed       = false;
+  };
+
+  //!
+  //! \param fd file descriptor
+  //! \param bCreate whether the entry should be allocated if it does not exist yet
+  //! \return the entry of the given fd, or nullptr if it does not exist and bCreate is false (or if fd is invalid)
+  //!
+  entry*
+  find_entry(fd_t fd, bool bCreate) {
+#ifdef _WIN32
+    auto pos = m_mapEntries.find(fd);
+
+    if (pos != m_mapEntries.end()) { return pos->second.get(); }
+    if (!bCreate) { return nullptr; }
+
+    auto& ptrEntry = m_mapEntries[fd];
+    ptrEntry.reset(new entry);
+
+    return ptrEntry.get();
+#else
+    if (fd < 0) { return nullptr; }
+
+    std::size_t uIndex = static_cast<std::size_t>(fd);
+    std::size_t uPage  = uIndex / __TACOPIE_FD_TABLE_PAGE_SIZE;
+
+    if (uPage >= m_vctPages.size() || !m_vctPages[uPage]) {
+      if (!bCreate) { return nullptr; }
+      if (uPage >= m_vctPages.size()) { m_vctPages.resize(uPage + 1); }
+
+      m_vctPages[uPage].reset(new entry[__TACOPIE_FD_TABLE_PAGE_SIZE]);
+    }
+
+    return &m_vctPages[uPage][uIndex % __TACOPIE_FD_TABLE_PAGE_SIZE];
+#endif /* _WIN32 */
+  }
+
+private:
+#ifdef _WIN32
+  //!
+  //! entries, by socket handle
+  //!
+  std::unordered_map<fd_t, std::unique_ptr<entry>> m_mapEntries;
+#else
+  //!
+  //! pages of entries, indexed by fd / __TACOPIE_FD_TABLE_PAGE_SIZE
+  //!
+  std::vector<std::unique_ptr<entry[]>>            m_vctPages;
+#endif /* _WIN32 */
+
+  //!
+  //! number of stored values
+  //!
+  std::size_t                                      m_uSize;
+};
+
+} // namespace utils
+
+} // namespace tacopie
@@ -0,0 +1,354 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+//! size of the inline buffer of inplace_function, in bytes (callables that do not fit are allocated on the heap)
+//! with the default size and a 64-bit target, an inplace_function (inline buffer, aligned on std::max_align_t, and
+//! vtable pointer) takes exactly one cache line
+#ifndef __TACOPIE_INPLACE_FUNCTION_CAPACITY
+#define __TACOPIE_INPLACE_FUNCTION_CAPACITY 48
+#endif /* __TACOPIE_INPLACE_FUNCTION_CAPACITY */
+
+namespace tacopie {
+
+namespace utils {
+
+template <typename Signature, std::size_t uCapacity = __TACOPIE_INPLACE_FUNCTION_CAPACITY>
+class inplace_function;
+
+//!
+//! move-only, type-erased callable with a small inline buffer, used on the I/O dispatch path instead of std::function
+//!
+//! callables fitting in the inline buffer (and nothrow move constructible) are stored in it: constructing, moving and
+//! destroying an inplace_function then never allocates. bigger callables are allocated on the heap, so that any
+//! callable accepted by std::function (apart from pointers to members) is accepted.
+//! the callables used by tacopie itself (lambdas and std::bind capturing a few pointers) always fit.
+//!
+//! contrary to std::function, inplace_function can hold move-only callables and can not be copied.
+//!
+//! \tparam R return type
+//! \tparam Args parameters types
+//! \tparam uCapacity size of the inline buffer, in bytes
+//!
+template <typename R, typename... Args, std::size_t uCapacity>
+class inplace_function<R(Args...), uCapacity> {
+private:
+  //!
+  //! inline buffer
+  //!
+  typedef typename std::aligned_storage<uCapacity, alignof(std::max_align_t)>::type storage_t;
+
+  //!
+  //! whether F can be called with Args and returns something convertible to R
+  //!
+  template <typename F, typename = void>
+  struct is_invocable : std::false_type {};
+
+  template <typename F>
+  struct is_invocable<F, typename std::enable_if<std::is_void<R>::value || std::is_convertible<decltype(std::declval<F&>()(std::declval<Args>()...)), R>::value>::type>
+  : std::true_type {};
+
+  //!
+  //! whether F is stored in the inline buffer
+  //!
+  template <typename F>
+  struct fits_inplace : std::integral_constant<bool, sizeof(F) <= sizeof(storage_t) && alignof(storage_t) % alignof(F) == 0 && std::is_nothrow_move_constructible<F>::value> {};
+
+public:
+  //! ctor
+  inplace_function(void)
+  : m_pVTable(nullptr) {}
+
+  //! ctor, empty function
+  inplace_function(std::nullptr_t)
+  : m_pVTable(nullptr) {}
+
+  //!
+  //! ctor
+  //! an empty std::function or a null function pointer results in an empty inplace_function
+  //!
+  //! \param callable callable to be stored (moved or copied)
+  //!
+  template <typename F,
+      typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, inplace_function>::value>::type,
+      typename = typename std::enable_if<is_invocable<typename std::decay<F>::type>::value>::type>
+  inplace_function(F&& callable)
+  : m_pVTable(nullptr) {
+    typedef typename std::decay<F>::type callable_t;
+
+    if (is_null(callable)) { return; }
+
+    store<callable_t>(std::forward<F>(callable), std::integral_constant<bool, fits_inplace<callable_t>::value>());
+  }
+
+  //! move ctor
+  inplace_function(inplace_function&& other)
+  : m_pVTable(nullptr) {
+    move_from(other);
+  }
+
+  //! dtor
+  ~inplace_function(void) {
+    reset();
+  }
+
+  //! copy ctor
+  inplace_function(const inplace_function&) = delete;
+  //! assignment operator
+  inplace_function& operator=(const inplace_function&) = delete;
+
+public:
+  //! move assignment operator
+  inplace_function&
+  operator=(inplace_function&& other) {
+    if (this != &other) {
+      reset();
+      move_from(other);
+    }
+
+    return *this;
+  }
+
+  //! reset to an empty function
+  inplace_function&
+  operator=(std::nullptr_t) {
+    reset();
+    return *this;
+  }
+
+  //! store another callable
+  template <typename F,
+      typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, inplace_function>::value>::type,
+      typename = typename std::enable_if<is_invocable<typename std::decay<F>::type>::value>::type>
+  inplace_function&
+  operator=(F&& callable) {
+    return *this = inplace_function(std::forward<F>(callable));
+  }
+
+public:
+  //!
+  //! call the stored callable
+  //! throws std::bad_function_call if the function is empty
+  //!
+  R
+  operator()(Args... args) const {
+    if (!m_pVTable) { throw std::bad_function_call(); }
+
+    return m_pVTable->invoke(&m_storage, std::forward<Args>(args)...);
+  }
+
+  //!
+  //! \return whether a callable is stored
+  //!
+  explicit operator bool(void) const {
+    return m_pVTable != nullptr;
+  }
+
+  //!
+  //! \return whether the stored callable lives in the inline buffer (true for empty functions)
+  //!
+  bool
+  is_inplace(void) const {
+    return !m_pVTable || m_pVTable->bInplace;
+  }
+
+private:
+  //!
+  //! operations on the stored callable
+  //!  * invoke: call the callable
+  //!  * move: move the callable to another storage and destroy the moved-from one
+  //!  * destroy: destroy the callable
+  //!  * inplace: whether the callable lives in the inline buffer
+  //!
+  struct vtable {
+    R (*invoke)(void* pStorage, Args&&... args);
+    void (*move)(void* pDst, void* pSrc);
+    void (*destroy)(void* pStorage);
+    bool bInplace;
+  };
+
+  //!
+  //! callables stored in the inline buffer
+  //!
+  template <typename F>
+  struct inplace_ops {
+    static R
+    invoke(void* pStorage, Args&&... args) {
+      return (*static_cast<F*>(pStorage))(std::forward<Args>(args)...);
+    }
+
+    static void
+    move(void* pDst, void* pSrc) {
+      new (pDst) F(std::move(*static_cast<F*>(pSrc)));
+      static_cast<F*>(pSrc)->~F();
+    }
+
+    static void
+    destroy(void* pStorage) {
+      static_cast<F*>(pStorage)->~F();
+    }
+
+    static const vtable s_vtable;
+  };
+
+  //!
+  //! callables allocated on the heap, the inline buffer holds a pointer to them
+  //!
+  template <typename F>
+  struct heap_ops {
+    static R
+    invoke(void* pStorage, Args&&... args) {
+      return (**static_cast<F**>(pStorage))(std::forward<Args>(args)...);
+    }
+
+    static void
+    move(void* pDst, void* pSrc) {
+      *static_cast<F**>(pDst) = *static_cast<F**>(pSrc);
+    }
+
+    static void
+    destroy(void* pStorage) {
+      delete *static_cast<F**>(pStorage);
+    }
+
+    static const vtable s_vtable;
+  };
+
+private:
+  //! \return whether the callable is a null function pointer or an empty std::function
+  template <typename F>
+  static bool
+  is_null(const F&) {
+    return false;
+  }
+
+  template <typename F>
+  static bool
+  is_null(F* pFunction) {
+    return pFunction == nullptr;
+  }
+
+  template <typename Signature>
+  static bool
+  is_null(const std::function<Signature>& function) {
+    return !function;
+  }
+
+  //! store a callable in the inline buffer
+  template <typename F, typename G>
+  void
+  store(G&& callable, std::true_type) {
+    new (&m_storage) F(std::forward<G>(callable));
+    m_pVTable = &inplace_ops<F>::s_vtable;
+  }
+
+  //! store a callable on the heap
+  template <typename F, typename G>
+  void
+  store(G&& callable, std::false_type) {
+    *reinterpret_cast<F**>(&m_storage) = new F(std::forward<G>(callable));
+    m_pVTable                          = &heap_ops<F>::s_vtable;
+  }
+
+  //! take the callable of another function, leaving it empty
+  void
+  move_from(inplace_function& other) {
+    if (!other.m_pVTable) { return; }
+
+    other.m_pVTable->move(&m_storage, &other.m_storage);
+    m_pVTable       = other.m_pVTable;
+    other.m_pVTable = nullptr;
+  }
+
+  //! destroy the stored callable, if any
+  void
+  reset(void) {
+    if (!m_pVTable) { return; }
+
+    m_pVTable->destroy(&m_storage);
+    m_pVTable = nullptr;
+  }
+
+private:
+  //!
+  //! inline buffer (mutable, as the stored callable can be called from a const inplace_function like std::function)
+  //!
+  mutable storage_t m_storage;
+
+  //!
+  //! operations on the stored callable, nullptr when empty
+  //!
+  const vtable*     m_pVTable;
+};
+
+template <typename R, typename... Args, std::size_t uCapacity>
+template <typename F>
+const typename inplace_function<R(Args...), uCapacity>::vtable inplace_function<R(Args...), uCapacity>::inplace_ops<F>::s_vtable = {
+    &inplace_function<R(Args...), uCapacity>::inplace_ops<F>::invoke,
+    &inplace_function<R(Args...), uCapacity>::inplace_ops<F>::move,
+    &inplace_function<R(Args...), uCapacity>::inplace_ops<F>::destroy,
+    true};
+
+template <typename R, typename... Args, std::size_t uCapacity>
+template <typename F>
+const typename inplace_function<R(Args...), uCapacity>::vtable inplace_function<R(Args...), uCapacity>::heap_ops<F>::s_vtable = {
+    &inplace_function<R(Args...), uCapacity>::heap_ops<F>::invoke,
+    &inplace_function<R(Args...), uCapacity>::heap_ops<F>::move,
+    &inplace_function<R(Args...), uCapacity>::heap_ops<F>::destroy,
+    false};
+
+//! \return whether the function is empty
+template <typename Signature, std::size_t uCapacity>
+bool
+operator==(const inplace_function<Signature, uCapacity>& function, std::nullptr_t) {
+  return !function;
+}
+
+template <typename Signature, std::size_t uCapacity>
+bool
+operator==(std::nullptr_t, const inplace_function<Signature, uCapacity>& function) {
+  return !function;
+}
+
+//! \return whether the function is not empty
+template <typename Signature, std::size_t uCapacity>
+bool
+operator!=(const inplace_function<Signature, uCapacity>& function, std::nullptr_t) {
+  return static_cast<bool>(function);
+}
+
+template <typename Signature, std::size_t uCapacity>
+bool
+operator!=(std::nullptr_t, const inplace_function<Signature, uCapacity>& function) {
+  return static_cast<bool>(function);
+}
+
+} // namespace utils
+
+} // namespace tacopie
@@ -22,12 +22,29 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <string>
 
+//! maximum number of messages logged per second by each rate-limited call site
+#ifndef __TACOPIE_LOG_RATE_LIMIT
+#define __TACOPIE_LOG_RATE_LIMIT 10
+#endif /* __TACOPIE_LOG_RATE_LIMIT */
+
 namespace tacopie {
 
+//!
+//! log level
+//!
+enum class log_level {
+  error = 0,
+  warn  = 1,
+  info  = 2,
+  debug = 3
+};
+
 //!
 //! logger_iface
 //! should be inherited by any class intended to be used for logging
@@ -44,6 +61,20 @@ public:
   //! assignment operator
   logger_iface& operator=(const logger_iface&) = default;
 
+public:
+  //!
+  //! checked by __TACOPIE_LOG before the message is built: messages of disabled levels cost a virtual call only
+  //! all levels are enabled by default
+  //!
+  //! \param level log level
+  //! \return whether messages of the given level are logged
+  //!
+  virtual bool
+  is_enabled(log_level level) const {
+    (void) level;
+    return true;
+  }
+
 public:
   //!
   //! debug logging
@@ -90,12 +121,7 @@ public:
   //!
   //! log level
   //!
-  enum class log_level {
-    error = 0,
-    warn  = 1,
-    info  = 2,
-    debug = 3
-  };
+  typedef tacopie::log_level log_level;
 
 public:
   //! ctor
@@ -108,6 +134,13 @@ public:
   //! assignment operator
   logger& operator=(const logger&) = default;
 
+public:
+  //!
+  //! \param level log level
+  //! \return whether messages of the given level are logged
+  //!
+  bool is_enabled(log_level level) const;
+
 public:
   //!
   //! debug logging
@@ -204,12 +237,74 @@ void warn(const std::string& msg, const std::string& file, std::size_t line);
 void error(const std::string& msg, const std::string& file, std::size_t line);
 
 //!
-//! convenience macro to log with file and line information
+//! \param level log level
+//! \return whether a logger is active and logs messages of the given level
+//!
+inline bool
+is_log_enabled(log_level level) {
+  return active_logger && active_logger->is_enabled(level);
+}
+
+//!
+//! per call site rate limiter, used by __TACOPIE_LOG_RATE_LIMITED for messages logged on the I/O hot path
+//! at most __TACOPIE_LOG_RATE_LIMIT messages are let through per second, the others are counted and reported with
+//! the next message let through
+//!
+class log_rate_limiter {
+public:
+  //!
+  //! \param uNbSuppressed filled in with the number of messages suppressed since the last one let through
+  //! \return whether the message should be logged
+  //!
+  bool allow(std::uint64_t& uNbSuppressed);
+
+  //!
+  //! \param msg message to be logged
+  //! \param uNbSuppressed number of messages suppressed since the last one let through
+  //! \return the message, with the number of suppressed messages appended if any
+  //!
+  static std::string format(const std::string& msg, std::uint64_t uNbSuppressed);
+
+private:
+  //!
+  //! start of the current one second window (steady clock, in milliseconds)
+  //!
+  std::atomic<std::int64_t>  m_nWindowStartMsecs_a = ATOMIC_VAR_INIT(0);
+
+  //!
+  //! messages let through during the current window
+  //!
+  std::atomic<std::uint64_t> m_uNbAllowed_a = ATOMIC_VAR_INIT(0);
+
+  //!
+  //! messages suppressed since the last one let through
+  //!
+  std::atomic<std::uint64_t> m_uNbSuppressed_a = ATOMIC_VAR_INIT(0);
+};
+
+//!
+//! convenience macros to log with file and line information
+//! the level is checked before the message is built
+//! __TACOPIE_LOG_RATE_LIMITED is meant for messages logged on every I/O event
 //!
 #ifdef __TACOPIE_LOGGING_ENABLED
-#define __TACOPIE_LOG(level, msg) tacopie::level(msg, __FILE__, __LINE__);
+#define __TACOPIE_LOG(level, msg)                                     \
+  {                                                                   \
+    if (tacopie::is_log_enabled(tacopie::log_level::level)) {         \
+      tacopie::level(msg, __FILE__, __LINE__);                        \
+    }                                                                 \
+  }
+#define __TACOPIE_LOG_RATE_LIMITED(level, msg)                                                      \
+  {                                                                                                 \
+    static tacopie::log_rate_limiter rate_limiter;                                                  \
+    std::uint64_t uNbSuppressed;                                                                    \
+    if (tacopie::is_log_enabled(tacopie::log_level::level) && rate_limiter.allow(uNbSuppressed)) {  \
+      tacopie::level(tacopie::log_rate_limiter::format(msg, uNbSuppressed), __FILE__, __LINE__);    \
+    }                                                                                               \
+  }
 #else
 #define __TACOPIE_LOG(level, msg)
+#define __TACOPIE_LOG_RATE_LIMITED(level, msg)
 #endif /* __TACOPIE_LOGGING_ENABLED */
 
 } // namespace tacopie
@@ -0,0 +1,182 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace tacopie {
+
+namespace utils {
+
+//!
+//! process-wide counters and histograms instrumenting the io_service, the thread_pool and the sockets
+//!
+//! every thread updates its own set of metrics (relaxed atomics with a single writer: no lock and no contended cache
+//! line on the I/O path), snapshots aggregate the sets of all the threads. the metrics of exited threads are kept.
+//!
+//! metrics are only updated when the library is built with __TACOPIE_METRICS_ENABLED (CMake METRICS_ENABLED),
+//! snapshots are empty otherwise.
+//!
+class metrics {
+public:
+  //!
+  //! counters
+  //!  * poll_iterations: number of times a reactor woke up from the poller
+  //!  * empty_wakeups: number of times a reactor woke up with no event to process (timeout)
+  //!  * events_dispatched: number of read and write callbacks dispatched by the reactors
+  //!  * tasks_executed: number of tasks executed by thread pools
+  //!  * read_syscalls, write_syscalls: number of recv and send/writev system calls on TCP sockets
+  //!  * bytes_read, bytes_written: number of bytes received and sent on TCP sockets
+  //!  * accepted_connections: number of connections accepted by TCP servers
+  //!  * wakeup_notifications: number of system calls made to wake up a reactor through its self pipe
+  //!  * coalesced_wakeups: number of self pipe notifications skipped as a wakeup was already pending
+  //!
+  enum counter_id {
+    poll_iterations,
+    empty_wakeups,
+    events_dispatched,
+    tasks_executed,
+    read_syscalls,
+    write_syscalls,
+    bytes_read,
+    bytes_written,
+    accepted_connections,
+    wakeup_notifications,
+    coalesced_wakeups,
+    nb_counters
+  };
+
+  //!
+  //! histograms
+  //!  * events_per_poll: number of events reported by each poll
+  //!  * task_wait_usecs: time spent by tasks in thread pool queues, in microseconds
+  //!  * write_queue_length: number of pending write requests of a tcp_client whenever its socket is written to
+  //!
+  enum histogram_id {
+    events_per_poll,
+    task_wait_usecs,
+    write_queue_length,
+    nb_histograms
+  };
+
+  //!
+  //! number of buckets of the histograms
+  //! bucket 0 counts the values equal to 0, bucket i counts the values in [2^(i-1), 2^i)
+  //!
+  static const std::size_t s_uNbBuckets = 65;
+
+  //!
+  //! aggregated histogram
+  //!
+  struct histogram {
+    //!
+    //! number of recorded values
+    //!
+    std::uint64_t count;
+    //!
+    //! sum of the recorded values
+    //!
+    std::uint64_t sum;
+    //!
+    //! maximum recorded value
+    //!
+    std::uint64_t max;
+    //!
+    //! number of values per power of 2 bucket
+    //!
+    std::uint64_t buckets[s_uNbBuckets];
+
+    //!
+    //! \param dPercentile percentile, between 0 and 100
+    //! \return upper bound of the bucket holding the given percentile (0 if no value has been recorded)
+    //!
+    std::uint64_t get_percentile(double dPercentile) const;
+  };
+
+  //!
+  //! aggregated metrics
+  //!
+  struct snapshot {
+    //!
+    //! whether the library has been built with metrics enabled
+    //!
+    bool          enabled;
+    //!
+    //! counters, indexed by counter_id
+    //!
+    std::uint64_t counters[nb_counters];
+    //!
+    //! histograms, indexed by histogram_id
+    //!
+    histogram     histograms[nb_histograms];
+  };
+
+public:
+  //!
+  //! increment a counter of the calling thread
+  //!
+  //! \param id counter to be incremented
+  //! \param uValue increment
+  //!
+  static void add(counter_id id, std::uint64_t uValue = 1);
+
+  //!
+  //! record a value in a histogram of the calling thread
+  //!
+  //! \param id histogram to be updated
+  //! \param uValue recorded value
+  //!
+  static void record(histogram_id id, std::uint64_t uValue);
+
+  //!
+  //! \return the metrics aggregated over all the threads
+  //!
+  static snapshot get_snapshot(void);
+
+  //!
+  //! \return the name of the given counter
+  //!
+  static const char* get_name(counter_id id);
+
+  //!
+  //! \return the name of the given histogram
+  //!
+  static const char* get_name(histogram_id id);
+};
+
+//!
+//! convenience macros used internaly to update the metrics, compiled out when metrics are disabled
+//!
+#ifdef __TACOPIE_METRICS_ENABLED
+#define __TACOPIE_METRIC_ADD(id, value) tacopie::utils::metrics::add(tacopie::utils::metrics::id, value);
+#define __TACOPIE_METRIC_RECORD(id, value) tacopie::utils::metrics::record(tacopie::utils::metrics::id, value);
+#else
+#define __TACOPIE_METRIC_ADD(id, value)
+#define __TACOPIE_METRIC_RECORD(id, value)
+#endif /* __TACOPIE_METRICS_ENABLED */
+
+} // namespace utils
+
+} // namespace tacopie
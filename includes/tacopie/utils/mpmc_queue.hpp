@@ -0,0 +1,222 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#ifndef __TACOPIE_CACHE_LINE_SIZE
+#define __TACOPIE_CACHE_LINE_SIZE 64
+#endif /* __TACOPIE_CACHE_LINE_SIZE */
+
+namespace tacopie {
+
+namespace utils {
+
+//!
+//! bounded multi-producer multi-consumer lock-free queue
+//! each cell carries a sequence number telling producers and consumers whether the cell is ready for them,
+//! so that push and pop only contend on a single atomic increment in the common case
+//!
+//! \tparam T type of the stored elements, must be default constructible and move assignable
+//!
+template <typename T>
+class mpmc_queue {
+public:
+  //!
+  //! ctor
+  //!
+  //! \param uCapacity maximum number of elements in the queue (rounded up to the next power of 2)
+  //!
+  explicit mpmc_queue(std::size_t uCapacity)
+  : m_uCapacity(round_up_capacity(uCapacity))
+  , m_uMask(m_uCapacity - 1)
+  , m_arrCells(new cell[m_uCapacity]) {
+    for (std::size_t i = 0; i < m_uCapacity; ++i) {
+      m_arrCells[i].uSequence_a.store(i, std::memory_order_relaxed);
+    }
+
+    m_uEnqueuePos_a.store(0, std::memory_order_relaxed);
+    m_uDequeuePos_a.store(0, std::memory_order_relaxed);
+  }
+
+  //! dtor
+  ~mpmc_queue(void) = default;
+
+  //! copy ctor
+  mpmc_queue(const mpmc_queue&) = delete;
+  //! assignment operator
+  mpmc_queue& operator=(const mpmc_queue&) = delete;
+
+public:
+  //!
+  //! push an element at the end of the queue
+  //!
+  //! \param value element to be pushed (moved only on success)
+  //! \return false if the queue is full
+  //!
+  bool
+  try_push(T& value) {
+    std::size_t uPos = m_uEnqueuePos_a.load(std::memory_order_relaxed);
+    cell* pCell;
+
+    while (true) {
+      pCell               = &m_arrCells[uPos & m_uMask];
+      std::size_t uSeq    = pCell->uSequence_a.load(std::memory_order_acquire);
+      std::ptrdiff_t nDif = static_cast<std::ptrdiff_t>(uSeq) - static_cast<std::ptrdiff_t>(uPos);
+
+      if (nDif == 0) {
+        if (m_uEnqueuePos_a.compare_exchange_weak(uPos, uPos + 1, std::memory_order_relaxed)) { break; }
+      } else if (nDif < 0) {
+        return false;
+      } else {
+        uPos = m_uEnqueuePos_a.load(std::memory_order_relaxed);
+      }
+    }
+
+    pCell->value = std::move(value);
+    pCell->uSequence_a.store(uPos + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  //!
+  //! pop the element at the front of the queue
+  //!
+  //! \param value filled in with the popped element on success
+  //! \return false if the queue is empty
+  //!
+  bool
+  try_pop(T& value) {
+    std::size_t uPos = m_uDequeuePos_a.load(std::memory_order_relaxed);
+    cell* pCell;
+
+    while (true) {
+      pCell               = &m_arrCells[uPos & m_uMask];
+      std::size_t uSeq    = pCell->uSequence_a.load(std::memory_order_acquire);
+      std::ptrdiff_t nDif = static_cast<std::ptrdiff_t>(uSeq) - static_cast<std::ptrdiff_t>(uPos + 1);
+
+      if (nDif == 0) {
+        if (m_uDequeuePos_a.compare_exchange_weak(uPos, uPos + 1, std::memory_order_relaxed)) { break; }
+      } else if (nDif < 0) {
+        return false;
+      } else {
+        uPos = m_uDequeuePos_a.load(std::memory_order_relaxed);
+      }
+    }
+
+    value = std::move(pCell->value);
+    //! release resources held by the moved-from element right away
+    pCell->value = T();
+    pCell->uSequence_a.store(uPos + m_uMask + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  //!
+  //! \return whether the queue looks empty
+  //! only a hint when called concurrently with push or pop operations
+  //!
+  bool
+  empty(void) const {
+    return m_uEnqueuePos_a.load(std::memory_order_seq_cst) == m_uDequeuePos_a.load(std::memory_order_seq_cst);
+  }
+
+  //!
+  //! \return the number of elements in the queue
+  //! only a hint when called concurrently with push or pop operations
+  //!
+  std::size_t
+  size(void) const {
+    std::size_t uDequeuePos = m_uDequeuePos_a.load(std::memory_order_relaxed);
+    std::size_t uEnqueuePos = m_uEnqueuePos_a.load(std::memory_order_relaxed);
+
+    return uEnqueuePos > uDequeuePos ? uEnqueuePos - uDequeuePos : 0;
+  }
+
+  //!
+  //! \return maximum number of elements in the queue
+  //!
+  std::size_t
+  capacity(void) const {
+    return m_uCapacity;
+  }
+
+private:
+  //!
+  //! \param uCapacity requested capacity
+  //! \return smallest power of 2 greater or equal to the requested capacity (at least 2)
+  //!
+  static std::size_t
+  round_up_capacity(std::size_t uCapacity) {
+    std::size_t uRoundedCapacity = 2;
+
+    while (uRoundedCapacity < uCapacity) { uRoundedCapacity <<= 1; }
+
+    return uRoundedCapacity;
+  }
+
+private:
+  //!
+  //! struct cell
+  //! slot of the ring buffer
+  //!  * sequence: position for which the cell is ready to be written (pos) or read (pos + 1)
+  //!  * value: stored element
+  //!
+  struct cell {
+    std::atomic<std::size_t>  uSequence_a;
+    T                         value;
+  };
+
+private:
+  //!
+  //! number of cells
+  //!
+  const std::size_t                                         m_uCapacity;
+
+  //!
+  //! mask used to convert positions into cell indexes
+  //!
+  const std::size_t                                         m_uMask;
+
+  //!
+  //! cells
+  //!
+  std::unique_ptr<cell[]>                                   m_arrCells;
+
+  //!
+  //! next position to be written, on its own cache line to prevent false sharing with consumers
+  //!
+  alignas(__TACOPIE_CACHE_LINE_SIZE) std::atomic<std::size_t> m_uEnqueuePos_a;
+
+  //!
+  //! next position to be read, on its own cache line to prevent false sharing with producers
+  //!
+  alignas(__TACOPIE_CACHE_LINE_SIZE) std::atomic<std::size_t> m_uDequeuePos_a;
+};
+
+} // namespace utils
+
+} // namespace tacopie
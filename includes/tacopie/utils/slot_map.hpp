@@ -0,0 +1,273 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace tacopie {
+
+namespace utils {
+
+//!
+//! slot map: associative container handing out stable handles, with O(1) insert, lookup and erase
+//!
+//! values are stored contiguously (dense storage, erase moves the last value into the hole) so that iterating over
+//! them is cache-friendly. handles index a table of slots pointing into the dense storage, and carry the generation
+//! of their slot so that stale handles (whose value has been erased) are detected.
+//!
+//! this class is not thread-safe.
+//!
+//! \tparam T type of the stored values, must be move constructible and move assignable
+//!
+template <typename T>
+class slot_map {
+public:
+  //!
+  //! handle of a stored value (slot index and generation), never 0
+  //!
+  typedef std::uint64_t handle_t;
+
+  //!
+  //! iterators over the values, in no particular order
+  //! invalidated by insert and erase
+  //!
+  typedef typename std::vector<T>::iterator iterator;
+  typedef typename std::vector<T>::const_iterator const_iterator;
+
+public:
+  //! ctor
+  slot_map(void)
+  : m_uFreeHead(s_uInvalidIndex) {}
+
+  //! dtor
+  ~slot_map(void) = default;
+
+  //! copy ctor
+  slot_map(const slot_map&) = delete;
+  //! assignment operator
+  slot_map& operator=(const slot_map&) = delete;
+
+public:
+  //!
+  //! store a value
+  //!
+  //! \param value value to be stored
+  //! \return handle of the value
+  //!
+  handle_t
+  insert(T value) {
+    std::uint32_t uSlotIndex;
+
+    if (m_uFreeHead != s_uInvalidIndex) {
+      uSlotIndex  = m_uFreeHead;
+      m_uFreeHead = m_vctSlots[uSlotIndex].uIndex;
+    } else {
+      uSlotIndex = static_cast<std::uint32_t>(m_vctSlots.size());
+      m_vctSlots.push_back({s_uInvalidIndex, 1});
+    }
+
+    auto& slot  = m_vctSlots[uSlotIndex];
+    slot.uIndex = static_cast<std::uint32_t>(m_vctValues.size());
+
+    m_vctValues.push_back(std::move(value));
+    m_vctValueSlots.push_back(uSlotIndex);
+
+    return make_handle(uSlotIndex, slot.uGeneration);
+  }
+
+  //!
+  //! remove a value
+  //!
+  //! \param handle handle of the value
+  //! \param value filled in with the removed value (optional)
+  //! \return false if the handle does not match any stored value
+  //!
+  bool
+  erase(handle_t handle, T* value = nullptr) {
+    std::uint32_t uSlotIndex = find_slot(handle);
+
+    if (uSlotIndex == s_uInvalidIndex) { return false; }
+
+    auto& slot          = m_vctSlots[uSlotIndex];
+    std::uint32_t uHole = slot.uIndex;
+
+    if (value) { *value = std::move(m_vctValues[uHole]); }
+
+    //! fill the hole with the last value to keep the storage dense
+    std::uint32_t uLast = static_cast<std::uint32_t>(m_vctValues.size() - 1);
+    if (uHole != uLast) {
+      m_vctValues[uHole]                        = std::move(m_vctValues[uLast]);
+      m_vctValueSlots[uHole]                    = m_vctValueSlots[uLast];
+      m_vctSlots[m_vctValueSlots[uHole]].uIndex = uHole;
+    }
+
+    m_vctValues.pop_back();
+    m_vctValueSlots.pop_back();
+
+    //! invalidate the handles of this slot (0 is skipped so that a handle is never 0)
+    if (++slot.uGeneration == 0) { slot.uGeneration = 1; }
+
+    slot.uIndex = m_uFreeHead;
+    m_uFreeHead = uSlotIndex;
+
+    return true;
+  }
+
+  //!
+  //! \param handle handle of the value
+  //! \return the value matching the handle, or nullptr if the handle does not match any stored value
+  //!
+  T*
+  find(handle_t handle) {
+    std::uint32_t uSlotIndex = find_slot(handle);
+
+    return uSlotIndex == s_uInvalidIndex ? nullptr : &m_vctValues[m_vctSlots[uSlotIndex].uIndex];
+  }
+
+  //!
+  //! remove all the values, invalidating all the handles
+  //!
+  void
+  clear(void) {
+    while (!m_vctValueSlots.empty()) {
+      std::uint32_t uSlotIndex = m_vctValueSlots.back();
+      erase(make_handle(uSlotIndex, m_vctSlots[uSlotIndex].uGeneration));
+    }
+  }
+
+public:
+  //!
+  //! \return the number of stored values
+  //!
+  std::size_t
+  size(void) const {
+    return m_vctValues.size();
+  }
+
+  //!
+  //! \return whether no value is stored
+  //!
+  bool
+  empty(void) const {
+    return m_vctValues.empty();
+  }
+
+  //!
+  //! contiguous storage of the values
+  //!
+  iterator
+  begin(void) {
+    return m_vctValues.begin();
+  }
+
+  iterator
+  end(void) {
+    return m_vctValues.end();
+  }
+
+  const_iterator
+  begin(void) const {
+    return m_vctValues.begin();
+  }
+
+  const_iterator
+  end(void) const {
+    return m_vctValues.end();
+  }
+
+private:
+  //!
+  //! struct slot
+  //!  * index: position of the value in the dense storage (next free slot when the slot is free)
+  //!  * generation: incremented whenever the value of the slot is erased
+  //!
+  struct slot {
+    std::uint32_t uIndex;
+    std::uint32_t uGeneration;
+  };
+
+  //!
+  //! invalid slot or value index
+  //!
+  static const std::uint32_t s_uInvalidIndex = 0xFFFFFFFF;
+
+private:
+  //!
+  //! \return handle of the given slot
+  //!
+  static handle_t
+  make_handle(std::uint32_t uSlotIndex, std::uint32_t uGeneration) {
+    return (static_cast<handle_t>(uGeneration) << 32) | uSlotIndex;
+  }
+
+  //!
+  //! \return index of the slot matching the handle, or s_uInvalidIndex if the handle is invalid
+  //!
+  std::uint32_t
+  find_slot(handle_t handle) const {
+    std::uint32_t uSlotIndex  = static_cast<std::uint32_t>(handle & 0xFFFFFFFF);
+    std::uint32_t uGeneration = static_cast<std::uint32_t>(handle >> 32);
+
+    if (uSlotIndex >= m_vctSlots.size()) { return s_uInvalidIndex; }
+
+    const auto& slot = m_vctSlots[uSlotIndex];
+
+    //! free slots have an outdated generation
+    if (slot.uGeneration != uGeneration || slot.uIndex >= m_vctValues.size() || m_vctValueSlots[slot.uIndex] != uSlotIndex) {
+      return s_uInvalidIndex;
+    }
+
+    return uSlotIndex;
+  }
+
+private:
+  //!
+  //! values, stored contiguously
+  //!
+  std::vector<T>             m_vctValues;
+
+  //!
+  //! slot of each value (same order as m_vctValues)
+  //!
+  std::vector<std::uint32_t> m_vctValueSlots;
+
+  //!
+  //! slots, indexed by handles
+  //!
+  std::vector<slot>          m_vctSlots;
+
+  //!
+  //! head of the list of free slots
+  //!
+  std::uint32_t              m_uFreeHead;
+};
+
+template <typename T>
+const std::uint32_t slot_map<T>::s_uInvalidIndex;
+
+} // namespace utils
+
+} // namespace tacopie
@@ -23,14 +23,27 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <functional>
 #include <list>
 #include <mutex>
 #include <queue>
+#include <string>
 #include <thread>
 #include <vector>
 
+#include <tacopie/utils/inplace_function.hpp>
+#include <tacopie/utils/mpmc_queue.hpp>
+
+#ifndef __TACOPIE_THREAD_POOL_QUEUE_SIZE
+#define __TACOPIE_THREAD_POOL_QUEUE_SIZE 4096
+#endif /* __TACOPIE_THREAD_POOL_QUEUE_SIZE */
+
+#ifndef __TACOPIE_THREAD_POOL_SPIN_COUNT
+#define __TACOPIE_THREAD_POOL_SPIN_COUNT 256
+#endif /* __TACOPIE_THREAD_POOL_SPIN_COUNT */
+
 namespace tacopie {
 
 namespace utils {
@@ -38,6 +51,10 @@ namespace utils {
 //!
 //! basic thread pool used to push async tasks from the io_service
 //!
+//! tasks are pushed to a bounded lock-free queue (falling back to a locked queue when it is full).
+//! idle workers spin for a while before parking on a condition variable, and producers only take the lock to wake up
+//! workers when some of them are parked.
+//!
 class thread_pool {
 public:
   //!
@@ -60,8 +77,9 @@ public:
   //!
   //! task typedef
   ///! simply a callable taking no parameter
+  //! stored in place (no allocation) by the task queue
   //!
-  typedef std::function<void()> task_t;
+  typedef inplace_function<void()> task_t;
 
   //!
   //! add tasks to thread pool
@@ -70,7 +88,7 @@ public:
   //!
   //! \param task task to be executed by the threadpool
   //!
-  void add_task(const task_t& task);
+  void add_task(task_t task);
 
   //!
   //! same as add_task
@@ -78,7 +96,7 @@ public:
   //! \param task task to be executed by the threadpool
   //! \return current instance
   //!
-  thread_pool& operator<<(const task_t& task);
+  thread_pool& operator<<(task_t task);
 
   //!
   //! stop the thread pool and wait for workers completion
@@ -109,6 +127,33 @@ public:
   //!
   void set_nb_threads(std::size_t nb_threads);
 
+  //!
+  //! \return the number of tasks waiting to be executed (only a hint when called concurrently with add_task)
+  //!
+  std::size_t get_nb_pending_tasks(void) const;
+
+public:
+  //!
+  //! pin the workers to a set of CPUs
+  //! this can be safely called at runtime: workers apply it in the background (once their current task completes)
+  //!
+  //! \param vctCpus indexes of the CPUs the workers are allowed to run on, empty to allow all the CPUs of the process
+  //!
+  void set_cpu_affinity(const std::vector<std::size_t>& vctCpus);
+
+  //!
+  //! name the workers, for debuggers and profilers: each worker is named "<sName>-<worker index>"
+  //! this can be safely called at runtime: workers apply it in the background (once their current task completes)
+  //!
+  //! \param sName name prefix of the workers (workers are not named when empty)
+  //!
+  void set_thread_name(const std::string& sName);
+
+  //!
+  //! \return whether the calling thread is one of the workers of this thread pool
+  //!
+  bool is_worker_thread(void) const;
+
 private:
   //!
   //! worker main loop
@@ -117,19 +162,54 @@ private:
 
   //!
   //! retrieve a new task
-  //! fetch the first element in the queue, or wait if no task are available
+  //! fetch the first element in the queue, or spin and then wait if no task are available
+  //! returns without task when the name or CPU affinity settings changed
   //!
+  //! \param uPlacementGeneration generation of the settings applied by the calling worker
   //! \return a pair <stopped, task>
   //!         pair.first indicated whether the thread has been marked for stop and should return immediately
   //!         pair.second contains the task to be executed
   //!
-  std::pair<bool, task_t> fetch_task_or_stop(void);
+  std::pair<bool, task_t> fetch_task_or_stop(std::size_t uPlacementGeneration);
+
+  //!
+  //! task stored by the queues
+  //! when metrics are enabled, its enqueue time is stored next to it (measures the time spent in the queues without
+  //! wrapping the task, which would not fit in place anymore)
+  //!
+  struct queued_task {
+    task_t                                task;
+#ifdef __TACOPIE_METRICS_ENABLED
+    std::chrono::steady_clock::time_point timeQueued;
+#endif /* __TACOPIE_METRICS_ENABLED */
+  };
 
   //!
   //! \return whether the thread should stop or not
   //!
   bool should_stop(void) const;
 
+  //!
+  //! pop a task from the lock-free queue, or from the overflow queue if the lock-free queue is empty
+  //!
+  //! \param queuedTask filled in with the popped task on success
+  //! \return whether a task has been popped
+  //!
+  bool try_pop_task(queued_task& queuedTask);
+
+  //!
+  //! \return whether some tasks are pending (only a hint when called concurrently with add_task)
+  //!
+  bool has_pending_tasks(void) const;
+
+  //!
+  //! apply the current name and CPU affinity settings to the calling worker
+  //!
+  //! \param uWorkerIndex index of the calling worker
+  //! \return generation of the applied settings
+  //!
+  std::size_t apply_placement(std::size_t uWorkerIndex);
+
 private:
   //!
   //! threads
@@ -154,17 +234,47 @@ private:
   //!
   //! tasks
   //!
-  std::queue<task_t>            m_queTasks;
+  mpmc_queue<queued_task>       m_queTasks{__TACOPIE_THREAD_POOL_QUEUE_SIZE};
+
+  //!
+  //! tasks that did not fit in m_queTasks, and the ones added until these are executed
+  //! (only popped once m_queTasks is empty, which then only holds older tasks)
+  //!
+  std::queue<queued_task>       m_queOverflowTasks;
 
   //!
-  //! tasks thread safety
+  //! number of tasks in m_queOverflowTasks, checked without the lock
+  //!
+  std::atomic<std::size_t>      m_uNbOverflowTasks_a    = ATOMIC_VAR_INIT(0);
+
+  //!
+  //! overflow tasks and parking thread safety
   //!
   std::mutex                    m_mtxTasks;
 
   //!
-  //! task condvar to sync on tasks changes
+  //! task condvar used by idle workers to park
   //!
   std::condition_variable       m_cvTasks;
+
+  //!
+  //! number of workers parked on m_cvTasks
+  //!
+  std::atomic<std::size_t>      m_uNbParkedThreads_a    = ATOMIC_VAR_INIT(0);
+
+  //!
+  //! index given to the next spawned worker
+  //!
+  std::atomic<std::size_t>      m_uNextWorkerIndex_a    = ATOMIC_VAR_INIT(0);
+
+  //!
+  //! name and CPU affinity settings of the workers, and their generation (incremented on each change)
+  //!
+  std::mutex                    m_mtxPlacement;
+  std::string                   m_sThreadName;
+  std::vector<std::size_t>      m_vctCpus;
+  bool                          m_bHasCpuAffinity       = false;
+  std::atomic<std::size_t>      m_uPlacementGeneration_a = ATOMIC_VAR_INIT(0);
 };
 
 } // namespace utils
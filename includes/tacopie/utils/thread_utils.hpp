@@ -0,0 +1,54 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace tacopie {
+
+namespace utils {
+
+//!
+//! set the name of the calling thread, as displayed by debuggers and profilers
+//! names are truncated to 15 characters on linux
+//!
+//! \param sName name of the thread
+//! \return whether the name has been set (false if not supported on the current platform)
+//!
+bool set_current_thread_name(const std::string& sName);
+
+//!
+//! pin the calling thread to a set of CPUs
+//! memory allocated and first written by the thread afterwards is then placed on the NUMA node of these CPUs by the
+//! default (first-touch) policy of the operating system
+//!
+//! \param vctCpus indexes of the CPUs the thread is allowed to run on, empty to allow all the CPUs of the process
+//! \return whether the affinity has been set (false if not supported on the current platform or if the set is invalid)
+//!
+bool set_current_thread_affinity(const std::vector<std::size_t>& vctCpus);
+
+} // namespace utils
+
+} // namespace tacopie
@@ -0,0 +1,200 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+//! number of levels of the timer wheel (each level has 64 slots: 6 levels cover 64^6 ticks)
+#ifndef __TACOPIE_TIMER_WHEEL_NB_LEVELS
+#define __TACOPIE_TIMER_WHEEL_NB_LEVELS 6
+#endif /* __TACOPIE_TIMER_WHEEL_NB_LEVELS */
+
+namespace tacopie {
+
+namespace utils {
+
+//!
+//! hierarchical timing wheel
+//!
+//! time is expressed in ticks, the unit of a tick is up to the user of the wheel.
+//! each level has 64 slots, a slot of level L spans 64^L ticks. timers are stored in the slot of the lowest level
+//! that can hold their deadline and are moved to lower levels (cascaded) when time reaches their slot.
+//! adding and cancelling a timer are O(1), advancing the wheel is O(1) per expired or cascaded timer and empty slots
+//! are skipped using a per-level bitmap.
+//!
+//! timer nodes are kept in a slab and linked in intrusive lists, so that steady-state operations do not allocate.
+//!
+//! this class is not thread-safe.
+//!
+class timer_wheel {
+public:
+  //!
+  //! callback executed on timer expiry
+  //!
+  typedef std::function<void()> callback_t;
+
+  //!
+  //! timer handle (slab index and generation), never 0
+  //!
+  typedef std::uint64_t handle_t;
+
+  //!
+  //! expired timer, as returned by advance()
+  //!
+  typedef std::pair<handle_t, callback_t> expired_timer_t;
+
+public:
+  //! ctor
+  timer_wheel(void);
+  //! dtor
+  ~timer_wheel(void) = default;
+
+  //! copy ctor
+  timer_wheel(const timer_wheel&) = delete;
+  //! assignment operator
+  timer_wheel& operator=(const timer_wheel&) = delete;
+
+public:
+  //!
+  //! add a timer
+  //!
+  //! \param uExpiryTick tick at which the timer expires (timers expiring in the past expire on the next advance)
+  //! \param uPeriodTicks rescheduling period for periodic timers, 0 for one-shot timers
+  //! \param callback callback executed on expiry
+  //! \return handle of the timer
+  //!
+  handle_t add(std::uint64_t uExpiryTick, std::uint64_t uPeriodTicks, const callback_t& callback);
+
+  //!
+  //! cancel a timer
+  //!
+  //! \param handle handle of the timer
+  //! \return true if the timer was pending
+  //!
+  bool cancel(handle_t handle);
+
+  //!
+  //! advance the wheel up to the given tick and collect the expired timers
+  //! one-shot timers are removed from the wheel, periodic ones are rescheduled (their callback is copied)
+  //!
+  //! \param uTick current tick
+  //! \param vctExpiredTimers filled in with the expired timers, in expiry order
+  //!
+  void advance(std::uint64_t uTick, std::vector<expired_timer_t>& vctExpiredTimers);
+
+  //!
+  //! \return the next tick at which advance() has something to do (expiry or cascade), or UINT64_MAX if empty
+  //! the actual expiry of the nearest timer might be later than this tick
+  //!
+  std::uint64_t get_next_event_tick(void) const;
+
+  //!
+  //! \return the tick the wheel has been advanced up to
+  //!
+  std::uint64_t get_current_tick(void) const;
+
+  //!
+  //! \return the number of pending timers
+  //!
+  std::size_t size(void) const;
+
+private:
+  //!
+  //! timer node, linked in the list of its slot (or in the free list)
+  //!
+  struct node {
+    std::uint64_t uExpiryTick;
+    std::uint64_t uPeriodTicks;
+    callback_t    callback;
+    std::uint32_t uGeneration;
+    std::uint32_t uPrev;
+    std::uint32_t uNext;
+    std::uint8_t  uLevel;
+    std::uint8_t  uSlot;
+    bool          bLinked;
+  };
+
+private:
+  //!
+  //! insert a node in the slot matching its expiry
+  //!
+  void link(std::uint32_t uIndex);
+
+  //!
+  //! remove a node from its slot
+  //!
+  void unlink(std::uint32_t uIndex);
+
+  //!
+  //! give a node back to the free list
+  //!
+  void release(std::uint32_t uIndex);
+
+  //!
+  //! move the timers of the given slot to the lower levels
+  //!
+  void cascade(std::size_t uLevel, std::size_t uSlot);
+
+  //!
+  //! \return index of the node matching the handle, or UINT32_MAX if the handle is invalid
+  //!
+  std::uint32_t find(handle_t handle) const;
+
+private:
+  //!
+  //! slab of nodes
+  //!
+  std::vector<node>   m_vctNodes;
+
+  //!
+  //! head of the free list
+  //!
+  std::uint32_t       m_uFreeHead;
+
+  //!
+  //! head of the list of each slot of each level
+  //!
+  std::uint32_t       m_arrSlots[__TACOPIE_TIMER_WHEEL_NB_LEVELS][64];
+
+  //!
+  //! non-empty slots of each level
+  //!
+  std::uint64_t       m_arrOccupiedSlots[__TACOPIE_TIMER_WHEEL_NB_LEVELS];
+
+  //!
+  //! tick the wheel has been advanced up to
+  //!
+  std::uint64_t       m_uCurrentTick;
+
+  //!
+  //! number of pending timers
+  //!
+  std::size_t         m_uNbTimers;
+};
+
+} // namespace utils
+
+} // namespace tacopie
@@ -37,6 +37,13 @@ typedef int fd_t;
 #define __TACOPIE_INVALID_FD -1
 #endif /* _WIN32 */
 
+//! regular file platform type (see tcp_socket::sendfile)
+#ifdef _WIN32
+typedef HANDLE file_handle_t;
+#else
+typedef int file_handle_t;
+#endif /* _WIN32 */
+
 //! ssize_t
 #if defined(_MSC_VER)
 #include <BaseTsd.h>
@@ -0,0 +1,81 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <tacopie/network/poller.hpp>
+#include <tacopie/utils/error.hpp>
+
+namespace tacopie {
+
+//!
+//! poller factory
+//!
+
+std::unique_ptr<poller_iface>
+create_poller(poller_backend eBackend) {
+  switch (eBackend) {
+  case poller_backend::automatic:
+#if defined(__TACOPIE_HAS_EPOLL)
+    return std::unique_ptr<poller_iface>(new epoll_poller);
+#elif defined(__TACOPIE_HAS_KQUEUE)
+    return std::unique_ptr<poller_iface>(new kqueue_poller);
+#elif defined(__TACOPIE_HAS_IOCP)
+    return std::unique_ptr<poller_iface>(new iocp_poller);
+#else
+    return std::unique_ptr<poller_iface>(new select_poller);
+#endif
+
+  case poller_backend::select:
+    return std::unique_ptr<poller_iface>(new select_poller);
+
+  case poller_backend::epoll:
+#ifdef __TACOPIE_HAS_EPOLL
+    return std::unique_ptr<poller_iface>(new epoll_poller);
+#else
+    __TACOPIE_THROW(error, "epoll poller backend is not available on this platform");
+#endif /* __TACOPIE_HAS_EPOLL */
+
+  case poller_backend::kqueue:
+#ifdef __TACOPIE_HAS_KQUEUE
+    return std::unique_ptr<poller_iface>(new kqueue_poller);
+#else
+    __TACOPIE_THROW(error, "kqueue poller backend is not available on this platform");
+#endif /* __TACOPIE_HAS_KQUEUE */
+
+  case poller_backend::io_uring:
+#ifdef __TACOPIE_HAS_IO_URING
+    return std::unique_ptr<poller_iface>(new io_uring_poller);
+#else
+    __TACOPIE_THROW(error, "io_uring poller backend is not available on this platform");
+#endif /* __TACOPIE_HAS_IO_URING */
+
+  case poller_backend::iocp:
+#ifdef __TACOPIE_HAS_IOCP
+    return std::unique_ptr<poller_iface>(new iocp_poller);
+#else
+    __TACOPIE_THROW(error, "iocp poller backend is not available on this platform");
+#endif /* __TACOPIE_HAS_IOCP */
+  }
+
+  __TACOPIE_THROW(error, "unknown poller backend");
+}
+
+} // namespace tacopie
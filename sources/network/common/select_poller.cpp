@@ -0,0 +1,111 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <tacopie/network/poller.hpp>
+#include <tacopie/utils/logger.hpp>
+
+namespace tacopie {
+
+//!
+//! register events for fd
+//!
+
+void
+select_poller::update(fd_t fd, int, int nNewEvents) {
+  std::lock_guard<std::mutex> lock(m_mtxRegisteredEvents);
+
+  if (nNewEvents == none) {
+    m_mapRegisteredEvents.erase(fd);
+  } else {
+    m_mapRegisteredEvents[fd] = nNewEvents;
+  }
+}
+
+//!
+//! wait for events
+//!
+
+void
+select_poller::wait(std::vector<poll_event>& vctEvents, int nTimeoutMsecs) {
+  vctEvents.clear();
+  m_vctPolledFds.clear();
+  FD_ZERO(&m_fdsetRead);
+  FD_ZERO(&m_fdsetWrite);
+
+  int nFds = 0;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mtxRegisteredEvents);
+
+    for (const auto& registered : m_mapRegisteredEvents) {
+      const auto& fd      = registered.first;
+      const auto& nEvents = registered.second;
+
+      if (nEvents & rd) { FD_SET(fd, &m_fdsetRead); }
+      if (nEvents & wr) { FD_SET(fd, &m_fdsetWrite); }
+
+      m_vctPolledFds.push_back(fd);
+
+      if (static_cast<int>(fd) > nFds) { nFds = static_cast<int>(fd); }
+    }
+  }
+
+  //! setup timeout
+  timeval* pTimeout = NULL;
+  timeval timeout;
+  if (nTimeoutMsecs >= 0) {
+    timeout.tv_sec  = nTimeoutMsecs / 1000;
+    timeout.tv_usec = (nTimeoutMsecs % 1000) * 1000;
+    pTimeout        = &timeout;
+  }
+
+  if (select(nFds + 1, &m_fdsetRead, &m_fdsetWrite, NULL, pTimeout) <= 0) { return; }
+
+  for (const auto& fd : m_vctPolledFds) {
+    int nEvents = none;
+
+    if (FD_ISSET(fd, &m_fdsetRead)) { nEvents |= rd; }
+    if (FD_ISSET(fd, &m_fdsetWrite)) { nEvents |= wr; }
+
+    if (nEvents != none) { vctEvents.push_back({fd, nEvents}); }
+  }
+}
+
+//!
+//! fd_sets are only built when wait() starts
+//!
+
+bool
+select_poller::needs_wakeup_on_update(void) const {
+  return true;
+}
+
+//!
+//! backend getter
+//!
+
+poller_backend
+select_poller::get_backend(void) const {
+  return poller_backend::select;
+}
+
+} // namespace tacopie
@@ -21,8 +21,10 @@
 // SOFTWARE.
 
 #include <tacopie/network/tcp_server.hpp>
+#include <tacopie/utils/buffer_pool.hpp>
 #include <tacopie/utils/error.hpp>
 #include <tacopie/utils/logger.hpp>
+#include <tacopie/utils/metrics.hpp>
 
 #ifdef _WIN32
 #ifdef __GNUC__
@@ -43,16 +45,26 @@
 #endif
 #else
 #include <arpa/inet.h>
+#include <cerrno>
 #include <fcntl.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <sys/select.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <unistd.h>
 #endif /* _WIN32 */
 
+#ifdef _WIN32
+#include <mswsock.h>
+#pragma comment(lib, "mswsock.lib")
+#elif defined(__linux__)
+#include <sys/sendfile.h>
+#endif /* _WIN32 */
+
 #ifndef SOCKET_ERROR
 #define SOCKET_ERROR -1
 #endif /* SOCKET_ERROR */
@@ -64,6 +76,12 @@
 #define __TACOPIE_LENGTH(size) size // for Unix, keep buffer size as `size_t`
 #endif                              /* _WIN32 */
 
+#ifdef _WIN32
+#define __TACOPIE_WOULD_BLOCK() (WSAGetLastError() == WSAEWOULDBLOCK)
+#else
+#define __TACOPIE_WOULD_BLOCK() (errno == EAGAIN || errno == EWOULDBLOCK)
+#endif /* _WIN32 */
+
 namespace tacopie {
 
 //!
@@ -95,7 +113,8 @@ tcp_socket::tcp_socket(tcp_socket&& socket)
 : m_fd(std::move(socket.m_fd))
 , m_sHost(socket.m_sHost)
 , m_uPort(socket.m_uPort)
-, m_eType(socket.m_eType) {
+, m_eType(socket.m_eType)
+, m_options(socket.m_options) {
   socket.m_fd       = __TACOPIE_INVALID_FD;
   socket.m_eType    = type::UNKNOWN;
 
@@ -108,34 +127,249 @@ tcp_socket::tcp_socket(tcp_socket&& socket)
 
 std::vector<char>
 tcp_socket::recv(std::size_t uSizeToRead) {
+  std::vector<char> vctData = utils::buffer_pool::get_instance().acquire(uSizeToRead);
+
+  try {
+    vctData.resize(recv(vctData.data(), uSizeToRead));
+  }
+  catch (const tacopie_error&) {
+    utils::buffer_pool::get_instance().release(std::move(vctData));
+    throw;
+  }
+
+  return vctData;
+}
+
+std::size_t
+tcp_socket::recv(char* pBuffer, std::size_t uSizeToRead) {
   create_socket_if_necessary();
   check_or_set_type(type::CLIENT);
 
-  std::vector<char> vctData(uSizeToRead, 0);
+  ssize_t uReadSize = ::recv(m_fd, pBuffer, __TACOPIE_LENGTH(uSizeToRead), 0);
+  __TACOPIE_METRIC_ADD(read_syscalls, 1)
 
-  ssize_t uReadSize = ::recv(m_fd, const_cast<char*>(vctData.data()), __TACOPIE_LENGTH(uSizeToRead), 0);
-
-  if (uReadSize == SOCKET_ERROR) { __TACOPIE_THROW(error, "recv() failure"); }
+  if (uReadSize == SOCKET_ERROR) {
+    if (__TACOPIE_WOULD_BLOCK()) { return 0; }
+    __TACOPIE_THROW(error, "recv() failure");
+  }
 
   if (uReadSize == 0) { __TACOPIE_THROW(warn, "nothing to read, socket has been closed by remote host"); }
 
-  vctData.resize(uReadSize);
+  __TACOPIE_METRIC_ADD(bytes_read, uReadSize)
 
-  return vctData;
+  return uReadSize;
 }
 
 std::size_t
 tcp_socket::send(const std::vector<char>& vctData, std::size_t uSizeToWrite) {
+  return send(vctData.data(), uSizeToWrite);
+}
+
+std::size_t
+tcp_socket::send(const char* pData, std::size_t uSizeToWrite) {
+  create_socket_if_necessary();
+  check_or_set_type(type::CLIENT);
+
+  ssize_t uWriteSize = ::send(m_fd, pData, __TACOPIE_LENGTH(uSizeToWrite), 0);
+  __TACOPIE_METRIC_ADD(write_syscalls, 1)
+
+  if (uWriteSize == SOCKET_ERROR) {
+    if (__TACOPIE_WOULD_BLOCK()) { return 0; }
+    __TACOPIE_THROW(error, "send() failure");
+  }
+
+  __TACOPIE_METRIC_ADD(bytes_written, uWriteSize)
+
+  return uWriteSize;
+}
+
+std::size_t
+tcp_socket::sendv(const io_buffer* pBuffers, std::size_t uNbBuffers) {
+  create_socket_if_necessary();
+  check_or_set_type(type::CLIENT);
+
+  if (uNbBuffers > __TACOPIE_MAX_IO_BUFFERS) { uNbBuffers = __TACOPIE_MAX_IO_BUFFERS; }
+
+#ifdef _WIN32
+  WSABUF arrBuffers[__TACOPIE_MAX_IO_BUFFERS];
+  for (std::size_t i = 0; i < uNbBuffers; ++i) {
+    arrBuffers[i].buf = const_cast<char*>(pBuffers[i].pData);
+    arrBuffers[i].len = static_cast<ULONG>(pBuffers[i].uSize);
+  }
+
+  DWORD uWriteSize = 0;
+  __TACOPIE_METRIC_ADD(write_syscalls, 1)
+  if (::WSASend(m_fd, arrBuffers, static_cast<DWORD>(uNbBuffers), &uWriteSize, 0, NULL, NULL) == SOCKET_ERROR) {
+    if (__TACOPIE_WOULD_BLOCK()) { return 0; }
+    __TACOPIE_THROW(error, "WSASend() failure");
+  }
+#else
+  struct iovec arrBuffers[__TACOPIE_MAX_IO_BUFFERS];
+  for (std::size_t i = 0; i < uNbBuffers; ++i) {
+    arrBuffers[i].iov_base = const_cast<char*>(pBuffers[i].pData);
+    arrBuffers[i].iov_len  = pBuffers[i].uSize;
+  }
+
+  ssize_t uWriteSize = ::writev(m_fd, arrBuffers, static_cast<int>(uNbBuffers));
+  __TACOPIE_METRIC_ADD(write_syscalls, 1)
+
+  if (uWriteSize == SOCKET_ERROR) {
+    if (__TACOPIE_WOULD_BLOCK()) { return 0; }
+    __TACOPIE_THROW(error, "writev() failure");
+  }
+#endif /* _WIN32 */
+
+  __TACOPIE_METRIC_ADD(bytes_written, uWriteSize)
+
+  return uWriteSize;
+}
+
+//!
+//! zero-copy operations
+//!
+
+std::size_t
+tcp_socket::sendfile(file_handle_t hFile, std::uint64_t uOffset, std::size_t uSize) {
   create_socket_if_necessary();
   check_or_set_type(type::CLIENT);
 
-  ssize_t uWriteSize = ::send(m_fd, vctData.data(), __TACOPIE_LENGTH(uSizeToWrite), 0);
+#ifdef _WIN32
+  LARGE_INTEGER nFileSize;
+  if (!::GetFileSizeEx(hFile, &nFileSize)) { __TACOPIE_THROW(error, "GetFileSizeEx() failure"); }
+  if (uOffset >= static_cast<std::uint64_t>(nFileSize.QuadPart)) { __TACOPIE_THROW(error, "sendfile() reached the end of the file"); }
+
+  //! TransmitFile sends from the file position and is limited to 2GB - 2 bytes per call
+  std::uint64_t uAvailable = static_cast<std::uint64_t>(nFileSize.QuadPart) - uOffset;
+  if (uSize > uAvailable) { uSize = static_cast<std::size_t>(uAvailable); }
+  if (uSize > 0x7FFFFFFE) { uSize = 0x7FFFFFFE; }
+
+  LARGE_INTEGER nOffset;
+  nOffset.QuadPart = static_cast<LONGLONG>(uOffset);
+  if (!::SetFilePointerEx(hFile, nOffset, NULL, FILE_BEGIN)) { __TACOPIE_THROW(error, "SetFilePointerEx() failure"); }
+
+  __TACOPIE_METRIC_ADD(write_syscalls, 1)
+  if (!::TransmitFile(m_fd, hFile, static_cast<DWORD>(uSize), 0, NULL, NULL, 0)) {
+    if (__TACOPIE_WOULD_BLOCK()) { return 0; }
+    __TACOPIE_THROW(error, "TransmitFile() failure");
+  }
+
+  std::size_t uWriteSize = uSize;
+#elif defined(__linux__)
+  off_t nOffset = static_cast<off_t>(uOffset);
+
+  ssize_t nWriteSize = ::sendfile(m_fd, hFile, &nOffset, uSize);
+  __TACOPIE_METRIC_ADD(write_syscalls, 1)
+
+  if (nWriteSize == SOCKET_ERROR) {
+    if (__TACOPIE_WOULD_BLOCK()) { return 0; }
+    __TACOPIE_THROW(error, "sendfile() failure");
+  }
+
+  if (nWriteSize == 0 && uSize) { __TACOPIE_THROW(error, "sendfile() reached the end of the file"); }
+
+  std::size_t uWriteSize = static_cast<std::size_t>(nWriteSize);
+#elif defined(__APPLE__)
+  //! on failure, the number of bytes that have been sent is still reported
+  off_t nWriteSize = static_cast<off_t>(uSize);
+  int nResult      = ::sendfile(hFile, m_fd, static_cast<off_t>(uOffset), &nWriteSize, NULL, 0);
+  __TACOPIE_METRIC_ADD(write_syscalls, 1)
+
+  if (nResult == SOCKET_ERROR && !(__TACOPIE_WOULD_BLOCK() && nWriteSize > 0)) {
+    if (__TACOPIE_WOULD_BLOCK()) { return 0; }
+    __TACOPIE_THROW(error, "sendfile() failure");
+  }
+
+  if (nWriteSize == 0 && uSize) { __TACOPIE_THROW(error, "sendfile() reached the end of the file"); }
+
+  std::size_t uWriteSize = static_cast<std::size_t>(nWriteSize);
+#else
+  //! no zero-copy primitive: read the region into a pooled buffer, bytes that could not be sent are read again later
+  auto& pool                = utils::buffer_pool::get_instance();
+  std::vector<char> vctData = pool.acquire(uSize < __TACOPIE_SENDFILE_FALLBACK_SIZE ? uSize : __TACOPIE_SENDFILE_FALLBACK_SIZE);
+
+  ssize_t nReadSize = ::pread(hFile, vctData.data(), vctData.size(), static_cast<off_t>(uOffset));
+  if (nReadSize <= 0) {
+    pool.release(std::move(vctData));
+    if (nReadSize == 0 && uSize) { __TACOPIE_THROW(error, "sendfile() reached the end of the file"); }
+    if (nReadSize) { __TACOPIE_THROW(error, "pread() failure"); }
+    return 0;
+  }
+
+  std::size_t uWriteSize;
+  try {
+    uWriteSize = send(vctData.data(), static_cast<std::size_t>(nReadSize));
+  }
+  catch (const tacopie_error&) {
+    pool.release(std::move(vctData));
+    throw;
+  }
+
+  pool.release(std::move(vctData));
+
+  //! bytes and syscalls already accounted by send
+  return uWriteSize;
+#endif /* _WIN32 */
 
-  if (uWriteSize == SOCKET_ERROR) { __TACOPIE_THROW(error, "send() failure"); }
+  __TACOPIE_METRIC_ADD(bytes_written, uWriteSize)
 
   return uWriteSize;
 }
 
+std::size_t
+tcp_socket::splice_to_pipe(fd_t fdPipe, std::size_t uSize, bool& bEndOfStream) {
+  create_socket_if_necessary();
+  check_or_set_type(type::CLIENT);
+
+  bEndOfStream = false;
+
+#ifdef __linux__
+  ssize_t nReadSize = ::splice(m_fd, NULL, fdPipe, NULL, uSize, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+  __TACOPIE_METRIC_ADD(read_syscalls, 1)
+
+  if (nReadSize == SOCKET_ERROR) {
+    if (__TACOPIE_WOULD_BLOCK()) { return 0; }
+    __TACOPIE_THROW(error, "splice() failure");
+  }
+
+  if (nReadSize == 0 && uSize) {
+    bEndOfStream = true;
+    return 0;
+  }
+
+  __TACOPIE_METRIC_ADD(bytes_read, nReadSize)
+
+  return static_cast<std::size_t>(nReadSize);
+#else
+  (void) fdPipe;
+  (void) uSize;
+  __TACOPIE_THROW(error, "splice() is not supported on this platform");
+#endif /* __linux__ */
+}
+
+std::size_t
+tcp_socket::splice_from_pipe(fd_t fdPipe, std::size_t uSize) {
+  create_socket_if_necessary();
+  check_or_set_type(type::CLIENT);
+
+#ifdef __linux__
+  ssize_t nWriteSize = ::splice(fdPipe, NULL, m_fd, NULL, uSize, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+  __TACOPIE_METRIC_ADD(write_syscalls, 1)
+
+  if (nWriteSize == SOCKET_ERROR) {
+    if (__TACOPIE_WOULD_BLOCK()) { return 0; }
+    __TACOPIE_THROW(error, "splice() failure");
+  }
+
+  __TACOPIE_METRIC_ADD(bytes_written, nWriteSize)
+
+  return static_cast<std::size_t>(nWriteSize);
+#else
+  (void) fdPipe;
+  (void) uSize;
+  __TACOPIE_THROW(error, "splice() is not supported on this platform");
+#endif /* __linux__ */
+}
+
 //!
 //! server socket operations
 //!
@@ -150,19 +384,12 @@ tcp_socket::listen(std::size_t uMaxConnectionQueue) {
   }
 }
 
-tcp_socket
-tcp_socket::accept(void) {
-  create_socket_if_necessary();
-  check_or_set_type(type::SERVER);
-
-  sockaddr_storage sockAddrStorage;
-  socklen_t nAddrLen = sizeof(sockAddrStorage);
-
-  fd_t fdClient = ::accept(m_fd, reinterpret_cast<sockaddr*>(&sockAddrStorage), &nAddrLen);
-
-  if (fdClient == __TACOPIE_INVALID_FD) { __TACOPIE_THROW(error, "accept() failure"); }
+//!
+//! build the tcp_socket of an accepted connection, determining host and port based on socket type
+//!
 
-  //! now determine host and port based on socket type
+static tcp_socket
+make_accepted_socket(fd_t fdClient, sockaddr_storage& sockAddrStorage) {
   std::string       sAddr;
   std::uint32_t     uPort;
 
@@ -188,7 +415,193 @@ tcp_socket::accept(void) {
 
     uPort = ntohs(pSockAddr4->sin_port);
   }
-  return {fdClient, sAddr, uPort, type::CLIENT};
+  return {fdClient, sAddr, uPort, tcp_socket::type::CLIENT};
+}
+
+tcp_socket
+tcp_socket::accept(void) {
+  create_socket_if_necessary();
+  check_or_set_type(type::SERVER);
+
+  sockaddr_storage sockAddrStorage;
+  socklen_t nAddrLen = sizeof(sockAddrStorage);
+
+  fd_t fdClient = ::accept(m_fd, reinterpret_cast<sockaddr*>(&sockAddrStorage), &nAddrLen);
+
+  if (fdClient == __TACOPIE_INVALID_FD) { __TACOPIE_THROW(error, "accept() failure"); }
+
+  __TACOPIE_METRIC_ADD(accepted_connections, 1)
+
+  return make_accepted_socket(fdClient, sockAddrStorage);
+}
+
+std::vector<tcp_socket>
+tcp_socket::accept_batch(std::size_t uMaxConnections) {
+  create_socket_if_necessary();
+  check_or_set_type(type::SERVER);
+
+  std::vector<tcp_socket> vctSockets;
+
+  while (vctSockets.size() < uMaxConnections) {
+    sockaddr_storage sockAddrStorage;
+    socklen_t nAddrLen = sizeof(sockAddrStorage);
+
+#if defined(__linux__)
+    fd_t fdClient = ::accept4(m_fd, reinterpret_cast<sockaddr*>(&sockAddrStorage), &nAddrLen, SOCK_CLOEXEC);
+#else
+    fd_t fdClient = ::accept(m_fd, reinterpret_cast<sockaddr*>(&sockAddrStorage), &nAddrLen);
+#endif /* __linux__ */
+
+    if (fdClient == __TACOPIE_INVALID_FD) {
+      //! drained
+      if (__TACOPIE_WOULD_BLOCK()) { break; }
+#ifndef _WIN32
+      //! connection reset before being accepted
+      if (errno == ECONNABORTED || errno == EINTR) { continue; }
+#endif /* _WIN32 */
+      //! report the failure once the connections already accepted have been handled
+      if (!vctSockets.empty()) { break; }
+
+      __TACOPIE_THROW(error, "accept() failure");
+    }
+
+    vctSockets.push_back(make_accepted_socket(fdClient, sockAddrStorage));
+    __TACOPIE_METRIC_ADD(accepted_connections, 1)
+
+#if !defined(__linux__)
+    //! accepted sockets inherit the non-blocking mode of the listening socket on BSD, macOS and windows
+    vctSockets.back().set_non_blocking(false);
+#ifndef _WIN32
+    fcntl(fdClient, F_SETFD, FD_CLOEXEC);
+#endif /* _WIN32 */
+#endif /* __linux__ */
+  }
+
+  return vctSockets;
+}
+
+//!
+//! tuning options
+//!
+
+//! set an integer socket option
+static void
+set_int_option(fd_t fd, int nLevel, int nOption, int nValue, const char* pName) {
+  if (::setsockopt(fd, nLevel, nOption, reinterpret_cast<const char*>(&nValue), sizeof(nValue)) == SOCKET_ERROR) {
+    __TACOPIE_THROW(error, std::string("setsockopt(") + pName + ") failure");
+  }
+}
+
+//! report an option that can not be set on this platform (inline: unused where every option is available)
+static inline void
+throw_unsupported_option(const char* pName) {
+  __TACOPIE_THROW(error, std::string(pName) + " is not supported on this platform");
+}
+
+void
+tcp_socket::set_options(const socket_options& options) {
+  m_options = options;
+
+  if (m_fd != __TACOPIE_INVALID_FD && m_eType != type::UNKNOWN) { apply_options(false); }
+}
+
+const socket_options&
+tcp_socket::get_options(void) const {
+  return m_options;
+}
+
+void
+tcp_socket::apply_options(bool bIsConnecting) {
+  const auto& options = m_options;
+
+  if (options.send_buffer_size > 0) { set_int_option(m_fd, SOL_SOCKET, SO_SNDBUF, options.send_buffer_size, "SO_SNDBUF"); }
+  if (options.receive_buffer_size > 0) { set_int_option(m_fd, SOL_SOCKET, SO_RCVBUF, options.receive_buffer_size, "SO_RCVBUF"); }
+
+  //! tcp and ip level options do not apply to unix sockets
+  if (m_uPort == 0) { return; }
+
+  if (options.tcp_nodelay >= 0) { set_int_option(m_fd, IPPROTO_TCP, TCP_NODELAY, options.tcp_nodelay != 0, "TCP_NODELAY"); }
+  if (options.keepalive >= 0) { set_int_option(m_fd, SOL_SOCKET, SO_KEEPALIVE, options.keepalive != 0, "SO_KEEPALIVE"); }
+
+  if (options.keepalive_idle_secs > 0) {
+#if defined(TCP_KEEPIDLE)
+    set_int_option(m_fd, IPPROTO_TCP, TCP_KEEPIDLE, options.keepalive_idle_secs, "TCP_KEEPIDLE");
+#elif defined(TCP_KEEPALIVE)
+    set_int_option(m_fd, IPPROTO_TCP, TCP_KEEPALIVE, options.keepalive_idle_secs, "TCP_KEEPALIVE");
+#else
+    throw_unsupported_option("TCP_KEEPIDLE");
+#endif /* TCP_KEEPIDLE */
+  }
+
+  if (options.keepalive_interval_secs > 0) {
+#ifdef TCP_KEEPINTVL
+    set_int_option(m_fd, IPPROTO_TCP, TCP_KEEPINTVL, options.keepalive_interval_secs, "TCP_KEEPINTVL");
+#else
+    throw_unsupported_option("TCP_KEEPINTVL");
+#endif /* TCP_KEEPINTVL */
+  }
+
+  if (options.keepalive_count > 0) {
+#ifdef TCP_KEEPCNT
+    set_int_option(m_fd, IPPROTO_TCP, TCP_KEEPCNT, options.keepalive_count, "TCP_KEEPCNT");
+#else
+    throw_unsupported_option("TCP_KEEPCNT");
+#endif /* TCP_KEEPCNT */
+  }
+
+  if (options.tcp_quickack >= 0) {
+#ifdef TCP_QUICKACK
+    set_int_option(m_fd, IPPROTO_TCP, TCP_QUICKACK, options.tcp_quickack != 0, "TCP_QUICKACK");
+#else
+    throw_unsupported_option("TCP_QUICKACK");
+#endif /* TCP_QUICKACK */
+  }
+
+  if (options.busy_poll_usecs > 0) {
+#ifdef SO_BUSY_POLL
+    set_int_option(m_fd, SOL_SOCKET, SO_BUSY_POLL, options.busy_poll_usecs, "SO_BUSY_POLL");
+#else
+    throw_unsupported_option("SO_BUSY_POLL");
+#endif /* SO_BUSY_POLL */
+  }
+
+  if (options.tcp_fastopen > 0) {
+    if (m_eType == type::SERVER) {
+#ifdef TCP_FASTOPEN
+      set_int_option(m_fd, IPPROTO_TCP, TCP_FASTOPEN, options.tcp_fastopen, "TCP_FASTOPEN");
+#else
+      throw_unsupported_option("TCP_FASTOPEN");
+#endif /* TCP_FASTOPEN */
+    } else if (bIsConnecting) {
+#ifdef TCP_FASTOPEN_CONNECT
+      set_int_option(m_fd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, 1, "TCP_FASTOPEN_CONNECT");
+#else
+      throw_unsupported_option("TCP_FASTOPEN_CONNECT");
+#endif /* TCP_FASTOPEN_CONNECT */
+    }
+  }
+
+  if (options.tcp_cork >= 0) {
+#if defined(TCP_CORK)
+    set_int_option(m_fd, IPPROTO_TCP, TCP_CORK, options.tcp_cork != 0, "TCP_CORK");
+#elif defined(TCP_NOPUSH)
+    set_int_option(m_fd, IPPROTO_TCP, TCP_NOPUSH, options.tcp_cork != 0, "TCP_NOPUSH");
+#else
+    throw_unsupported_option("TCP_CORK");
+#endif /* TCP_CORK */
+  }
+
+  if (options.ip_tos >= 0) {
+    if (is_ipv6()) {
+#ifdef IPV6_TCLASS
+      set_int_option(m_fd, IPPROTO_IPV6, IPV6_TCLASS, options.ip_tos, "IPV6_TCLASS");
+#else
+      throw_unsupported_option("IPV6_TCLASS");
+#endif /* IPV6_TCLASS */
+    } else {
+      set_int_option(m_fd, IPPROTO_IP, IP_TOS, options.ip_tos, "IP_TOS");
+    }
+  }
 }
 
 //!
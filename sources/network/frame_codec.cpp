@@ -0,0 +1,382 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <tacopie/network/frame_codec.hpp>
+#include <tacopie/utils/buffer_pool.hpp>
+#include <tacopie/utils/error.hpp>
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define __TACOPIE_FRAME_CODEC_SSE2
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif /* _MSC_VER */
+#endif /* __SSE2__ || _M_X64 || _M_IX86_FP >= 2 */
+
+namespace tacopie {
+
+//!
+//! delimiter search
+//!
+
+//! first occurrence of a single byte
+static const char*
+find_byte(const char* pBegin, const char* pEnd, char cByte) {
+  return static_cast<const char*>(std::memchr(pBegin, cByte, static_cast<std::size_t>(pEnd - pBegin)));
+}
+
+#ifdef __TACOPIE_FRAME_CODEC_SSE2
+//! index of the lowest set bit (uBits must not be 0)
+static unsigned int
+get_lowest_bit(unsigned int uBits) {
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<unsigned int>(__builtin_ctz(uBits));
+#else
+  unsigned long uBit;
+  _BitScanForward(&uBit, uBits);
+  return static_cast<unsigned int>(uBit);
+#endif /* __GNUC__ || __clang__ */
+}
+#endif /* __TACOPIE_FRAME_CODEC_SSE2 */
+
+//!
+//! first occurrence of a delimiter of at least 2 bytes
+//! 16 candidate positions are checked at once by comparing both the first and the last byte of the delimiter, so
+//! that the remaining bytes only have to be compared for the rare positions matching both
+//!
+static const char*
+find_delimiter(const char* pBegin, const char* pEnd, const std::string& sDelimiter) {
+  std::size_t uDelimiterSize = sDelimiter.size();
+  const char* pDelimiter     = sDelimiter.data();
+
+  if (static_cast<std::size_t>(pEnd - pBegin) < uDelimiterSize) { return nullptr; }
+
+  //! last position at which the delimiter can start
+  const char* pLast = pEnd - uDelimiterSize;
+  const char* pPos  = pBegin;
+
+#ifdef __TACOPIE_FRAME_CODEC_SSE2
+  const __m128i firstByte = _mm_set1_epi8(pDelimiter[0]);
+  const __m128i lastByte  = _mm_set1_epi8(pDelimiter[uDelimiterSize - 1]);
+
+  for (; pLast - pPos >= 16; pPos += 16) {
+    __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pPos));
+    __m128i blockLast  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pPos + uDelimiterSize - 1));
+    __m128i matches    = _mm_and_si128(_mm_cmpeq_epi8(blockFirst, firstByte), _mm_cmpeq_epi8(blockLast, lastByte));
+    unsigned int uMask = static_cast<unsigned int>(_mm_movemask_epi8(matches));
+
+    while (uMask) {
+      const char* pCandidate = pPos + get_lowest_bit(uMask);
+
+      if (!std::memcmp(pCandidate + 1, pDelimiter + 1, uDelimiterSize - 2)) { return pCandidate; }
+
+      uMask &= uMask - 1;
+    }
+  }
+#endif /* __TACOPIE_FRAME_CODEC_SSE2 */
+
+  while ((pPos = find_byte(pPos, pLast + 1, pDelimiter[0])) != nullptr) {
+    if (!std::memcmp(pPos + 1, pDelimiter + 1, uDelimiterSize - 1)) { return pPos; }
+
+    ++pPos;
+  }
+
+  return nullptr;
+}
+
+//!
+//! ctor & dtor
+//!
+
+frame_codec::frame_codec(framing eFraming, std::size_t uHeaderSize, const std::string& sDelimiter, std::size_t uMaxFrameSize)
+: m_eFraming(eFraming)
+, m_uHeaderSize(uHeaderSize)
+, m_sDelimiter(sDelimiter)
+, m_uMaxFrameSize(uMaxFrameSize) {}
+
+frame_codec::~frame_codec(void) {
+  utils::buffer_pool::get_instance().release(std::move(m_vctBuffer));
+}
+
+frame_codec
+frame_codec::length_prefixed(std::size_t uHeaderSize, std::size_t uMaxFrameSize) {
+  if (uHeaderSize != 1 && uHeaderSize != 2 && uHeaderSize != 4 && uHeaderSize != 8) {
+    __TACOPIE_THROW(error, "invalid frame header size");
+  }
+
+  return frame_codec(framing::length_prefix, uHeaderSize, "", uMaxFrameSize);
+}
+
+frame_codec
+frame_codec::varint_prefixed(std::size_t uMaxFrameSize) {
+  return frame_codec(framing::varint_prefix, 0, "", uMaxFrameSize);
+}
+
+frame_codec
+frame_codec::delimited(const std::string& sDelimiter, std::size_t uMaxFrameSize) {
+  if (sDelimiter.empty()) { __TACOPIE_THROW(error, "empty frame delimiter"); }
+
+  return frame_codec(framing::delimiter, 0, sDelimiter, uMaxFrameSize);
+}
+
+//!
+//! receive buffer
+//!
+
+char*
+frame_codec::prepare(std::size_t uSize) {
+  if (m_vctBuffer.capacity() == 0) {
+    m_vctBuffer = utils::buffer_pool::get_instance().acquire(uSize);
+    m_vctBuffer.resize(m_vctBuffer.capacity());
+  }
+
+  if (m_vctBuffer.size() - m_uReceivedOffset < uSize) {
+    //! move the bytes that have not been consumed (incomplete frame) to the beginning of the buffer
+    if (m_uConsumedOffset) {
+      std::memmove(m_vctBuffer.data(), m_vctBuffer.data() + m_uConsumedOffset, m_uReceivedOffset - m_uConsumedOffset);
+
+      m_uDecodedOffset -= m_uConsumedOffset;
+      m_uScannedOffset -= m_uConsumedOffset;
+      m_uReceivedOffset -= m_uConsumedOffset;
+      m_uConsumedOffset = 0;
+    }
+
+    if (m_vctBuffer.size() - m_uReceivedOffset < uSize) {
+      m_vctBuffer.resize(m_uReceivedOffset + uSize);
+      m_vctBuffer.resize(m_vctBuffer.capacity());
+    }
+  }
+
+  return m_vctBuffer.data() + m_uReceivedOffset;
+}
+
+std::size_t
+frame_codec::get_writable_size(void) const {
+  return m_vctBuffer.size() - m_uReceivedOffset;
+}
+
+void
+frame_codec::commit(std::size_t uSize) {
+  m_uReceivedOffset += uSize;
+}
+
+void
+frame_codec::feed(const char* pData, std::size_t uSize) {
+  if (!uSize) { return; }
+
+  std::memcpy(prepare(uSize), pData, uSize);
+  commit(uSize);
+}
+
+void
+frame_codec::consume(void) {
+  m_uConsumedOffset = m_uDecodedOffset;
+
+  //! everything has been consumed: restart from the beginning of the buffer, no compaction needed
+  if (m_uConsumedOffset == m_uReceivedOffset) {
+    m_uConsumedOffset = 0;
+    m_uDecodedOffset  = 0;
+    m_uScannedOffset  = 0;
+    m_uReceivedOffset = 0;
+  }
+}
+
+std::size_t
+frame_codec::get_buffered_size(void) const {
+  return m_uReceivedOffset - m_uConsumedOffset;
+}
+
+//!
+//! decoding
+//!
+
+bool
+frame_codec::decode(std::vector<frame>& vctFrames) {
+  bool bValid = true;
+
+  switch (m_eFraming) {
+  case framing::length_prefix:
+    while (decode_length_prefixed(vctFrames, bValid)) {}
+    break;
+  case framing::varint_prefix:
+    while (decode_varint_prefixed(vctFrames, bValid)) {}
+    break;
+  case framing::delimiter:
+    while (decode_delimited(vctFrames, bValid)) {}
+    break;
+  }
+
+  return bValid;
+}
+
+bool
+frame_codec::decode_length_prefixed(std::vector<frame>& vctFrames, bool& bValid) {
+  std::size_t uAvailable = m_uReceivedOffset - m_uDecodedOffset;
+
+  if (uAvailable < m_uHeaderSize) { return false; }
+
+  const unsigned char* pHeader = reinterpret_cast<const unsigned char*>(m_vctBuffer.data() + m_uDecodedOffset);
+  std::uint64_t uFrameSize     = 0;
+
+  for (std::size_t i = 0; i < m_uHeaderSize; ++i) { uFrameSize = (uFrameSize << 8) | pHeader[i]; }
+
+  if (uFrameSize > m_uMaxFrameSize) {
+    bValid = false;
+    return false;
+  }
+
+  if (uAvailable - m_uHeaderSize < uFrameSize) { return false; }
+
+  vctFrames.push_back({m_vctBuffer.data() + m_uDecodedOffset + m_uHeaderSize, static_cast<std::size_t>(uFrameSize)});
+  m_uDecodedOffset += m_uHeaderSize + static_cast<std::size_t>(uFrameSize);
+
+  return true;
+}
+
+bool
+frame_codec::decode_varint_prefixed(std::vector<frame>& vctFrames, bool& bValid) {
+  //! a 64 bits varint takes at most 10 bytes
+  static const std::size_t uMaxVarintSize = 10;
+
+  std::size_t uAvailable       = m_uReceivedOffset - m_uDecodedOffset;
+  const unsigned char* pHeader = reinterpret_cast<const unsigned char*>(m_vctBuffer.data() + m_uDecodedOffset);
+  std::uint64_t uFrameSize     = 0;
+  std::size_t uHeaderSize      = 0;
+
+  while (true) {
+    if (uHeaderSize == uAvailable) { return false; }
+
+    if (uHeaderSize == uMaxVarintSize) {
+      bValid = false;
+      return false;
+    }
+
+    unsigned char uByte = pHeader[uHeaderSize];
+
+    //! the last byte only holds the 64th bit: any other bit would overflow the size
+    if (uHeaderSize == uMaxVarintSize - 1 && uByte > 1) {
+      bValid = false;
+      return false;
+    }
+
+    uFrameSize |=static_cast<std::uint64_t>(uByte & 0x7F) << (7 * uHeaderSize);
+    ++uHeaderSize;
+
+    if (!(uByte & 0x80)) { break; }
+  }
+
+  if (uFrameSize > m_uMaxFrameSize) {
+    bValid = false;
+    return false;
+  }
+
+  if (uAvailable - uHeaderSize < uFrameSize) { return false; }
+
+  vctFrames.push_back({m_vctBuffer.data() + m_uDecodedOffset + uHeaderSize, static_cast<std::size_t>(uFrameSize)});
+  m_uDecodedOffset += uHeaderSize + static_cast<std::size_t>(uFrameSize);
+
+  return true;
+}
+
+bool
+frame_codec::decode_delimited(std::vector<frame>& vctFrames, bool& bValid) {
+  const char* pFrame = m_vctBuffer.data() + m_uDecodedOffset;
+  const char* pScan  = m_vctBuffer.data() + (m_uScannedOffset > m_uDecodedOffset ? m_uScannedOffset : m_uDecodedOffset);
+  const char* pEnd   = m_vctBuffer.data() + m_uReceivedOffset;
+
+  const char* pDelimiter = m_sDelimiter.size() == 1 ? find_byte(pScan, pEnd, m_sDelimiter[0])
+                                                    : find_delimiter(pScan, pEnd, m_sDelimiter);
+
+  if (!pDelimiter) {
+    //! the end of the received bytes might be the beginning of a delimiter: scan it again next time
+    std::size_t uRescanSize = m_sDelimiter.size() - 1;
+    std::size_t uScanned    = m_uReceivedOffset - m_uDecodedOffset;
+
+    m_uScannedOffset = m_uDecodedOffset + (uScanned > uRescanSize ? uScanned - uRescanSize : 0);
+
+    if (uScanned > m_uMaxFrameSize + uRescanSize) { bValid = false; }
+
+    return false;
+  }
+
+  std::size_t uFrameSize = static_cast<std::size_t>(pDelimiter - pFrame);
+
+  if (uFrameSize > m_uMaxFrameSize) {
+    bValid = false;
+    return false;
+  }
+
+  vctFrames.push_back({pFrame, uFrameSize});
+  m_uDecodedOffset += uFrameSize + m_sDelimiter.size();
+  m_uScannedOffset = m_uDecodedOffset;
+
+  return true;
+}
+
+//!
+//! encoding
+//!
+
+void
+frame_codec::encode(const char* pData, std::size_t uSize, std::vector<char>& vctBuffer) const {
+  if (uSize > m_uMaxFrameSize) { __TACOPIE_THROW(error, "frame exceeds the maximum frame size"); }
+
+  std::uint64_t uFrameSize = static_cast<std::uint64_t>(uSize);
+
+  switch (m_eFraming) {
+  case framing::length_prefix:
+    if (m_uHeaderSize < 8 && (uFrameSize >> (8 * m_uHeaderSize))) {
+      __TACOPIE_THROW(error, "frame size does not fit in the frame header");
+    }
+
+    for (std::size_t i = m_uHeaderSize; i > 0; --i) {
+      vctBuffer.push_back(static_cast<char>((uFrameSize >> (8 * (i - 1))) & 0xFF));
+    }
+    vctBuffer.insert(vctBuffer.end(), pData, pData + uSize);
+    break;
+  case framing::varint_prefix:
+    while (uFrameSize >= 0x80) {
+      vctBuffer.push_back(static_cast<char>((uFrameSize & 0x7F) | 0x80));
+      uFrameSize >>= 7;
+    }
+    vctBuffer.push_back(static_cast<char>(uFrameSize));
+    vctBuffer.insert(vctBuffer.end(), pData, pData + uSize);
+    break;
+  case framing::delimiter:
+    vctBuffer.insert(vctBuffer.end(), pData, pData + uSize);
+    vctBuffer.insert(vctBuffer.end(), m_sDelimiter.begin(), m_sDelimiter.end());
+    break;
+  }
+}
+
+//!
+//! getters
+//!
+
+frame_codec::framing
+frame_codec::get_framing(void) const {
+  return m_eFraming;
+}
+
+} // namespace tacopie
@@ -23,13 +23,15 @@
 #include <tacopie/network/io_service.hpp>
 #include <tacopie/utils/error.hpp>
 #include <tacopie/utils/logger.hpp>
+#include <tacopie/utils/metrics.hpp>
+#include <tacopie/utils/thread_utils.hpp>
 
-#include <fcntl.h>
+#include <algorithm>
+#include <future>
+#include <limits>
 
-#ifdef _WIN32
-#include <io.h>
-#else
-#include <unistd.h>
+#ifndef _WIN32
+#include <sys/socket.h>
 #endif /* _WIN32 */
 
 namespace tacopie {
@@ -59,17 +61,42 @@ set_default_io_service(const std::shared_ptr<io_service>& service) {
 //! ctor & dtor
 //!
 
-io_service::io_service(void)
+io_service::io_service(poller_backend eBackend, std::size_t uNbReactors)
 #ifdef _WIN32
-: m_bShouldStop_a(ATOMIC_VAR_INIT(false))
+: m_eReactorAssignmentPolicy_a(ATOMIC_VAR_INIT(reactor_assignment_policy::round_robin))
+, m_uNextReactor_a(ATOMIC_VAR_INIT(0))
+, m_eCallbackExecutionMode_a(ATOMIC_VAR_INIT(callback_execution_mode::worker_pool))
+, m_uTimerWakeupTick(std::numeric_limits<std::uint64_t>::max())
+, m_timeTimerOrigin(std::chrono::steady_clock::now())
+, m_bShouldStop_a(ATOMIC_VAR_INIT(false))
 #else
-: m_bShouldStop_a(false)
+: m_eReactorAssignmentPolicy_a(reactor_assignment_policy::round_robin)
+, m_uNextReactor_a(0)
+, m_eCallbackExecutionMode_a(callback_execution_mode::worker_pool)
+, m_uTimerWakeupTick(std::numeric_limits<std::uint64_t>::max())
+, m_timeTimerOrigin(std::chrono::steady_clock::now())
+, m_bShouldStop_a(false)
 #endif /* _WIN32 */
 , m_threadPoolCallbackWorkers(__TACOPIE_IO_SERVICE_NB_WORKERS) {
   __TACOPIE_LOG(debug, "create io_service");
 
-  //! Start worker after everything has been initialized
-  m_threadPollWorker = std::thread(std::bind(&io_service::poll, this));
+  if (uNbReactors == 0) { __TACOPIE_THROW(error, "io_service requires at least one reactor"); }
+
+  for (std::size_t i = 0; i < uNbReactors; ++i) {
+    m_vctReactors.push_back(std::unique_ptr<reactor>(new reactor(eBackend)));
+
+    //! the self pipe is always polled for read
+    auto& r = *m_vctReactors.back();
+    r.ptrPoller->update(r.selfPipeNotifier.get_read_fd(), poller_iface::none, poller_iface::rd);
+    r.sThreadName = "tacopie-io-" + std::to_string(i);
+  }
+
+  m_threadPoolCallbackWorkers.set_thread_name("tacopie-wk");
+
+  //! Start workers after everything has been initialized
+  for (auto& r : m_vctReactors) {
+    r->threadPollWorker = std::thread(std::bind(&io_service::poll, this, std::ref(*r)));
+  }
 }
 
 io_service::~io_service(void) {
@@ -77,9 +104,13 @@ io_service::~io_service(void) {
 
   m_bShouldStop_a = true;
 
-  m_selfPipeNotifier.notify();
-  if (m_threadPollWorker.joinable()) {
-    m_threadPollWorker.join();
+  for (auto& r : m_vctReactors) {
+    wakeup_reactor(*r);
+  }
+  for (auto& r : m_vctReactors) {
+    if (r->threadPollWorker.joinable()) {
+      r->threadPollWorker.join();
+    }
   }
   m_threadPoolCallbackWorkers.stop();
 }
@@ -92,32 +123,240 @@ io_service::set_nb_workers(std::size_t nNbThreads) {
   m_threadPoolCallbackWorkers.set_nb_threads(nNbThreads);
 }
 
+//!
+//! polling backend getter
+//!
+poller_backend
+io_service::get_poller_backend(void) const {
+  return m_vctReactors.front()->ptrPoller->get_backend();
+}
+
+//!
+//! reactors
+//!
+
+std::size_t
+io_service::get_nb_reactors(void) const {
+  return m_vctReactors.size();
+}
+
+bool
+io_service::is_service_thread(void) const {
+  if (m_threadPoolCallbackWorkers.is_worker_thread()) { return true; }
+
+  for (const auto& r : m_vctReactors) {
+    if (std::this_thread::get_id() == r->threadPollWorker.get_id()) { return true; }
+  }
+
+  return false;
+}
+
+void
+io_service::set_reactor_assignment_policy(reactor_assignment_policy ePolicy) {
+  m_eReactorAssignmentPolicy_a = ePolicy;
+}
+
+//!
+//! threads name & CPU affinity
+//!
+
+void
+io_service::set_reactor_cpu_affinity(std::size_t uReactorIndex, const std::vector<std::size_t>& vctCpus) {
+  if (uReactorIndex >= m_vctReactors.size()) { __TACOPIE_THROW(error, "invalid reactor index"); }
+
+  auto& r = *m_vctReactors[uReactorIndex];
+
+  {
+    std::lock_guard<std::mutex> lock(m_mtxPlacement);
+
+    r.vctCpus         = vctCpus;
+    r.bHasCpuAffinity = true;
+
+    //! rebuild the CPU to reactor mapping used by the incoming_cpu policy (the first reactor pinned to a CPU wins)
+    m_vctCpuReactors.clear();
+    for (std::size_t i = 0; i < m_vctReactors.size(); ++i) {
+      for (auto uCpu : m_vctReactors[i]->vctCpus) {
+        if (uCpu >= m_vctCpuReactors.size()) { m_vctCpuReactors.resize(uCpu + 1, m_vctReactors.size()); }
+        if (m_vctCpuReactors[uCpu] == m_vctReactors.size()) { m_vctCpuReactors[uCpu] = i; }
+      }
+    }
+  }
+
+  r.bPlacementPending_a = true;
+  wakeup_reactor(r);
+}
+
+void
+io_service::set_worker_cpu_affinity(const std::vector<std::size_t>& vctCpus) {
+  m_threadPoolCallbackWorkers.set_cpu_affinity(vctCpus);
+}
+
+void
+io_service::set_thread_name(const std::string& sName) {
+  {
+    std::lock_guard<std::mutex> lock(m_mtxPlacement);
+
+    for (std::size_t i = 0; i < m_vctReactors.size(); ++i) {
+      m_vctReactors[i]->sThreadName = sName + "-io-" + std::to_string(i);
+    }
+  }
+
+  for (auto& r : m_vctReactors) {
+    r->bPlacementPending_a = true;
+    wakeup_reactor(*r);
+  }
+
+  m_threadPoolCallbackWorkers.set_thread_name(sName + "-wk");
+}
+
+void
+io_service::apply_reactor_placement(reactor& r) {
+  std::string sThreadName;
+  std::vector<std::size_t> vctCpus;
+  bool bHasCpuAffinity;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mtxPlacement);
+
+    sThreadName     = r.sThreadName;
+    vctCpus         = r.vctCpus;
+    bHasCpuAffinity = r.bHasCpuAffinity;
+  }
+
+  utils::set_current_thread_name(sThreadName);
+
+  if (!bHasCpuAffinity) { return; }
+
+  if (!utils::set_current_thread_affinity(vctCpus)) {
+    __TACOPIE_LOG(warn, "failed to set the CPU affinity of a poll thread");
+    return;
+  }
+
+  //! the buffers have been allocated by the thread that created the io_service, or on the previous CPUs:
+  //! reallocate them from here so that they get placed on the local NUMA node
+  r.ptrPoller->reallocate_buffers();
+  std::vector<poller_iface::poll_event>().swap(r.vctPolledEvents);
+  std::vector<reactor_callback>().swap(r.vctReactorCallbacks);
+  std::vector<event_callback_t>().swap(r.vctReplacedCallbacks);
+  std::vector<removal_callback_t>().swap(r.vctRemovalCallbacks);
+}
+
+//!
+//! metrics
+//!
+
+io_service::metrics_snapshot
+io_service::get_metrics(void) {
+  metrics_snapshot snapshot;
+
+  snapshot.time               = std::chrono::steady_clock::now();
+  snapshot.process_metrics    = utils::metrics::get_snapshot();
+  snapshot.nb_tracked_sockets = 0;
+  snapshot.nb_pending_tasks   = m_threadPoolCallbackWorkers.get_nb_pending_tasks();
+
+  for (const auto& r : m_vctReactors) { snapshot.nb_tracked_sockets += r->nNbTrackedSockets_a; }
+
+  std::lock_guard<std::mutex> lock(m_mtxTimers);
+  snapshot.nb_pending_timers = m_timerWheel.size();
+
+  return snapshot;
+}
+
+io_service::reactor*
+io_service::find_reactor(const fd_t& fd) {
+  if (m_vctReactors.size() == 1) { return m_vctReactors.front().get(); }
+
+  std::lock_guard<std::mutex> lock(m_mtxReactorAssignments);
+
+  auto pIndex = m_tableReactorAssignments.find(fd);
+
+  return pIndex ? m_vctReactors[*pIndex].get() : nullptr;
+}
+
+io_service::reactor&
+io_service::assign_reactor(const fd_t& fd) {
+  if (m_vctReactors.size() == 1) { return *m_vctReactors.front(); }
+
+  std::size_t uIndex = 0;
+
+  reactor_assignment_policy ePolicy = m_eReactorAssignmentPolicy_a;
+
+  if (ePolicy == reactor_assignment_policy::least_load) {
+    for (std::size_t i = 1; i < m_vctReactors.size(); ++i) {
+      if (m_vctReactors[i]->nNbTrackedSockets_a < m_vctReactors[uIndex]->nNbTrackedSockets_a) { uIndex = i; }
+    }
+  } else if (ePolicy == reactor_assignment_policy::incoming_cpu) {
+    uIndex = find_incoming_cpu_reactor(fd);
+
+    if (uIndex == m_vctReactors.size()) { uIndex = m_uNextReactor_a++ % m_vctReactors.size(); }
+  } else {
+    uIndex = m_uNextReactor_a++ % m_vctReactors.size();
+  }
+
+  std::lock_guard<std::mutex> lock(m_mtxReactorAssignments);
+  bool bInserted;
+  m_tableReactorAssignments.find_or_insert(fd, bInserted) = uIndex;
+
+  return *m_vctReactors[uIndex];
+}
+
+io_service::reactor&
+io_service::find_or_assign_reactor(const fd_t& fd) {
+  auto pReactor = find_reactor(fd);
+
+  return pReactor ? *pReactor : assign_reactor(fd);
+}
+
+std::size_t
+io_service::find_incoming_cpu_reactor(const fd_t& fd) {
+#ifdef SO_INCOMING_CPU
+  int nCpu          = -1;
+  socklen_t nCpuLen = sizeof(nCpu);
+
+  if (getsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &nCpu, &nCpuLen) == -1 || nCpu < 0) { return m_vctReactors.size(); }
+
+  std::lock_guard<std::mutex> lock(m_mtxPlacement);
+
+  if (static_cast<std::size_t>(nCpu) >= m_vctCpuReactors.size()) { return m_vctReactors.size(); }
+
+  return m_vctCpuReactors[static_cast<std::size_t>(nCpu)];
+#else
+  (void) fd;
+  return m_vctReactors.size();
+#endif /* SO_INCOMING_CPU */
+}
 
 //!
 //! poll worker function
 //!
 
 void
-io_service::poll(void) {
+io_service::poll(reactor& r) {
   __TACOPIE_LOG(debug, "starting poll() worker");
 
-  while (!m_bShouldStop_a) {
-    int nFds = init_poll_fds_info();
-
-    //! setup timeout
-    timeval* pTimeout = NULL;
+  //! setup timeout
+  int nDefaultTimeoutMsecs = -1;
 #ifdef __TACOPIE_TIMEOUT
-    timeval timeout;
-    timeout.tv_usec = __TACOPIE_TIMEOUT;
-    pTimeout        = &timeout;
+  //! __TACOPIE_TIMEOUT is expressed in microseconds
+  nDefaultTimeoutMsecs = (__TACOPIE_TIMEOUT + 999) / 1000;
 #endif /* __TACOPIE_TIMEOUT */
 
-    __TACOPIE_LOG(debug, "polling fds");
-    if (select(nFds, &m_fdsetRead, &m_fdsetWrite, NULL, pTimeout) > 0) {
-      process_events();
+  while (!m_bShouldStop_a) {
+    if (r.bPlacementPending_a.exchange(false)) { apply_reactor_placement(r); }
+
+    __TACOPIE_LOG_RATE_LIMITED(debug, "polling fds");
+    r.ptrPoller->wait(r.vctPolledEvents, get_poll_timeout(r, nDefaultTimeoutMsecs));
+    __TACOPIE_METRIC_ADD(poll_iterations, 1)
+    __TACOPIE_METRIC_RECORD(events_per_poll, r.vctPolledEvents.size())
+
+    if (!r.vctPolledEvents.empty()) {
+      process_events(r);
     } else {
-      __TACOPIE_LOG(debug, "poll woke up, but nothing to process");
+      __TACOPIE_LOG_RATE_LIMITED(debug, "poll woke up, but nothing to process");
+      __TACOPIE_METRIC_ADD(empty_wakeups, 1)
     }
+
+    if (&r == m_vctReactors.front().get()) { process_expired_timers(); }
   }
 
   __TACOPIE_LOG(debug, "stop poll() worker");
@@ -128,203 +367,711 @@ io_service::poll(void) {
 //!
 
 void
-io_service::process_events(void) {
-  std::lock_guard<std::mutex> lock(m_mtxTrackedSockets);
+io_service::process_events(reactor& r) {
+  __TACOPIE_LOG_RATE_LIMITED(debug, "processing events");
+
+  process_polled_events(r);
 
-  __TACOPIE_LOG(debug, "processing events");
+  if (!r.vctReactorCallbacks.empty()) { execute_reactor_callbacks(r); }
+  if (!r.vctRemovalCallbacks.empty()) { execute_removal_callbacks(r.vctRemovalCallbacks); }
+}
+
+void
+io_service::process_polled_events(reactor& r) {
+  for (const auto& event : r.vctPolledEvents) {
+    const auto& fd = event.fd;
 
-  for (const auto& fd : m_vctPolledFds) {
-    if (fd == m_selfPipeNotifier.get_read_fd() && FD_ISSET(fd, &m_fdsetRead)) {
-      m_selfPipeNotifier.clr_buffer();
+    if (fd == r.selfPipeNotifier.get_read_fd()) {
+      r.selfPipeNotifier.clr_buffer();
       continue;
     }
 
-    auto pos = m_mapTrackedSockets.find(fd);
+    std::lock_guard<std::mutex> lock(r.get_socket_mutex(fd));
+    auto pSocket = find_tracked_socket(r, fd);
 
-    if (pos == m_mapTrackedSockets.end()) { continue; }
+    if (!pSocket) { continue; }
 
-    auto& socket = pos->second;
+    auto& socket = *pSocket;
 
-    if (FD_ISSET(fd, &m_fdsetRead) && socket.callbackRead && !socket.bIsExecutingCallbackRead_a) {
-      process_rd_event(fd, socket);
-    }
-    if (FD_ISSET(fd, &m_fdsetWrite) && socket.callbackWrite && !socket.bIsExecutingCallbackWrite_a) {
-      process_wr_event(fd, socket);
+    //! sockets marked for untrack only wait for the completion of the callbacks being executed: the events reported for
+    //! the other direction are stale (the owner of the callbacks may be gone)
+    if (!socket.is_set(tracked_socket::marked_for_untrack)) {
+      if ((event.nEvents & poller_iface::rd) && socket.callbackRead && !socket.is_set(tracked_socket::executing_rd_callback)) {
+        process_rd_event(r, fd, socket);
+      }
+      if ((event.nEvents & poller_iface::wr) && socket.callbackWrite && !socket.is_set(tracked_socket::executing_wr_callback)) {
+        process_wr_event(r, fd, socket);
+      }
     }
 
-    if (socket.bMarkedForUntrack_a && !socket.bIsExecutingCallbackRead_a && !socket.bIsExecutingCallbackWrite_a) {
+    if (socket.is_removable()) {
       __TACOPIE_LOG(debug, "untrack socket");
-      m_mapTrackedSockets.erase(pos);
-      m_cvWaitForRemoval.notify_all();
+      erase_tracked_socket(r, fd, socket, r.vctRemovalCallbacks);
     }
   }
 }
 
 void
-io_service::process_rd_event(const fd_t& fd, tracked_socket& socket) {
-  __TACOPIE_LOG(debug, "processing read event");
+io_service::process_rd_event(reactor& r, const fd_t& fd, tracked_socket& socket) {
+  __TACOPIE_LOG_RATE_LIMITED(debug, "processing read event");
+  __TACOPIE_METRIC_ADD(events_dispatched, 1)
 
-  auto callbackRead = socket.callbackRead;
+  socket.set(tracked_socket::executing_rd_callback);
 
-  socket.bIsExecutingCallbackRead_a = true;
+  if (socket.eCallbackExecutionMode == callback_execution_mode::reactor_thread) {
+    r.vctReactorCallbacks.push_back({fd, true, &socket});
+    return;
+  }
 
-  m_threadPoolCallbackWorkers << [=] {
-    __TACOPIE_LOG(debug, "execute read callback");
-    callbackRead(fd);
+  auto pReactor = &r;
+  auto pSocket  = &socket;
 
-    std::lock_guard<std::mutex> lock(m_mtxTrackedSockets);
-    auto pos = m_mapTrackedSockets.find(fd);
+  update_polled_events(r, fd, socket);
 
-    if (pos == m_mapTrackedSockets.end()) { return; }
+  m_threadPoolCallbackWorkers << [this, pReactor, pSocket, fd] {
+    __TACOPIE_LOG_RATE_LIMITED(debug, "execute read callback");
 
-    auto& socket                    = pos->second;
-    socket.bIsExecutingCallbackRead_a = false;
+    //! untracked since the dispatch (typically by the other callback of the socket): not executed anymore
+    if (!pSocket->is_set(tracked_socket::marked_for_untrack)) { pSocket->callbackRead(fd); }
 
-    if (socket.bMarkedForUntrack_a && !socket.bIsExecutingCallbackWrite_a) {
-      __TACOPIE_LOG(debug, "untrack socket");
-      m_mapTrackedSockets.erase(pos);
-      m_cvWaitForRemoval.notify_all();
+    event_callback_t callbackReplaced;
+    std::vector<removal_callback_t> vctRemovalCallbacks;
+
+    {
+      std::lock_guard<std::mutex> lock(pReactor->get_socket_mutex(fd));
+      callbackReplaced = complete_callback(*pReactor, fd, *pSocket, true, vctRemovalCallbacks);
+      wakeup_poller_on_update(*pReactor);
     }
 
-    m_selfPipeNotifier.notify();
+    if (!vctRemovalCallbacks.empty()) { execute_removal_callbacks(vctRemovalCallbacks); }
   };
 }
 
 void
-io_service::process_wr_event(const fd_t& fd, tracked_socket& socket) {
-  __TACOPIE_LOG(debug, "processing write event");
+io_service::process_wr_event(reactor& r, const fd_t& fd, tracked_socket& socket) {
+  __TACOPIE_LOG_RATE_LIMITED(debug, "processing write event");
+  __TACOPIE_METRIC_ADD(events_dispatched, 1)
 
-  auto callbackWrite = socket.callbackWrite;
+  socket.set(tracked_socket::executing_wr_callback);
 
-  socket.bIsExecutingCallbackWrite_a = true;
+  if (socket.eCallbackExecutionMode == callback_execution_mode::reactor_thread) {
+    r.vctReactorCallbacks.push_back({fd, false, &socket});
+    return;
+  }
 
-  m_threadPoolCallbackWorkers << [=] {
-    __TACOPIE_LOG(debug, "execute write callback");
-    callbackWrite(fd);
+  auto pReactor = &r;
+  auto pSocket  = &socket;
 
-    std::lock_guard<std::mutex> lock(m_mtxTrackedSockets);
-    auto it = m_mapTrackedSockets.find(fd);
+  update_polled_events(r, fd, socket);
 
-    if (it == m_mapTrackedSockets.end()) { return; }
+  m_threadPoolCallbackWorkers << [this, pReactor, pSocket, fd] {
+    __TACOPIE_LOG_RATE_LIMITED(debug, "execute write callback");
 
-    auto& socket                    = it->second;
-    socket.bIsExecutingCallbackWrite_a = false;
+    //! untracked since the dispatch (typically by the other callback of the socket): not executed anymore
+    if (!pSocket->is_set(tracked_socket::marked_for_untrack)) { pSocket->callbackWrite(fd); }
 
-    if (socket.bMarkedForUntrack_a && !socket.bIsExecutingCallbackRead_a) {
-      __TACOPIE_LOG(debug, "untrack socket");
-      m_mapTrackedSockets.erase(it);
-      m_cvWaitForRemoval.notify_all();
+    event_callback_t callbackReplaced;
+    std::vector<removal_callback_t> vctRemovalCallbacks;
+
+    {
+      std::lock_guard<std::mutex> lock(pReactor->get_socket_mutex(fd));
+      callbackReplaced = complete_callback(*pReactor, fd, *pSocket, false, vctRemovalCallbacks);
+      wakeup_poller_on_update(*pReactor);
     }
 
-    m_selfPipeNotifier.notify();
+    if (!vctRemovalCallbacks.empty()) { execute_removal_callbacks(vctRemovalCallbacks); }
   };
 }
 
+void
+io_service::execute_reactor_callbacks(reactor& r) {
+  for (const auto& reactorCallback : r.vctReactorCallbacks) {
+    __TACOPIE_LOG_RATE_LIMITED(debug, "execute callback on reactor thread");
+
+    //! untracked by a callback executed before in this batch: not executed anymore
+    if (reactorCallback.pSocket->is_set(tracked_socket::marked_for_untrack)) { continue; }
+
+    try {
+      if (reactorCallback.bIsRead) {
+        reactorCallback.pSocket->callbackRead(reactorCallback.fd);
+      } else {
+        reactorCallback.pSocket->callbackWrite(reactorCallback.fd);
+      }
+    }
+    catch (const std::exception&) {
+      __TACOPIE_LOG(warn, "uncatched exception propagated up to the reactor.")
+    }
+  }
+
+  for (const auto& reactorCallback : r.vctReactorCallbacks) {
+    std::lock_guard<std::mutex> lock(r.get_socket_mutex(reactorCallback.fd));
+    auto callbackReplaced = complete_callback(r, reactorCallback.fd, *reactorCallback.pSocket, reactorCallback.bIsRead,
+        r.vctRemovalCallbacks);
+
+    if (callbackReplaced) { r.vctReplacedCallbacks.push_back(std::move(callbackReplaced)); }
+  }
+
+  r.vctReactorCallbacks.clear();
+  r.vctReplacedCallbacks.clear();
+}
+
 //!
-//! init m_poll_fds_info
+//! poller interest management
 //!
 
-int
-io_service::init_poll_fds_info(void) {
-  std::lock_guard<std::mutex> lock(m_mtxTrackedSockets);
+void
+io_service::update_polled_events(reactor& r, const fd_t& fd, tracked_socket& socket) {
+  int nEvents = poller_iface::none;
+
+  //! sockets marked for untrack are not polled anymore, they are only waiting for their callbacks to complete
+  //! callbacks executed by the poll thread do not need to be disarmed: the reactor does not poll while executing them
+  bool bIsReactorThreadMode = socket.eCallbackExecutionMode == callback_execution_mode::reactor_thread;
+
+  //! callbacks kept pending are the ones the socket is waiting for
+  const auto& callbackRead  = socket.bHasPendingCallbackRead ? socket.callbackReadPending : socket.callbackRead;
+  const auto& callbackWrite = socket.bHasPendingCallbackWrite ? socket.callbackWritePending : socket.callbackWrite;
 
-  m_vctPolledFds.clear();
-  FD_ZERO(&m_fdsetRead);
-  FD_ZERO(&m_fdsetWrite);
+  if (!socket.is_set(tracked_socket::marked_for_untrack)) {
+    if (callbackRead && (bIsReactorThreadMode || !socket.is_set(tracked_socket::executing_rd_callback))) { nEvents |= poller_iface::rd; }
+    if (callbackWrite && (bIsReactorThreadMode || !socket.is_set(tracked_socket::executing_wr_callback))) { nEvents |= poller_iface::wr; }
+  }
 
-  int nFds = static_cast<int>(m_selfPipeNotifier.get_read_fd());
-  FD_SET(m_selfPipeNotifier.get_read_fd(), &m_fdsetRead);
-  m_vctPolledFds.push_back(m_selfPipeNotifier.get_read_fd());
+  if (nEvents == socket.nPolledEvents) { return; }
 
-  for (const auto& socket : m_mapTrackedSockets) {
-    const auto& fd          = socket.first;
-    const auto& socket_info = socket.second;
+  r.ptrPoller->update(fd, socket.nPolledEvents, nEvents);
+  socket.nPolledEvents = nEvents;
+}
 
-    bool bShouldRead = socket_info.callbackRead && !socket_info.bIsExecutingCallbackRead_a;
-    if (bShouldRead) {
-      FD_SET(fd, &m_fdsetRead);
+void
+io_service::set_callback(tracked_socket& socket, bool bIsRead, event_callback_t callback) {
+  if (bIsRead) {
+    if (socket.is_set(tracked_socket::executing_rd_callback)) {
+      socket.callbackReadPending     = std::move(callback);
+      socket.bHasPendingCallbackRead = true;
+    } else {
+      socket.callbackRead = std::move(callback);
+    }
+  } else {
+    if (socket.is_set(tracked_socket::executing_wr_callback)) {
+      socket.callbackWritePending     = std::move(callback);
+      socket.bHasPendingCallbackWrite = true;
+    } else {
+      socket.callbackWrite = std::move(callback);
     }
+  }
+}
+
+io_service::event_callback_t
+io_service::complete_callback(reactor& r, const fd_t& fd, tracked_socket& socket, bool bIsRead,
+    std::vector<removal_callback_t>& vctRemovalCallbacks) {
+  event_callback_t callbackReplaced;
 
-    bool bShouldWrite = socket_info.callbackWrite && !socket_info.bIsExecutingCallbackWrite_a;
-    if (bShouldWrite) {
-      FD_SET(fd, &m_fdsetWrite);
+  if (bIsRead) {
+    socket.clr(tracked_socket::executing_rd_callback);
+
+    if (socket.bHasPendingCallbackRead) {
+      callbackReplaced               = std::move(socket.callbackRead);
+      socket.callbackRead            = std::move(socket.callbackReadPending);
+      socket.bHasPendingCallbackRead = false;
     }
+  } else {
+    socket.clr(tracked_socket::executing_wr_callback);
 
-    if (bShouldRead || bShouldWrite || socket_info.bMarkedForUntrack_a) {
-      m_vctPolledFds.push_back(fd);
+    if (socket.bHasPendingCallbackWrite) {
+      callbackReplaced                = std::move(socket.callbackWrite);
+      socket.callbackWrite            = std::move(socket.callbackWritePending);
+      socket.bHasPendingCallbackWrite = false;
     }
+  }
+
+  if (socket.is_removable()) {
+    __TACOPIE_LOG(debug, "untrack socket");
+    erase_tracked_socket(r, fd, socket, vctRemovalCallbacks);
+  } else {
+    update_polled_events(r, fd, socket);
+  }
 
-    if ((bShouldRead || bShouldWrite) && static_cast<int>(fd) > nFds) {
-      nFds = static_cast<int>(fd);
+  return callbackReplaced;
+}
+
+void
+io_service::erase_tracked_socket(reactor& r, const fd_t& fd, tracked_socket& socket,
+    std::vector<removal_callback_t>& vctRemovalCallbacks) {
+  if (socket.nPolledEvents != poller_iface::none) { r.ptrPoller->update(fd, socket.nPolledEvents, poller_iface::none); }
+  r.ptrPoller->release(fd);
+
+  for (auto& callbackRemoval : socket.vctRemovalCallbacks) { vctRemovalCallbacks.push_back(std::move(callbackRemoval)); }
+
+  {
+    std::lock_guard<std::mutex> lock(r.mtxTrackedSockets);
+    r.tableTrackedSockets.erase(fd);
+  }
+
+  --r.nNbTrackedSockets_a;
+}
+
+void
+io_service::execute_removal_callbacks(std::vector<removal_callback_t>& vctRemovalCallbacks) {
+  for (auto& callbackRemoval : vctRemovalCallbacks) {
+    __TACOPIE_LOG(debug, "execute removal callback");
+
+    try {
+      callbackRemoval();
+    }
+    catch (const std::exception&) {
+      __TACOPIE_LOG(warn, "uncatched exception propagated up to the io_service.")
     }
   }
 
-  return nFds + 1;
+  vctRemovalCallbacks.clear();
+}
+
+void
+io_service::wakeup_poller_on_update(reactor& r) {
+  //! updates made from the poll thread itself are taken into account by the next poll
+  if (r.ptrPoller->needs_wakeup_on_update() && std::this_thread::get_id() != r.threadPollWorker.get_id()) {
+    wakeup_reactor(r);
+  }
+}
+
+void
+io_service::wakeup_reactor(reactor& r) {
+  //! the self pipe is only used by the pollers that cannot be woken up by themselves
+  if (!r.ptrPoller->wakeup()) { r.selfPipeNotifier.notify(); }
+}
+
+//!
+//! timers
+//!
+
+io_service::timer_id_t
+io_service::schedule_after(std::chrono::milliseconds delay, const timer_callback_t& callback) {
+  return add_timer(delay, std::chrono::milliseconds(0), callback);
+}
+
+io_service::timer_id_t
+io_service::schedule_every(std::chrono::milliseconds period, const timer_callback_t& callback) {
+  //! a period of 0 would make the timer one-shot
+  if (period.count() <= 0) { period = std::chrono::milliseconds(1); }
+
+  return add_timer(period, period, callback);
+}
+
+io_service::timer_id_t
+io_service::add_timer(std::chrono::milliseconds delay, std::chrono::milliseconds period, const timer_callback_t& callback) {
+  if (delay.count() < 0) { delay = std::chrono::milliseconds(0); }
+
+  std::uint64_t uExpiryTick = get_timer_tick(std::chrono::steady_clock::now() + delay, true);
+  timer_id_t id;
+  bool bIsNearest;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mtxTimers);
+
+    id         = m_timerWheel.add(uExpiryTick, static_cast<std::uint64_t>(period.count()), callback);
+    bIsNearest = uExpiryTick < m_uTimerWakeupTick;
+  }
+
+  //! the poll timeout of the first reactor must be recomputed if the new timer expires before it wakes up
+  auto& r = *m_vctReactors.front();
+  if (bIsNearest && std::this_thread::get_id() != r.threadPollWorker.get_id()) { wakeup_reactor(r); }
+
+  return id;
+}
+
+bool
+io_service::cancel_timer(timer_id_t id, bool bWaitForCompletion) {
+  if (id == 0) { return false; }
+
+  std::unique_lock<std::mutex> lock(m_mtxTimers);
+
+  bool bIsPending  = m_timerWheel.cancel(id);
+  auto posExecuting = m_mapExecutingTimers.find(id);
+
+  //! expired but not started yet: the queued callback is skipped, no need to wait for it (it may be queued behind the
+  //! calling thread)
+  if (posExecuting != m_mapExecutingTimers.end() && posExecuting->second.threadId == std::thread::id()) {
+    bool bIsQueued                  = !posExecuting->second.bCancelled;
+    posExecuting->second.bCancelled = true;
+
+    return bIsPending || bIsQueued;
+  }
+
+  if (bWaitForCompletion) {
+    m_cvTimers.wait(lock, [&]() {
+      auto pos = m_mapExecutingTimers.find(id);
+
+      return pos == m_mapExecutingTimers.end() || pos->second.threadId == std::this_thread::get_id();
+    });
+  }
+
+  return bIsPending;
+}
+
+std::uint64_t
+io_service::get_timer_tick(std::chrono::steady_clock::time_point time, bool bRoundUp) const {
+  if (time <= m_timeTimerOrigin) { return 0; }
+
+  auto elapsed    = time - m_timeTimerOrigin;
+  auto nElapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+
+  if (bRoundUp && std::chrono::milliseconds(nElapsedMs) < elapsed) { ++nElapsedMs; }
+
+  return static_cast<std::uint64_t>(nElapsedMs);
+}
+
+int
+io_service::get_poll_timeout(reactor& r, int nDefaultTimeoutMsecs) {
+  if (&r != m_vctReactors.front().get()) { return nDefaultTimeoutMsecs; }
+
+  std::lock_guard<std::mutex> lock(m_mtxTimers);
+
+  std::uint64_t uNextTick = m_timerWheel.get_next_event_tick();
+  std::uint64_t uNowTick  = get_timer_tick(std::chrono::steady_clock::now(), false);
+
+  if (uNextTick == std::numeric_limits<std::uint64_t>::max()) {
+    m_uTimerWakeupTick = nDefaultTimeoutMsecs >= 0 ? uNowTick + nDefaultTimeoutMsecs : uNextTick;
+    return nDefaultTimeoutMsecs;
+  }
+
+  std::uint64_t uDelay = uNextTick > uNowTick ? uNextTick - uNowTick : 0;
+
+  if (nDefaultTimeoutMsecs >= 0 && static_cast<std::uint64_t>(nDefaultTimeoutMsecs) < uDelay) {
+    uDelay = static_cast<std::uint64_t>(nDefaultTimeoutMsecs);
+  }
+
+  uDelay             = std::min<std::uint64_t>(uDelay, std::numeric_limits<int>::max());
+  m_uTimerWakeupTick = uNowTick + uDelay;
+
+  return static_cast<int>(uDelay);
+}
+
+void
+io_service::process_expired_timers(void) {
+  {
+    std::lock_guard<std::mutex> lock(m_mtxTimers);
+
+    m_timerWheel.advance(get_timer_tick(std::chrono::steady_clock::now(), false), m_vctExpiredTimers);
+
+    //! periodic timers whose previous execution is still running skip this expiry
+    auto pos = std::remove_if(m_vctExpiredTimers.begin(), m_vctExpiredTimers.end(),
+        [&](const utils::timer_wheel::expired_timer_t& expiredTimer) {
+          return m_mapExecutingTimers.find(expiredTimer.first) != m_mapExecutingTimers.end();
+        });
+    m_vctExpiredTimers.erase(pos, m_vctExpiredTimers.end());
+
+    for (const auto& expiredTimer : m_vctExpiredTimers) { m_mapExecutingTimers[expiredTimer.first] = executing_timer(); }
+  }
+
+  for (auto& expiredTimer : m_vctExpiredTimers) {
+    timer_id_t id = expiredTimer.first;
+    auto callback = std::move(expiredTimer.second);
+
+    m_threadPoolCallbackWorkers << [=] {
+      __TACOPIE_LOG_RATE_LIMITED(debug, "execute timer callback");
+
+      {
+        std::lock_guard<std::mutex> lock(m_mtxTimers);
+        auto& timer = m_mapExecutingTimers[id];
+
+        //! cancelled while queued: none waits for it
+        if (timer.bCancelled) {
+          m_mapExecutingTimers.erase(id);
+          return;
+        }
+
+        timer.threadId = std::this_thread::get_id();
+      }
+
+      try {
+        callback();
+      }
+      catch (const std::exception&) {
+        __TACOPIE_LOG(warn, "uncatched exception propagated up to the timer.")
+      }
+
+      std::lock_guard<std::mutex> lock(m_mtxTimers);
+      m_mapExecutingTimers.erase(id);
+      m_cvTimers.notify_all();
+    };
+  }
+
+  m_vctExpiredTimers.clear();
 }
 
 //!
 //! track & untrack socket
 //!
 
+io_service::tracked_socket*
+io_service::find_tracked_socket(reactor& r, const fd_t& fd) {
+  std::lock_guard<std::mutex> lock(r.mtxTrackedSockets);
+
+  return r.tableTrackedSockets.find(fd);
+}
+
+io_service::tracked_socket&
+io_service::get_or_create_tracked_socket(reactor& r, const fd_t& fd) {
+  bool bInserted;
+  std::unique_lock<std::mutex> lock(r.mtxTrackedSockets);
+  auto& track_info = r.tableTrackedSockets.find_or_insert(fd, bInserted);
+  lock.unlock();
+
+  if (bInserted) {
+    ++r.nNbTrackedSockets_a;
+    track_info.eCallbackExecutionMode = m_eCallbackExecutionMode_a;
+  }
+
+  return track_info;
+}
+
 void
-io_service::track(const tcp_socket& socket, const event_callback_t& callbackRead,
-    const event_callback_t& callbackWrite) {
-  std::lock_guard<std::mutex> lock(m_mtxTrackedSockets);
+io_service::track(const tcp_socket& socket, event_callback_t callbackRead, event_callback_t callbackWrite) {
+  auto fd       = socket.get_fd();
+  auto pReactor = find_reactor(fd);
+
+  //! a socket still tracked (pending for untrack) stays on its reactor, any other socket gets a new assignment
+  if (pReactor && m_vctReactors.size() > 1) {
+    std::lock_guard<std::mutex> lock(pReactor->get_socket_mutex(fd));
+    if (!find_tracked_socket(*pReactor, fd)) { pReactor = nullptr; }
+  }
+
+  auto& r = pReactor ? *pReactor : assign_reactor(fd);
+  std::lock_guard<std::mutex> lock(r.get_socket_mutex(fd));
 
   __TACOPIE_LOG(debug, "track new socket");
 
-  auto& track_info                          = m_mapTrackedSockets[socket.get_fd()];
-  track_info.callbackRead                   = callbackRead;
-  track_info.callbackWrite                  = callbackWrite;
-  track_info.bMarkedForUntrack_a            = false;
-  track_info.bIsExecutingCallbackRead_a     = false;
-  track_info.bIsExecutingCallbackWrite_a    = false;
+  //! callbacks still being executed (socket pending for untrack) are replaced once they complete
+  auto& track_info                  = get_or_create_tracked_socket(r, fd);
+  set_callback(track_info, true, std::move(callbackRead));
+  set_callback(track_info, false, std::move(callbackWrite));
+  track_info.clr(tracked_socket::marked_for_untrack);
+  track_info.eCallbackExecutionMode = m_eCallbackExecutionMode_a;
+  update_polled_events(r, fd, track_info);
 
-  m_selfPipeNotifier.notify();
+  wakeup_poller_on_update(r);
 }
 
 void
-io_service::set_rd_callback(const tcp_socket& socket, const event_callback_t& callbackEvent) {
-  std::lock_guard<std::mutex> lock(m_mtxTrackedSockets);
+io_service::set_rd_callback(const tcp_socket& socket, event_callback_t callbackEvent) {
+  auto fd = socket.get_fd();
+  auto& r = find_or_assign_reactor(fd);
+  std::lock_guard<std::mutex> lock(r.get_socket_mutex(fd));
 
   __TACOPIE_LOG(debug, "update read socket tracking callback");
 
-  auto& track_info       = m_mapTrackedSockets[socket.get_fd()];
-  track_info.callbackRead = callbackEvent;
+  auto& track_info = get_or_create_tracked_socket(r, fd);
+  set_callback(track_info, true, std::move(callbackEvent));
+  update_polled_events(r, fd, track_info);
 
-  m_selfPipeNotifier.notify();
+  wakeup_poller_on_update(r);
 }
 
 void
-io_service::set_wr_callback(const tcp_socket& socket, const event_callback_t& callbackEvent) {
-  std::lock_guard<std::mutex> lock(m_mtxTrackedSockets);
+io_service::set_wr_callback(const tcp_socket& socket, event_callback_t callbackEvent) {
+  auto fd = socket.get_fd();
+  auto& r = find_or_assign_reactor(fd);
+  std::lock_guard<std::mutex> lock(r.get_socket_mutex(fd));
 
   __TACOPIE_LOG(debug, "update write socket tracking callback");
 
-  auto& track_info       = m_mapTrackedSockets[socket.get_fd()];
-  track_info.callbackWrite = callbackEvent;
+  auto& track_info = get_or_create_tracked_socket(r, fd);
+  set_callback(track_info, false, std::move(callbackEvent));
+  update_polled_events(r, fd, track_info);
 
-  m_selfPipeNotifier.notify();
+  wakeup_poller_on_update(r);
+}
+
+void
+io_service::set_callback_execution_mode(callback_execution_mode eMode) {
+  m_eCallbackExecutionMode_a = eMode;
+}
+
+void
+io_service::set_callback_execution_mode(const tcp_socket& socket, callback_execution_mode eMode) {
+  auto fd = socket.get_fd();
+  auto& r = find_or_assign_reactor(fd);
+  std::lock_guard<std::mutex> lock(r.get_socket_mutex(fd));
+
+  __TACOPIE_LOG(debug, "update socket callback execution mode");
+
+  auto& track_info                  = get_or_create_tracked_socket(r, fd);
+  track_info.eCallbackExecutionMode = eMode;
+  update_polled_events(r, fd, track_info);
+
+  wakeup_poller_on_update(r);
+}
+
+//!
+//! completion based receive
+//!
+
+bool
+io_service::supports_recv_completions(void) const {
+  return m_vctReactors.front()->ptrPoller->supports_recv_completions();
+}
+
+void
+io_service::set_recv_completions(const tcp_socket& socket, bool bEnabled, std::size_t uBufferSize) {
+  auto fd       = socket.get_fd();
+  auto pReactor = find_reactor(fd);
+
+  if (!pReactor) { return; }
+
+  auto& r = *pReactor;
+  std::lock_guard<std::mutex> lock(r.get_socket_mutex(fd));
+
+  //! released along with the tracking: never enabled for a socket that is not tracked
+  if (!find_tracked_socket(r, fd)) { return; }
+
+  __TACOPIE_LOG(debug, "update socket completion based receive");
+
+  r.ptrPoller->set_recv_completions(fd, bEnabled, uBufferSize);
+
+  wakeup_poller_on_update(r);
+}
+
+bool
+io_service::take_received(const tcp_socket& socket, char* pBuffer, std::size_t uSizeToRead, std::size_t& uReadSize) {
+  auto fd       = socket.get_fd();
+  auto pReactor = find_reactor(fd);
+
+  if (!pReactor) { return false; }
+
+  //! the receive is re-armed by the next poll: taken from a read callback, whose completion wakes up the poll thread
+  return pReactor->ptrPoller->take_received(fd, pBuffer, uSizeToRead, uReadSize);
 }
 
 void
 io_service::untrack(const tcp_socket& socket) {
-  std::lock_guard<std::mutex> lock(m_mtxTrackedSockets);
+  untrack(socket, nullptr);
+}
 
-  auto pos = m_mapTrackedSockets.find(socket.get_fd());
+bool
+io_service::untrack_tracked_socket(reactor& r, const fd_t& fd, removal_callback_t& callbackRemoval,
+    std::vector<removal_callback_t>& vctRemovalCallbacks) {
+  auto pSocket = find_tracked_socket(r, fd);
 
-  if (pos == m_mapTrackedSockets.end()) { return; }
+  if (!pSocket) { return false; }
 
-  if (pos->second.bIsExecutingCallbackRead_a || pos->second.bIsExecutingCallbackWrite_a) {
+  if (callbackRemoval) { pSocket->vctRemovalCallbacks.push_back(std::move(callbackRemoval)); }
+
+  if (pSocket->is_set(tracked_socket::executing_rd_callback | tracked_socket::executing_wr_callback)) {
     __TACOPIE_LOG(debug, "mark socket for untracking");
-    pos->second.bMarkedForUntrack_a = true;
+    pSocket->set(tracked_socket::marked_for_untrack);
+    update_polled_events(r, fd, *pSocket);
+
+    //! the callbacks not being executed will not be anymore: release them, and what they captured, right away
+    if (!pSocket->is_set(tracked_socket::executing_rd_callback)) { pSocket->callbackRead = nullptr; }
+    if (!pSocket->is_set(tracked_socket::executing_wr_callback)) { pSocket->callbackWrite = nullptr; }
+    pSocket->callbackReadPending      = nullptr;
+    pSocket->callbackWritePending     = nullptr;
+    pSocket->bHasPendingCallbackRead  = false;
+    pSocket->bHasPendingCallbackWrite = false;
   } else {
     __TACOPIE_LOG(debug, "untrack socket");
-    m_mapTrackedSockets.erase(pos);
-    m_cvWaitForRemoval.notify_all();
+    erase_tracked_socket(r, fd, *pSocket, vctRemovalCallbacks);
+  }
+
+  return true;
+}
+
+void
+io_service::untrack(const tcp_socket& socket, removal_callback_t callbackRemoval) {
+  auto fd       = socket.get_fd();
+  auto pReactor = find_reactor(fd);
+  std::vector<removal_callback_t> vctRemovalCallbacks;
+
+  if (pReactor) {
+    auto& r = *pReactor;
+    std::lock_guard<std::mutex> lock(r.get_socket_mutex(fd));
+
+    if (untrack_tracked_socket(r, fd, callbackRemoval, vctRemovalCallbacks)) { wakeup_poller_on_update(r); }
+  }
+
+  //! socket not tracked: it is already removed (the callback has been moved, and thus emptied, otherwise)
+  if (callbackRemoval) { vctRemovalCallbacks.push_back(std::move(callbackRemoval)); }
+
+  if (!vctRemovalCallbacks.empty()) { execute_removal_callbacks(vctRemovalCallbacks); }
+}
+
+void
+io_service::untrack(std::vector<untrack_request>&& vctRequests) {
+  std::vector<fd_t> vctFds;
+  vctFds.reserve(vctRequests.size());
+  for (const auto& request : vctRequests) { vctFds.push_back(request.socket->get_fd()); }
+
+  std::vector<removal_callback_t> vctRemovalCallbacks;
+
+  __TACOPIE_LOG(debug, "untrack batch of sockets");
+
+  process_batch_sockets(sort_batch_sockets(vctFds), [&](reactor& r, const batch_socket& socket) {
+    return untrack_tracked_socket(r, socket.fd, vctRequests[socket.uIndex].removal_callback, vctRemovalCallbacks);
+  });
+
+  //! sockets not tracked: they are already removed
+  for (auto& request : vctRequests) {
+    if (request.removal_callback) { vctRemovalCallbacks.push_back(std::move(request.removal_callback)); }
   }
 
-  m_selfPipeNotifier.notify();
+  if (!vctRemovalCallbacks.empty()) { execute_removal_callbacks(vctRemovalCallbacks); }
+}
+
+//!
+//! batch operations
+//!
+
+std::vector<io_service::batch_socket>
+io_service::sort_batch_sockets(const std::vector<fd_t>& vctFds) {
+  std::vector<batch_socket> vctSockets;
+  vctSockets.reserve(vctFds.size());
+
+  if (m_vctReactors.size() == 1) {
+    for (std::size_t i = 0; i < vctFds.size(); ++i) { vctSockets.push_back(batch_socket{m_vctReactors.front().get(), vctFds[i], i}); }
+  } else {
+    std::lock_guard<std::mutex> lock(m_mtxReactorAssignments);
+
+    for (std::size_t i = 0; i < vctFds.size(); ++i) {
+      auto pIndex = m_tableReactorAssignments.find(vctFds[i]);
+      vctSockets.push_back(batch_socket{pIndex ? m_vctReactors[*pIndex].get() : nullptr, vctFds[i], i});
+    }
+  }
+
+  std::sort(vctSockets.begin(), vctSockets.end(), [](const batch_socket& lhs, const batch_socket& rhs) {
+    if (lhs.pReactor != rhs.pReactor) { return std::less<reactor*>()(lhs.pReactor, rhs.pReactor); }
+
+    return reactor::get_socket_mutex_index(lhs.fd) < reactor::get_socket_mutex_index(rhs.fd);
+  });
+
+  return vctSockets;
+}
+
+void
+io_service::process_batch_sockets(const std::vector<batch_socket>& vctSockets,
+    const std::function<bool(reactor&, const batch_socket&)>& fnProcess) {
+  auto it = vctSockets.begin();
+
+  while (it != vctSockets.end()) {
+    //! never assigned to a reactor: not tracked
+    if (!it->pReactor) {
+      ++it;
+      continue;
+    }
+
+    auto& r      = *it->pReactor;
+    bool bWakeup = false;
+
+    while (it != vctSockets.end() && it->pReactor == &r) {
+      std::size_t uMutexIndex = reactor::get_socket_mutex_index(it->fd);
+      std::lock_guard<std::mutex> lock(r.arrSocketMutexes[uMutexIndex]);
+
+      for (; it != vctSockets.end() && it->pReactor == &r && reactor::get_socket_mutex_index(it->fd) == uMutexIndex; ++it) {
+        if (fnProcess(r, *it)) { bWakeup = true; }
+      }
+    }
+
+    if (bWakeup) { wakeup_poller_on_update(r); }
+  }
 }
 
 //!
@@ -334,15 +1081,70 @@ io_service::untrack(const tcp_socket& socket) {
 
 void
 io_service::wait_for_removal(const tcp_socket& socket) {
-  std::unique_lock<std::mutex> lock(m_mtxTrackedSockets);
+  auto fd       = socket.get_fd();
+  auto pReactor = find_reactor(fd);
+
+  if (!pReactor) { return; }
+
+  std::promise<void> promiseRemoval;
+  auto futureRemoval = promiseRemoval.get_future();
+  auto pPromise      = &promiseRemoval;
+
+  {
+    auto& r = *pReactor;
+    std::lock_guard<std::mutex> lock(r.get_socket_mutex(fd));
+    auto pSocket = find_tracked_socket(r, fd);
+
+    if (!pSocket) { return; }
+
+    pSocket->vctRemovalCallbacks.push_back([pPromise] { pPromise->set_value(); });
+  }
 
   __TACOPIE_LOG(debug, "waiting for socket removal");
 
-  m_cvWaitForRemoval.wait(lock, [&]() {
-    __TACOPIE_LOG(debug, "socket has been removed");
+  futureRemoval.wait();
+
+  __TACOPIE_LOG(debug, "socket has been removed");
+}
 
-    return m_mapTrackedSockets.find(socket.get_fd()) == m_mapTrackedSockets.end();
+void
+io_service::wait_for_removal(const std::vector<const tcp_socket*>& vctSockets) {
+  std::vector<fd_t> vctFds;
+  vctFds.reserve(vctSockets.size());
+  for (auto pSocket : vctSockets) { vctFds.push_back(pSocket->get_fd()); }
+
+  //! released by the removal callback of the last socket removed
+  struct removal_barrier {
+    std::mutex              mtx;
+    std::condition_variable cv;
+    std::size_t             uNbPendingRemovals = 0;
+  } barrier;
+  auto pBarrier = &barrier;
+
+  process_batch_sockets(sort_batch_sockets(vctFds), [&](reactor& r, const batch_socket& socket) {
+    auto pSocket = find_tracked_socket(r, socket.fd);
+
+    if (pSocket) {
+      {
+        std::lock_guard<std::mutex> lock(barrier.mtx);
+        ++barrier.uNbPendingRemovals;
+      }
+
+      pSocket->vctRemovalCallbacks.push_back([pBarrier] {
+        std::lock_guard<std::mutex> lock(pBarrier->mtx);
+        if (--pBarrier->uNbPendingRemovals == 0) { pBarrier->cv.notify_all(); }
+      });
+    }
+
+    return false;
   });
+
+  __TACOPIE_LOG(debug, "waiting for sockets removal");
+
+  std::unique_lock<std::mutex> lock(barrier.mtx);
+  barrier.cv.wait(lock, [&]() { return barrier.uNbPendingRemovals == 0; });
+
+  __TACOPIE_LOG(debug, "sockets have been removed");
 }
 
 } // namespace tacopie
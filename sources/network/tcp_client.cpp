@@ -21,11 +21,112 @@
 // SOFTWARE.
 
 #include <tacopie/network/tcp_client.hpp>
+#include <tacopie/utils/buffer_pool.hpp>
 #include <tacopie/utils/error.hpp>
 #include <tacopie/utils/logger.hpp>
+#include <tacopie/utils/metrics.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif /* __linux__ */
 
 namespace tacopie {
 
+//!
+//! current time used by the idle and read timeouts
+//!
+
+static std::int64_t
+get_current_msecs(void) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//!
+//! I/O statistics
+//! updated by a single thread at a time (with the read or write lock held): no need for an atomic read-modify-write
+//!
+
+#ifdef __TACOPIE_METRICS_ENABLED
+static void
+add_statistic(std::atomic<std::uint64_t>& uStatistic, std::uint64_t uValue) {
+  uStatistic.store(uStatistic.load(std::memory_order_relaxed) + uValue, std::memory_order_relaxed);
+}
+#endif /* __TACOPIE_METRICS_ENABLED */
+
+//!
+//! splice relay
+//! ends of the pipe are used by a single thread at a time each (source read callback, target write processing),
+//! the remaining state is protected by mtx
+//!
+
+struct tcp_client::splice_relay {
+  splice_relay(tcp_client& source, tcp_client& target, std::size_t uSize)
+  : pSource(&source)
+  , pTarget(&target)
+  , uPipeCapacity(0)
+  , uPipeBytes(0)
+  , uRemainingBytes(uSize ? uSize : std::numeric_limits<std::size_t>::max())
+  , uWrittenBytes(0)
+  , bSourceDone(false)
+  , bSourcePaused(false)
+  , bSourceGone(false)
+  , bTargetGone(false)
+  , bFailed(false) {
+#ifdef __linux__
+    if (::pipe2(arrPipe, O_NONBLOCK | O_CLOEXEC) == -1) { __TACOPIE_THROW(error, "pipe2() failure"); }
+
+    //! a bigger pipe means fewer events per relayed byte, keep the system default if it is refused
+    ::fcntl(arrPipe[1], F_SETPIPE_SZ, __TACOPIE_SPLICE_PIPE_SIZE);
+    int nCapacity = ::fcntl(arrPipe[1], F_GETPIPE_SZ);
+    uPipeCapacity = nCapacity > 0 ? static_cast<std::size_t>(nCapacity) : 65536;
+#else
+    __TACOPIE_THROW(error, "splice() is not supported on this platform");
+#endif /* __linux__ */
+  }
+
+  ~splice_relay(void) {
+#ifdef __linux__
+    ::close(arrPipe[0]);
+    ::close(arrPipe[1]);
+#endif /* __linux__ */
+  }
+
+  splice_relay(const splice_relay&) = delete;
+  splice_relay& operator=(const splice_relay&) = delete;
+
+  //! client the bytes are read from
+  tcp_client*   pSource;
+  //! client the bytes are written to
+  tcp_client*   pTarget;
+  //! pipe (read end, write end)
+  int           arrPipe[2];
+  //! capacity of the pipe
+  std::size_t   uPipeCapacity;
+  //! bytes moved into the pipe and not written to the target yet
+  std::size_t   uPipeBytes;
+  //! bytes still to be read from the source
+  std::size_t   uRemainingBytes;
+  //! bytes written to the target
+  std::size_t   uWrittenBytes;
+  //! whether the source is not read anymore (end of stream, all bytes read, failure or abort)
+  bool          bSourceDone;
+  //! whether the source is not read until the target drains the pipe
+  bool          bSourcePaused;
+  //! whether the source has been disconnected (it must not be used anymore)
+  bool          bSourceGone;
+  //! whether the relay request left the write queue of the target (it must not be used anymore)
+  bool          bTargetGone;
+  //! whether reading the source failed
+  bool          bFailed;
+  //! relay state thread safety
+  std::mutex    mtx;
+};
+
 //!
 //! ctor & dtor
 //!
@@ -38,7 +139,25 @@ tcp_client::tcp_client(void)
 
 tcp_client::~tcp_client(void) {
   __TACOPIE_LOG(debug, "destroy tcp_client");
+
+  {
+    std::lock_guard<std::mutex> lock(m_mtxConnect);
+
+    //! destroyed by its own connect callback: the completion must not access the client once the callback returned
+    if (m_completingConnectThreadId == std::this_thread::get_id()) { *m_pbDestroyedByConnectCallback = true; }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mtxSocketCallbacks);
+
+    //! destroyed by one of its socket callbacks: the callback must not access the client once it returned
+    if (m_readingThreadId == std::this_thread::get_id()) { *m_pbDestroyedByReadCallback = true; }
+    if (m_writingThreadId == std::this_thread::get_id()) { *m_pbDestroyedByWriteCallback = true; }
+  }
+
   disconnect(true);
+  wait_for_socket_callbacks();
+  wait_for_expired_timeout_check();
 }
 
 //!
@@ -50,7 +169,8 @@ tcp_client::tcp_client(tcp_socket&& socket)
 : m_ptrIOService(get_default_io_service())
 , m_tcpSocket(std::move(socket))
 , m_handlerDisconnection(nullptr) {
-  m_bIsConnected_a = true;
+  set_connected();
+  reset_timeout_clocks();
   __TACOPIE_LOG(debug, "create tcp_client");
   m_ptrIOService->track(m_tcpSocket);
 }
@@ -76,6 +196,7 @@ tcp_client::get_port(void) const {
 void
 tcp_client::connect(const std::string& sHost, std::uint32_t uPort, std::uint32_t uTimeoutMsecs) {
   if (is_connected()) { __TACOPIE_THROW(warn, "tcp_client is already connected"); }
+  if (is_connecting()) { __TACOPIE_THROW(warn, "tcp_client is already connecting"); }
 
   try {
     m_tcpSocket.connect(sHost, uPort, uTimeoutMsecs);
@@ -86,219 +207,1562 @@ tcp_client::connect(const std::string& sHost, std::uint32_t uPort, std::uint32_t
     throw e;
   }
 
-  m_bIsConnected_a = true;
+  set_connected();
+  reset_timeout_clocks();
+  start_timeout_timer();
 
   __TACOPIE_LOG(info, "tcp_client connected");
 }
 
 void
-tcp_client::disconnect(bool bWaitForRemoval) {
-  if (!is_connected()) { return; }
+tcp_client::async_connect(const std::string& sHost, std::uint32_t uPort, std::uint32_t uTimeoutMsecs,
+    const async_connect_callback_t& callbackConnect) {
+  std::lock_guard<std::mutex> lock(m_mtxConnect);
+
+  if (is_connected()) { __TACOPIE_THROW(warn, "tcp_client is already connected"); }
+  if (is_connecting()) { __TACOPIE_THROW(warn, "tcp_client is already connecting"); }
+
+  try {
+    m_tcpSocket.connect_non_blocking(sHost, uPort);
+  }
+  catch (const tacopie_error& e) {
+    m_tcpSocket.close();
+    throw e;
+  }
+
+  m_bIsConnecting_a = true;
+  m_callbackConnect = callbackConnect;
+
+  if (uTimeoutMsecs > 0) {
+    m_uConnectTimerId = m_ptrIOService->schedule_after(std::chrono::milliseconds(uTimeoutMsecs),
+        std::bind(&tcp_client::on_connect_timeout, this));
+  }
+
+  //! the socket becomes writable once the connection completed (even if it completed immediately)
+  m_ptrIOService->track(m_tcpSocket, nullptr, [this](fd_t fd) { on_connect_available(fd); });
+
+  __TACOPIE_LOG(info, "tcp_client connecting");
+}
+
+void
+tcp_client::on_connect_available(fd_t) {
+  async_connect_callback_t callbackConnect;
+  bool bSuccess   = true;
+  bool bDestroyed = false;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mtxConnect);
+
+    //! timed out or aborted in the meantime
+    if (!m_bIsConnecting_a) { return; }
+
+    m_ptrIOService->cancel_timer(m_uConnectTimerId);
+    m_uConnectTimerId              = 0;
+    callbackConnect                = std::move(m_callbackConnect);
+    m_completingConnectThreadId    = std::this_thread::get_id();
+    m_pbDestroyedByConnectCallback = &bDestroyed;
+
+    try {
+      m_tcpSocket.finish_connect();
+    }
+    catch (const tacopie_error&) {
+      bSuccess = false;
+    }
+
+    if (bSuccess) {
+      m_ptrIOService->set_wr_callback(m_tcpSocket, nullptr);
+      set_connected();
+      reset_timeout_clocks();
+    } else {
+      m_ptrIOService->untrack(m_tcpSocket);
+      m_tcpSocket.close();
+    }
+
+    m_bIsConnecting_a = false;
+  }
+
+  if (bSuccess) { start_timeout_timer(); }
+
+  __TACOPIE_LOG(info, bSuccess ? "tcp_client connected" : "tcp_client connection failure");
+
+  if (callbackConnect) {
+    //! executed as the write callback of the socket: a disconnection from the callback must not wait for the removal
+    begin_socket_callback(false, bDestroyed);
+    callbackConnect(bSuccess);
+
+    //! release what the callback captured while its destruction of the client is still detected
+    callbackConnect = nullptr;
+    if (!bDestroyed) { end_socket_callback(false); }
+  }
+
+  if (!bDestroyed) { end_connect_completion(); }
+}
+
+void
+tcp_client::on_connect_timeout(void) {
+  async_connect_callback_t callbackConnect;
+  bool bDestroyed = false;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mtxConnect);
+
+    //! connection completed or aborted in the meantime
+    if (!m_bIsConnecting_a) { return; }
+
+    m_uConnectTimerId              = 0;
+    callbackConnect                = std::move(m_callbackConnect);
+    m_completingConnectThreadId    = std::this_thread::get_id();
+    m_pbDestroyedByConnectCallback = &bDestroyed;
+
+    m_ptrIOService->untrack(m_tcpSocket);
+    m_tcpSocket.close();
+
+    m_bIsConnecting_a = false;
+  }
+
+  __TACOPIE_LOG(warn, "tcp_client connection timed out");
 
-  //! update state
-  m_bIsConnected_a = false;
+  if (callbackConnect) { callbackConnect(false); }
+
+  if (!bDestroyed) { end_connect_completion(); }
+}
+
+void
+tcp_client::abort_async_connect(bool bWaitForRemoval) {
+  io_service::timer_id_t uConnectTimerId;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mtxConnect);
+
+    if (!m_bIsConnecting_a) { return; }
+
+    m_bIsConnecting_a = false;
+    m_callbackConnect = nullptr;
+    uConnectTimerId   = m_uConnectTimerId;
+    m_uConnectTimerId = 0;
+
+    m_ptrIOService->untrack(m_tcpSocket);
+  }
+
+  //! outside of the lock: an expired timer callback might be waiting for it
+  m_ptrIOService->cancel_timer(uConnectTimerId, true);
+  if (bWaitForRemoval) { m_ptrIOService->wait_for_removal(m_tcpSocket); }
+
+  m_tcpSocket.close();
+
+  __TACOPIE_LOG(info, "tcp_client connection aborted");
+}
+
+void
+tcp_client::end_connect_completion(void) {
+  std::lock_guard<std::mutex> lock(m_mtxConnect);
+
+  m_completingConnectThreadId    = std::thread::id();
+  m_pbDestroyedByConnectCallback = nullptr;
+  m_cvConnect.notify_all();
+}
+
+void
+tcp_client::wait_for_connect_completion(void) {
+  std::unique_lock<std::mutex> lock(m_mtxConnect);
+
+  //! disconnection from the connect callback
+  if (m_completingConnectThreadId == std::this_thread::get_id()) { return; }
+
+  m_cvConnect.wait(lock, [&]() { return m_completingConnectThreadId == std::thread::id(); });
+}
+
+bool
+tcp_client::begin_disconnection(bool bWaitForRemoval) {
+  if (is_connecting()) { abort_async_connect(bWaitForRemoval); }
+  if (bWaitForRemoval) { wait_for_connect_completion(); }
+
+  //! update state: only one thread performs the disconnection, concurrent calls wait for it if requested
+  if (!m_bIsConnected_a.exchange(false)) {
+    if (bWaitForRemoval) { wait_for_removal(); }
+    return false;
+  }
+
+  //! stop enforcing timeouts
+  stop_timeout_timer();
 
   //! clear all pending requests
   clear_read_requests();
   clear_write_requests();
 
+  return true;
+}
+
+void
+tcp_client::disconnect(bool bWaitForRemoval) {
+  if (!begin_disconnection(bWaitForRemoval)) { return; }
+
   //! remove socket from io service and wait for removal if necessary
-  m_ptrIOService->untrack(m_tcpSocket);
-  if (bWaitForRemoval) { m_ptrIOService->wait_for_removal(m_tcpSocket); }
+  auto ptrRemovalState = m_ptrRemovalState;
+  m_ptrIOService->untrack(m_tcpSocket, [ptrRemovalState] { on_removal(*ptrRemovalState); });
+  if (bWaitForRemoval) { wait_for_removal(); }
 
   //! close the socket
-  m_tcpSocket.close();
+  close_socket(m_tcpSocket, *m_ptrRemovalState);
 
   __TACOPIE_LOG(info, "tcp_client disconnected");
 }
 
-//!
-//! Clear pending requests
-//!
 void
-tcp_client::clear_read_requests(void) {
-  std::lock_guard<std::mutex> lock(m_mtxReadRequests);
+tcp_client::disconnect_all(const std::vector<std::shared_ptr<tcp_client>>& vctClients, bool bWaitForRemoval) {
+  //! clients performing their disconnection, grouped by io_service (usually a single one)
+  struct io_service_batch {
+    io_service*                               pIOService;
+    std::vector<tcp_client*>                  vctClients;
+    std::vector<io_service::untrack_request>  vctRequests;
+  };
+  std::vector<io_service_batch> vctBatches;
+
+  for (const auto& ptrClient : vctClients) {
+    if (!ptrClient->begin_disconnection(bWaitForRemoval)) { continue; }
+
+    auto pIOService = ptrClient->m_ptrIOService.get();
+    auto itBatch    = std::find_if(vctBatches.begin(), vctBatches.end(),
+        [&](const io_service_batch& batch) { return batch.pIOService == pIOService; });
+
+    if (itBatch == vctBatches.end()) {
+      vctBatches.push_back(io_service_batch{pIOService, {}, {}});
+      itBatch = vctBatches.end() - 1;
+    }
+
+    tcp_client* pClient  = ptrClient.get();
+    auto ptrRemovalState = pClient->m_ptrRemovalState;
+    itBatch->vctClients.push_back(pClient);
+    itBatch->vctRequests.push_back(io_service::untrack_request{&pClient->m_tcpSocket,
+        [ptrRemovalState] { on_removal(*ptrRemovalState); }});
+  }
 
-  std::queue<read_request> empty;
-  std::swap(m_queReadRequests, empty);
-}
+  for (auto& batch : vctBatches) {
+    //! remove the sockets from the io service and wait for their removal if necessary
+    batch.pIOService->untrack(std::move(batch.vctRequests));
 
-void
-tcp_client::clear_write_requests(void) {
-  std::lock_guard<std::mutex> lock(m_mtxWriteRequests);
+    if (bWaitForRemoval) {
+      std::vector<const tcp_socket*> vctSockets;
+      vctSockets.reserve(batch.vctClients.size());
+      for (auto pClient : batch.vctClients) { vctSockets.push_back(&pClient->m_tcpSocket); }
+
+      batch.pIOService->wait_for_removal(vctSockets);
+    }
 
-  std::queue<write_request> empty;
-  std::swap(m_queWriteRequests, empty);
+    //! close the sockets
+    for (auto pClient : batch.vctClients) { close_socket(pClient->m_tcpSocket, *pClient->m_ptrRemovalState); }
+
+    __TACOPIE_LOG(info, "tcp_clients disconnected");
+  }
 }
 
 //!
-//! Call disconnection handler
+//! removal tracking
 //!
+
 void
-tcp_client::call_disconnection_handler(void) {
-  if (m_handlerDisconnection) {
-    m_handlerDisconnection();
+tcp_client::set_connected(void) {
+  {
+    std::lock_guard<std::mutex> lock(m_ptrRemovalState->mtx);
+    m_ptrRemovalState->bIsRemoved = false;
   }
-}
 
-//!
-//! io service read callback
-//!
+  m_bRecvCompletions_a = false;
+  m_bIsConnected_a     = true;
+}
 
 void
-tcp_client::on_read_available(fd_t) {
-  __TACOPIE_LOG(info, "read available");
+tcp_client::on_removal(removal_state& stateRemoval) {
+  std::unique_ptr<tcp_socket> ptrSocketPendingClose;
 
-  read_result resultRead;
-  auto callbackRead = process_read(resultRead);
+  {
+    std::lock_guard<std::mutex> lock(stateRemoval.mtx);
 
-  if (!resultRead.success) {
-    __TACOPIE_LOG(warn, "read operation failure");
-    disconnect();
+    stateRemoval.bIsRemoved = true;
+    ptrSocketPendingClose   = std::move(stateRemoval.ptrSocketPendingClose);
+    stateRemoval.cv.notify_all();
   }
 
-  if (callbackRead) { callbackRead(resultRead); }
+  if (ptrSocketPendingClose) { ptrSocketPendingClose->close(); }
+}
 
-  if (!resultRead.success) { call_disconnection_handler(); }
+void
+tcp_client::close_socket(tcp_socket& tcpSocket, removal_state& stateRemoval) {
+  {
+    std::lock_guard<std::mutex> lock(stateRemoval.mtx);
+
+    if (!stateRemoval.bIsRemoved) {
+      //! the moved-from socket keeps its host and port, but is not opened anymore
+      stateRemoval.ptrSocketPendingClose.reset(new tcp_socket(std::move(tcpSocket)));
+      return;
+    }
+  }
+
+  tcpSocket.close();
+}
+
+void
+tcp_client::wait_for_removal(void) {
+  //! from a callback of the socket: the removal waits for it to return
+  if (is_executing_socket_callback()) { return; }
+
+  std::unique_lock<std::mutex> lock(m_ptrRemovalState->mtx);
+
+  m_ptrRemovalState->cv.wait(lock, [&]() { return m_ptrRemovalState->bIsRemoved; });
 }
 
 //!
-//! io service write callback
+//! socket callbacks tracking
 //!
 
 void
-tcp_client::on_write_available(fd_t) {
-  __TACOPIE_LOG(info, "write available");
+tcp_client::begin_socket_callback(bool bIsRead, bool& bDestroyed) {
+  std::lock_guard<std::mutex> lock(m_mtxSocketCallbacks);
 
-  write_result resultWrite;
-  auto callbackWrite = process_write(resultWrite);
+  if (bIsRead) {
+    m_readingThreadId           = std::this_thread::get_id();
+    m_pbDestroyedByReadCallback = &bDestroyed;
+  } else {
+    m_writingThreadId            = std::this_thread::get_id();
+    m_pbDestroyedByWriteCallback = &bDestroyed;
+  }
+}
 
-  if (!resultWrite.success) {
-    __TACOPIE_LOG(warn, "write operation failure");
-    disconnect();
+void
+tcp_client::end_socket_callback(bool bIsRead) {
+  std::lock_guard<std::mutex> lock(m_mtxSocketCallbacks);
+
+  if (bIsRead) {
+    m_readingThreadId           = std::thread::id();
+    m_pbDestroyedByReadCallback = nullptr;
+  } else {
+    m_writingThreadId            = std::thread::id();
+    m_pbDestroyedByWriteCallback = nullptr;
   }
 
-  if (callbackWrite) { callbackWrite(resultWrite); }
+  m_cvSocketCallbacks.notify_all();
+}
+
+bool
+tcp_client::is_executing_socket_callback(void) {
+  std::lock_guard<std::mutex> lock(m_mtxSocketCallbacks);
+
+  return m_readingThreadId == std::this_thread::get_id() || m_writingThreadId == std::this_thread::get_id();
+}
+
+void
+tcp_client::wait_for_socket_callbacks(void) {
+  std::unique_lock<std::mutex> lock(m_mtxSocketCallbacks);
 
-  if (!resultWrite.success) { call_disconnection_handler(); }
+  m_cvSocketCallbacks.wait(lock, [&]() {
+    return (m_readingThreadId == std::thread::id() || m_readingThreadId == std::this_thread::get_id())
+           && (m_writingThreadId == std::thread::id() || m_writingThreadId == std::this_thread::get_id());
+  });
 }
 
 //!
-//! process read & write operations when available
+//! idle & read timeouts
 //!
 
-tcp_client::async_read_callback_t
-tcp_client::process_read(read_result& resultRead) {
-  std::lock_guard<std::mutex> lock(m_mtxReadRequests);
-
-  if (m_queReadRequests.empty()) { return nullptr; }
+void
+tcp_client::set_idle_timeout(std::uint32_t uTimeoutMsecs) {
+  m_uIdleTimeoutMsecs_a = uTimeoutMsecs;
+  start_timeout_timer();
+}
 
-  const auto& requestRead   = m_queReadRequests.front();
-  auto callbackRead         = requestRead.callbackAsyncRead;
+std::uint32_t
+tcp_client::get_idle_timeout(void) const {
+  return m_uIdleTimeoutMsecs_a;
+}
 
-  try {
-    resultRead.buffer  = m_tcpSocket.recv(requestRead.nSizeToRead);
-    resultRead.success = true;
-  }
-  catch (const tacopie::tacopie_error&) {
-    resultRead.success = false;
-  }
+void
+tcp_client::set_read_timeout(std::uint32_t uTimeoutMsecs) {
+  m_uReadTimeoutMsecs_a = uTimeoutMsecs;
+  start_timeout_timer();
+}
 
-  m_queReadRequests.pop();
+std::uint32_t
+tcp_client::get_read_timeout(void) const {
+  return m_uReadTimeoutMsecs_a;
+}
 
-  if (m_queReadRequests.empty()) { m_ptrIOService->set_rd_callback(m_tcpSocket, nullptr); }
+void
+tcp_client::reset_timeout_clocks(void) {
+  std::int64_t nNowMsecs = get_current_msecs();
 
-  return callbackRead;
+  m_nLastActivityMsecs_a = nNowMsecs;
+  m_nLastReadMsecs_a     = nNowMsecs;
 }
 
-tcp_client::async_write_callback_t
-tcp_client::process_write(write_result& resultWrite) {
-  std::lock_guard<std::mutex> lock(m_mtxWriteRequests);
+void
+tcp_client::start_timeout_timer(void) {
+  std::lock_guard<std::mutex> lock(m_mtxTimeout);
 
-  if (m_queWriteRequests.empty()) { return nullptr; }
+  if (!is_connected()) { return; }
 
-  const auto& requestWrite = m_queWriteRequests.front();
-  auto callbackWrite       = requestWrite.callbackAsyncWrite;
+  //! the check being executed reschedules itself according to the new timeouts
+  if (m_uTimeoutTimerId && !m_ptrIOService->cancel_timer(m_uTimeoutTimerId)) { return; }
 
-  try {
-    resultWrite.size    = m_tcpSocket.send(requestWrite.vctBuffer, requestWrite.vctBuffer.size());
-    resultWrite.success = true;
-  }
-  catch (const tacopie::tacopie_error&) {
-    resultWrite.success = false;
-  }
+  m_uTimeoutTimerId = 0;
 
-  m_queWriteRequests.pop();
+  std::uint32_t uIdleTimeoutMsecs = m_uIdleTimeoutMsecs_a;
+  std::uint32_t uReadTimeoutMsecs = m_uReadTimeoutMsecs_a;
 
-  if (m_queWriteRequests.empty()) { m_ptrIOService->set_wr_callback(m_tcpSocket, nullptr); }
+  if (!uIdleTimeoutMsecs && !uReadTimeoutMsecs) { return; }
 
-  return callbackWrite;
+  //! first check after the shortest timeout, the check computes the actual deadlines
+  std::uint32_t uDelayMsecs = uIdleTimeoutMsecs && uReadTimeoutMsecs ? std::min(uIdleTimeoutMsecs, uReadTimeoutMsecs)
+                                                                     : std::max(uIdleTimeoutMsecs, uReadTimeoutMsecs);
+
+  m_uTimeoutTimerId = m_ptrIOService->schedule_after(std::chrono::milliseconds(uDelayMsecs),
+      std::bind(&tcp_client::on_timeout_check, this));
 }
 
-//!
-//! async read & write operations
-//!
+void
+tcp_client::stop_timeout_timer(void) {
+  io_service::timer_id_t uTimeoutTimerId;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mtxTimeout);
+
+    uTimeoutTimerId   = m_uTimeoutTimerId;
+    m_uTimeoutTimerId = 0;
+  }
+
+  //! outside of the lock: the check being executed might be waiting for it
+  m_ptrIOService->cancel_timer(uTimeoutTimerId, true);
+}
 
 void
-tcp_client::async_read(const read_request& requestRead) {
-  std::lock_guard<std::mutex> lock(m_mtxReadRequests);
+tcp_client::wait_for_expired_timeout_check(void) {
+  io_service::timer_id_t uExpiredTimeoutTimerId;
 
-  if (is_connected()) {
-    m_ptrIOService->set_rd_callback(m_tcpSocket,
-        std::bind(&tcp_client::on_read_available, this, std::placeholders::_1));
-    m_queReadRequests.push(requestRead);
-  } else {
-    __TACOPIE_THROW(warn, "tcp_client is disconnected");
+  {
+    std::lock_guard<std::mutex> lock(m_mtxTimeout);
+    uExpiredTimeoutTimerId = m_uExpiredTimeoutTimerId;
   }
+
+  m_ptrIOService->cancel_timer(uExpiredTimeoutTimerId, true);
 }
 
 void
-tcp_client::async_write(const write_request& requestWrite) {
-  std::lock_guard<std::mutex> lock(m_mtxWriteRequests);
+tcp_client::on_timeout_check(void) {
+  bool bIsReadPending;
 
-  if (is_connected()) {
-    m_ptrIOService->set_wr_callback(m_tcpSocket,
-        std::bind(&tcp_client::on_write_available, this, std::placeholders::_1));
-    m_queWriteRequests.push(requestWrite);
-  } else {
-    __TACOPIE_THROW(warn, "tcp_client is disconnected");
+  {
+    std::lock_guard<std::mutex> lock(m_mtxReadRequests);
+    bIsReadPending = !m_bReadPaused_a && (m_bContinuousRead_a || !m_queReadRequests.empty());
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mtxTimeout);
+
+    //! disconnected in the meantime
+    if (!m_uTimeoutTimerId || !is_connected()) { return; }
+
+    std::int64_t nNowMsecs          = get_current_msecs();
+    std::int64_t nNextCheckMsecs    = std::numeric_limits<std::int64_t>::max();
+    std::uint32_t uIdleTimeoutMsecs = m_uIdleTimeoutMsecs_a;
+    std::uint32_t uReadTimeoutMsecs = m_uReadTimeoutMsecs_a;
+    bool bTimedOut                  = false;
+
+    if (uIdleTimeoutMsecs) {
+      std::int64_t nDeadlineMsecs = m_nLastActivityMsecs_a + uIdleTimeoutMsecs;
+
+      bTimedOut       = bTimedOut || nNowMsecs >= nDeadlineMsecs;
+      nNextCheckMsecs = std::min(nNextCheckMsecs, nDeadlineMsecs);
+    }
+
+    if (uReadTimeoutMsecs) {
+      //! no read pending: check again later, the read clock is reset once a read becomes pending
+      std::int64_t nDeadlineMsecs = bIsReadPending ? m_nLastReadMsecs_a + uReadTimeoutMsecs : nNowMsecs + uReadTimeoutMsecs;
+
+      bTimedOut       = bTimedOut || nNowMsecs >= nDeadlineMsecs;
+      nNextCheckMsecs = std::min(nNextCheckMsecs, nDeadlineMsecs);
+    }
+
+    //! timeouts disabled in the meantime
+    if (nNextCheckMsecs == std::numeric_limits<std::int64_t>::max()) {
+      m_uTimeoutTimerId = 0;
+      return;
+    }
+
+    //! on expiry the handle of this timer is kept, so that disconnect() waits for this check to complete
+    if (!bTimedOut) {
+      m_uTimeoutTimerId = m_ptrIOService->schedule_after(std::chrono::milliseconds(nNextCheckMsecs - nNowMsecs),
+          std::bind(&tcp_client::on_timeout_check, this));
+      return;
+    }
+
+    //! the client can be destroyed as soon as it is disconnected: its destruction waits for this check to complete
+    m_uExpiredTimeoutTimerId = m_uTimeoutTimerId;
   }
+
+  __TACOPIE_LOG(warn, "tcp_client timed out");
+  disconnect();
+  call_disconnection_handler();
 }
 
 //!
-//! socket getter
+//! Clear pending requests
 //!
+void
+tcp_client::clear_read_requests(void) {
+  std::shared_ptr<splice_relay> ptrSpliceRelay;
 
-tacopie::tcp_socket&
-tcp_client::get_socket(void) {
-  return m_tcpSocket;
+  {
+    std::lock_guard<std::mutex> lock(m_mtxReadRequests);
+
+    std::queue<read_request> empty;
+    std::swap(m_queReadRequests, empty);
+
+    m_bContinuousRead_a = false;
+    m_bReadPaused_a     = false;
+    m_ptrContinuousReadCallback.reset();
+    m_ptrFramedRead.reset();
+    utils::buffer_pool::get_instance().release(std::move(m_vctReceiveBuffer));
+    std::swap(ptrSpliceRelay, m_ptrSpliceRelay);
+  }
+
+  //! the relay is locked after the read requests: see stop_splice_source
+  detach_splice_source(ptrSpliceRelay);
 }
 
-const tacopie::tcp_socket&
-tcp_client::get_socket(void) const {
-  return m_tcpSocket;
+void
+tcp_client::clear_write_requests(void) {
+  std::shared_ptr<tcp_client> ptrPairedClient;
+  watermark_handler_t handlerFlush;
+  watermark_handler_t handlerServerFlush;
+  std::deque<write_request> queDroppedRequests;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mtxWriteRequests);
+
+    if (!m_queWriteRequests.empty()) {
+      handlerFlush       = m_handlerFlush;
+      handlerServerFlush = m_handlerServerFlush;
+    }
+
+    for (auto& requestWrite : m_queWriteRequests) {
+      if (requestWrite.ptrSpliceRelay) { abort_splice(*requestWrite.ptrSpliceRelay); }
+    }
+
+    std::swap(m_queWriteRequests, queDroppedRequests);
+    m_uWriteOffset            = 0;
+    m_uPendingWriteBytes_a    = 0;
+    m_uPendingWriteRequests_a = 0;
+
+    //! nothing will be written anymore: do not keep the paired client paused
+    if (m_bAboveHighWatermark_a) {
+      m_bAboveHighWatermark_a = false;
+      ptrPairedClient         = m_ptrPairedClient.lock();
+      if (ptrPairedClient) { ptrPairedClient->resume_read(); }
+    }
+  }
+
+  //! the dropped requests are completed as failed, so that their callers are not left waiting for them
+  for (auto& requestWrite : queDroppedRequests) {
+    if (requestWrite.callbackAsyncWrite) {
+      write_result resultWrite = {false, 0};
+      requestWrite.callbackAsyncWrite(resultWrite);
+    }
+  }
+
+  if (handlerFlush) { handlerFlush(); }
+  if (handlerServerFlush) { handlerServerFlush(); }
 }
 
 //!
-//! io_service getter
+//! Call disconnection handler
 //!
-const std::shared_ptr<tacopie::io_service>&
-tcp_client::get_io_service(void) const {
-  return m_ptrIOService;
+void
+tcp_client::call_disconnection_handler(void) {
+  //! the handler may release the last reference to the client (tcp_server does for the clients it manages)
+  auto handlerDisconnection = m_handlerDisconnection;
+  if (handlerDisconnection) {
+    handlerDisconnection();
+  }
 }
 
 //!
-//! set on disconnection handler
+//! io service read callback
 //!
 
 void
-tcp_client::set_on_disconnection_handler(const disconnection_handler_t& handlerDisconnection) {
-  m_handlerDisconnection = handlerDisconnection;
+tcp_client::on_read_available(fd_t) {
+  __TACOPIE_LOG_RATE_LIMITED(info, "read available");
+
+  bool bDestroyed = false;
+
+  //! the read callbacks may destroy the client: their captures are released before the end of the tracking
+  begin_socket_callback(true, bDestroyed);
+  process_read_available(bDestroyed);
+  if (!bDestroyed) { end_socket_callback(true); }
 }
 
-//!
-//! returns whether the client is currently running or not
-//!
+void
+tcp_client::process_read_available(bool& bDestroyed) {
+  if (m_bContinuousRead_a) {
+    on_continuous_read_available(bDestroyed);
+    return;
+  }
+
+  read_result resultRead;
+  auto callbackRead = process_read(resultRead);
+
+  if (!resultRead.success) {
+    __TACOPIE_LOG(warn, "read operation failure");
+    disconnect();
+  }
+
+  if (callbackRead) { callbackRead(resultRead); }
+
+  utils::buffer_pool::get_instance().release(std::move(resultRead.buffer));
+
+  if (!resultRead.success && !bDestroyed) { call_disconnection_handler(); }
+}
+
+void
+tcp_client::on_continuous_read_available(bool& bDestroyed) {
+  read_result resultRead;
+  std::shared_ptr<framed_read> ptrFramedRead;
+  auto ptrCallback = process_continuous_read(resultRead, ptrFramedRead);
+
+  if (ptrFramedRead) {
+    deliver_frames(*ptrFramedRead, resultRead.success, bDestroyed);
+    return;
+  }
+
+  if (!ptrCallback) { return; }
+
+  //! deliver the bytes read before a failure first
+  if (resultRead.size) {
+    bool bSuccess      = resultRead.success;
+    resultRead.success = true;
+    (*ptrCallback)(resultRead);
+    resultRead.success = bSuccess;
+
+    if (bDestroyed) {
+      utils::buffer_pool::get_instance().release(std::move(resultRead.buffer));
+      return;
+    }
+
+    //! keep the receive buffer for the next read, unless the callback moved it out
+    std::unique_lock<std::mutex> lock(m_mtxReadRequests);
+    if (m_bContinuousRead_a && m_vctReceiveBuffer.capacity() == 0) {
+      m_vctReceiveBuffer = std::move(resultRead.buffer);
+    }
+    lock.unlock();
+
+    utils::buffer_pool::get_instance().release(std::move(resultRead.buffer));
+    resultRead.size = 0;
+  }
+
+  if (!resultRead.success) {
+    __TACOPIE_LOG(warn, "read operation failure");
+    disconnect();
+    (*ptrCallback)(resultRead);
+    if (!bDestroyed) { call_disconnection_handler(); }
+  }
+}
+
+void
+tcp_client::deliver_frames(framed_read& framedRead, bool bSuccess, bool& bDestroyed) {
+  frames_result resultFrames;
+  resultFrames.success = true;
+
+  //! reuse the frames storage of the previous reads
+  std::swap(resultFrames.frames, framedRead.vctFrames);
+
+  bool bValid = framedRead.codec.decode(resultFrames.frames);
+
+  if (!resultFrames.frames.empty()) { framedRead.callbackFrames(resultFrames); }
+
+  framedRead.codec.consume();
+  resultFrames.frames.clear();
+  std::swap(resultFrames.frames, framedRead.vctFrames);
+
+  if (bDestroyed) { return; }
+
+  if (!bValid) {
+    __TACOPIE_LOG(warn, "invalid frame received");
+  } else if (!bSuccess) {
+    __TACOPIE_LOG(warn, "read operation failure");
+  }
+
+  if (!bValid || !bSuccess) {
+    disconnect();
+    resultFrames.success = false;
+    framedRead.callbackFrames(resultFrames);
+    if (!bDestroyed) { call_disconnection_handler(); }
+  }
+}
+
+//!
+//! io service write callback
+//!
+
+void
+tcp_client::on_write_available(fd_t) {
+  __TACOPIE_LOG_RATE_LIMITED(info, "write available");
+
+  bool bDestroyed = false;
+
+  //! the write callbacks may destroy the client: their captures are released before the end of the tracking
+  begin_socket_callback(false, bDestroyed);
+  process_write_available(bDestroyed);
+  if (!bDestroyed) { end_socket_callback(false); }
+}
+
+void
+tcp_client::process_write_available(bool& bDestroyed) {
+  //! the completions storage is reused across writes, but must not belong to the client while callbacks may destroy it
+  std::vector<write_completion> vctCompletions;
+  std::swap(vctCompletions, m_vctWriteCompletions);
+
+  watermark_handler_t handlerFlush;
+  watermark_handler_t handlerServerFlush;
+  bool bDrained = process_write(vctCompletions, handlerFlush, handlerServerFlush);
+
+  //! a failure can only be the last completion
+  bool bSuccess = vctCompletions.empty() || vctCompletions.back().resultWrite.success;
+
+  if (!bSuccess) {
+    __TACOPIE_LOG(warn, "write operation failure");
+    disconnect();
+  }
+
+  for (auto& completion : vctCompletions) {
+    if (completion.callbackAsyncWrite && !bDestroyed) { completion.callbackAsyncWrite(completion.resultWrite); }
+    utils::buffer_pool::get_instance().release(std::move(completion.vctBuffer));
+  }
+  vctCompletions.clear();
+
+  //! only owned by this call: safe even if the client has been destroyed
+  if (handlerFlush) { handlerFlush(); }
+  if (handlerServerFlush) { handlerServerFlush(); }
+
+  if (bDestroyed) { return; }
+
+  std::swap(vctCompletions, m_vctWriteCompletions);
+
+  if (bDrained) { on_drain(); }
+
+  if (!bSuccess) { call_disconnection_handler(); }
+}
+
+//!
+//! process read & write operations when available
+//!
+
+tcp_client::async_read_callback_t
+tcp_client::process_read(read_result& resultRead) {
+  std::lock_guard<std::mutex> lock(m_mtxReadRequests);
+
+  resultRead.success = true;
+  resultRead.size    = 0;
+
+  if (m_queReadRequests.empty()) { return nullptr; }
+
+  auto& requestRead = m_queReadRequests.front();
+
+  try {
+    if (requestRead.pBuffer) {
+      resultRead.size = receive(requestRead.pBuffer, requestRead.nSizeToRead);
+    } else {
+      resultRead.buffer = utils::buffer_pool::get_instance().acquire(requestRead.nSizeToRead);
+      resultRead.size   = receive(resultRead.buffer.data(), requestRead.nSizeToRead);
+      resultRead.buffer.resize(resultRead.size);
+    }
+    resultRead.success = true;
+
+#ifdef __TACOPIE_METRICS_ENABLED
+    add_statistic(m_uBytesRead_a, resultRead.size);
+#endif /* __TACOPIE_METRICS_ENABLED */
+  }
+  catch (const tacopie::tacopie_error&) {
+    resultRead.success = false;
+    resultRead.size    = 0;
+    resultRead.buffer.clear();
+  }
+
+  if (resultRead.size) {
+    m_nLastReadMsecs_a     = get_current_msecs();
+    m_nLastActivityMsecs_a = m_nLastReadMsecs_a.load();
+  }
+
+  //! non-blocking socket without data available: keep the request for the next read event
+  if (resultRead.success && !resultRead.size && requestRead.nSizeToRead) { return nullptr; }
+
+  auto callbackRead = std::move(requestRead.callbackAsyncRead);
+  m_queReadRequests.pop();
+
+  if (m_queReadRequests.empty()) { m_ptrIOService->set_rd_callback(m_tcpSocket, nullptr); }
+
+  return callbackRead;
+}
+
+std::size_t
+tcp_client::receive(char* pBuffer, std::size_t uSizeToRead) {
+  std::size_t uReadSize;
+
+  //! the bytes received by the io_service come first, even once completion based receive has been disabled
+  if (m_bRecvCompletions_a && m_ptrIOService->take_received(m_tcpSocket, pBuffer, uSizeToRead, uReadSize)) {
+    return uReadSize;
+  }
+
+  uReadSize = m_tcpSocket.recv(pBuffer, uSizeToRead);
+
+#ifdef __TACOPIE_METRICS_ENABLED
+  add_statistic(m_uReadSyscalls_a, 1);
+#endif /* __TACOPIE_METRICS_ENABLED */
+
+  return uReadSize;
+}
+
+std::shared_ptr<tcp_client::async_read_callback_t>
+tcp_client::process_continuous_read(read_result& resultRead, std::shared_ptr<framed_read>& ptrFramedRead) {
+  std::lock_guard<std::mutex> lock(m_mtxReadRequests);
+
+  if (!m_ptrContinuousReadCallback && !m_ptrFramedRead) { return nullptr; }
+
+  ptrFramedRead         = m_ptrFramedRead;
+  std::size_t uReadSize = 0;
+
+  try {
+    while (uReadSize < __TACOPIE_CONTINUOUS_READ_MAX_SIZE) {
+      char* pBuffer;
+      std::size_t uBufferSize;
+
+      if (ptrFramedRead) {
+        //! framed read mode: read in place, after the incomplete frame of the previous reads
+        pBuffer     = ptrFramedRead->codec.prepare(m_uContinuousReadSize);
+        uBufferSize = ptrFramedRead->codec.get_writable_size();
+      } else {
+        if (m_vctReceiveBuffer.capacity() == 0) {
+          m_vctReceiveBuffer = utils::buffer_pool::get_instance().acquire(m_uContinuousReadSize);
+        } else if (m_vctReceiveBuffer.size() - uReadSize < m_uContinuousReadSize) {
+          m_vctReceiveBuffer.resize(uReadSize + m_uContinuousReadSize);
+        }
+
+        pBuffer     = m_vctReceiveBuffer.data() + uReadSize;
+        uBufferSize = m_vctReceiveBuffer.size() - uReadSize;
+      }
+
+      std::size_t uSize = receive(pBuffer, uBufferSize);
+
+#ifdef __TACOPIE_METRICS_ENABLED
+      add_statistic(m_uBytesRead_a, uSize);
+#endif /* __TACOPIE_METRICS_ENABLED */
+
+      //! drained
+      if (!uSize) { break; }
+
+      if (ptrFramedRead) { ptrFramedRead->codec.commit(uSize); }
+
+      uReadSize += uSize;
+    }
+    resultRead.success = true;
+  }
+  catch (const tacopie::tacopie_error&) {
+    resultRead.success = false;
+  }
+
+  resultRead.size = uReadSize;
+  if (uReadSize) {
+    m_nLastReadMsecs_a     = get_current_msecs();
+    m_nLastActivityMsecs_a = m_nLastReadMsecs_a.load();
+  }
+
+  if (uReadSize && !ptrFramedRead) {
+    m_vctReceiveBuffer.resize(uReadSize);
+    resultRead.buffer = std::move(m_vctReceiveBuffer);
+  }
+
+  return m_ptrContinuousReadCallback;
+}
+
+bool
+tcp_client::process_write(std::vector<write_completion>& vctCompletions, watermark_handler_t& handlerFlush,
+    watermark_handler_t& handlerServerFlush) {
+  std::lock_guard<std::mutex> lock(m_mtxWriteRequests);
+
+  if (m_queWriteRequests.empty()) { return false; }
+
+  __TACOPIE_METRIC_RECORD(write_queue_length, m_queWriteRequests.size())
+
+  try {
+    if (m_queWriteRequests.front().ptrSpliceRelay) {
+      process_splice_write(vctCompletions);
+    } else {
+      std::size_t uWriteSize   = 0;
+      const auto& requestFront = m_queWriteRequests.front();
+
+      if (m_bWriteCoalescing_a && m_queWriteRequests.size() > 1 && !requestFront.is_zero_copy()) {
+        tcp_socket::io_buffer arrBuffers[__TACOPIE_MAX_IO_BUFFERS];
+        std::size_t uNbBuffers = 0;
+
+        //! files and relays are not gathered: they are sent by their own system calls
+        for (auto it = m_queWriteRequests.begin(); it != m_queWriteRequests.end() && uNbBuffers < __TACOPIE_MAX_IO_BUFFERS && !it->is_zero_copy(); ++it) {
+          std::size_t uOffset = uNbBuffers ? 0 : m_uWriteOffset;
+
+          arrBuffers[uNbBuffers].pData = it->data() + uOffset;
+          arrBuffers[uNbBuffers].uSize = it->size() - uOffset;
+          ++uNbBuffers;
+        }
+
+        uWriteSize = m_tcpSocket.sendv(arrBuffers, uNbBuffers);
+      } else if (requestFront.bFromFile) {
+        std::size_t uSize = std::min<std::size_t>(requestFront.size() - m_uWriteOffset, __TACOPIE_SENDFILE_MAX_SIZE);
+
+        uWriteSize = m_tcpSocket.sendfile(requestFront.hFile, requestFront.uFileOffset + m_uWriteOffset, uSize);
+      } else {
+        uWriteSize = m_tcpSocket.send(requestFront.data() + m_uWriteOffset, requestFront.size() - m_uWriteOffset);
+      }
+
+      if (uWriteSize) { m_nLastActivityMsecs_a = get_current_msecs(); }
+
+#ifdef __TACOPIE_METRICS_ENABLED
+      add_statistic(m_uWriteSyscalls_a, 1);
+      add_statistic(m_uBytesWritten_a, uWriteSize);
+#endif /* __TACOPIE_METRICS_ENABLED */
+
+      //! complete the requests that have been fully written, keep track of the progress of the others
+      m_uWriteOffset += uWriteSize;
+      m_uPendingWriteBytes_a -= uWriteSize;
+
+      while (!m_queWriteRequests.empty() && !m_queWriteRequests.front().ptrSpliceRelay
+             && m_uWriteOffset >= m_queWriteRequests.front().size()) {
+        auto& requestWrite = m_queWriteRequests.front();
+
+        m_uWriteOffset -= requestWrite.size();
+        vctCompletions.push_back({std::move(requestWrite.callbackAsyncWrite), {true, requestWrite.size()}, std::move(requestWrite.vctBuffer)});
+        m_queWriteRequests.pop_front();
+        --m_uPendingWriteRequests_a;
+      }
+    }
+  }
+  catch (const tacopie::tacopie_error&) {
+    auto& requestWrite = m_queWriteRequests.front();
+
+    if (requestWrite.ptrSpliceRelay) { abort_splice(*requestWrite.ptrSpliceRelay); }
+
+    m_uPendingWriteBytes_a -= requestWrite.size() - m_uWriteOffset;
+    vctCompletions.push_back({std::move(requestWrite.callbackAsyncWrite), {false, 0}, std::move(requestWrite.vctBuffer)});
+    m_queWriteRequests.pop_front();
+    --m_uPendingWriteRequests_a;
+    m_uWriteOffset = 0;
+  }
+
+  if (m_queWriteRequests.empty()) {
+    m_ptrIOService->set_wr_callback(m_tcpSocket, nullptr);
+    handlerFlush       = m_handlerFlush;
+    handlerServerFlush = m_handlerServerFlush;
+  }
+
+  return update_low_watermark();
+}
+
+//!
+//! async read & write operations
+//!
+
+void
+tcp_client::async_read(read_request&& requestRead) {
+  std::lock_guard<std::mutex> lock(m_mtxReadRequests);
+
+  if (m_bContinuousRead_a) { __TACOPIE_THROW(warn, "tcp_client is in continuous read mode"); }
+
+  if (m_ptrSpliceRelay) { __TACOPIE_THROW(warn, "tcp_client is the source of a splice relay"); }
+
+  if (is_connected()) {
+    if (!m_bReadPaused_a) {
+      m_ptrIOService->set_rd_callback(m_tcpSocket, [this](fd_t fd) { on_read_available(fd); });
+    }
+
+    //! the read timeout starts when reading becomes pending
+    if (m_queReadRequests.empty()) { m_nLastReadMsecs_a = get_current_msecs(); }
+
+    m_queReadRequests.push(std::move(requestRead));
+  } else {
+    __TACOPIE_THROW(warn, "tcp_client is disconnected");
+  }
+}
+
+void
+tcp_client::async_write(write_request&& requestWrite) {
+  std::unique_lock<std::mutex> lock(m_mtxWriteRequests);
+
+  if (!is_connected()) { __TACOPIE_THROW(warn, "tcp_client is disconnected"); }
+
+  std::size_t uSize = requestWrite.size();
+
+  if (m_uMaxPendingWriteBytes && m_uPendingWriteBytes_a && m_uPendingWriteBytes_a + uSize > m_uMaxPendingWriteBytes) {
+    __TACOPIE_THROW(warn, "tcp_client write queue is full");
+  }
+
+  m_ptrIOService->set_wr_callback(m_tcpSocket, [this](fd_t fd) { on_write_available(fd); });
+  m_queWriteRequests.push_back(std::move(requestWrite));
+  m_uPendingWriteBytes_a += uSize;
+  ++m_uPendingWriteRequests_a;
+
+  bool bHighWatermark = update_high_watermark();
+  lock.unlock();
+
+  if (bHighWatermark) { on_high_watermark(); }
+}
+
+void
+tcp_client::async_sendfile(file_handle_t hFile, std::uint64_t uOffset, std::size_t uSize, async_write_callback_t callback) {
+  write_request requestWrite(nullptr, 0, std::move(callback));
+
+  requestWrite.bFromFile   = true;
+  requestWrite.hFile       = hFile;
+  requestWrite.uFileOffset = uOffset;
+  requestWrite.uFileSize   = uSize;
+
+  async_write(std::move(requestWrite));
+}
+
+//!
+//! splice relay
+//! lock order: write requests of the target, then relay, then read requests of the source
+//!
+
+void
+tcp_client::async_splice(tcp_client& source, std::size_t uSize, async_write_callback_t callback) {
+  if (&source == this) { __TACOPIE_THROW(warn, "tcp_client can not relay its own bytes"); }
+
+  auto ptrRelay = std::make_shared<splice_relay>(source, *this, uSize);
+
+  {
+    std::lock_guard<std::mutex> lock(source.m_mtxReadRequests);
+
+    if (!source.is_connected()) { __TACOPIE_THROW(warn, "source tcp_client is disconnected"); }
+
+    if (!source.m_queReadRequests.empty() || source.m_bContinuousRead_a || source.m_ptrSpliceRelay) {
+      __TACOPIE_THROW(warn, "source tcp_client is already being read");
+    }
+
+    //! the bytes the io_service may still hold for the source would be skipped by the relay
+    if (source.m_bRecvCompletions_a) { __TACOPIE_THROW(warn, "source tcp_client is read by the io_service"); }
+
+    source.m_ptrSpliceRelay = ptrRelay;
+  }
+
+  write_request requestWrite(nullptr, 0, std::move(callback));
+  requestWrite.ptrSpliceRelay = ptrRelay;
+
+  try {
+    async_write(std::move(requestWrite));
+  }
+  catch (const tacopie::tacopie_error&) {
+    abort_splice(*ptrRelay);
+    throw;
+  }
+
+  //! the source might have been disconnected meanwhile
+  std::lock_guard<std::mutex> lock(ptrRelay->mtx);
+
+  if (!ptrRelay->bSourceDone) {
+    source.m_ptrIOService->set_rd_callback(source.m_tcpSocket, [ptrRelay](fd_t) { on_splice_source_readable(ptrRelay); });
+  }
+}
+
+void
+tcp_client::on_splice_source_readable(const std::shared_ptr<splice_relay>& ptrRelay) {
+  auto& relay = *ptrRelay;
+  std::unique_lock<std::mutex> lock(relay.mtx);
+
+  if (relay.bSourceDone) { return; }
+
+  std::size_t uSize = std::min(relay.uPipeCapacity - relay.uPipeBytes, relay.uRemainingBytes);
+  lock.unlock();
+
+  //! the source can not be destroyed while its read callback is executed
+  tcp_client& source = *relay.pSource;
+  std::size_t uReadSize = 0;
+  bool bEndOfStream     = false;
+  bool bFailed          = false;
+
+  try {
+    if (uSize) { uReadSize = source.m_tcpSocket.splice_to_pipe(static_cast<fd_t>(relay.arrPipe[1]), uSize, bEndOfStream); }
+  }
+  catch (const tacopie::tacopie_error&) {
+    bFailed = true;
+  }
+
+  if (uReadSize) {
+    source.m_nLastReadMsecs_a     = get_current_msecs();
+    source.m_nLastActivityMsecs_a = source.m_nLastReadMsecs_a.load();
+
+#ifdef __TACOPIE_METRICS_ENABLED
+    std::lock_guard<std::mutex> lockRead(source.m_mtxReadRequests);
+    add_statistic(source.m_uReadSyscalls_a, 1);
+    add_statistic(source.m_uBytesRead_a, uReadSize);
+#endif /* __TACOPIE_METRICS_ENABLED */
+  }
+
+  lock.lock();
+
+  relay.uPipeBytes += uReadSize;
+  relay.uRemainingBytes -= uReadSize;
+
+  if (relay.bSourceDone) { return; }
+
+  if (bFailed || bEndOfStream || !relay.uRemainingBytes) {
+    __TACOPIE_LOG(info, bFailed ? "splice source read failure" : "splice source done");
+    relay.bFailed = bFailed;
+    stop_splice_source(relay);
+  } else if (relay.uPipeBytes && (!uReadSize || relay.uPipeBytes == relay.uPipeCapacity)) {
+    //! pipe full: stop reading until the target drains it
+    relay.bSourcePaused = true;
+    source.m_ptrIOService->set_rd_callback(source.m_tcpSocket, nullptr);
+  }
+
+  if (uReadSize || relay.bSourceDone) { wakeup_splice_target(relay); }
+}
+
+void
+tcp_client::process_splice_write(std::vector<write_completion>& vctCompletions) {
+  auto& requestWrite = m_queWriteRequests.front();
+  auto ptrRelay      = requestWrite.ptrSpliceRelay;
+  auto& relay        = *ptrRelay;
+
+  std::unique_lock<std::mutex> lock(relay.mtx);
+  std::size_t uSize = relay.uPipeBytes;
+  lock.unlock();
+
+  std::size_t uWriteSize = uSize ? m_tcpSocket.splice_from_pipe(static_cast<fd_t>(relay.arrPipe[0]), uSize) : 0;
+
+  if (uWriteSize) {
+    m_nLastActivityMsecs_a = get_current_msecs();
+
+#ifdef __TACOPIE_METRICS_ENABLED
+    add_statistic(m_uWriteSyscalls_a, 1);
+    add_statistic(m_uBytesWritten_a, uWriteSize);
+#endif /* __TACOPIE_METRICS_ENABLED */
+  }
+
+  lock.lock();
+
+  relay.uPipeBytes -= uWriteSize;
+  relay.uWrittenBytes += uWriteSize;
+
+  //! room has been made in the pipe: read the source again
+  if (relay.bSourcePaused && uWriteSize && !relay.bSourceDone) {
+    relay.bSourcePaused = false;
+    relay.pSource->m_ptrIOService->set_rd_callback(relay.pSource->m_tcpSocket, [ptrRelay](fd_t) { on_splice_source_readable(ptrRelay); });
+  }
+
+  if (relay.uPipeBytes) { return; }
+
+  if (!relay.bSourceDone) {
+    //! pipe drained: wait for the source to provide more bytes (see wakeup_splice_target)
+    m_ptrIOService->set_wr_callback(m_tcpSocket, nullptr);
+    return;
+  }
+
+  relay.bTargetGone = true;
+  vctCompletions.push_back({std::move(requestWrite.callbackAsyncWrite), {!relay.bFailed, relay.uWrittenBytes}, {}});
+  lock.unlock();
+
+  m_queWriteRequests.pop_front();
+  --m_uPendingWriteRequests_a;
+}
+
+void
+tcp_client::wakeup_splice_target(splice_relay& relay) {
+  if (relay.bTargetGone) { return; }
+
+  tcp_client* pTarget = relay.pTarget;
+  pTarget->m_ptrIOService->set_wr_callback(pTarget->m_tcpSocket, [pTarget](fd_t fd) { pTarget->on_write_available(fd); });
+}
+
+void
+tcp_client::stop_splice_source(splice_relay& relay) {
+  relay.bSourceDone = true;
+
+  if (relay.bSourceGone) { return; }
+
+  tcp_client& source = *relay.pSource;
+  std::lock_guard<std::mutex> lock(source.m_mtxReadRequests);
+
+  source.m_ptrSpliceRelay.reset();
+
+  if (source.is_connected()) { source.m_ptrIOService->set_rd_callback(source.m_tcpSocket, nullptr); }
+}
+
+void
+tcp_client::abort_splice(splice_relay& relay) {
+  std::lock_guard<std::mutex> lock(relay.mtx);
+
+  relay.bTargetGone = true;
+
+  if (!relay.bSourceDone) { stop_splice_source(relay); }
+}
+
+void
+tcp_client::detach_splice_source(const std::shared_ptr<splice_relay>& ptrRelay) {
+  if (!ptrRelay) { return; }
+
+  std::lock_guard<std::mutex> lock(ptrRelay->mtx);
+
+  ptrRelay->bSourceGone = true;
+
+  if (ptrRelay->bSourceDone) { return; }
+
+  //! the bytes already in the pipe are still written, but the relay fails
+  ptrRelay->bSourceDone = true;
+  ptrRelay->bFailed     = true;
+  wakeup_splice_target(*ptrRelay);
+}
+
+//!
+//! write queue watermarks
+//!
+
+void
+tcp_client::set_write_watermarks(std::size_t uHighBytes, std::size_t uLowBytes,
+    std::size_t uHighRequests, std::size_t uLowRequests) {
+  if ((uHighBytes && uLowBytes >= uHighBytes) || (uHighRequests && uLowRequests >= uHighRequests)) {
+    __TACOPIE_THROW(error, "low watermark must be lower than high watermark");
+  }
+
+  std::unique_lock<std::mutex> lock(m_mtxWriteRequests);
+
+  m_uHighWatermarkBytes    = uHighBytes;
+  m_uLowWatermarkBytes     = uLowBytes;
+  m_uHighWatermarkRequests = uHighRequests;
+  m_uLowWatermarkRequests  = uLowRequests;
+
+  //! the pending writes might already be on the other side of the new watermarks
+  bool bHighWatermark = update_high_watermark();
+  bool bDrained       = !bHighWatermark && update_low_watermark();
+  lock.unlock();
+
+  if (bHighWatermark) { on_high_watermark(); }
+  if (bDrained) { on_drain(); }
+}
+
+void
+tcp_client::set_max_pending_write_bytes(std::size_t uMaxBytes) {
+  std::lock_guard<std::mutex> lock(m_mtxWriteRequests);
+  m_uMaxPendingWriteBytes = uMaxBytes;
+}
+
+std::size_t
+tcp_client::pending_write_bytes(void) const {
+  return m_uPendingWriteBytes_a;
+}
+
+std::size_t
+tcp_client::pending_write_requests(void) const {
+  return m_uPendingWriteRequests_a;
+}
+
+bool
+tcp_client::is_above_high_watermark(void) const {
+  return m_bAboveHighWatermark_a;
+}
+
+void
+tcp_client::set_on_high_watermark_handler(const watermark_handler_t& handlerHighWatermark) {
+  std::lock_guard<std::mutex> lock(m_mtxWriteRequests);
+  m_handlerHighWatermark = handlerHighWatermark;
+}
+
+void
+tcp_client::set_on_drain_handler(const watermark_handler_t& handlerDrain) {
+  std::lock_guard<std::mutex> lock(m_mtxWriteRequests);
+  m_handlerDrain = handlerDrain;
+}
+
+void
+tcp_client::set_on_flush_handler(const watermark_handler_t& handlerFlush) {
+  std::lock_guard<std::mutex> lock(m_mtxWriteRequests);
+  m_handlerFlush = handlerFlush;
+}
+
+void
+tcp_client::set_on_server_flush_handler(const watermark_handler_t& handlerServerFlush) {
+  std::lock_guard<std::mutex> lock(m_mtxWriteRequests);
+  m_handlerServerFlush = handlerServerFlush;
+}
+
+void
+tcp_client::set_paired_client(const std::shared_ptr<tcp_client>& ptrClient) {
+  std::lock_guard<std::mutex> lock(m_mtxWriteRequests);
+  m_ptrPairedClient = ptrClient;
+}
+
+bool
+tcp_client::update_high_watermark(void) {
+  if (m_bAboveHighWatermark_a) { return false; }
+
+  bool bHighWatermark = (m_uHighWatermarkBytes && m_uPendingWriteBytes_a >= m_uHighWatermarkBytes)
+                        || (m_uHighWatermarkRequests && m_uPendingWriteRequests_a >= m_uHighWatermarkRequests);
+
+  if (bHighWatermark) { m_bAboveHighWatermark_a = true; }
+
+  return bHighWatermark;
+}
+
+bool
+tcp_client::update_low_watermark(void) {
+  if (!m_bAboveHighWatermark_a) { return false; }
+
+  bool bDrained = (!m_uHighWatermarkBytes || m_uPendingWriteBytes_a <= m_uLowWatermarkBytes)
+                  && (!m_uHighWatermarkRequests || m_uPendingWriteRequests_a <= m_uLowWatermarkRequests);
+
+  if (bDrained) { m_bAboveHighWatermark_a = false; }
+
+  return bDrained;
+}
+
+void
+tcp_client::on_high_watermark(void) {
+  std::unique_lock<std::mutex> lock(m_mtxWriteRequests);
+
+  //! drained in the meantime
+  if (!m_bAboveHighWatermark_a) { return; }
+
+  __TACOPIE_LOG(debug, "tcp_client reached its write high watermark");
+
+  //! paused with the lock held, so that it can not be reordered with the resume of a concurrent drain
+  auto ptrPairedClient = m_ptrPairedClient.lock();
+  if (ptrPairedClient) { ptrPairedClient->pause_read(); }
+
+  auto handlerHighWatermark = m_handlerHighWatermark;
+  lock.unlock();
+
+  if (handlerHighWatermark) { handlerHighWatermark(); }
+}
+
+void
+tcp_client::on_drain(void) {
+  std::unique_lock<std::mutex> lock(m_mtxWriteRequests);
+
+  //! went above the high watermark again in the meantime
+  if (m_bAboveHighWatermark_a) { return; }
+
+  __TACOPIE_LOG(debug, "tcp_client write queue drained");
+
+  auto ptrPairedClient = m_ptrPairedClient.lock();
+  if (ptrPairedClient) { ptrPairedClient->resume_read(); }
+
+  auto handlerDrain = m_handlerDrain;
+  lock.unlock();
+
+  if (handlerDrain) { handlerDrain(); }
+}
+
+//!
+//! read pause
+//!
+
+void
+tcp_client::pause_read(void) {
+  std::lock_guard<std::mutex> lock(m_mtxReadRequests);
+
+  if (m_bReadPaused_a) { return; }
+
+  m_bReadPaused_a = true;
+
+  //! the reads of a relay source are driven by the relay
+  if (is_connected() && !m_ptrSpliceRelay) { m_ptrIOService->set_rd_callback(m_tcpSocket, nullptr); }
+}
+
+void
+tcp_client::resume_read(void) {
+  std::lock_guard<std::mutex> lock(m_mtxReadRequests);
+
+  if (!m_bReadPaused_a) { return; }
+
+  m_bReadPaused_a = false;
+
+  //! the read timeout starts over
+  m_nLastReadMsecs_a = get_current_msecs();
+
+  if (is_connected() && (m_bContinuousRead_a || !m_queReadRequests.empty())) {
+    m_ptrIOService->set_rd_callback(m_tcpSocket, [this](fd_t fd) { on_read_available(fd); });
+  }
+}
+
+bool
+tcp_client::is_read_paused(void) const {
+  return m_bReadPaused_a;
+}
+
+//!
+//! I/O statistics
+//!
+
+tcp_client::io_statistics
+tcp_client::get_io_statistics(void) const {
+  return {m_uBytesRead_a, m_uBytesWritten_a, m_uReadSyscalls_a, m_uWriteSyscalls_a};
+}
+
+//!
+//! socket options
+//!
+
+void
+tcp_client::set_socket_options(const socket_options& options) {
+  m_tcpSocket.set_options(options);
+}
+
+const socket_options&
+tcp_client::get_socket_options(void) const {
+  return m_tcpSocket.get_options();
+}
+
+//!
+//! socket getter
+//!
+
+tacopie::tcp_socket&
+tcp_client::get_socket(void) {
+  return m_tcpSocket;
+}
+
+const tacopie::tcp_socket&
+tcp_client::get_socket(void) const {
+  return m_tcpSocket;
+}
+
+//!
+//! io_service getter
+//!
+const std::shared_ptr<tacopie::io_service>&
+tcp_client::get_io_service(void) const {
+  return m_ptrIOService;
+}
+
+//!
+//! callback execution mode
+//!
+void
+tcp_client::set_callback_execution_mode(io_service::callback_execution_mode eMode) {
+  if (!is_connected()) { __TACOPIE_THROW(warn, "tcp_client is disconnected"); }
+
+  m_ptrIOService->set_callback_execution_mode(m_tcpSocket, eMode);
+}
+
+//!
+//! continuous read mode
+//!
+
+void
+tcp_client::start_continuous_read(async_read_callback_t callback, std::size_t uReadSize) {
+  std::lock_guard<std::mutex> lock(m_mtxReadRequests);
+
+  if (!is_connected()) { __TACOPIE_THROW(warn, "tcp_client is disconnected"); }
+
+  if (!m_queReadRequests.empty()) { __TACOPIE_THROW(warn, "tcp_client has pending read requests"); }
+
+  if (m_ptrSpliceRelay) { __TACOPIE_THROW(warn, "tcp_client is the source of a splice relay"); }
+
+  m_tcpSocket.set_non_blocking(true);
+
+  m_uContinuousReadSize       = uReadSize ? uReadSize : __TACOPIE_CONTINUOUS_READ_SIZE;
+  m_ptrContinuousReadCallback = std::make_shared<async_read_callback_t>(std::move(callback));
+  m_ptrFramedRead.reset();
+  m_bContinuousRead_a         = true;
+  m_nLastReadMsecs_a          = get_current_msecs();
+  enable_recv_completions();
+
+  if (!m_bReadPaused_a) {
+    m_ptrIOService->set_rd_callback(m_tcpSocket, [this](fd_t fd) { on_read_available(fd); });
+  }
+}
+
+void
+tcp_client::start_framed_read(frame_codec codec, async_frames_callback_t callback, std::size_t uReadSize) {
+  std::lock_guard<std::mutex> lock(m_mtxReadRequests);
+
+  if (!is_connected()) { __TACOPIE_THROW(warn, "tcp_client is disconnected"); }
+
+  if (!m_queReadRequests.empty()) { __TACOPIE_THROW(warn, "tcp_client has pending read requests"); }
+
+  if (m_ptrSpliceRelay) { __TACOPIE_THROW(warn, "tcp_client is the source of a splice relay"); }
+
+  m_tcpSocket.set_non_blocking(true);
+
+  m_uContinuousReadSize = uReadSize ? uReadSize : __TACOPIE_CONTINUOUS_READ_SIZE;
+  m_ptrContinuousReadCallback.reset();
+  m_ptrFramedRead       = std::make_shared<framed_read>(framed_read{std::move(codec), std::move(callback), {}});
+  m_bContinuousRead_a   = true;
+  m_nLastReadMsecs_a    = get_current_msecs();
+  enable_recv_completions();
+
+  if (!m_bReadPaused_a) {
+    m_ptrIOService->set_rd_callback(m_tcpSocket, [this](fd_t fd) { on_read_available(fd); });
+  }
+}
+
+void
+tcp_client::stop_continuous_read(void) {
+  std::lock_guard<std::mutex> lock(m_mtxReadRequests);
+
+  if (!m_bContinuousRead_a) { return; }
+
+  m_bContinuousRead_a = false;
+  m_ptrContinuousReadCallback.reset();
+  m_ptrFramedRead.reset();
+  utils::buffer_pool::get_instance().release(std::move(m_vctReceiveBuffer));
+
+  if (is_connected()) {
+    if (m_bRecvCompletions_a) { m_ptrIOService->set_recv_completions(m_tcpSocket, false); }
+    m_ptrIOService->set_rd_callback(m_tcpSocket, nullptr);
+    m_tcpSocket.set_non_blocking(false);
+  }
+}
+
+void
+tcp_client::enable_recv_completions(void) {
+  if (!m_ptrIOService->supports_recv_completions()) { return; }
+
+  m_ptrIOService->set_recv_completions(m_tcpSocket, true, m_uContinuousReadSize);
+  m_bRecvCompletions_a = true;
+}
+
+bool
+tcp_client::is_continuous_read_enabled(void) const {
+  return m_bContinuousRead_a;
+}
+
+//!
+//! write coalescing
+//!
+
+void
+tcp_client::set_write_coalescing(bool bEnabled) {
+  m_bWriteCoalescing_a = bEnabled;
+}
+
+bool
+tcp_client::is_write_coalescing_enabled(void) const {
+  return m_bWriteCoalescing_a;
+}
+
+//!
+//! set on disconnection handler
+//!
+
+void
+tcp_client::set_on_disconnection_handler(const disconnection_handler_t& handlerDisconnection) {
+  m_handlerDisconnection = handlerDisconnection;
+}
+
+//!
+//! returns whether the client is currently running or not
+//!
+
+bool
+tcp_client::is_connecting(void) const {
+  return m_bIsConnecting_a;
+}
 
 bool
 tcp_client::is_connected(void) const {
@@ -0,0 +1,426 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <tacopie/network/tcp_client_pool.hpp>
+#include <tacopie/utils/error.hpp>
+#include <tacopie/utils/logger.hpp>
+
+#include <algorithm>
+
+namespace tacopie {
+
+//!
+//! endpoint
+//!
+
+//! index of no slot, terminates the stacks of slots
+static const std::uint32_t s_uNoSlot = 0xFFFFFFFF;
+
+struct tcp_client_pool::endpoint {
+  //!
+  //! connection of the endpoint
+  //! a slot is owned by exactly one party at a time: its stack (idle or broken), a lease, its pending connection or
+  //! the maintenance. the client and the backoff are only accessed by the owner of the slot.
+  //!
+  struct slot {
+    std::unique_ptr<tcp_client>           ptrClient;
+    std::atomic<std::uint32_t>            uNext_a{s_uNoSlot};
+    std::uint32_t                         uBackoffMsecs = 0;
+    std::chrono::steady_clock::time_point timeRetry;
+  };
+
+  //!
+  //! lock-free stack of slots
+  //! the head packs a tag (incremented by each operation, against ABA) in its upper half and a slot index in its lower
+  //! half: nodes are slots of a fixed array, which are never freed while the endpoint exists
+  //!
+  struct slot_stack {
+    std::atomic<std::uint64_t> uHead_a{s_uNoSlot};
+  };
+
+  endpoint(const std::string& sHost_, std::uint32_t uPort_, std::size_t uNbSlots_)
+  : sHost(sHost_)
+  , uPort(uPort_)
+  , arrSlots(new slot[uNbSlots_])
+  , uNbSlots(uNbSlots_) {
+    //! lowest slots first
+    for (std::size_t uSlot = uNbSlots; uSlot > 0; --uSlot) { vctFreeSlots.push_back(static_cast<std::uint32_t>(uSlot - 1)); }
+  }
+
+  void
+  push(slot_stack& stack, std::uint32_t uSlot) {
+    std::uint64_t uHead = stack.uHead_a.load(std::memory_order_relaxed);
+    std::uint64_t uNewHead;
+
+    do {
+      arrSlots[uSlot].uNext_a.store(static_cast<std::uint32_t>(uHead), std::memory_order_relaxed);
+      uNewHead = (((uHead >> 32) + 1) << 32) | uSlot;
+    } while (!stack.uHead_a.compare_exchange_weak(uHead, uNewHead, std::memory_order_release, std::memory_order_relaxed));
+  }
+
+  std::uint32_t
+  pop(slot_stack& stack) {
+    std::uint64_t uHead = stack.uHead_a.load(std::memory_order_acquire);
+
+    while (static_cast<std::uint32_t>(uHead) != s_uNoSlot) {
+      //! the next index might be stale if the head changed in the meantime, in which case the tag makes the CAS fail
+      std::uint32_t uNext    = arrSlots[static_cast<std::uint32_t>(uHead)].uNext_a.load(std::memory_order_relaxed);
+      std::uint64_t uNewHead = (((uHead >> 32) + 1) << 32) | uNext;
+
+      if (stack.uHead_a.compare_exchange_weak(uHead, uNewHead, std::memory_order_acquire, std::memory_order_acquire)) {
+        return static_cast<std::uint32_t>(uHead);
+      }
+    }
+
+    return s_uNoSlot;
+  }
+
+  //!
+  //! address of the endpoint
+  //!
+  std::string                sHost;
+  std::uint32_t              uPort;
+
+  //!
+  //! connections
+  //!
+  std::unique_ptr<slot[]>    arrSlots;
+  std::size_t                uNbSlots;
+
+  //!
+  //! connected clients ready to be leased, and clients to be reconnected
+  //!
+  slot_stack                 stackIdle;
+  slot_stack                 stackBroken;
+
+  //!
+  //! checkouts that found no idle connection since the last maintenance, and connections in progress
+  //!
+  std::atomic<std::size_t>   uNbMisses_a{0};
+  std::atomic<std::size_t>   uNbConnecting_a{0};
+
+  //!
+  //! slots owned by the maintenance: never connected, and waiting for their reconnection
+  //!
+  std::vector<std::uint32_t> vctFreeSlots;
+  std::vector<std::uint32_t> vctBackoffSlots;
+};
+
+//!
+//! lease
+//!
+
+tcp_client_pool::lease::lease(endpoint* pEndpoint, std::uint32_t uSlot)
+: m_pEndpoint(pEndpoint)
+, m_uSlot(uSlot) {}
+
+tcp_client_pool::lease::~lease(void) {
+  release();
+}
+
+tcp_client_pool::lease::lease(lease&& other)
+: m_pEndpoint(other.m_pEndpoint)
+, m_uSlot(other.m_uSlot) {
+  other.m_pEndpoint = nullptr;
+}
+
+tcp_client_pool::lease&
+tcp_client_pool::lease::operator=(lease&& other) {
+  if (this != &other) {
+    release();
+
+    m_pEndpoint       = other.m_pEndpoint;
+    m_uSlot           = other.m_uSlot;
+    other.m_pEndpoint = nullptr;
+  }
+
+  return *this;
+}
+
+tcp_client_pool::lease::operator bool(void) const {
+  return m_pEndpoint != nullptr;
+}
+
+tcp_client&
+tcp_client_pool::lease::operator*(void) const {
+  return *m_pEndpoint->arrSlots[m_uSlot].ptrClient;
+}
+
+tcp_client*
+tcp_client_pool::lease::operator->(void) const {
+  return m_pEndpoint->arrSlots[m_uSlot].ptrClient.get();
+}
+
+void
+tcp_client_pool::lease::release(void) {
+  if (!m_pEndpoint) { return; }
+
+  checkin(m_pEndpoint, m_uSlot);
+  m_pEndpoint = nullptr;
+}
+
+//!
+//! ctor & dtor
+//!
+
+tcp_client_pool::tcp_client_pool(std::size_t uMinSize, std::size_t uMaxSize)
+: m_uMinSize(uMinSize)
+, m_uMaxSize(uMaxSize)
+, m_uConnectTimeoutMsecs_a(1000)
+, m_uHealthCheckIntervalMsecs_a(5000)
+, m_uMinBackoffMsecs_a(100)
+, m_uMaxBackoffMsecs_a(10000)
+, m_uNbEndpoints_a(0)
+, m_rng(std::random_device{}())
+, m_timeLastHealthCheck(std::chrono::steady_clock::now())
+, m_ptrIOService(get_default_io_service()) {
+  if (uMaxSize == 0 || uMinSize > uMaxSize || uMaxSize >= s_uNoSlot) { __TACOPIE_THROW(error, "invalid tcp_client_pool sizes"); }
+
+  __TACOPIE_LOG(debug, "create tcp_client_pool");
+
+  m_vctEndpoints.reserve(__TACOPIE_CLIENT_POOL_MAX_ENDPOINTS);
+  m_uMaintenanceTimerId = m_ptrIOService->schedule_every(
+      std::chrono::milliseconds(__TACOPIE_CLIENT_POOL_MAINTENANCE_PERIOD_MSECS), [this] { on_maintenance(); });
+}
+
+tcp_client_pool::~tcp_client_pool(void) {
+  __TACOPIE_LOG(debug, "destroy tcp_client_pool");
+
+  m_ptrIOService->cancel_timer(m_uMaintenanceTimerId, true);
+
+  std::lock_guard<std::mutex> lock(m_mtxMaintenance);
+
+  //! destroying the clients aborts the pending connections and waits for the callbacks in progress
+  //! the connection callbacks share the ownership of their endpoint, which may hence outlive the pool (without clients)
+  for (const auto& ptrEndpoint : m_vctEndpoints) {
+    for (std::size_t uSlot = 0; uSlot < ptrEndpoint->uNbSlots; ++uSlot) { ptrEndpoint->arrSlots[uSlot].ptrClient.reset(); }
+  }
+}
+
+//!
+//! settings
+//!
+
+void
+tcp_client_pool::set_connect_timeout(std::uint32_t uTimeoutMsecs) {
+  m_uConnectTimeoutMsecs_a = uTimeoutMsecs;
+}
+
+void
+tcp_client_pool::set_health_check_interval(std::uint32_t uIntervalMsecs) {
+  m_uHealthCheckIntervalMsecs_a = uIntervalMsecs;
+}
+
+void
+tcp_client_pool::set_reconnect_backoff(std::uint32_t uMinBackoffMsecs, std::uint32_t uMaxBackoffMsecs) {
+  if (uMinBackoffMsecs == 0 || uMinBackoffMsecs > uMaxBackoffMsecs) { __TACOPIE_THROW(error, "invalid reconnect backoff"); }
+
+  m_uMinBackoffMsecs_a = uMinBackoffMsecs;
+  m_uMaxBackoffMsecs_a = uMaxBackoffMsecs;
+}
+
+//!
+//! endpoints
+//!
+
+void
+tcp_client_pool::add_endpoint(const std::string& sHost, std::uint32_t uPort) {
+  std::lock_guard<std::mutex> lock(m_mtxMaintenance);
+
+  if (find_endpoint(sHost, uPort)) { return; }
+  if (m_vctEndpoints.size() >= __TACOPIE_CLIENT_POOL_MAX_ENDPOINTS) { __TACOPIE_THROW(error, "too many tcp_client_pool endpoints"); }
+
+  //! the storage is reserved: concurrent lookups keep reading the existing elements while this one is appended
+  m_vctEndpoints.push_back(std::make_shared<endpoint>(sHost, uPort, m_uMaxSize));
+  m_uNbEndpoints_a.store(m_vctEndpoints.size(), std::memory_order_release);
+
+  __TACOPIE_LOG(info, "tcp_client_pool endpoint added");
+
+  //! pre-warm the minimum number of connections
+  maintain(m_vctEndpoints.back(), false);
+}
+
+tcp_client_pool::endpoint*
+tcp_client_pool::find_endpoint(const std::string& sHost, std::uint32_t uPort) const {
+  std::size_t uNbEndpoints = m_uNbEndpoints_a.load(std::memory_order_acquire);
+
+  for (std::size_t i = 0; i < uNbEndpoints; ++i) {
+    endpoint* pEndpoint = m_vctEndpoints[i].get();
+
+    if (pEndpoint->uPort == uPort && pEndpoint->sHost == sHost) { return pEndpoint; }
+  }
+
+  return nullptr;
+}
+
+//!
+//! checkout & checkin
+//!
+
+tcp_client_pool::lease
+tcp_client_pool::checkout(const std::string& sHost, std::uint32_t uPort) {
+  endpoint* pEndpoint = find_endpoint(sHost, uPort);
+  if (!pEndpoint) { return lease(); }
+
+  for (;;) {
+    std::uint32_t uSlot = pEndpoint->pop(pEndpoint->stackIdle);
+
+    if (uSlot == s_uNoSlot) {
+      //! the maintenance connects more clients (up to the maximum size)
+      pEndpoint->uNbMisses_a.fetch_add(1, std::memory_order_relaxed);
+      return lease();
+    }
+
+    if (pEndpoint->arrSlots[uSlot].ptrClient->is_connected()) { return lease(pEndpoint, uSlot); }
+
+    //! disconnected while idle
+    pEndpoint->push(pEndpoint->stackBroken, uSlot);
+  }
+}
+
+void
+tcp_client_pool::checkin(endpoint* pEndpoint, std::uint32_t uSlot) {
+  bool bConnected = pEndpoint->arrSlots[uSlot].ptrClient->is_connected();
+
+  pEndpoint->push(bConnected ? pEndpoint->stackIdle : pEndpoint->stackBroken, uSlot);
+}
+
+//!
+//! maintenance
+//!
+
+void
+tcp_client_pool::on_maintenance(void) {
+  //! endpoint being added: skip this period
+  std::unique_lock<std::mutex> lock(m_mtxMaintenance, std::try_to_lock);
+  if (!lock.owns_lock()) { return; }
+
+  auto timeNow              = std::chrono::steady_clock::now();
+  std::uint32_t uIntervalMs = m_uHealthCheckIntervalMsecs_a;
+  bool bHealthCheck         = uIntervalMs > 0 && timeNow - m_timeLastHealthCheck >= std::chrono::milliseconds(uIntervalMs);
+
+  if (bHealthCheck) { m_timeLastHealthCheck = timeNow; }
+
+  for (const auto& ptrEndpoint : m_vctEndpoints) { maintain(ptrEndpoint, bHealthCheck); }
+}
+
+void
+tcp_client_pool::maintain(const std::shared_ptr<endpoint>& ptrEndpoint, bool bHealthCheck) {
+  endpoint& ep = *ptrEndpoint;
+
+  //! failed connections and clients found disconnected
+  for (auto uSlot = ep.pop(ep.stackBroken); uSlot != s_uNoSlot; uSlot = ep.pop(ep.stackBroken)) {
+    schedule_reconnection(ep, uSlot);
+  }
+
+  //! health check of the idle connections (the stack is briefly empty, its order is preserved)
+  if (bHealthCheck) {
+    std::vector<std::uint32_t> vctHealthySlots;
+
+    for (auto uSlot = ep.pop(ep.stackIdle); uSlot != s_uNoSlot; uSlot = ep.pop(ep.stackIdle)) {
+      const auto& ptrClient = ep.arrSlots[uSlot].ptrClient;
+
+      if (ptrClient->is_connected() && !ptrClient->get_socket().is_peer_closed()) {
+        vctHealthySlots.push_back(uSlot);
+      }
+      else {
+        __TACOPIE_LOG(warn, "tcp_client_pool health check failure");
+        schedule_reconnection(ep, uSlot);
+      }
+    }
+
+    for (auto it = vctHealthySlots.rbegin(); it != vctHealthySlots.rend(); ++it) { ep.push(ep.stackIdle, *it); }
+
+    //! checkouts missed because of the health check are not worth growing the pool
+    ep.uNbMisses_a.store(0, std::memory_order_relaxed);
+  }
+
+  //! reconnections whose backoff expired
+  auto timeNow = std::chrono::steady_clock::now();
+  std::vector<std::uint32_t> vctDueSlots;
+
+  auto itDue = std::stable_partition(ep.vctBackoffSlots.begin(), ep.vctBackoffSlots.end(),
+      [&](std::uint32_t uSlot) { return ep.arrSlots[uSlot].timeRetry > timeNow; });
+  vctDueSlots.assign(itDue, ep.vctBackoffSlots.end());
+  ep.vctBackoffSlots.erase(itDue, ep.vctBackoffSlots.end());
+
+  for (auto uSlot : vctDueSlots) { connect(ptrEndpoint, uSlot); }
+
+  //! top up to the minimum size, and grow for the missed checkouts that pending connections will not serve
+  std::size_t uNbUsedSlots  = ep.uNbSlots - ep.vctFreeSlots.size();
+  std::size_t uNbMisses     = ep.uNbMisses_a.exchange(0, std::memory_order_relaxed);
+  std::size_t uNbConnecting = ep.uNbConnecting_a.load(std::memory_order_relaxed);
+  std::size_t uNbNewClients = uNbMisses > uNbConnecting ? uNbMisses - uNbConnecting : 0;
+
+  if (uNbUsedSlots < m_uMinSize) { uNbNewClients = (std::max)(uNbNewClients, m_uMinSize - uNbUsedSlots); }
+
+  while (uNbNewClients-- > 0 && !ep.vctFreeSlots.empty()) {
+    std::uint32_t uSlot = ep.vctFreeSlots.back();
+    ep.vctFreeSlots.pop_back();
+
+    connect(ptrEndpoint, uSlot);
+  }
+}
+
+void
+tcp_client_pool::connect(const std::shared_ptr<endpoint>& ptrEndpoint, std::uint32_t uSlot) {
+  auto& s = ptrEndpoint->arrSlots[uSlot];
+
+  //! a new client for each connection: the previous one (if any) is destroyed here, outside of its callbacks
+  s.ptrClient.reset(new tcp_client);
+  ++ptrEndpoint->uNbConnecting_a;
+
+  try {
+    //! the callback owns the slot until it gives it to one of the stacks
+    s.ptrClient->async_connect(ptrEndpoint->sHost, ptrEndpoint->uPort, m_uConnectTimeoutMsecs_a,
+        [ptrEndpoint, uSlot](bool bSuccess) {
+          if (bSuccess) { ptrEndpoint->arrSlots[uSlot].uBackoffMsecs = 0; }
+
+          --ptrEndpoint->uNbConnecting_a;
+          ptrEndpoint->push(bSuccess ? ptrEndpoint->stackIdle : ptrEndpoint->stackBroken, uSlot);
+        });
+  }
+  catch (const tacopie_error&) {
+    //! resolution or socket failure
+    --ptrEndpoint->uNbConnecting_a;
+    schedule_reconnection(*ptrEndpoint, uSlot);
+  }
+}
+
+void
+tcp_client_pool::schedule_reconnection(endpoint& ep, std::uint32_t uSlot) {
+  auto& s = ep.arrSlots[uSlot];
+
+  //! immediate first attempt, then exponential backoff
+  std::uint64_t uDelayMsecs = s.uBackoffMsecs;
+  std::uint64_t uMinMsecs   = m_uMinBackoffMsecs_a;
+  std::uint64_t uMaxMsecs   = m_uMaxBackoffMsecs_a;
+  s.uBackoffMsecs           = static_cast<std::uint32_t>(uDelayMsecs ? (std::min)(uDelayMsecs * 2, uMaxMsecs) : uMinMsecs);
+
+  //! jitter in [delay / 2, delay]: clients of a failed endpoint do not all retry at once
+  if (uDelayMsecs > 0) { uDelayMsecs = uDelayMsecs / 2 + m_rng() % (uDelayMsecs / 2 + 1); }
+
+  s.timeRetry = std::chrono::steady_clock::now() + std::chrono::milliseconds(uDelayMsecs);
+  ep.vctBackoffSlots.push_back(uSlot);
+}
+
+} // namespace tacopie
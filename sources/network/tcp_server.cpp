@@ -24,7 +24,9 @@
 #include <tacopie/utils/error.hpp>
 #include <tacopie/utils/logger.hpp>
 
-#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <unordered_set>
 
 namespace tacopie {
 
@@ -34,6 +36,9 @@ namespace tacopie {
 
 tcp_server::tcp_server(void)
 : m_ptrIOService(get_default_io_service())
+, m_uNbAcceptors(1)
+, m_uListenBacklog(__TACOPIE_CONNECTION_QUEUE_SIZE)
+, m_uDrainTimeoutMsecs(0)
 , m_callbackOnNewConnection(nullptr) { __TACOPIE_LOG(debug, "create tcp_server"); }
 
 tcp_server::~tcp_server(void) {
@@ -49,13 +54,36 @@ void
 tcp_server::start(const std::string& sHost, std::uint32_t uPort, const on_new_connection_callback_t& callback) {
   if (is_running()) { __TACOPIE_THROW(warn, "tcp_server is already running"); }
 
-  m_tcpSocket.bind(sHost, uPort);
-  m_tcpSocket.listen(__TACOPIE_CONNECTION_QUEUE_SIZE);
+  std::size_t uNbAcceptors = m_uNbAcceptors ? m_uNbAcceptors : m_ptrIOService->get_nb_reactors();
+  if (uPort == 0) { uNbAcceptors = 1; }
+
+  bool bReusePort = uNbAcceptors > 1;
+
+  m_vctReusePortSockets.clear();
+  m_vctReusePortSockets.reserve(uNbAcceptors - 1);
+
+  try {
+    m_tcpSocket.set_options(m_socketOptions);
+    m_tcpSocket.bind(sHost, uPort, bReusePort);
+    for (std::size_t i = 1; i < uNbAcceptors; ++i) {
+      m_vctReusePortSockets.emplace_back();
+      m_vctReusePortSockets.back().set_options(m_socketOptions);
+      m_vctReusePortSockets.back().bind(sHost, uPort, bReusePort);
+    }
+  }
+  catch (const tacopie_error& e) {
+    m_tcpSocket.close();
+    for (auto& socket : m_vctReusePortSockets) { socket.close(); }
+    m_vctReusePortSockets.clear();
+    throw e;
+  }
 
-  m_ptrIOService->track(m_tcpSocket);
-  m_ptrIOService->set_rd_callback(m_tcpSocket, std::bind(&tcp_server::on_read_available, this, std::placeholders::_1));
   m_callbackOnNewConnection = callback;
 
+  //! each listener is tracked separately, so that they are spread across the reactors
+  start_listener(m_tcpSocket);
+  for (auto& socket : m_vctReusePortSockets) { start_listener(socket); }
+
   m_bIsRunning_a = true;
 
   __TACOPIE_LOG(info, "tcp_server running");
@@ -68,42 +96,138 @@ tcp_server::stop(bool bWaitForRemoval, bool bRecursiveWaitForRemoval) {
   m_bIsRunning_a = false;
 
   m_ptrIOService->untrack(m_tcpSocket);
-  if (bWaitForRemoval) { m_ptrIOService->wait_for_removal(m_tcpSocket); }
+  for (auto& socket : m_vctReusePortSockets) { m_ptrIOService->untrack(socket); }
+  if (bWaitForRemoval) {
+    m_ptrIOService->wait_for_removal(m_tcpSocket);
+    for (auto& socket : m_vctReusePortSockets) { m_ptrIOService->wait_for_removal(socket); }
+  }
   m_tcpSocket.close();
+  for (auto& socket : m_vctReusePortSockets) { socket.close(); }
+
+  //! let the clients flush their pending writes
+  if (m_uDrainTimeoutMsecs > 0) { drain_clients(); }
 
   std::lock_guard<std::mutex> lock(m_mtxClients);
-  for (auto& client : m_lstClients) {
-    client->disconnect(bRecursiveWaitForRemoval && bWaitForRemoval);
-  }
-  m_lstClients.clear();
+  std::vector<std::shared_ptr<tacopie::tcp_client>> vctClients(m_mapClients.begin(), m_mapClients.end());
+  tcp_client::disconnect_all(vctClients, bRecursiveWaitForRemoval && bWaitForRemoval);
+  m_mapClients.clear();
+  m_ptrClientsSnapshot.reset();
 
   __TACOPIE_LOG(info, "tcp_server stopped");
 }
 
+void
+tcp_server::drain_clients(void) {
+  //! the pending writes are flushed by the io_service threads: waiting for them from one of these threads might never end
+  if (m_ptrIOService->is_service_thread()) {
+    __TACOPIE_LOG(warn, "tcp_server stopped from an io_service thread, clients are not drained");
+    return;
+  }
+
+  //! clients whose pending writes are being flushed, removed by their flush handler (shared with the handlers, which
+  //! may be called after the drain timed out)
+  struct drain_state {
+    std::mutex                            mtx;
+    std::condition_variable               cv;
+    std::unordered_set<const tcp_client*> setFlushingClients;
+  };
+
+  auto ptrClients   = get_clients_snapshot();
+  auto ptrDrain     = std::make_shared<drain_state>();
+  auto timeDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_uDrainTimeoutMsecs);
+
+  __TACOPIE_LOG(info, "tcp_server draining clients");
+
+  //! no new request is processed while the pending writes are flushed
+  for (const auto& ptrClient : *ptrClients) {
+    const tcp_client* pClient = ptrClient.get();
+
+    ptrClient->pause_read();
+    //! the flush handler of the user is kept: the server has its own
+    ptrClient->set_on_server_flush_handler([ptrDrain, pClient] {
+      std::lock_guard<std::mutex> lock(ptrDrain->mtx);
+
+      if (ptrDrain->setFlushingClients.erase(pClient) && ptrDrain->setFlushingClients.empty()) {
+        ptrDrain->cv.notify_all();
+      }
+    });
+  }
+
+  std::unique_lock<std::mutex> lock(ptrDrain->mtx);
+
+  //! clients flushed in the meantime are skipped: their handler either found nothing to remove, or waits for the lock
+  for (const auto& ptrClient : *ptrClients) {
+    if (ptrClient->is_connected() && ptrClient->pending_write_requests() > 0) {
+      ptrDrain->setFlushingClients.insert(ptrClient.get());
+    }
+  }
+
+  if (!ptrDrain->cv.wait_until(lock, timeDeadline, [&]() { return ptrDrain->setFlushingClients.empty(); })) {
+    __TACOPIE_LOG(warn, "tcp_server drain timed out");
+  }
+}
+
 //!
 //! io service read callback
 //!
 
 void
-tcp_server::on_read_available(fd_t) {
+tcp_server::start_listener(tcp_socket& socket) {
+  socket.listen(m_uListenBacklog);
+  socket.set_non_blocking(true);
+
+  m_ptrIOService->track(socket);
+  m_ptrIOService->set_rd_callback(socket, std::bind(&tcp_server::on_read_available, this, std::placeholders::_1));
+}
+
+tcp_socket&
+tcp_server::get_listener(fd_t fd) {
+  for (auto& socket : m_vctReusePortSockets) {
+    if (socket.get_fd() == fd) { return socket; }
+  }
+
+  return m_tcpSocket;
+}
+
+void
+tcp_server::on_read_available(fd_t fd) {
+  std::vector<tcp_socket> vctSockets;
+
   try {
+    vctSockets = get_listener(fd).accept_batch();
+  }
+  catch (const tacopie::tacopie_error&) {
+    __TACOPIE_LOG(warn, "accept operation failure");
+    stop();
+    return;
+  }
+
+  for (auto& socket : vctSockets) {
     __TACOPIE_LOG(info, "tcp_server received new connection");
 
-    auto ptrTcpClient = std::make_shared<tcp_client>(m_tcpSocket.accept());
+    try {
+      socket.set_options(m_clientSocketOptions);
+    }
+    catch (const tacopie::tacopie_error&) {
+      __TACOPIE_LOG(warn, "could not apply socket options to new connection");
+    }
+
+    auto ptrTcpClient = std::make_shared<tcp_client>(std::move(socket));
 
     if (!m_callbackOnNewConnection || !m_callbackOnNewConnection(ptrTcpClient)) {
       __TACOPIE_LOG(info, "connection handling delegated to tcp_server");
 
-      ptrTcpClient->set_on_disconnection_handler(std::bind(&tcp_server::on_client_disconnected, this, ptrTcpClient));
-      m_lstClients.push_back(ptrTcpClient);
+      std::unique_lock<std::mutex> lock(m_mtxClients);
+      client_id_t uClientId = m_mapClients.insert(ptrTcpClient);
+      m_ptrClientsSnapshot.reset();
+      lock.unlock();
+
+      //! the handler must not own the client: it would never be released once erased
+      ptrTcpClient->set_on_disconnection_handler(std::bind(&tcp_server::on_client_disconnected, this, uClientId));
     } else {
       __TACOPIE_LOG(info, "connection handled by tcp_server wrapper");
     }
   }
-  catch (const tacopie::tacopie_error&) {
-    __TACOPIE_LOG(warn, "accept operation failure");
-    stop();
-  }
 }
 
 //!
@@ -111,17 +235,21 @@ tcp_server::on_read_available(fd_t) {
 //!
 
 void
-tcp_server::on_client_disconnected(const std::shared_ptr<tcp_client>& client) {
+tcp_server::on_client_disconnected(client_id_t uClientId) {
   //! If we are not running the server
   //! Then it means that this function is called by tcp_client::disconnect() at the destruction of all clients
   if (!is_running()) { return; }
 
   __TACOPIE_LOG(debug, "handle server's client disconnection");
 
+  //! these may hold the last reference to the client: released out of the lock, as its destruction may wait for its
+  //! callbacks
+  std::shared_ptr<tcp_client> ptrClient;
+  clients_snapshot_t          ptrClientsSnapshot;
+
   std::lock_guard<std::mutex> lock(m_mtxClients);
-  auto pos = std::find(m_lstClients.begin(), m_lstClients.end(), client);
 
-  if (pos != m_lstClients.end()) { m_lstClients.erase(pos); }
+  if (m_mapClients.erase(uClientId, &ptrClient)) { std::swap(ptrClientsSnapshot, m_ptrClientsSnapshot); }
 }
 
 //!
@@ -133,6 +261,132 @@ tcp_server::is_running(void) const {
   return m_bIsRunning_a;
 }
 
+//!
+//! acceptors & backlog
+//!
+
+void
+tcp_server::set_nb_acceptors(std::size_t uNbAcceptors) {
+  m_uNbAcceptors = uNbAcceptors;
+}
+
+std::size_t
+tcp_server::get_nb_acceptors(void) const {
+  return m_uNbAcceptors;
+}
+
+void
+tcp_server::set_listen_backlog(std::size_t uBacklog) {
+  m_uListenBacklog = uBacklog;
+}
+
+std::size_t
+tcp_server::get_listen_backlog(void) const {
+  return m_uListenBacklog;
+}
+
+void
+tcp_server::set_drain_timeout(std::uint32_t uTimeoutMsecs) {
+  m_uDrainTimeoutMsecs = uTimeoutMsecs;
+}
+
+std::uint32_t
+tcp_server::get_drain_timeout(void) const {
+  return m_uDrainTimeoutMsecs;
+}
+
+//!
+//! socket options
+//!
+
+void
+tcp_server::set_socket_options(const socket_options& options) {
+  m_socketOptions = options;
+}
+
+const socket_options&
+tcp_server::get_socket_options(void) const {
+  return m_socketOptions;
+}
+
+void
+tcp_server::set_client_socket_options(const socket_options& options) {
+  m_clientSocketOptions = options;
+}
+
+const socket_options&
+tcp_server::get_client_socket_options(void) const {
+  return m_clientSocketOptions;
+}
+
+//!
+//! broadcast
+//!
+
+//! progress of a broadcast, shared by the write callbacks of all the selected clients
+//! the pending count starts at 1 so that completion is not reported before all the writes have been queued
+struct broadcast_state {
+  std::atomic<std::size_t>         uNbPending_a;
+  std::atomic<std::size_t>         uNbSucceeded_a;
+  std::atomic<std::size_t>         uNbFailed_a;
+  std::size_t                      uNbClients;
+  tcp_server::broadcast_callback_t callback;
+};
+
+static void
+complete_broadcast(broadcast_state& state) {
+  if (--state.uNbPending_a) { return; }
+
+  tcp_server::broadcast_result result = {state.uNbClients, state.uNbSucceeded_a, state.uNbFailed_a};
+
+  if (state.callback) { state.callback(result); }
+}
+
+std::size_t
+tcp_server::broadcast(const tcp_client::shared_buffer_t& buffer, const broadcast_filter_t& filter,
+    const broadcast_callback_t& callback) {
+  auto ptrState = std::make_shared<broadcast_state>();
+
+  ptrState->uNbPending_a   = 1;
+  ptrState->uNbSucceeded_a = 0;
+  ptrState->uNbFailed_a    = 0;
+  ptrState->uNbClients     = 0;
+  ptrState->callback       = callback;
+
+  //! the write callback only holds the shared state
+  auto callbackWrite = [ptrState](tcp_client::write_result& result) {
+    if (result.success) {
+      ++ptrState->uNbSucceeded_a;
+    } else {
+      ++ptrState->uNbFailed_a;
+    }
+    complete_broadcast(*ptrState);
+  };
+
+  auto ptrClients = get_clients_snapshot();
+
+  for (const auto& client : *ptrClients) {
+    if (!client->is_connected() || (filter && !filter(client))) { continue; }
+
+    ++ptrState->uNbPending_a;
+
+    try {
+      client->async_write({buffer, callbackWrite});
+      ++ptrState->uNbClients;
+    }
+    catch (const tacopie::tacopie_error&) {
+      //! disconnected in the meantime: skipped, like the clients that were already disconnected
+      --ptrState->uNbPending_a;
+    }
+  }
+
+  std::size_t uNbClients = ptrState->uNbClients;
+
+  complete_broadcast(*ptrState);
+
+  return uNbClients;
+}
+
 //!
 //! get socket
 //!
@@ -159,9 +413,27 @@ tcp_server::get_io_service(void) const {
 //! get client sockets
 //!
 
-const std::list<std::shared_ptr<tacopie::tcp_client>>&
+std::vector<std::shared_ptr<tacopie::tcp_client>>
 tcp_server::get_clients(void) const {
-  return m_lstClients;
+  return *get_clients_snapshot();
+}
+
+tcp_server::clients_snapshot_t
+tcp_server::get_clients_snapshot(void) const {
+  std::lock_guard<std::mutex> lock(m_mtxClients);
+
+  if (!m_ptrClientsSnapshot) {
+    m_ptrClientsSnapshot = std::make_shared<const std::vector<std::shared_ptr<tacopie::tcp_client>>>(m_mapClients.begin(), m_mapClients.end());
+  }
+
+  return m_ptrClientsSnapshot;
+}
+
+std::size_t
+tcp_server::get_nb_clients(void) const {
+  std::lock_guard<std::mutex> lock(m_mtxClients);
+
+  return m_mapClients.size();
 }
 
 //!
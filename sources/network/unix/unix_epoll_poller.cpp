@@ -0,0 +1,145 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <tacopie/network/poller.hpp>
+
+//! guard for bulk content integration depending on how user integrates the library
+#ifdef __TACOPIE_HAS_EPOLL
+
+#include <tacopie/utils/error.hpp>
+#include <tacopie/utils/logger.hpp>
+
+#include <cerrno>
+
+#include <unistd.h>
+
+#ifndef __TACOPIE_EPOLL_INITIAL_NB_EVENTS
+#define __TACOPIE_EPOLL_INITIAL_NB_EVENTS 256
+#endif /* __TACOPIE_EPOLL_INITIAL_NB_EVENTS */
+
+namespace tacopie {
+
+//!
+//! ctor & dtor
+//!
+
+epoll_poller::epoll_poller(void)
+: m_fdEpoll(epoll_create1(EPOLL_CLOEXEC))
+, m_vctEpollEvents(__TACOPIE_EPOLL_INITIAL_NB_EVENTS) {
+  if (m_fdEpoll == __TACOPIE_INVALID_FD) { __TACOPIE_THROW(error, "epoll_create1() failure"); }
+
+  __TACOPIE_LOG(debug, "create epoll_poller");
+}
+
+epoll_poller::~epoll_poller(void) {
+  if (m_fdEpoll != __TACOPIE_INVALID_FD) {
+    close(m_fdEpoll);
+  }
+}
+
+//!
+//! register events for fd
+//!
+
+void
+epoll_poller::update(fd_t fd, int nOldEvents, int nNewEvents) {
+  if (nNewEvents == none) {
+    //! fd might have already been closed (and thus removed from the epoll set by the kernel)
+    epoll_ctl(m_fdEpoll, EPOLL_CTL_DEL, fd, NULL);
+    return;
+  }
+
+  epoll_event event = {};
+  event.data.fd     = fd;
+  if (nNewEvents & rd) { event.events |= EPOLLIN; }
+  if (nNewEvents & wr) { event.events |= EPOLLOUT; }
+
+  //! the registration state known by the caller might be stale if the fd has been closed and reused in the meantime
+  //! so fallback on the other operation when the kernel disagrees
+  if (nOldEvents == none) {
+    if (epoll_ctl(m_fdEpoll, EPOLL_CTL_ADD, fd, &event) == -1 && (errno != EEXIST || epoll_ctl(m_fdEpoll, EPOLL_CTL_MOD, fd, &event) == -1)) {
+      __TACOPIE_LOG(error, "epoll_ctl() failure");
+    }
+  } else {
+    if (epoll_ctl(m_fdEpoll, EPOLL_CTL_MOD, fd, &event) == -1 && (errno != ENOENT || epoll_ctl(m_fdEpoll, EPOLL_CTL_ADD, fd, &event) == -1)) {
+      __TACOPIE_LOG(error, "epoll_ctl() failure");
+    }
+  }
+}
+
+//!
+//! wait for events
+//!
+
+void
+epoll_poller::wait(std::vector<poll_event>& vctEvents, int nTimeoutMsecs) {
+  vctEvents.clear();
+
+  int nNbEvents = epoll_wait(m_fdEpoll, m_vctEpollEvents.data(), static_cast<int>(m_vctEpollEvents.size()), nTimeoutMsecs);
+
+  for (int i = 0; i < nNbEvents; ++i) {
+    const auto& event = m_vctEpollEvents[i];
+    int nEvents       = none;
+
+    //! errors and hang-ups are reported as both read and write availability, as select does
+    if (event.events & (EPOLLIN | EPOLLHUP | EPOLLERR)) { nEvents |= rd; }
+    if (event.events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) { nEvents |= wr; }
+
+    vctEvents.push_back({event.data.fd, nEvents});
+  }
+
+  if (nNbEvents == static_cast<int>(m_vctEpollEvents.size())) {
+    m_vctEpollEvents.resize(m_vctEpollEvents.size() * 2);
+  }
+}
+
+//!
+//! epoll_ctl applies immediately, even on a pending epoll_wait
+//!
+
+bool
+epoll_poller::needs_wakeup_on_update(void) const {
+  return false;
+}
+
+//!
+//! buffers reallocation
+//!
+
+void
+epoll_poller::reallocate_buffers(void) {
+  //! value-initialized: the new buffer is written (and thus placed) by the calling thread
+  std::vector<epoll_event>(m_vctEpollEvents.size()).swap(m_vctEpollEvents);
+}
+
+//!
+//! backend getter
+//!
+
+poller_backend
+epoll_poller::get_backend(void) const {
+  return poller_backend::epoll;
+}
+
+} // namespace tacopie
+
+#endif /* __TACOPIE_HAS_EPOLL */
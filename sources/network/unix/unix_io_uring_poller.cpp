@@ -0,0 +1,545 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <tacopie/network/poller.hpp>
+
+//! guard for bulk content integration depending on how user integrates the library
+#ifdef __TACOPIE_HAS_IO_URING
+
+#include <tacopie/utils/error.hpp>
+#include <tacopie/utils/logger.hpp>
+#include <tacopie/utils/metrics.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+//! number of submission queue entries of the ring (the completion queue is twice as big)
+#ifndef __TACOPIE_IO_URING_ENTRIES
+#define __TACOPIE_IO_URING_ENTRIES 256
+#endif /* __TACOPIE_IO_URING_ENTRIES */
+
+namespace tacopie {
+
+//!
+//! system calls (not wrapped by the libc)
+//!
+
+static int
+io_uring_setup(unsigned uEntries, io_uring_params* pParams) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, uEntries, pParams));
+}
+
+static int
+io_uring_enter(int fdRing, unsigned uToSubmit, unsigned uMinComplete, unsigned uFlags, const void* pArg, std::size_t uArgSize) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, fdRing, uToSubmit, uMinComplete, uFlags, pArg, uArgSize));
+}
+
+//!
+//! user data of poll and receive requests: generation in the upper bits, fd in the lower bits
+//! user data 0 is used by the requests whose completion is ignored (poll removals and cancellations)
+//!
+
+static std::uint64_t
+make_user_data(std::uint32_t uGeneration, fd_t fd) {
+  return (static_cast<std::uint64_t>(uGeneration) << 32) | static_cast<std::uint32_t>(fd);
+}
+
+static fd_t
+get_user_data_fd(std::uint64_t uUserData) {
+  return static_cast<fd_t>(uUserData & 0xFFFFFFFF);
+}
+
+//!
+//! ctor & dtor
+//!
+
+io_uring_poller::io_uring_poller(void)
+: m_fdRing(__TACOPIE_INVALID_FD)
+, m_pSqRing(MAP_FAILED)
+, m_uSqRingSize(0)
+, m_pCqRing(MAP_FAILED)
+, m_uCqRingSize(0)
+, m_pSqes(static_cast<io_uring_sqe*>(MAP_FAILED))
+, m_uSqesSize(0)
+, m_pSqHead(nullptr)
+, m_pSqTail(nullptr)
+, m_pSqArray(nullptr)
+, m_uSqMask(0)
+, m_uSqEntries(0)
+, m_uSqPending(0)
+, m_pCqHead(nullptr)
+, m_pCqTail(nullptr)
+, m_pCqes(nullptr)
+, m_uCqMask(0)
+, m_uNextGeneration(1) {
+  io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+
+  m_fdRing = io_uring_setup(__TACOPIE_IO_URING_ENTRIES, &params);
+  if (m_fdRing == __TACOPIE_INVALID_FD) { __TACOPIE_THROW(error, "io_uring_setup() failure"); }
+
+  //! timeouts are passed to io_uring_enter (5.11+) and completions must never be dropped (5.5+)
+  if (!(params.features & IORING_FEAT_EXT_ARG) || !(params.features & IORING_FEAT_NODROP)) {
+    close(m_fdRing);
+    __TACOPIE_THROW(error, "io_uring poller backend is not supported by this kernel");
+  }
+
+  m_uSqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  m_uCqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  m_uSqesSize   = params.sq_entries * sizeof(io_uring_sqe);
+
+  m_pSqRing = mmap(nullptr, m_uSqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fdRing, IORING_OFF_SQ_RING);
+  m_pCqRing = mmap(nullptr, m_uCqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fdRing, IORING_OFF_CQ_RING);
+  m_pSqes   = static_cast<io_uring_sqe*>(mmap(nullptr, m_uSqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fdRing, IORING_OFF_SQES));
+
+  if (m_pSqRing == MAP_FAILED || m_pCqRing == MAP_FAILED || m_pSqes == MAP_FAILED) {
+    if (m_pSqes != MAP_FAILED) { munmap(m_pSqes, m_uSqesSize); }
+    if (m_pCqRing != MAP_FAILED) { munmap(m_pCqRing, m_uCqRingSize); }
+    if (m_pSqRing != MAP_FAILED) { munmap(m_pSqRing, m_uSqRingSize); }
+    close(m_fdRing);
+    __TACOPIE_THROW(error, "mmap() failure on io_uring rings");
+  }
+
+  char* pSqRing = static_cast<char*>(m_pSqRing);
+  m_pSqHead     = reinterpret_cast<unsigned*>(pSqRing + params.sq_off.head);
+  m_pSqTail     = reinterpret_cast<unsigned*>(pSqRing + params.sq_off.tail);
+  m_pSqArray    = reinterpret_cast<unsigned*>(pSqRing + params.sq_off.array);
+  m_uSqMask     = *reinterpret_cast<unsigned*>(pSqRing + params.sq_off.ring_mask);
+  m_uSqEntries  = params.sq_entries;
+
+  char* pCqRing = static_cast<char*>(m_pCqRing);
+  m_pCqHead     = reinterpret_cast<unsigned*>(pCqRing + params.cq_off.head);
+  m_pCqTail     = reinterpret_cast<unsigned*>(pCqRing + params.cq_off.tail);
+  m_pCqes       = reinterpret_cast<io_uring_cqe*>(pCqRing + params.cq_off.cqes);
+  m_uCqMask     = *reinterpret_cast<unsigned*>(pCqRing + params.cq_off.ring_mask);
+
+  __TACOPIE_LOG(debug, "create io_uring_poller");
+}
+
+io_uring_poller::~io_uring_poller(void) {
+  if (m_pSqes != MAP_FAILED) { munmap(m_pSqes, m_uSqesSize); }
+  if (m_pCqRing != MAP_FAILED) { munmap(m_pCqRing, m_uCqRingSize); }
+  if (m_pSqRing != MAP_FAILED) { munmap(m_pSqRing, m_uSqRingSize); }
+
+  //! closing the ring cancels the requests in flight
+  if (m_fdRing != __TACOPIE_INVALID_FD) { close(m_fdRing); }
+}
+
+//!
+//! register events for fd
+//! the change is only recorded here, wait() submits it
+//!
+
+void
+io_uring_poller::update(fd_t fd, int, int nNewEvents) {
+  std::lock_guard<std::mutex> lock(m_mtxRegistrations);
+
+  auto it = m_mapRegistrations.find(fd);
+
+  if (it == m_mapRegistrations.end()) {
+    if (nNewEvents == none) { return; }
+
+    it = m_mapRegistrations.insert({fd, registration()}).first;
+  }
+
+  //! once unregistered, the fd might be closed and reused: the request in flight (if any) must not be kept
+  if (nNewEvents == none) { it->second.bReset = true; }
+
+  it->second.nEvents = nNewEvents;
+  mark_dirty(fd, it->second);
+}
+
+//!
+//! completion based receive
+//!
+
+void
+io_uring_poller::set_recv_completions(fd_t fd, bool bEnabled, std::size_t uBufferSize) {
+  std::lock_guard<std::mutex> lock(m_mtxRegistrations);
+
+  auto it = m_mapRegistrations.find(fd);
+
+  if (it == m_mapRegistrations.end()) {
+    if (!bEnabled) { return; }
+
+    it = m_mapRegistrations.insert({fd, registration()}).first;
+  }
+
+  auto& reg = it->second;
+
+  if (bEnabled) {
+    reg.bRecvEnabled    = true;
+    reg.uRecvBufferSize = uBufferSize;
+  } else {
+    if (!reg.bRecvEnabled) { return; }
+
+    //! the receive in flight might complete before being cancelled: its bytes are still taken from here
+    reg.bRecvEnabled = false;
+    if (reg.uRecvId) { m_vctCancelledRecvIds.push_back(reg.uRecvId); }
+  }
+
+  mark_dirty(fd, reg);
+}
+
+bool
+io_uring_poller::take_received(fd_t fd, char* pBuffer, std::size_t uSizeToRead, std::size_t& uReadSize) {
+  std::lock_guard<std::mutex> lock(m_mtxRegistrations);
+
+  auto it = m_mapRegistrations.find(fd);
+
+  if (it == m_mapRegistrations.end() || !it->second.owns_recv()) { return false; }
+
+  auto& reg = it->second;
+  uReadSize = 0;
+
+  if (reg.uRecvSize) {
+    uReadSize = std::min(uSizeToRead, reg.uRecvSize);
+    std::memcpy(pBuffer, reg.vctRecvBuffer.data() + reg.uRecvOffset, uReadSize);
+    reg.uRecvOffset += uReadSize;
+    reg.uRecvSize -= uReadSize;
+
+    //! re-armed (or reported again if bytes are left) by the next wait()
+    mark_dirty(fd, reg);
+  } else if (reg.bRecvDone) {
+    if (reg.nRecvResult == 0) { __TACOPIE_THROW(warn, "nothing to read, socket has been closed by remote host"); }
+    __TACOPIE_THROW(error, "recv() failure");
+  }
+
+  return true;
+}
+
+void
+io_uring_poller::release(fd_t fd) {
+  std::lock_guard<std::mutex> lock(m_mtxRegistrations);
+
+  auto it = m_mapRegistrations.find(fd);
+
+  if (it == m_mapRegistrations.end() || !it->second.owns_recv()) { return; }
+
+  auto& reg = it->second;
+
+  //! the kernel keeps writing into the buffer until the receive in flight completes
+  if (reg.uRecvId) {
+    m_vctCancelledRecvIds.push_back(reg.uRecvId);
+    m_mapReleasedRecvBuffers[reg.uRecvId] = std::move(reg.vctRecvBuffer);
+  }
+
+  reg.bRecvEnabled = false;
+  reg.uRecvId      = 0;
+  reg.uRecvOffset  = 0;
+  reg.uRecvSize    = 0;
+  reg.bRecvDone    = false;
+  reg.nRecvResult  = 0;
+  reg.vctRecvBuffer.clear();
+
+  mark_dirty(fd, reg);
+}
+
+void
+io_uring_poller::mark_dirty(fd_t fd, registration& reg) {
+  if (reg.bDirty) { return; }
+
+  reg.bDirty = true;
+  m_vctDirtyFds.push_back(fd);
+}
+
+//!
+//! submission queue
+//!
+
+io_uring_sqe*
+io_uring_poller::get_sqe(void) {
+  unsigned uTail = *m_pSqTail;
+
+  //! queue full: submit what has been queued so far (the kernel consumes all of it as SQPOLL is not used)
+  if (uTail - __atomic_load_n(m_pSqHead, __ATOMIC_ACQUIRE) == m_uSqEntries) { enter(false, 0); }
+
+  unsigned uIndex    = uTail & m_uSqMask;
+  io_uring_sqe* pSqe = &m_pSqes[uIndex];
+  m_pSqArray[uIndex] = uIndex;
+  std::memset(pSqe, 0, sizeof(*pSqe));
+
+  //! the kernel only reads entries on io_uring_enter, so the entry can be filled by the caller after being published
+  __atomic_store_n(m_pSqTail, uTail + 1, __ATOMIC_RELEASE);
+  ++m_uSqPending;
+
+  return pSqe;
+}
+
+void
+io_uring_poller::enter(bool bWait, int nTimeoutMsecs) {
+  unsigned uFlags = 0;
+  __kernel_timespec timeout;
+  io_uring_getevents_arg arg;
+  std::memset(&arg, 0, sizeof(arg));
+
+  if (bWait) {
+    uFlags |= IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+    arg.sigmask_sz = _NSIG / 8;
+
+    if (nTimeoutMsecs >= 0) {
+      timeout.tv_sec  = nTimeoutMsecs / 1000;
+      timeout.tv_nsec = static_cast<long long>(nTimeoutMsecs % 1000) * 1000000;
+      arg.ts          = reinterpret_cast<std::uint64_t>(&timeout);
+    }
+  }
+
+  int nResult = io_uring_enter(m_fdRing, m_uSqPending, bWait ? 1 : 0, uFlags, bWait ? &arg : nullptr, bWait ? sizeof(arg) : 0);
+
+  //! entries not consumed by the kernel stay queued for the next call
+  m_uSqPending = *m_pSqTail - __atomic_load_n(m_pSqHead, __ATOMIC_ACQUIRE);
+
+  //! timeout expiry, signal interruption, or completion queue busy: available completions are reaped by the caller
+  if (nResult == -1 && errno != ETIME && errno != EINTR && errno != EBUSY) { __TACOPIE_LOG(error, "io_uring_enter() failure"); }
+}
+
+//!
+//! poll and receive requests management
+//!
+
+std::uint64_t
+io_uring_poller::next_user_data(fd_t fd) {
+  std::uint32_t uGeneration = m_uNextGeneration++;
+  if (!m_uNextGeneration) { m_uNextGeneration = 1; }
+
+  return make_user_data(uGeneration, fd);
+}
+
+bool
+io_uring_poller::prepare_updates(std::vector<poll_event>& vctEvents) {
+  bool bRecvQueued = false;
+
+  for (std::uint64_t uRecvId : m_vctCancelledRecvIds) {
+    //! its completion (-ECANCELED, or the bytes received meanwhile) is matched by the receive user data
+    io_uring_sqe* pSqe = get_sqe();
+    pSqe->opcode       = IORING_OP_ASYNC_CANCEL;
+    pSqe->fd           = -1;
+    pSqe->addr         = uRecvId;
+    pSqe->user_data    = 0;
+  }
+  m_vctCancelledRecvIds.clear();
+
+  for (fd_t fd : m_vctDirtyFds) {
+    auto it = m_mapRegistrations.find(fd);
+
+    if (it == m_mapRegistrations.end()) { continue; }
+
+    auto& reg   = it->second;
+    bool bReset = reg.bReset;
+    reg.bDirty  = false;
+    reg.bReset  = false;
+
+    //! the read events of the fds whose reads go through the poller come from their receive requests
+    bool bOwnsRecv  = reg.owns_recv();
+    int nPollEvents = bOwnsRecv ? (reg.nEvents & ~rd) : reg.nEvents;
+
+    if (bOwnsRecv && (reg.nEvents & rd) && !reg.uRecvId && (reg.uRecvSize || reg.bRecvDone)) {
+      //! bytes (or the end of the stream) still waiting to be taken: level-triggered, as for the polled fds
+      vctEvents.push_back({fd, rd});
+    } else if (reg.bRecvEnabled && !reg.uRecvId && !reg.uRecvSize && !reg.bRecvDone) {
+      if (reg.vctRecvBuffer.size() != reg.uRecvBufferSize) { reg.vctRecvBuffer.resize(reg.uRecvBufferSize); }
+
+      io_uring_sqe* pSqe = get_sqe();
+      pSqe->opcode       = IORING_OP_RECV;
+      pSqe->fd           = fd;
+      pSqe->addr         = reinterpret_cast<std::uint64_t>(reg.vctRecvBuffer.data());
+      pSqe->len          = static_cast<std::uint32_t>(reg.vctRecvBuffer.size());
+      pSqe->user_data    = next_user_data(fd);
+
+      reg.uRecvId = pSqe->user_data;
+      bRecvQueued = true;
+    }
+
+    if (reg.nArmedEvents != nPollEvents || bReset) {
+      //! events changed: cancel the request in flight, its completion (-ECANCELED) is ignored as it does not match uArmedId anymore
+      if (reg.nArmedEvents != none) {
+        io_uring_sqe* pSqe = get_sqe();
+        pSqe->opcode       = IORING_OP_POLL_REMOVE;
+        pSqe->fd           = -1;
+        pSqe->addr         = reg.uArmedId;
+        pSqe->user_data    = 0;
+
+        reg.nArmedEvents = none;
+        reg.uArmedId     = 0;
+      }
+
+      if (nPollEvents != none) {
+        std::uint32_t uPollMask = (nPollEvents & rd ? POLLIN : 0) | (nPollEvents & wr ? POLLOUT : 0);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        //! the kernel expects the 16-bit halves of the mask to be swapped on big-endian
+        uPollMask = (uPollMask << 16) | (uPollMask >> 16);
+#endif /* __BYTE_ORDER__ */
+
+        io_uring_sqe* pSqe  = get_sqe();
+        pSqe->opcode        = IORING_OP_POLL_ADD;
+        pSqe->fd            = fd;
+        pSqe->poll32_events = uPollMask;
+        pSqe->user_data     = next_user_data(fd);
+
+        reg.nArmedEvents = nPollEvents;
+        reg.uArmedId     = pSqe->user_data;
+      }
+    }
+
+    if (reg.nEvents == none && !bOwnsRecv) { m_mapRegistrations.erase(it); }
+  }
+
+  m_vctDirtyFds.clear();
+
+  return bRecvQueued;
+}
+
+void
+io_uring_poller::handle_recv_completion(fd_t fd, registration& reg, int nResult, std::vector<poll_event>& vctEvents) {
+  reg.uRecvId = 0;
+
+  if (nResult > 0) {
+    reg.uRecvOffset = 0;
+    reg.uRecvSize   = static_cast<std::size_t>(nResult);
+    __TACOPIE_METRIC_ADD(bytes_read, nResult)
+  } else if (nResult == -ECANCELED) {
+    //! cancelled by set_recv_completions(): the fd goes back to the read poll requests
+  } else if (nResult == -EAGAIN || nResult == -EINTR) {
+    //! kernel not waiting for the data by itself: fall back to the read poll requests
+    __TACOPIE_LOG(warn, "io_uring receive not supported, falling back to read polling");
+    reg.bRecvEnabled = false;
+  } else {
+    reg.bRecvDone   = true;
+    reg.nRecvResult = nResult;
+  }
+
+  if ((reg.nEvents & rd) && (reg.uRecvSize || reg.bRecvDone)) { vctEvents.push_back({fd, rd}); }
+
+  //! re-armed (or back to polling) once taken
+  mark_dirty(fd, reg);
+}
+
+void
+io_uring_poller::reap_completions(std::vector<poll_event>& vctEvents) {
+  unsigned uHead = *m_pCqHead;
+  unsigned uTail = __atomic_load_n(m_pCqTail, __ATOMIC_ACQUIRE);
+
+  for (; uHead != uTail; ++uHead) {
+    const io_uring_cqe& cqe = m_pCqes[uHead & m_uCqMask];
+
+    if (!cqe.user_data) { continue; }
+
+    fd_t fd = get_user_data_fd(cqe.user_data);
+    auto it = m_mapRegistrations.find(fd);
+
+    if (it != m_mapRegistrations.end() && it->second.uRecvId == cqe.user_data) {
+      handle_recv_completion(fd, it->second, cqe.res, vctEvents);
+      continue;
+    }
+
+    //! completion of a cancelled or stale request (the buffer of a released receive can be freed now)
+    if (it == m_mapRegistrations.end() || it->second.uArmedId != cqe.user_data) {
+      if (!m_mapReleasedRecvBuffers.empty()) { m_mapReleasedRecvBuffers.erase(cqe.user_data); }
+      continue;
+    }
+
+    auto& reg        = it->second;
+    reg.nArmedEvents = none;
+    reg.uArmedId     = 0;
+
+    //! the request failed (e.g. the fd has been closed before submission): it is re-armed on the next update only
+    if (cqe.res < 0) {
+      __TACOPIE_LOG(warn, "io_uring poll request failure");
+      continue;
+    }
+
+    int nEvents = none;
+
+    //! errors and hang-ups are reported as both read and write availability, as select does
+    if (cqe.res & (POLLIN | POLLHUP | POLLERR)) { nEvents |= rd; }
+    if (cqe.res & (POLLOUT | POLLHUP | POLLERR)) { nEvents |= wr; }
+
+    vctEvents.push_back({fd, nEvents});
+
+    //! poll requests are one-shot: re-arm on the next wait() to keep level-triggered semantics
+    mark_dirty(fd, reg);
+  }
+
+  __atomic_store_n(m_pCqHead, uHead, __ATOMIC_RELEASE);
+}
+
+//!
+//! wait for events
+//! the queued updates are submitted by the same system call
+//!
+
+void
+io_uring_poller::wait(std::vector<poll_event>& vctEvents, int nTimeoutMsecs) {
+  vctEvents.clear();
+
+  {
+    std::lock_guard<std::mutex> lock(m_mtxRegistrations);
+
+    //! receives are submitted with the lock held: once released, the fd may be closed and reused by a new socket,
+    //! whose bytes a receive submitted afterwards would steal
+    if (prepare_updates(vctEvents)) { enter(false, 0); }
+  }
+
+  //! received bytes already waiting to be taken: only reap the completions available
+  if (vctEvents.empty()) {
+    enter(true, nTimeoutMsecs);
+  } else if (m_uSqPending) {
+    enter(false, 0);
+  }
+
+  std::lock_guard<std::mutex> lock(m_mtxRegistrations);
+  reap_completions(vctEvents);
+}
+
+//!
+//! updates are only submitted by wait()
+//!
+
+bool
+io_uring_poller::needs_wakeup_on_update(void) const {
+  return true;
+}
+
+bool
+io_uring_poller::supports_recv_completions(void) const {
+  return true;
+}
+
+//!
+//! backend getter
+//!
+
+poller_backend
+io_uring_poller::get_backend(void) const {
+  return poller_backend::io_uring;
+}
+
+} // namespace tacopie
+
+#endif /* __TACOPIE_HAS_IO_URING */
@@ -0,0 +1,146 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <tacopie/network/poller.hpp>
+
+//! guard for bulk content integration depending on how user integrates the library
+#ifdef __TACOPIE_HAS_KQUEUE
+
+#include <tacopie/utils/error.hpp>
+#include <tacopie/utils/logger.hpp>
+
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#ifndef __TACOPIE_KQUEUE_INITIAL_NB_EVENTS
+#define __TACOPIE_KQUEUE_INITIAL_NB_EVENTS 256
+#endif /* __TACOPIE_KQUEUE_INITIAL_NB_EVENTS */
+
+namespace tacopie {
+
+//!
+//! ctor & dtor
+//!
+
+kqueue_poller::kqueue_poller(void)
+: m_fdKqueue(kqueue())
+, m_vctKevents(__TACOPIE_KQUEUE_INITIAL_NB_EVENTS) {
+  if (m_fdKqueue == __TACOPIE_INVALID_FD) { __TACOPIE_THROW(error, "kqueue() failure"); }
+
+  __TACOPIE_LOG(debug, "create kqueue_poller");
+}
+
+kqueue_poller::~kqueue_poller(void) {
+  if (m_fdKqueue != __TACOPIE_INVALID_FD) {
+    close(m_fdKqueue);
+  }
+}
+
+//!
+//! register events for fd
+//!
+
+void
+kqueue_poller::update(fd_t fd, int nOldEvents, int nNewEvents) {
+  struct kevent arrChanges[2];
+  int nNbChanges = 0;
+
+  //! read and write are two distinct filters in kqueue, only submit the ones that changed
+  if ((nOldEvents & rd) != (nNewEvents & rd)) {
+    EV_SET(&arrChanges[nNbChanges++], fd, EVFILT_READ, (nNewEvents & rd) ? EV_ADD | EV_ENABLE : EV_DELETE, 0, 0, NULL);
+  }
+  if ((nOldEvents & wr) != (nNewEvents & wr)) {
+    EV_SET(&arrChanges[nNbChanges++], fd, EVFILT_WRITE, (nNewEvents & wr) ? EV_ADD | EV_ENABLE : EV_DELETE, 0, 0, NULL);
+  }
+
+  if (nNbChanges == 0) { return; }
+
+  //! EV_DELETE failures are expected whenever the fd has already been closed (kernel drops the filters on close)
+  if (kevent(m_fdKqueue, arrChanges, nNbChanges, NULL, 0, NULL) == -1 && nNewEvents != none) {
+    __TACOPIE_LOG(error, "kevent() failure");
+  }
+}
+
+//!
+//! wait for events
+//!
+
+void
+kqueue_poller::wait(std::vector<poll_event>& vctEvents, int nTimeoutMsecs) {
+  vctEvents.clear();
+
+  timespec* pTimeout = NULL;
+  timespec timeout;
+  if (nTimeoutMsecs >= 0) {
+    timeout.tv_sec  = nTimeoutMsecs / 1000;
+    timeout.tv_nsec = (nTimeoutMsecs % 1000) * 1000000;
+    pTimeout        = &timeout;
+  }
+
+  int nNbEvents = kevent(m_fdKqueue, NULL, 0, m_vctKevents.data(), static_cast<int>(m_vctKevents.size()), pTimeout);
+
+  for (int i = 0; i < nNbEvents; ++i) {
+    const auto& event = m_vctKevents[i];
+
+    if (event.flags & EV_ERROR) { continue; }
+
+    //! EV_EOF is reported through the filter that triggered, as select would report it
+    vctEvents.push_back({static_cast<fd_t>(event.ident), event.filter == EVFILT_READ ? rd : wr});
+  }
+
+  if (nNbEvents == static_cast<int>(m_vctKevents.size())) {
+    m_vctKevents.resize(m_vctKevents.size() * 2);
+  }
+}
+
+//!
+//! kevent changes apply immediately, even on a pending kevent wait
+//!
+
+bool
+kqueue_poller::needs_wakeup_on_update(void) const {
+  return false;
+}
+
+//!
+//! buffers reallocation
+//!
+
+void
+kqueue_poller::reallocate_buffers(void) {
+  //! value-initialized: the new buffer is written (and thus placed) by the calling thread
+  std::vector<struct kevent>(m_vctKevents.size()).swap(m_vctKevents);
+}
+
+//!
+//! backend getter
+//!
+
+poller_backend
+kqueue_poller::get_backend(void) const {
+  return poller_backend::kqueue;
+}
+
+} // namespace tacopie
+
+#endif /* __TACOPIE_HAS_KQUEUE */
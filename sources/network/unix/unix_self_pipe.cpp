@@ -25,27 +25,48 @@
 
 #include <tacopie/network/self_pipe.hpp>
 #include <tacopie/utils/error.hpp>
+#include <tacopie/utils/metrics.hpp>
+
+#include <cstdint>
 
 #include <fcntl.h>
 #include <unistd.h>
 
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif /* __linux__ */
+
 namespace tacopie {
 
 //!
 //! ctor & dtor
 //!
 self_pipe::self_pipe(void)
-: m_fds{__TACOPIE_INVALID_FD, __TACOPIE_INVALID_FD} {
+: m_fds{__TACOPIE_INVALID_FD, __TACOPIE_INVALID_FD}
+, m_bNotifyPending_a(false) {
+#ifdef __linux__
+  //! an eventfd is a single fd and a single 8 bytes counter, cheaper than a pipe
+  m_fds[0] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (m_fds[0] == __TACOPIE_INVALID_FD) { __TACOPIE_THROW(error, "eventfd() failure"); }
+  m_fds[1] = m_fds[0];
+#else
   if (pipe(m_fds) == -1) { __TACOPIE_THROW(error, "pipe() failure"); }
+
+  //! neither notify() nor clr_buffer() must ever block
+  for (fd_t fd : m_fds) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+  }
+#endif /* __linux__ */
 }
 
 self_pipe::~self_pipe(void) {
-  if (m_fds[0] != __TACOPIE_INVALID_FD) {
-    close(m_fds[0]);
+  if (m_fds[1] != __TACOPIE_INVALID_FD && m_fds[1] != m_fds[0]) {
+    close(m_fds[1]);
   }
 
-  if (m_fds[1] != __TACOPIE_INVALID_FD) {
-    close(m_fds[1]);
+  if (m_fds[0] != __TACOPIE_INVALID_FD) {
+    close(m_fds[0]);
   }
 }
 
@@ -71,7 +92,20 @@ ___ignore_unused(T1 const&) {}
 //!
 void
 self_pipe::notify(void) {
+  //! a pending notification already guarantees that the poll thread wakes up and rescans
+  if (m_bNotifyPending_a.exchange(true)) {
+    __TACOPIE_METRIC_ADD(coalesced_wakeups, 1)
+    return;
+  }
+
+  __TACOPIE_METRIC_ADD(wakeup_notifications, 1)
+
+#ifdef __linux__
+  std::uint64_t uValue = 1;
+  ___ignore_unused(write(m_fds[1], &uValue, sizeof(uValue)));
+#else
   ___ignore_unused(write(m_fds[1], "a", 1));
+#endif /* __linux__ */
 }
 
 //!
@@ -79,8 +113,17 @@ self_pipe::notify(void) {
 //!
 void
 self_pipe::clr_buffer(void) {
+#ifdef __linux__
+  std::uint64_t uValue;
+  ___ignore_unused(read(m_fds[0], &uValue, sizeof(uValue)));
+#else
   char buf[1024];
   ___ignore_unused(read(m_fds[0], buf, 1024));
+#endif /* __linux__ */
+
+  //! cleared after reading: a notification skipped in between is still honored, as the poll thread has not rescanned yet
+  //! (the exchange also synchronizes with the skipped notifications)
+  m_bNotifyPending_a.exchange(false);
 }
 
 } // namespace tacopie
@@ -33,6 +33,7 @@
 #include <fcntl.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <poll.h>
 #include <sys/select.h>
 #include <sys/socket.h>
 #include <sys/types.h>
@@ -41,23 +42,19 @@
 
 namespace tacopie {
 
-void
-tcp_socket::connect(const std::string& host, std::uint32_t port, std::uint32_t timeout_msecs) {
-  //! Reset host and port
-  m_host = host;
-  m_port = port;
-
-  create_socket_if_necessary();
-  check_or_set_type(type::CLIENT);
+//!
+//! build the address of the remote server to connect to
+//!
 
-  struct sockaddr_storage ss;
+static socklen_t
+get_connect_addr(const std::string& host, std::uint32_t port, bool is_ipv6, struct sockaddr_storage& ss) {
   socklen_t addr_len;
 
   //! 0-init addr info struct
   std::memset(&ss, 0, sizeof(ss));
 
   //! Handle case of unix sockets if port is 0
-  bool is_unix_socket = m_port == 0;
+  bool is_unix_socket = port == 0;
   if (is_unix_socket) {
     //! init sockaddr_un struct
     struct sockaddr_un* addr = reinterpret_cast<struct sockaddr_un*>(&ss);
@@ -66,7 +63,7 @@ tcp_socket::connect(const std::string& host, std::uint32_t port, std::uint32_t t
     //! Remaining fields
     ss.ss_family = AF_UNIX;
     addr_len     = sizeof(*addr);
-  } else if (is_ipv6()) {
+  } else if (is_ipv6) {
     //! init sockaddr_in6 struct
     struct sockaddr_in6* addr = reinterpret_cast<struct sockaddr_in6*>(&ss);
     //! convert addr
@@ -100,6 +97,29 @@ tcp_socket::connect(const std::string& host, std::uint32_t port, std::uint32_t t
     freeaddrinfo(result);
   }
 
+  return addr_len;
+}
+
+void
+tcp_socket::connect(const std::string& host, std::uint32_t port, std::uint32_t timeout_msecs) {
+  //! Reset host and port
+  m_sHost = host;
+  m_uPort = port;
+
+  create_socket_if_necessary();
+  check_or_set_type(type::CLIENT);
+
+  try {
+    apply_options(true);
+  }
+  catch (const tacopie_error&) {
+    close();
+    throw;
+  }
+
+  struct sockaddr_storage ss;
+  socklen_t addr_len = get_connect_addr(host, port, is_ipv6(), ss);
+
   if (timeout_msecs > 0) {
     //! for timeout connection handling:
     //!  1. set socket to non blocking
@@ -157,18 +177,79 @@ tcp_socket::connect(const std::string& host, std::uint32_t port, std::uint32_t t
   }
 }
 
+bool
+tcp_socket::connect_non_blocking(const std::string& host, std::uint32_t port) {
+  //! Reset host and port
+  m_sHost = host;
+  m_uPort = port;
+
+  create_socket_if_necessary();
+  check_or_set_type(type::CLIENT);
+
+  try {
+    apply_options(true);
+  }
+  catch (const tacopie_error&) {
+    close();
+    throw;
+  }
+
+  struct sockaddr_storage ss;
+  socklen_t addr_len = get_connect_addr(host, port, is_ipv6(), ss);
+
+  if (fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL, 0) | O_NONBLOCK) == -1) {
+    close();
+    __TACOPIE_THROW(error, "connect() set non-blocking failure");
+  }
+
+  int ret = ::connect(m_fd, reinterpret_cast<const struct sockaddr*>(&ss), addr_len);
+  if (ret < 0 && errno != EINPROGRESS) {
+    close();
+    __TACOPIE_THROW(error, "connect() failure");
+  }
+
+  return ret == 0;
+}
+
+void
+tcp_socket::finish_connect(void) {
+  //! Make sure there are no async connection errors
+  int err       = 0;
+  socklen_t len = sizeof(err);
+  if (getsockopt(m_fd, SOL_SOCKET, SO_ERROR, &err, &len) == -1 || err != 0) {
+    __TACOPIE_THROW(error, "connect() failure");
+  }
+
+  //! Set back to blocking mode as the user of this class is expecting
+  if (fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL, 0) & (~O_NONBLOCK)) == -1) {
+    __TACOPIE_THROW(error, "connect() set blocking failure");
+  }
+}
+
 //!
 //! server socket operations
 //!
 
 void
-tcp_socket::bind(const std::string& host, std::uint32_t port) {
+tcp_socket::bind(const std::string& host, std::uint32_t port, bool bReusePort) {
   //! Reset host and port
-  m_host = host;
-  m_port = port;
+  m_sHost = host;
+  m_uPort = port;
 
   create_socket_if_necessary();
   check_or_set_type(type::SERVER);
+  apply_options(false);
+
+  if (bReusePort) {
+#ifdef SO_REUSEPORT
+    int enabled = 1;
+    if (setsockopt(m_fd, SOL_SOCKET, SO_REUSEPORT, &enabled, sizeof(enabled)) == -1) {
+      __TACOPIE_THROW(error, "setsockopt(SO_REUSEPORT) failure");
+    }
+#else
+    __TACOPIE_THROW(error, "SO_REUSEPORT is not supported on this platform");
+#endif /* SO_REUSEPORT */
+  }
 
   struct sockaddr_storage ss;
   socklen_t addr_len;
@@ -177,7 +258,7 @@ tcp_socket::bind(const std::string& host, std::uint32_t port) {
   std::memset(&ss, 0, sizeof(ss));
 
   //! Handle case of unix sockets if port is 0
-  bool is_unix_socket = m_port == 0;
+  bool is_unix_socket = m_uPort == 0;
   if (is_unix_socket) {
     //! init sockaddr_un struct
     struct sockaddr_un* addr = reinterpret_cast<struct sockaddr_un*>(&ss);
@@ -234,7 +315,40 @@ tcp_socket::close(void) {
   }
 
   m_fd   = __TACOPIE_INVALID_FD;
-  m_type = type::UNKNOWN;
+  m_eType = type::UNKNOWN;
+}
+
+void
+tcp_socket::set_non_blocking(bool bNonBlocking) {
+  create_socket_if_necessary();
+
+  int nFlags = fcntl(m_fd, F_GETFL, 0);
+  nFlags     = bNonBlocking ? (nFlags | O_NONBLOCK) : (nFlags & (~O_NONBLOCK));
+
+  if (fcntl(m_fd, F_SETFL, nFlags) == -1) { __TACOPIE_THROW(error, "fcntl() failure"); }
+}
+
+bool
+tcp_socket::is_peer_closed(void) const {
+  if (m_fd == __TACOPIE_INVALID_FD) { return true; }
+
+  struct pollfd pollFd;
+  pollFd.fd      = m_fd;
+  pollFd.events  = POLLIN;
+  pollFd.revents = 0;
+
+  int nRet = ::poll(&pollFd, 1, 0);
+  if (nRet < 0) { return errno != EINTR; }
+  if (nRet == 0) { return false; }
+  if (pollFd.revents & (POLLERR | POLLNVAL)) { return true; }
+
+  //! readable: either pending data or the end of the stream
+  char cByte;
+  ssize_t nRdSize = ::recv(m_fd, &cByte, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (nRdSize == 0) { return true; }
+  if (nRdSize < 0) { return errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR; }
+
+  return false;
 }
 //!
 //! create a new socket if no socket has been initialized yet
@@ -248,7 +362,7 @@ tcp_socket::create_socket_if_necessary(void) {
   //! handle case of unix sockets by checking whether the port is 0 or not
   //! also handle ipv6 addr
   short family;
-  if (m_port == 0) {
+  if (m_uPort == 0) {
     family = AF_UNIX;
   } else if (is_ipv6()) {
     family = AF_INET6;
@@ -257,7 +371,7 @@ tcp_socket::create_socket_if_necessary(void) {
   }
 
   m_fd   = socket(family, SOCK_STREAM, 0);
-  m_type = type::UNKNOWN;
+  m_eType = type::UNKNOWN;
 
   if (m_fd == __TACOPIE_INVALID_FD) {
       __TACOPIE_THROW(error, "tcp_socket::create_socket_if_necessary: socket() failure");
@@ -0,0 +1,436 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//! GetQueuedCompletionStatusEx and SetFileCompletionNotificationModes require windows vista
+#if defined(__GNUC__) && defined(_WIN32) && (!defined(_WIN32_WINNT) || _WIN32_WINNT < 0x0600)
+#undef _WIN32_WINNT
+#define _WIN32_WINNT 0x0600
+#endif /* __GNUC__ && _WIN32 && _WIN32_WINNT */
+
+#include <tacopie/network/poller.hpp>
+
+//! guard for bulk content integration depending on how user integrates the library
+#ifdef __TACOPIE_HAS_IOCP
+
+#include <tacopie/utils/error.hpp>
+#include <tacopie/utils/logger.hpp>
+
+#include <climits>
+#include <cstring>
+
+#include <winsock2.h>
+#include <winternl.h>
+
+#ifndef __TACOPIE_IOCP_INITIAL_NB_ENTRIES
+#define __TACOPIE_IOCP_INITIAL_NB_ENTRIES 256
+#endif /* __TACOPIE_IOCP_INITIAL_NB_ENTRIES */
+
+//! not exposed by every SDK
+#ifndef SIO_BASE_HANDLE
+#define SIO_BASE_HANDLE 0x48000022
+#endif /* SIO_BASE_HANDLE */
+
+#ifndef FILE_OPEN
+#define FILE_OPEN 0x00000001
+#endif /* FILE_OPEN */
+
+namespace tacopie {
+
+//!
+//! AFD driver definitions (not exposed by the SDK)
+//!
+
+static const ULONG g_uIoctlAfdPoll = 0x00012024;
+
+static const ULONG g_uAfdPollReceive     = 0x0001;
+static const ULONG g_uAfdPollSend        = 0x0004;
+static const ULONG g_uAfdPollDisconnect  = 0x0008;
+static const ULONG g_uAfdPollAbort       = 0x0010;
+static const ULONG g_uAfdPollLocalClose  = 0x0020;
+static const ULONG g_uAfdPollAccept      = 0x0080;
+static const ULONG g_uAfdPollConnectFail = 0x0100;
+
+static const NTSTATUS g_nStatusSuccess   = 0x00000000;
+static const NTSTATUS g_nStatusPending   = 0x00000103;
+static const NTSTATUS g_nStatusCancelled = static_cast<NTSTATUS>(0xC0000120);
+
+struct afd_poll_handle_info {
+  HANDLE   hSocket;
+  ULONG    uEvents;
+  NTSTATUS nStatus;
+};
+
+struct afd_poll_info {
+  LARGE_INTEGER        timeout;
+  ULONG                uNbHandles;
+  ULONG                uExclusive;
+  afd_poll_handle_info handles[1];
+};
+
+//!
+//! ntdll functions, loaded at runtime as ntdll.lib is not part of the SDK import libraries
+//!
+
+typedef NTSTATUS(NTAPI* nt_create_file_t)(PHANDLE, ACCESS_MASK, POBJECT_ATTRIBUTES, PIO_STATUS_BLOCK, PLARGE_INTEGER, ULONG, ULONG, ULONG, ULONG, PVOID, ULONG);
+typedef NTSTATUS(NTAPI* nt_device_io_control_file_t)(HANDLE, HANDLE, PIO_APC_ROUTINE, PVOID, PIO_STATUS_BLOCK, ULONG, PVOID, ULONG, PVOID, ULONG);
+
+struct ntdll_functions {
+  nt_create_file_t            pNtCreateFile;
+  nt_device_io_control_file_t pNtDeviceIoControlFile;
+};
+
+static ntdll_functions
+load_ntdll_functions(void) {
+  ntdll_functions functions = {nullptr, nullptr};
+  HMODULE hNtdll            = GetModuleHandleW(L"ntdll.dll");
+
+  if (hNtdll) {
+    functions.pNtCreateFile          = reinterpret_cast<nt_create_file_t>(reinterpret_cast<void*>(GetProcAddress(hNtdll, "NtCreateFile")));
+    functions.pNtDeviceIoControlFile = reinterpret_cast<nt_device_io_control_file_t>(reinterpret_cast<void*>(GetProcAddress(hNtdll, "NtDeviceIoControlFile")));
+  }
+
+  return functions;
+}
+
+static const ntdll_functions&
+get_ntdll_functions(void) {
+  static const ntdll_functions functions = load_ntdll_functions();
+  return functions;
+}
+
+//!
+//! poll requests must target the base provider socket, not a socket wrapped by a layered service provider
+//!
+
+static HANDLE
+get_base_socket(fd_t fd) {
+  SOCKET baseSocket = INVALID_SOCKET;
+  DWORD dwBytes     = 0;
+
+  if (WSAIoctl(fd, SIO_BASE_HANDLE, NULL, 0, &baseSocket, sizeof(baseSocket), &dwBytes, NULL, NULL) == SOCKET_ERROR) {
+    return reinterpret_cast<HANDLE>(fd);
+  }
+
+  return reinterpret_cast<HANDLE>(baseSocket);
+}
+
+//!
+//! poll state of a socket
+//!  * iosb: status block of the request in flight, also used to cancel it
+//!  * pollInfo: input and output of the request in flight
+//!  * fd: registered socket
+//!  * hBaseSocket: base provider socket of fd
+//!  * nEvents: events registered by update()
+//!  * nPolledEvents: events of the request in flight
+//!  * bPending: whether a request is in flight
+//!  * bCancelled: whether the request in flight has been cancelled
+//!
+//! the state must stay alive while a request is in flight, as the kernel writes to iosb and pollInfo on completion
+//!
+
+struct iocp_poller::afd_socket {
+  IO_STATUS_BLOCK iosb;
+  afd_poll_info   pollInfo;
+  fd_t            fd;
+  HANDLE          hBaseSocket;
+  int             nEvents;
+  int             nPolledEvents;
+  bool            bPending;
+  bool            bCancelled;
+};
+
+//!
+//! ctor & dtor
+//!
+
+iocp_poller::iocp_poller(void)
+: m_hCompletionPort(CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 1))
+, m_hAfd(INVALID_HANDLE_VALUE)
+, m_vctCompletionEntries(__TACOPIE_IOCP_INITIAL_NB_ENTRIES) {
+  if (m_hCompletionPort == NULL) { __TACOPIE_THROW(error, "CreateIoCompletionPort() failure"); }
+
+  const auto& ntdll = get_ntdll_functions();
+
+  if (!ntdll.pNtCreateFile || !ntdll.pNtDeviceIoControlFile) {
+    CloseHandle(m_hCompletionPort);
+    __TACOPIE_THROW(error, "iocp poller backend is not supported by this system");
+  }
+
+  //! any name under \Device\Afd opens a handle to the driver
+  static wchar_t s_wszAfdName[] = L"\\Device\\Afd\\tacopie";
+
+  UNICODE_STRING afdName;
+  afdName.Length        = sizeof(s_wszAfdName) - sizeof(wchar_t);
+  afdName.MaximumLength = sizeof(s_wszAfdName);
+  afdName.Buffer        = s_wszAfdName;
+
+  OBJECT_ATTRIBUTES attributes;
+  std::memset(&attributes, 0, sizeof(attributes));
+  attributes.Length     = sizeof(attributes);
+  attributes.ObjectName = &afdName;
+
+  IO_STATUS_BLOCK iosb;
+  NTSTATUS nStatus = ntdll.pNtCreateFile(&m_hAfd, SYNCHRONIZE, &attributes, &iosb, NULL, 0, FILE_SHARE_READ | FILE_SHARE_WRITE, FILE_OPEN, 0, NULL, 0);
+
+  if (nStatus != g_nStatusSuccess) {
+    CloseHandle(m_hCompletionPort);
+    __TACOPIE_THROW(error, "could not open the AFD driver");
+  }
+
+  //! poll requests issued on the AFD handle complete on the completion port
+  if (CreateIoCompletionPort(m_hAfd, m_hCompletionPort, 0, 0) == NULL || !SetFileCompletionNotificationModes(m_hAfd, FILE_SKIP_SET_EVENT_ON_HANDLE)) {
+    CloseHandle(m_hAfd);
+    CloseHandle(m_hCompletionPort);
+    __TACOPIE_THROW(error, "could not associate the AFD driver with the completion port");
+  }
+
+  __TACOPIE_LOG(debug, "create iocp_poller");
+}
+
+iocp_poller::~iocp_poller(void) {
+  //! requests in flight write to their poll state on completion: cancel them and wait for them to complete
+  for (auto& it : m_mapSockets) {
+    if (it.second->bPending) {
+      cancel_poll(*it.second);
+      m_mapReleasedSockets.insert({it.second.get(), std::move(it.second)});
+    }
+  }
+  m_mapSockets.clear();
+
+  while (!m_mapReleasedSockets.empty()) {
+    ULONG uNbEntries = 0;
+
+    if (!GetQueuedCompletionStatusEx(m_hCompletionPort, m_vctCompletionEntries.data(), static_cast<ULONG>(m_vctCompletionEntries.size()), &uNbEntries, 1000, FALSE)) {
+      break;
+    }
+
+    for (ULONG i = 0; i < uNbEntries; ++i) {
+      m_mapReleasedSockets.erase(reinterpret_cast<afd_socket*>(m_vctCompletionEntries[i].lpOverlapped));
+    }
+  }
+
+  //! requests that did not complete in time are leaked rather than completed on freed memory
+  for (auto& it : m_mapReleasedSockets) { it.second.release(); }
+
+  CloseHandle(m_hAfd);
+  CloseHandle(m_hCompletionPort);
+}
+
+//!
+//! poll requests management
+//!
+
+void
+iocp_poller::submit_poll(afd_socket& socket) {
+  //! errors and hang-ups are always polled for
+  ULONG uAfdEvents = g_uAfdPollLocalClose | g_uAfdPollAbort | g_uAfdPollConnectFail;
+  if (socket.nEvents & rd) { uAfdEvents |= g_uAfdPollReceive | g_uAfdPollDisconnect | g_uAfdPollAccept; }
+  if (socket.nEvents & wr) { uAfdEvents |= g_uAfdPollSend; }
+
+  socket.pollInfo.timeout.QuadPart    = LLONG_MAX;
+  socket.pollInfo.uNbHandles          = 1;
+  socket.pollInfo.uExclusive          = FALSE;
+  socket.pollInfo.handles[0].hSocket  = socket.hBaseSocket;
+  socket.pollInfo.handles[0].uEvents  = uAfdEvents;
+  socket.pollInfo.handles[0].nStatus  = g_nStatusSuccess;
+  socket.iosb.Status                  = g_nStatusPending;
+
+  //! the poll state is given as APC context, which is reported as the overlapped pointer of the completion
+  NTSTATUS nStatus = get_ntdll_functions().pNtDeviceIoControlFile(m_hAfd, NULL, NULL, &socket, &socket.iosb, g_uIoctlAfdPoll,
+                                                                  &socket.pollInfo, sizeof(socket.pollInfo), &socket.pollInfo, sizeof(socket.pollInfo));
+
+  if (nStatus != g_nStatusSuccess && nStatus != g_nStatusPending) {
+    __TACOPIE_LOG(error, "IOCTL_AFD_POLL failure");
+    return;
+  }
+
+  socket.bPending      = true;
+  socket.bCancelled    = false;
+  socket.nPolledEvents = socket.nEvents;
+}
+
+void
+iocp_poller::cancel_poll(afd_socket& socket) {
+  if (!socket.bPending || socket.bCancelled) { return; }
+
+  //! the request then completes with STATUS_CANCELLED, or normally if it completed in the meantime
+  if (!CancelIoEx(m_hAfd, reinterpret_cast<LPOVERLAPPED>(&socket.iosb)) && GetLastError() != ERROR_NOT_FOUND) {
+    __TACOPIE_LOG(error, "CancelIoEx() failure");
+  }
+
+  socket.bCancelled = true;
+}
+
+void
+iocp_poller::handle_completion(afd_socket* pSocket, std::vector<poll_event>& vctEvents) {
+  //! the socket has been unregistered while its request was in flight
+  auto itReleased = m_mapReleasedSockets.find(pSocket);
+  if (itReleased != m_mapReleasedSockets.end()) {
+    m_mapReleasedSockets.erase(itReleased);
+    return;
+  }
+
+  auto& socket     = *pSocket;
+  socket.bPending  = false;
+  NTSTATUS nStatus = socket.iosb.Status;
+  int nEvents      = none;
+
+  if (nStatus == g_nStatusCancelled) {
+    //! cancelled to change the polled events, re-issued below
+  } else if (nStatus < 0) {
+    //! the request failed: report it as both read and write availability so that the error gets noticed
+    nEvents = rd | wr;
+  } else if (socket.pollInfo.uNbHandles) {
+    ULONG uAfdEvents = socket.pollInfo.handles[0].uEvents;
+
+    //! the socket has been closed without being unregistered first
+    if (uAfdEvents & g_uAfdPollLocalClose) {
+      m_mapSockets.erase(socket.fd);
+      return;
+    }
+
+    //! errors and hang-ups are reported as both read and write availability, as select does
+    if (uAfdEvents & (g_uAfdPollReceive | g_uAfdPollDisconnect | g_uAfdPollAccept | g_uAfdPollAbort | g_uAfdPollConnectFail)) { nEvents |= rd; }
+    if (uAfdEvents & (g_uAfdPollSend | g_uAfdPollAbort | g_uAfdPollConnectFail)) { nEvents |= wr; }
+  }
+
+  //! a request completing while being cancelled might report events that are not registered anymore
+  nEvents &= socket.nEvents;
+  if (nEvents != none) { vctEvents.push_back({socket.fd, nEvents}); }
+
+  //! requests are one-shot: re-issue it to keep level-triggered semantics
+  submit_poll(socket);
+}
+
+//!
+//! register events for fd
+//! requests are issued right away, even on a pending wait()
+//!
+
+void
+iocp_poller::update(fd_t fd, int, int nNewEvents) {
+  std::lock_guard<std::mutex> lock(m_mtxSockets);
+
+  auto it = m_mapSockets.find(fd);
+
+  if (it == m_mapSockets.end()) {
+    if (nNewEvents == none) { return; }
+
+    std::unique_ptr<afd_socket> ptrSocket(new afd_socket());
+    ptrSocket->fd          = fd;
+    ptrSocket->hBaseSocket = get_base_socket(fd);
+
+    it = m_mapSockets.insert({fd, std::move(ptrSocket)}).first;
+  }
+
+  auto& socket   = *it->second;
+  socket.nEvents = nNewEvents;
+
+  if (nNewEvents == none) {
+    //! the poll state must outlive the request in flight
+    if (socket.bPending) {
+      cancel_poll(socket);
+      m_mapReleasedSockets.insert({it->second.get(), std::move(it->second)});
+    }
+
+    m_mapSockets.erase(it);
+    return;
+  }
+
+  if (!socket.bPending) {
+    submit_poll(socket);
+  } else if (socket.nPolledEvents != socket.nEvents) {
+    //! the request is re-issued with the new events once its cancellation completes
+    cancel_poll(socket);
+  }
+}
+
+//!
+//! wait for events
+//!
+
+void
+iocp_poller::wait(std::vector<poll_event>& vctEvents, int nTimeoutMsecs) {
+  vctEvents.clear();
+
+  ULONG uNbEntries = 0;
+  DWORD dwTimeout  = nTimeoutMsecs < 0 ? INFINITE : static_cast<DWORD>(nTimeoutMsecs);
+
+  if (!GetQueuedCompletionStatusEx(m_hCompletionPort, m_vctCompletionEntries.data(), static_cast<ULONG>(m_vctCompletionEntries.size()), &uNbEntries, dwTimeout, FALSE)) {
+    if (GetLastError() != WAIT_TIMEOUT) { __TACOPIE_LOG(error, "GetQueuedCompletionStatusEx() failure"); }
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mtxSockets);
+
+  for (ULONG i = 0; i < uNbEntries; ++i) {
+    //! packets posted by wakeup() carry no overlapped pointer
+    if (!m_vctCompletionEntries[i].lpOverlapped) { continue; }
+
+    handle_completion(reinterpret_cast<afd_socket*>(m_vctCompletionEntries[i].lpOverlapped), vctEvents);
+  }
+
+  if (uNbEntries == m_vctCompletionEntries.size()) {
+    m_vctCompletionEntries.resize(m_vctCompletionEntries.size() * 2);
+  }
+}
+
+//!
+//! requests are issued right away, even on a pending wait()
+//!
+
+bool
+iocp_poller::needs_wakeup_on_update(void) const {
+  return false;
+}
+
+//!
+//! buffers reallocation
+//!
+
+void
+iocp_poller::reallocate_buffers(void) {
+  //! value-initialized: the new buffer is written (and thus placed) by the calling thread
+  std::vector<OVERLAPPED_ENTRY>(m_vctCompletionEntries.size()).swap(m_vctCompletionEntries);
+}
+
+//!
+//! wake up a pending wait() with an empty completion packet
+//!
+
+bool
+iocp_poller::wakeup(void) {
+  return PostQueuedCompletionStatus(m_hCompletionPort, 0, 0, NULL) != 0;
+}
+
+//!
+//! backend getter
+//!
+
+poller_backend
+iocp_poller::get_backend(void) const {
+  return poller_backend::iocp;
+}
+
+} // namespace tacopie
+
+#endif /* __TACOPIE_HAS_IOCP */
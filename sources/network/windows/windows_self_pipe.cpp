@@ -25,6 +25,7 @@
 
 #include <tacopie/network/self_pipe.hpp>
 #include <tacopie/utils/error.hpp>
+#include <tacopie/utils/metrics.hpp>
 
 #include <winsock2.h>
 
@@ -37,7 +38,8 @@ namespace tacopie {
 //! ctor & dtor
 //!
 self_pipe::self_pipe(void)
-: m_fd(__TACOPIE_INVALID_FD) {
+: m_fd(__TACOPIE_INVALID_FD)
+, m_bNotifyPending_a(false) {
   //! Create a server
   m_fd = ::socket(AF_INET, SOCK_DGRAM, 0);
   if (m_fd == __TACOPIE_INVALID_FD) { __TACOPIE_THROW(error, "fail socket()"); }
@@ -88,6 +90,14 @@ self_pipe::get_write_fd(void) const {
 //!
 void
 self_pipe::notify(void) {
+  //! a pending notification already guarantees that the poll thread wakes up and rescans
+  if (m_bNotifyPending_a.exchange(true)) {
+    __TACOPIE_METRIC_ADD(coalesced_wakeups, 1)
+    return;
+  }
+
+  __TACOPIE_METRIC_ADD(wakeup_notifications, 1)
+
   (void) sendto(m_fd, "a", 1, 0, &m_sockaddr, m_nAddrLen);
 }
 
@@ -98,6 +108,9 @@ void
 self_pipe::clr_buffer(void) {
   char buf[1024];
   (void) recvfrom(m_fd, buf, 1024, 0, &m_sockaddr, &m_nAddrLen);
+
+  //! cleared after reading: a notification skipped in between is still honored, as the poll thread has not rescanned yet
+  m_bNotifyPending_a.exchange(false);
 }
 
 } // namespace tacopie
@@ -53,22 +53,18 @@
 
 namespace tacopie {
 
-void
-tcp_socket::connect(const std::string& sHost, std::uint32_t uPort, std::uint32_t uTimeoutMsecs) {
-  //! Reset host and port
-  m_sHost = sHost;
-  m_uPort = uPort;
+//!
+//! build the address of the remote server to connect to
+//!
 
-  create_socket_if_necessary();
-  check_or_set_type(type::CLIENT);
-
-  sockaddr_storage  sockAddrStorage;
-  socklen_t         nAddrLen;
+static socklen_t
+get_connect_addr(const std::string& sHost, std::uint32_t uPort, bool bIsIPv6, sockaddr_storage& sockAddrStorage) {
+  socklen_t nAddrLen;
 
   //! 0-init addr info struct
   std::memset(&sockAddrStorage, 0, sizeof(sockAddrStorage));
 
-  if (is_ipv6()) {
+  if (bIsIPv6) {
     //! init sockaddr_in6 struct
     sockaddr_in6* pSockAddr6 = reinterpret_cast<sockaddr_in6*>(&sockAddrStorage);
     //! convert addr
@@ -104,6 +100,29 @@ tcp_socket::connect(const std::string& sHost, std::uint32_t uPort, std::uint32_t
     freeaddrinfo(pAddrInfoResult);
   }
 
+  return nAddrLen;
+}
+
+void
+tcp_socket::connect(const std::string& sHost, std::uint32_t uPort, std::uint32_t uTimeoutMsecs) {
+  //! Reset host and port
+  m_sHost = sHost;
+  m_uPort = uPort;
+
+  create_socket_if_necessary();
+  check_or_set_type(type::CLIENT);
+
+  try {
+    apply_options(true);
+  }
+  catch (const tacopie_error&) {
+    close();
+    throw;
+  }
+
+  sockaddr_storage  sockAddrStorage;
+  socklen_t         nAddrLen = get_connect_addr(sHost, uPort, is_ipv6(), sockAddrStorage);
+
   if (uTimeoutMsecs > 0) {
     //! for timeout connection handling:
     //!  1. set socket to non blocking
@@ -164,18 +183,73 @@ tcp_socket::connect(const std::string& sHost, std::uint32_t uPort, std::uint32_t
   }
 }
 
+bool
+tcp_socket::connect_non_blocking(const std::string& sHost, std::uint32_t uPort) {
+  //! Reset host and port
+  m_sHost = sHost;
+  m_uPort = uPort;
+
+  create_socket_if_necessary();
+  check_or_set_type(type::CLIENT);
+
+  try {
+    apply_options(true);
+  }
+  catch (const tacopie_error&) {
+    close();
+    throw;
+  }
+
+  sockaddr_storage  sockAddrStorage;
+  socklen_t         nAddrLen = get_connect_addr(sHost, uPort, is_ipv6(), sockAddrStorage);
+
+  u_long uMode = 1;
+  if (ioctlsocket(m_fd, FIONBIO, &uMode) != 0) {
+    close();
+    __TACOPIE_THROW(error, "connect() set non-blocking failure");
+  }
+
+  int nReturn = ::connect(m_fd, reinterpret_cast<const sockaddr*>(&sockAddrStorage), nAddrLen);
+  if (nReturn == -1 && WSAGetLastError() != WSAEWOULDBLOCK) {
+    close();
+    __TACOPIE_THROW(error, "connect() failure");
+  }
+
+  return nReturn == 0;
+}
+
+void
+tcp_socket::finish_connect(void) {
+  //! Make sure there are no async connection errors
+  int nErr = 0;
+  int nLen = sizeof(nErr);
+  if (getsockopt(m_fd, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&nErr), &nLen) == -1 || nErr != 0) {
+    __TACOPIE_THROW(error, "connect() failure");
+  }
+
+  //! Set back to blocking mode as the user of this class is expecting
+  u_long uMode = 0;
+  if (ioctlsocket(m_fd, FIONBIO, &uMode) != 0) {
+    __TACOPIE_THROW(error, "connect() set blocking failure");
+  }
+}
+
 //!
 //! server socket operations
 //!
 
 void
-tcp_socket::bind(const std::string& sHost, std::uint32_t uPort) {
+tcp_socket::bind(const std::string& sHost, std::uint32_t uPort, bool bReusePort) {
   //! Reset host and port
   m_sHost = sHost;
   m_uPort = uPort;
 
+  //! windows SO_REUSEADDR does not load-balance connections and allows port hijacking
+  if (bReusePort) { __TACOPIE_THROW(error, "SO_REUSEPORT is not supported on windows"); }
+
   create_socket_if_necessary();
   check_or_set_type(type::SERVER);
+  apply_options(false);
 
   sockaddr_storage  sockAddrStorage;
   socklen_t         nAddrLen;
@@ -233,6 +307,41 @@ tcp_socket::close(void) {
   m_fd      = __TACOPIE_INVALID_FD;
   m_eType   = type::UNKNOWN;
 }
+
+void
+tcp_socket::set_non_blocking(bool bNonBlocking) {
+  create_socket_if_necessary();
+
+  u_long uMode = bNonBlocking ? 1 : 0;
+
+  if (ioctlsocket(m_fd, FIONBIO, &uMode) != 0) { __TACOPIE_THROW(error, "ioctlsocket() failure"); }
+}
+
+bool
+tcp_socket::is_peer_closed(void) const {
+  if (m_fd == __TACOPIE_INVALID_FD) { return true; }
+
+  //! select is used as WSAPoll is not available before windows vista (windows fd_sets are not limited by fd values)
+  FD_SET fdSet;
+  FD_ZERO(&fdSet);
+  FD_SET(m_fd, &fdSet);
+
+  struct timeval timeVal;
+  timeVal.tv_sec  = 0;
+  timeVal.tv_usec = 0;
+
+  int nRet = select(static_cast<int>(m_fd) + 1, &fdSet, NULL, NULL, &timeVal);
+  if (nRet == SOCKET_ERROR) { return true; }
+  if (nRet == 0) { return false; }
+
+  //! readable: either pending data or the end of the stream (recv cannot block as the socket is readable)
+  char cByte;
+  int nRdSize = ::recv(m_fd, &cByte, 1, MSG_PEEK);
+  if (nRdSize == 0) { return true; }
+  if (nRdSize == SOCKET_ERROR) { return WSAGetLastError() != WSAEWOULDBLOCK; }
+
+  return false;
+}
 //!
 //! create a new socket if no socket has been initialized yet
 //!
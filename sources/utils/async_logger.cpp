@@ -0,0 +1,281 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <tacopie/utils/async_logger.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace tacopie {
+
+static const char black[]  = {0x1b, '[', '1', ';', '3', '0', 'm', 0};
+static const char red[]    = {0x1b, '[', '1', ';', '3', '1', 'm', 0};
+static const char yellow[] = {0x1b, '[', '1', ';', '3', '3', 'm', 0};
+static const char blue[]   = {0x1b, '[', '1', ';', '3', '4', 'm', 0};
+static const char normal[] = {0x1b, '[', '0', ';', '3', '9', 'm', 0};
+
+//!
+//! ring buffers of the calling thread, one per logger it logged to
+//!
+
+struct thread_rings {
+  std::vector<std::pair<std::uint64_t, std::shared_ptr<async_logger::ring>>> vctRings;
+};
+
+static thread_rings&
+get_thread_rings(void) {
+  static thread_local thread_rings rings;
+  return rings;
+}
+
+static std::atomic<std::uint64_t> g_uNextLoggerId_a(1);
+
+//!
+//! ctor & dtor
+//!
+
+async_logger::async_logger(log_level level)
+: m_eLevel_a(level)
+, m_uId(g_uNextLoggerId_a++)
+, m_uNbDropped_a(0)
+, m_uNbReportedDrops(0)
+, m_uNbFlushRequests(0)
+, m_uNbFlushesDone(0)
+, m_bShouldStop(false) {
+  m_threadFlusher = std::thread(std::bind(&async_logger::run, this));
+}
+
+async_logger::~async_logger(void) {
+  {
+    std::lock_guard<std::mutex> lock(m_mtxFlush);
+    m_bShouldStop = true;
+    m_cvFlush.notify_all();
+  }
+
+  m_threadFlusher.join();
+
+  //! the threads release their ring buffer the next time they log
+  std::lock_guard<std::mutex> lock(m_mtxRings);
+  for (auto& ptrRing : m_vctRings) { ptrRing->bOrphaned_a = true; }
+}
+
+//!
+//! level
+//!
+
+bool
+async_logger::is_enabled(log_level level) const {
+  return m_eLevel_a.load(std::memory_order_relaxed) >= level;
+}
+
+void
+async_logger::set_level(log_level level) {
+  m_eLevel_a = level;
+}
+
+//!
+//! logging
+//!
+
+void
+async_logger::debug(const std::string& msg, const std::string& file, std::size_t line) {
+  push(log_level::debug, msg, file, line);
+}
+
+void
+async_logger::info(const std::string& msg, const std::string& file, std::size_t line) {
+  push(log_level::info, msg, file, line);
+}
+
+void
+async_logger::warn(const std::string& msg, const std::string& file, std::size_t line) {
+  push(log_level::warn, msg, file, line);
+}
+
+void
+async_logger::error(const std::string& msg, const std::string& file, std::size_t line) {
+  push(log_level::error, msg, file, line);
+}
+
+async_logger::ring&
+async_logger::get_thread_ring(void) {
+  auto& vctRings = get_thread_rings().vctRings;
+
+  for (const auto& pairRing : vctRings) {
+    if (pairRing.first == m_uId) { return *pairRing.second; }
+  }
+
+  //! first message of this thread for this logger: release the ring buffers of the destroyed loggers
+  vctRings.erase(std::remove_if(vctRings.begin(), vctRings.end(),
+                     [](const std::pair<std::uint64_t, std::shared_ptr<ring>>& pairRing) { return pairRing.second->bOrphaned_a.load(); }),
+      vctRings.end());
+
+  auto ptrRing = std::make_shared<ring>();
+  vctRings.push_back({m_uId, ptrRing});
+
+  std::lock_guard<std::mutex> lock(m_mtxRings);
+  m_vctRings.push_back(ptrRing);
+
+  return *ptrRing;
+}
+
+void
+async_logger::push(log_level level, const std::string& msg, const std::string& file, std::size_t line) {
+  if (!is_enabled(level)) { return; }
+
+  auto& threadRing  = get_thread_ring();
+  std::size_t uTail = threadRing.uTail_a.load(std::memory_order_relaxed);
+
+  if (uTail - threadRing.uHead_a.load(std::memory_order_acquire) >= __TACOPIE_ASYNC_LOGGER_RING_SIZE) {
+    threadRing.uNbDropped_a.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  auto& logEntry  = threadRing.vctEntries[uTail & (__TACOPIE_ASYNC_LOGGER_RING_SIZE - 1)];
+  logEntry.eLevel = level;
+  logEntry.uLine  = line;
+
+  //! keep the end of the file path, which is the most meaningful part
+  std::size_t uFileSize = std::min(file.size(), static_cast<std::size_t>(__TACOPIE_ASYNC_LOGGER_FILE_SIZE));
+  std::memcpy(logEntry.arrFile, file.data() + file.size() - uFileSize, uFileSize);
+  logEntry.uFileSize = static_cast<std::uint32_t>(uFileSize);
+
+  std::size_t uMessageSize = std::min(msg.size(), static_cast<std::size_t>(__TACOPIE_ASYNC_LOGGER_MESSAGE_SIZE));
+  std::memcpy(logEntry.arrMessage, msg.data(), uMessageSize);
+  logEntry.uMessageSize = static_cast<std::uint32_t>(uMessageSize);
+
+  threadRing.uTail_a.store(uTail + 1, std::memory_order_release);
+}
+
+//!
+//! flush
+//!
+
+void
+async_logger::flush(void) {
+  std::unique_lock<std::mutex> lock(m_mtxFlush);
+
+  //! a flush already in progress might have missed the latest messages: wait for the next one
+  std::uint64_t uFlushRequest = ++m_uNbFlushRequests;
+  m_cvFlush.notify_all();
+  m_cvFlush.wait(lock, [&] { return m_uNbFlushesDone >= uFlushRequest || m_bShouldStop; });
+}
+
+std::uint64_t
+async_logger::get_nb_dropped_messages(void) const {
+  std::uint64_t uNbDropped = m_uNbDropped_a;
+
+  std::lock_guard<std::mutex> lock(m_mtxRings);
+  for (const auto& ptrRing : m_vctRings) { uNbDropped += ptrRing->uNbDropped_a; }
+
+  return uNbDropped;
+}
+
+void
+async_logger::run(void) {
+  std::unique_lock<std::mutex> lock(m_mtxFlush);
+
+  while (!m_bShouldStop) {
+    m_cvFlush.wait_for(lock, std::chrono::milliseconds(__TACOPIE_ASYNC_LOGGER_FLUSH_INTERVAL),
+        [&] { return m_bShouldStop || m_uNbFlushRequests > m_uNbFlushesDone; });
+
+    std::uint64_t uNbFlushRequests = m_uNbFlushRequests;
+    lock.unlock();
+
+    write_entries();
+
+    lock.lock();
+    m_uNbFlushesDone = uNbFlushRequests;
+    m_cvFlush.notify_all();
+  }
+
+  lock.unlock();
+
+  //! last messages
+  write_entries();
+}
+
+void
+async_logger::write_entries(void) {
+  std::vector<std::shared_ptr<ring>> vctRings;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mtxRings);
+
+    //! forget the ring buffers of the exited threads once drained
+    for (auto it = m_vctRings.begin(); it != m_vctRings.end();) {
+      auto& ptrRing = *it;
+
+      if (ptrRing.use_count() == 1 && ptrRing->uHead_a == ptrRing->uTail_a) {
+        m_uNbDropped_a += ptrRing->uNbDropped_a;
+        it = m_vctRings.erase(it);
+      } else {
+        ++it;
+      }
+    }
+
+    vctRings = m_vctRings;
+  }
+
+  std::string sOut;
+  std::string sErr;
+
+  //! report the messages dropped since the last pass
+  std::uint64_t uNbDropped = get_nb_dropped_messages();
+  if (uNbDropped > m_uNbReportedDrops) {
+    sErr.append("[").append(yellow).append("WARN ").append(normal).append("][tacopie][async_logger] ");
+    sErr.append(std::to_string(uNbDropped - m_uNbReportedDrops)).append(" messages dropped (ring buffer full)\n");
+    m_uNbReportedDrops = uNbDropped;
+  }
+
+  for (const auto& ptrRing : vctRings) {
+    std::size_t uHead = ptrRing->uHead_a.load(std::memory_order_relaxed);
+    std::size_t uTail = ptrRing->uTail_a.load(std::memory_order_acquire);
+
+    for (; uHead != uTail; ++uHead) {
+      const auto& logEntry = ptrRing->vctEntries[uHead & (__TACOPIE_ASYNC_LOGGER_RING_SIZE - 1)];
+      std::string& sOutput = logEntry.eLevel == log_level::error ? sErr : sOut;
+
+      switch (logEntry.eLevel) {
+      case log_level::debug: sOutput.append("[").append(black).append("DEBUG"); break;
+      case log_level::info: sOutput.append("[").append(blue).append("INFO "); break;
+      case log_level::warn: sOutput.append("[").append(yellow).append("WARN "); break;
+      case log_level::error: sOutput.append("[").append(red).append("ERROR"); break;
+      }
+
+      sOutput.append(normal).append("][tacopie][");
+      sOutput.append(logEntry.arrFile, logEntry.uFileSize);
+      sOutput.append(":").append(std::to_string(logEntry.uLine)).append("] ");
+      sOutput.append(logEntry.arrMessage, logEntry.uMessageSize);
+      sOutput.append("\n");
+    }
+
+    ptrRing->uHead_a.store(uHead, std::memory_order_release);
+  }
+
+  if (!sOut.empty()) { std::cout.write(sOut.data(), sOut.size()).flush(); }
+  if (!sErr.empty()) { std::cerr.write(sErr.data(), sErr.size()).flush(); }
+}
+
+} // namespace tacopie
@@ -0,0 +1,157 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <tacopie/utils/buffer_pool.hpp>
+
+namespace tacopie {
+
+namespace utils {
+
+//!
+//! size classes helpers
+//!
+
+static const std::size_t g_uMaxPooledSize = static_cast<std::size_t>(__TACOPIE_BUFFER_POOL_MIN_SIZE)
+                                            << (__TACOPIE_BUFFER_POOL_NB_SIZE_CLASSES - 1);
+
+//! smallest size class able to hold uSize bytes
+static std::size_t
+get_acquire_size_class(std::size_t uSize) {
+  std::size_t uSizeClass = 0;
+
+  while ((static_cast<std::size_t>(__TACOPIE_BUFFER_POOL_MIN_SIZE) << uSizeClass) < uSize) { ++uSizeClass; }
+
+  return uSizeClass;
+}
+
+//! biggest size class whose buffers fit in uCapacity bytes
+static std::size_t
+get_release_size_class(std::size_t uCapacity) {
+  std::size_t uSizeClass = 0;
+
+  while (uSizeClass + 1 < __TACOPIE_BUFFER_POOL_NB_SIZE_CLASSES
+         && (static_cast<std::size_t>(__TACOPIE_BUFFER_POOL_MIN_SIZE) << (uSizeClass + 1)) <= uCapacity) {
+    ++uSizeClass;
+  }
+
+  return uSizeClass;
+}
+
+//! maximum number of buffers of the given size class that can be kept for a budget of uBytes
+static std::size_t
+get_max_cached_buffers(std::size_t uSizeClass, std::size_t uBytes) {
+  std::size_t uNbBuffers = uBytes / buffer_pool::get_size_class_capacity(uSizeClass);
+
+  return uNbBuffers ? uNbBuffers : 1;
+}
+
+std::size_t
+buffer_pool::get_size_class_capacity(std::size_t uSizeClass) {
+  return static_cast<std::size_t>(__TACOPIE_BUFFER_POOL_MIN_SIZE) << uSizeClass;
+}
+
+//!
+//! thread cache
+//! buffers are freed when the thread exits
+//!
+
+struct thread_cache {
+  std::vector<buffer_pool::buffer_t> arrSizeClasses[__TACOPIE_BUFFER_POOL_NB_SIZE_CLASSES];
+};
+
+static thread_cache&
+get_thread_cache(void) {
+  static thread_local thread_cache cache;
+  return cache;
+}
+
+//!
+//! instance
+//!
+
+buffer_pool&
+buffer_pool::get_instance(void) {
+  static buffer_pool instance;
+  return instance;
+}
+
+//!
+//! acquire & release
+//!
+
+buffer_pool::buffer_t
+buffer_pool::acquire(std::size_t uSize) {
+  if (uSize > g_uMaxPooledSize) { return buffer_t(uSize, 0); }
+
+  std::size_t uSizeClass = get_acquire_size_class(uSize);
+  auto& vctThreadBuffers = get_thread_cache().arrSizeClasses[uSizeClass];
+  buffer_t buffer;
+
+  if (!vctThreadBuffers.empty()) {
+    buffer = std::move(vctThreadBuffers.back());
+    vctThreadBuffers.pop_back();
+  } else {
+    auto& sizeClass = m_arrSizeClasses[uSizeClass];
+    std::lock_guard<std::mutex> lock(sizeClass.mtxBuffers);
+
+    if (!sizeClass.vctBuffers.empty()) {
+      buffer = std::move(sizeClass.vctBuffers.back());
+      sizeClass.vctBuffers.pop_back();
+    }
+  }
+
+  //! no buffer available: allocate the full size class so that it can be reused for any request of this class
+  if (buffer.capacity() < uSize) { buffer.reserve(get_size_class_capacity(uSizeClass)); }
+
+  //! only the bytes beyond the size the buffer was released with are initialized (none when it was fully used)
+  buffer.resize(uSize);
+
+  return buffer;
+}
+
+void
+buffer_pool::release(buffer_t buffer) {
+  std::size_t uCapacity = buffer.capacity();
+
+  //! too small or too big to be pooled, simply free it
+  if (uCapacity < __TACOPIE_BUFFER_POOL_MIN_SIZE || uCapacity > 2 * g_uMaxPooledSize) { return; }
+
+  //! the buffer keeps its size: its bytes are already initialized, acquire does not need to fill them again
+  std::size_t uSizeClass = get_release_size_class(uCapacity);
+
+  auto& vctThreadBuffers = get_thread_cache().arrSizeClasses[uSizeClass];
+  if (vctThreadBuffers.size() < get_max_cached_buffers(uSizeClass, __TACOPIE_BUFFER_POOL_THREAD_CACHE_BYTES)) {
+    vctThreadBuffers.push_back(std::move(buffer));
+    return;
+  }
+
+  auto& sizeClass = m_arrSizeClasses[uSizeClass];
+  std::lock_guard<std::mutex> lock(sizeClass.mtxBuffers);
+
+  if (sizeClass.vctBuffers.size() < get_max_cached_buffers(uSizeClass, __TACOPIE_BUFFER_POOL_SHARED_CACHE_BYTES)) {
+    sizeClass.vctBuffers.push_back(std::move(buffer));
+  }
+}
+
+} // namespace utils
+
+} // namespace tacopie
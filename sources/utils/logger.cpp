@@ -20,6 +20,7 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include <chrono>
 #include <iostream>
 
 #include <tacopie/utils/logger.hpp>
@@ -37,6 +38,11 @@ static const char normal[] = {0x1b, '[', '0', ';', '3', '9', 'm', 0};
 logger::logger(log_level level)
 : m_level(level) {}
 
+bool
+logger::is_enabled(log_level level) const {
+  return m_level >= level;
+}
+
 void
 logger::debug(const std::string& msg, const std::string& file, std::size_t line) {
   if (m_level >= log_level::debug) {
@@ -69,6 +75,40 @@ logger::error(const std::string& msg, const std::string& file, std::size_t line)
   }
 }
 
+//!
+//! rate limiter
+//!
+
+bool
+log_rate_limiter::allow(std::uint64_t& uNbSuppressed) {
+  std::int64_t nNowMsecs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  std::int64_t nWindowStartMsecs = m_nWindowStartMsecs_a;
+
+  //! new window: only the thread that moves the window resets the counter
+  if (nNowMsecs - nWindowStartMsecs >= 1000 && m_nWindowStartMsecs_a.compare_exchange_strong(nWindowStartMsecs, nNowMsecs)) {
+    m_uNbAllowed_a = 0;
+  }
+
+  if (++m_uNbAllowed_a > __TACOPIE_LOG_RATE_LIMIT) {
+    ++m_uNbSuppressed_a;
+    return false;
+  }
+
+  uNbSuppressed = m_uNbSuppressed_a.exchange(0);
+  return true;
+}
+
+std::string
+log_rate_limiter::format(const std::string& msg, std::uint64_t uNbSuppressed) {
+  if (!uNbSuppressed) { return msg; }
+
+  return msg + " (" + std::to_string(uNbSuppressed) + " similar messages suppressed)";
+}
+
+//!
+//! convenience functions
+//!
+
 void
 debug(const std::string& msg, const std::string& file, std::size_t line) {
   if (active_logger)
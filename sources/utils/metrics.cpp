@@ -0,0 +1,234 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <tacopie/utils/metrics.hpp>
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace tacopie {
+
+namespace utils {
+
+const std::size_t metrics::s_uNbBuckets;
+
+//!
+//! metrics of a thread
+//! only updated by their thread (load + store instead of read-modify-write), read by snapshots
+//!
+
+struct thread_histogram {
+  std::atomic<std::uint64_t> uCount_a;
+  std::atomic<std::uint64_t> uSum_a;
+  std::atomic<std::uint64_t> uMax_a;
+  std::atomic<std::uint64_t> arrBuckets_a[metrics::s_uNbBuckets];
+};
+
+struct thread_metrics {
+  thread_metrics(void);
+  ~thread_metrics(void);
+
+  std::atomic<std::uint64_t> arrCounters_a[metrics::nb_counters];
+  thread_histogram           arrHistograms[metrics::nb_histograms];
+};
+
+//!
+//! registry of the thread metrics
+//! metrics of exited threads are accumulated in the retired snapshot
+//!
+
+struct metrics_registry {
+  std::mutex                   mtxThreads;
+  std::vector<thread_metrics*> vctThreads;
+  metrics::snapshot            retired = metrics::snapshot();
+};
+
+static metrics_registry&
+get_registry(void) {
+  static metrics_registry registry;
+  return registry;
+}
+
+static void
+accumulate(metrics::snapshot& snapshot, const thread_metrics& threadMetrics) {
+  for (std::size_t i = 0; i < metrics::nb_counters; ++i) {
+    snapshot.counters[i] += threadMetrics.arrCounters_a[i].load(std::memory_order_relaxed);
+  }
+
+  for (std::size_t i = 0; i < metrics::nb_histograms; ++i) {
+    const auto& threadHistogram = threadMetrics.arrHistograms[i];
+    auto& histogram             = snapshot.histograms[i];
+
+    histogram.count += threadHistogram.uCount_a.load(std::memory_order_relaxed);
+    histogram.sum += threadHistogram.uSum_a.load(std::memory_order_relaxed);
+    histogram.max = std::max(histogram.max, threadHistogram.uMax_a.load(std::memory_order_relaxed));
+
+    for (std::size_t j = 0; j < metrics::s_uNbBuckets; ++j) {
+      histogram.buckets[j] += threadHistogram.arrBuckets_a[j].load(std::memory_order_relaxed);
+    }
+  }
+}
+
+thread_metrics::thread_metrics(void) {
+  for (auto& counter : arrCounters_a) { counter.store(0, std::memory_order_relaxed); }
+
+  for (auto& histogram : arrHistograms) {
+    histogram.uCount_a.store(0, std::memory_order_relaxed);
+    histogram.uSum_a.store(0, std::memory_order_relaxed);
+    histogram.uMax_a.store(0, std::memory_order_relaxed);
+    for (auto& bucket : histogram.arrBuckets_a) { bucket.store(0, std::memory_order_relaxed); }
+  }
+
+  auto& registry = get_registry();
+  std::lock_guard<std::mutex> lock(registry.mtxThreads);
+  registry.vctThreads.push_back(this);
+}
+
+thread_metrics::~thread_metrics(void) {
+  auto& registry = get_registry();
+  std::lock_guard<std::mutex> lock(registry.mtxThreads);
+
+  accumulate(registry.retired, *this);
+  registry.vctThreads.erase(std::find(registry.vctThreads.begin(), registry.vctThreads.end(), this));
+}
+
+//! the registry is constructed by the first thread_metrics, so that it outlives all of them
+static thread_metrics&
+get_thread_metrics(void) {
+  static thread_local thread_metrics threadMetrics;
+  return threadMetrics;
+}
+
+//! single writer: no need for an atomic read-modify-write
+static void
+increment(std::atomic<std::uint64_t>& value, std::uint64_t uIncrement) {
+  value.store(value.load(std::memory_order_relaxed) + uIncrement, std::memory_order_relaxed);
+}
+
+//! index of the bucket holding the given value
+static std::size_t
+get_bucket(std::uint64_t uValue) {
+  std::size_t uBucket = 0;
+
+  while (uValue) {
+    uValue >>= 1;
+    ++uBucket;
+  }
+
+  return uBucket;
+}
+
+//!
+//! update metrics
+//!
+
+void
+metrics::add(counter_id id, std::uint64_t uValue) {
+  increment(get_thread_metrics().arrCounters_a[id], uValue);
+}
+
+void
+metrics::record(histogram_id id, std::uint64_t uValue) {
+  auto& histogram = get_thread_metrics().arrHistograms[id];
+
+  increment(histogram.uCount_a, 1);
+  increment(histogram.uSum_a, uValue);
+  increment(histogram.arrBuckets_a[get_bucket(uValue)], 1);
+
+  if (uValue > histogram.uMax_a.load(std::memory_order_relaxed)) { histogram.uMax_a.store(uValue, std::memory_order_relaxed); }
+}
+
+//!
+//! snapshots
+//!
+
+metrics::snapshot
+metrics::get_snapshot(void) {
+  auto& registry = get_registry();
+  std::lock_guard<std::mutex> lock(registry.mtxThreads);
+
+  snapshot result = registry.retired;
+
+  for (const auto pThreadMetrics : registry.vctThreads) { accumulate(result, *pThreadMetrics); }
+
+#ifdef __TACOPIE_METRICS_ENABLED
+  result.enabled = true;
+#else
+  result.enabled = false;
+#endif /* __TACOPIE_METRICS_ENABLED */
+
+  return result;
+}
+
+std::uint64_t
+metrics::histogram::get_percentile(double dPercentile) const {
+  if (!count) { return 0; }
+
+  std::uint64_t uRank  = static_cast<std::uint64_t>(static_cast<double>(count) * dPercentile / 100.0);
+  std::uint64_t uTotal = 0;
+
+  for (std::size_t i = 0; i < s_uNbBuckets; ++i) {
+    uTotal += buckets[i];
+
+    //! values of bucket i are lower than 2^i
+    if (uTotal > uRank) { return i < 64 ? std::min(max, (static_cast<std::uint64_t>(1) << i) - 1) : max; }
+  }
+
+  return max;
+}
+
+//!
+//! names
+//!
+
+const char*
+metrics::get_name(counter_id id) {
+  switch (id) {
+  case poll_iterations: return "poll_iterations";
+  case empty_wakeups: return "empty_wakeups";
+  case events_dispatched: return "events_dispatched";
+  case tasks_executed: return "tasks_executed";
+  case read_syscalls: return "read_syscalls";
+  case write_syscalls: return "write_syscalls";
+  case bytes_read: return "bytes_read";
+  case bytes_written: return "bytes_written";
+  case accepted_connections: return "accepted_connections";
+  case wakeup_notifications: return "wakeup_notifications";
+  case coalesced_wakeups: return "coalesced_wakeups";
+  default: return "unknown";
+  }
+}
+
+const char*
+metrics::get_name(histogram_id id) {
+  switch (id) {
+  case events_per_poll: return "events_per_poll";
+  case task_wait_usecs: return "task_wait_usecs";
+  case write_queue_length: return "write_queue_length";
+  default: return "unknown";
+  }
+}
+
+} // namespace utils
+
+} // namespace tacopie
@@ -21,12 +21,19 @@
 // SOFTWARE.
 
 #include <tacopie/utils/logger.hpp>
+#include <tacopie/utils/metrics.hpp>
 #include <tacopie/utils/thread_pool.hpp>
+#include <tacopie/utils/thread_utils.hpp>
 
 namespace tacopie {
 
 namespace utils {
 
+//!
+//! thread pool the calling thread is a worker of (null if none)
+//!
+static thread_local const thread_pool* g_pCurrentThreadPool = nullptr;
+
 //!
 //! ctor & dtor
 //!
@@ -49,10 +56,17 @@ void
 thread_pool::run(void) {
   __TACOPIE_LOG(debug, "start run() worker");
 
+  g_pCurrentThreadPool = this;
+
+  std::size_t uWorkerIndex         = m_uNextWorkerIndex_a++;
+  std::size_t uPlacementGeneration = apply_placement(uWorkerIndex);
+
   while (true) {
-    auto pairTaskInfo   = fetch_task_or_stop();
+    if (m_uPlacementGeneration_a != uPlacementGeneration) { uPlacementGeneration = apply_placement(uWorkerIndex); }
+
+    auto pairTaskInfo   = fetch_task_or_stop(uPlacementGeneration);
     bool bStopped       = pairTaskInfo.first;
-    task_t task         = pairTaskInfo.second;
+    task_t task         = std::move(pairTaskInfo.second);
 
     //! if thread has been requested to stop, stop it here
     if (bStopped) {
@@ -61,7 +75,7 @@ thread_pool::run(void) {
 
     //! execute task
     if (task) {
-      __TACOPIE_LOG(debug, "execute task");
+      __TACOPIE_LOG_RATE_LIMITED(debug, "execute task");
 
       try {
         task();
@@ -70,13 +84,77 @@ thread_pool::run(void) {
         __TACOPIE_LOG(warn, "uncatched exception propagated up to the threadpool.")
       }
 
-      __TACOPIE_LOG(debug, "execution complete");
+      __TACOPIE_LOG_RATE_LIMITED(debug, "execution complete");
+      __TACOPIE_METRIC_ADD(tasks_executed, 1)
     }
   }
 
   __TACOPIE_LOG(debug, "stop run() worker");
 }
 
+//!
+//! workers name & CPU affinity
+//!
+
+std::size_t
+thread_pool::apply_placement(std::size_t uWorkerIndex) {
+  std::string sThreadName;
+  std::vector<std::size_t> vctCpus;
+  bool bHasCpuAffinity;
+  std::size_t uPlacementGeneration;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mtxPlacement);
+
+    sThreadName          = m_sThreadName;
+    vctCpus              = m_vctCpus;
+    bHasCpuAffinity      = m_bHasCpuAffinity;
+    uPlacementGeneration = m_uPlacementGeneration_a;
+  }
+
+  if (!sThreadName.empty()) { set_current_thread_name(sThreadName + "-" + std::to_string(uWorkerIndex)); }
+
+  if (bHasCpuAffinity && !set_current_thread_affinity(vctCpus)) {
+    __TACOPIE_LOG(warn, "failed to set the CPU affinity of a thread_pool worker");
+  }
+
+  return uPlacementGeneration;
+}
+
+void
+thread_pool::set_cpu_affinity(const std::vector<std::size_t>& vctCpus) {
+  {
+    std::lock_guard<std::mutex> lock(m_mtxPlacement);
+
+    m_vctCpus         = vctCpus;
+    m_bHasCpuAffinity = true;
+    ++m_uPlacementGeneration_a;
+  }
+
+  //! wake up parked workers so that they apply the change without waiting for a task
+  std::lock_guard<std::mutex> lock(m_mtxTasks);
+  m_cvTasks.notify_all();
+}
+
+void
+thread_pool::set_thread_name(const std::string& sName) {
+  {
+    std::lock_guard<std::mutex> lock(m_mtxPlacement);
+
+    m_sThreadName = sName;
+    ++m_uPlacementGeneration_a;
+  }
+
+  //! wake up parked workers so that they apply the change without waiting for a task
+  std::lock_guard<std::mutex> lock(m_mtxTasks);
+  m_cvTasks.notify_all();
+}
+
+bool
+thread_pool::is_worker_thread(void) const {
+  return g_pCurrentThreadPool == this;
+}
+
 //!
 //! stop the thread pool and wait for workers completion
 //!
@@ -86,7 +164,11 @@ thread_pool::stop(void) {
   if (!is_running()) { return; }
 
   m_bShouldStop_a = true;
-  m_cvTasks.notify_all();
+
+  {
+    std::lock_guard<std::mutex> lock(m_mtxTasks);
+    m_cvTasks.notify_all();
+  }
 
   for (auto& worker : m_lstWorkerThreads) { worker.join(); }
 
@@ -115,22 +197,73 @@ thread_pool::should_stop(void) const {
 //! retrieve a new task
 //!
 
+bool
+thread_pool::try_pop_task(queued_task& queuedTask) {
+  if (m_queTasks.try_pop(queuedTask)) { return true; }
+
+  if (m_uNbOverflowTasks_a == 0) { return false; }
+
+  std::lock_guard<std::mutex> lock(m_mtxTasks);
+
+  if (m_queOverflowTasks.empty()) { return false; }
+
+  queuedTask = std::move(m_queOverflowTasks.front());
+  m_queOverflowTasks.pop();
+  --m_uNbOverflowTasks_a;
+
+  return true;
+}
+
+std::size_t
+thread_pool::get_nb_pending_tasks(void) const {
+  return m_queTasks.size() + m_uNbOverflowTasks_a;
+}
+
+bool
+thread_pool::has_pending_tasks(void) const {
+  return !m_queTasks.empty() || m_uNbOverflowTasks_a > 0;
+}
+
 std::pair<bool, thread_pool::task_t>
-thread_pool::fetch_task_or_stop(void) {
-  std::unique_lock<std::mutex> lock(m_mtxTasks);
+thread_pool::fetch_task_or_stop(std::size_t uPlacementGeneration) {
+  queued_task queuedTask;
 
-  __TACOPIE_LOG(debug, "waiting to fetch task");
+  __TACOPIE_LOG_RATE_LIMITED(debug, "waiting to fetch task");
 
-  m_cvTasks.wait(lock, [&] { return should_stop() || !m_queTasks.empty(); });
+  while (true) {
+    //! spin for a while: under load, tasks are likely to be pushed shortly
+    for (std::size_t i = 0; i < __TACOPIE_THREAD_POOL_SPIN_COUNT; ++i) {
+      if (should_stop()) {
+        --m_nNbRunningThreads_a;
+        return {true, nullptr};
+      }
 
-  if (should_stop()) {
-    --m_nNbRunningThreads_a;
-    return {true, nullptr};
-  }
+      if (try_pop_task(queuedTask)) {
+#ifdef __TACOPIE_METRICS_ENABLED
+        auto waitTime = std::chrono::steady_clock::now() - queuedTask.timeQueued;
+        __TACOPIE_METRIC_RECORD(task_wait_usecs, std::chrono::duration_cast<std::chrono::microseconds>(waitTime).count())
+#endif /* __TACOPIE_METRICS_ENABLED */
+
+        return {false, std::move(queuedTask.task)};
+      }
 
-  task_t task = std::move(m_queTasks.front());
-  m_queTasks.pop();
-  return {false, task};
+      //! name or CPU affinity changed: return without task to let the worker apply them
+      if (m_uPlacementGeneration_a != uPlacementGeneration) { return {false, nullptr}; }
+
+      std::this_thread::yield();
+    }
+
+    //! then park until a producer wakes us up
+    std::unique_lock<std::mutex> lock(m_mtxTasks);
+
+    ++m_uNbParkedThreads_a;
+    //! pairs with the fence in add_task: either the producer sees us parked, or we see its task
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    m_cvTasks.wait(lock, [&] {
+      return should_stop() || has_pending_tasks() || m_uPlacementGeneration_a != uPlacementGeneration;
+    });
+    --m_uNbParkedThreads_a;
+  }
 }
 
 //!
@@ -138,18 +271,37 @@ thread_pool::fetch_task_or_stop(void) {
 //!
 
 void
-thread_pool::add_task(const task_t& task) {
-  std::lock_guard<std::mutex> lock(m_mtxTasks);
+thread_pool::add_task(task_t task) {
+  __TACOPIE_LOG_RATE_LIMITED(debug, "add task to thread_pool");
+
+  queued_task queuedTask;
+  queuedTask.task = std::move(task);
+#ifdef __TACOPIE_METRICS_ENABLED
+  queuedTask.timeQueued = std::chrono::steady_clock::now();
+#endif /* __TACOPIE_METRICS_ENABLED */
+
+  //! once a task overflowed, the following ones are queued behind it until the overflow is drained: tasks pushed to
+  //! the lock-free queue in the meantime would be executed first (and could starve it)
+  if (m_uNbOverflowTasks_a > 0 || !m_queTasks.try_push(queuedTask)) {
+    std::lock_guard<std::mutex> lock(m_mtxTasks);
+
+    m_queOverflowTasks.push(std::move(queuedTask));
+    ++m_uNbOverflowTasks_a;
+  }
 
-  __TACOPIE_LOG(debug, "add task to thread_pool");
+  //! pairs with the fence in fetch_task_or_stop: either we see the worker parked, or it sees our task
+  std::atomic_thread_fence(std::memory_order_seq_cst);
 
-  m_queTasks.push(task);
-  m_cvTasks.notify_one();
+  if (m_uNbParkedThreads_a > 0) {
+    //! lock to make sure the parked worker is effectively waiting on the condvar or will see the task
+    std::lock_guard<std::mutex> lock(m_mtxTasks);
+    m_cvTasks.notify_one();
+  }
 }
 
 thread_pool&
-thread_pool::operator<<(const task_t& task) {
-  add_task(task);
+thread_pool::operator<<(task_t task) {
+  add_task(std::move(task));
 
   return *this;
 }
@@ -169,6 +321,7 @@ thread_pool::set_nb_threads(std::size_t uNbThreads) {
 
   //! otherwise, wake up threads to make them stop if necessary (until we get the right amount of threads)
   if (m_nNbRunningThreads_a > m_uMaxNbThreads_a) {
+    std::lock_guard<std::mutex> lock(m_mtxTasks);
     m_cvTasks.notify_all();
   }
 }
@@ -0,0 +1,111 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <tacopie/utils/thread_utils.hpp>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#ifdef __linux__
+#include <sched.h>
+#endif /* __linux__ */
+#endif /* _WIN32 */
+
+namespace tacopie {
+
+namespace utils {
+
+//!
+//! thread name
+//!
+
+#ifdef _WIN32
+//! SetThreadDescription is only available since windows 10 1607: load it at runtime
+typedef HRESULT(WINAPI* set_thread_description_t)(HANDLE, PCWSTR);
+#endif /* _WIN32 */
+
+bool
+set_current_thread_name(const std::string& sName) {
+#if defined(_WIN32)
+  static auto fnSetThreadDescription = reinterpret_cast<set_thread_description_t>(
+      reinterpret_cast<void*>(GetProcAddress(GetModuleHandleW(L"kernel32.dll"), "SetThreadDescription")));
+
+  if (!fnSetThreadDescription) { return false; }
+
+  std::wstring sWideName(sName.begin(), sName.end());
+  return SUCCEEDED(fnSetThreadDescription(GetCurrentThread(), sWideName.c_str()));
+#elif defined(__linux__)
+  //! the kernel limits thread names to 16 bytes, including the null terminator
+  return pthread_setname_np(pthread_self(), sName.substr(0, 15).c_str()) == 0;
+#elif defined(__APPLE__)
+  return pthread_setname_np(sName.c_str()) == 0;
+#else
+  (void) sName;
+  return false;
+#endif /* _WIN32 */
+}
+
+//!
+//! thread affinity
+//!
+
+bool
+set_current_thread_affinity(const std::vector<std::size_t>& vctCpus) {
+#if defined(_WIN32)
+  DWORD_PTR uProcessMask, uSystemMask;
+  if (!GetProcessAffinityMask(GetCurrentProcess(), &uProcessMask, &uSystemMask)) { return false; }
+
+  DWORD_PTR uMask = vctCpus.empty() ? uProcessMask : 0;
+  for (auto uCpu : vctCpus) {
+    //! only the CPUs of the processor group of the thread can be addressed
+    if (uCpu >= sizeof(DWORD_PTR) * 8) { return false; }
+
+    uMask |= static_cast<DWORD_PTR>(1) << uCpu;
+  }
+
+  return SetThreadAffinityMask(GetCurrentThread(), uMask) != 0;
+#elif defined(__linux__)
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+
+  if (vctCpus.empty()) {
+    //! the kernel restricts the mask to the CPUs the process is allowed to run on
+    for (std::size_t uCpu = 0; uCpu < CPU_SETSIZE; ++uCpu) { CPU_SET(uCpu, &cpuSet); }
+  }
+
+  for (auto uCpu : vctCpus) {
+    if (uCpu >= CPU_SETSIZE) { return false; }
+
+    CPU_SET(uCpu, &cpuSet);
+  }
+
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) == 0;
+#else
+  //! no affinity API on this platform (mac os only supports affinity tags, which are mere hints)
+  return vctCpus.empty();
+#endif /* _WIN32 */
+}
+
+} // namespace utils
+
+} // namespace tacopie
@@ -0,0 +1,287 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <tacopie/utils/timer_wheel.hpp>
+
+#include <limits>
+
+namespace tacopie {
+
+namespace utils {
+
+//!
+//! wheel geometry
+//!
+
+static const std::size_t   g_uSlotBits    = 6;
+static const std::uint64_t g_uSlotMask    = 63;
+static const std::uint32_t g_uInvalidNode = std::numeric_limits<std::uint32_t>::max();
+static const std::uint64_t g_uMaxDelay    = (static_cast<std::uint64_t>(1) << (g_uSlotBits * __TACOPIE_TIMER_WHEEL_NB_LEVELS)) - 1;
+
+//! index of the lowest set bit (uBits must not be 0)
+static std::size_t
+get_lowest_bit(std::uint64_t uBits) {
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<std::size_t>(__builtin_ctzll(uBits));
+#else
+  std::size_t uBit = 0;
+  while (!(uBits & 1)) {
+    uBits >>= 1;
+    ++uBit;
+  }
+  return uBit;
+#endif /* __GNUC__ || __clang__ */
+}
+
+//!
+//! ctor
+//!
+
+timer_wheel::timer_wheel(void)
+: m_uFreeHead(g_uInvalidNode)
+, m_uCurrentTick(0)
+, m_uNbTimers(0) {
+  for (std::size_t uLevel = 0; uLevel < __TACOPIE_TIMER_WHEEL_NB_LEVELS; ++uLevel) {
+    for (std::size_t uSlot = 0; uSlot <= g_uSlotMask; ++uSlot) { m_arrSlots[uLevel][uSlot] = g_uInvalidNode; }
+    m_arrOccupiedSlots[uLevel] = 0;
+  }
+}
+
+//!
+//! add & cancel timers
+//!
+
+timer_wheel::handle_t
+timer_wheel::add(std::uint64_t uExpiryTick, std::uint64_t uPeriodTicks, const callback_t& callback) {
+  std::uint32_t uIndex;
+
+  if (m_uFreeHead != g_uInvalidNode) {
+    uIndex      = m_uFreeHead;
+    m_uFreeHead = m_vctNodes[uIndex].uNext;
+  } else {
+    uIndex = static_cast<std::uint32_t>(m_vctNodes.size());
+    m_vctNodes.push_back(node());
+    m_vctNodes.back().uGeneration = 1;
+  }
+
+  auto& timer        = m_vctNodes[uIndex];
+  timer.uExpiryTick  = uExpiryTick > m_uCurrentTick ? uExpiryTick : m_uCurrentTick + 1;
+  timer.uPeriodTicks = uPeriodTicks;
+  timer.callback     = callback;
+
+  link(uIndex);
+  ++m_uNbTimers;
+
+  return (static_cast<handle_t>(timer.uGeneration) << 32) | uIndex;
+}
+
+bool
+timer_wheel::cancel(handle_t handle) {
+  std::uint32_t uIndex = find(handle);
+
+  if (uIndex == g_uInvalidNode) { return false; }
+
+  unlink(uIndex);
+  release(uIndex);
+  --m_uNbTimers;
+
+  return true;
+}
+
+std::uint32_t
+timer_wheel::find(handle_t handle) const {
+  std::uint32_t uIndex      = static_cast<std::uint32_t>(handle & 0xFFFFFFFF);
+  std::uint32_t uGeneration = static_cast<std::uint32_t>(handle >> 32);
+
+  if (uIndex >= m_vctNodes.size()) { return g_uInvalidNode; }
+
+  const auto& timer = m_vctNodes[uIndex];
+
+  if (!timer.bLinked || timer.uGeneration != uGeneration) { return g_uInvalidNode; }
+
+  return uIndex;
+}
+
+//!
+//! slots management
+//!
+
+void
+timer_wheel::link(std::uint32_t uIndex) {
+  auto& timer = m_vctNodes[uIndex];
+
+  //! deadlines beyond the wheel span are clamped to its end
+  if (timer.uExpiryTick - m_uCurrentTick > g_uMaxDelay) { timer.uExpiryTick = m_uCurrentTick + g_uMaxDelay; }
+
+  std::uint64_t uDelay = timer.uExpiryTick - m_uCurrentTick;
+  std::size_t uLevel   = 0;
+
+  while (uLevel + 1 < __TACOPIE_TIMER_WHEEL_NB_LEVELS && (uDelay >> (g_uSlotBits * (uLevel + 1)))) { ++uLevel; }
+
+  std::size_t uSlot = static_cast<std::size_t>((timer.uExpiryTick >> (g_uSlotBits * uLevel)) & g_uSlotMask);
+
+  timer.uLevel  = static_cast<std::uint8_t>(uLevel);
+  timer.uSlot   = static_cast<std::uint8_t>(uSlot);
+  timer.uPrev   = g_uInvalidNode;
+  timer.uNext   = m_arrSlots[uLevel][uSlot];
+  timer.bLinked = true;
+
+  if (timer.uNext != g_uInvalidNode) { m_vctNodes[timer.uNext].uPrev = uIndex; }
+
+  m_arrSlots[uLevel][uSlot] = uIndex;
+  m_arrOccupiedSlots[uLevel] |= static_cast<std::uint64_t>(1) << uSlot;
+}
+
+void
+timer_wheel::unlink(std::uint32_t uIndex) {
+  auto& timer = m_vctNodes[uIndex];
+
+  if (timer.uPrev != g_uInvalidNode) {
+    m_vctNodes[timer.uPrev].uNext = timer.uNext;
+  } else {
+    m_arrSlots[timer.uLevel][timer.uSlot] = timer.uNext;
+  }
+
+  if (timer.uNext != g_uInvalidNode) { m_vctNodes[timer.uNext].uPrev = timer.uPrev; }
+
+  if (m_arrSlots[timer.uLevel][timer.uSlot] == g_uInvalidNode) {
+    m_arrOccupiedSlots[timer.uLevel] &= ~(static_cast<std::uint64_t>(1) << timer.uSlot);
+  }
+
+  timer.bLinked = false;
+}
+
+void
+timer_wheel::release(std::uint32_t uIndex) {
+  auto& timer    = m_vctNodes[uIndex];
+  timer.callback = nullptr;
+
+  //! invalidate the handles of this node (0 is skipped so that a handle is never 0)
+  if (++timer.uGeneration == 0) { timer.uGeneration = 1; }
+
+  timer.uNext = m_uFreeHead;
+  m_uFreeHead = uIndex;
+}
+
+void
+timer_wheel::cascade(std::size_t uLevel, std::size_t uSlot) {
+  std::uint32_t uIndex = m_arrSlots[uLevel][uSlot];
+
+  m_arrSlots[uLevel][uSlot] = g_uInvalidNode;
+  m_arrOccupiedSlots[uLevel] &= ~(static_cast<std::uint64_t>(1) << uSlot);
+
+  while (uIndex != g_uInvalidNode) {
+    std::uint32_t uNext = m_vctNodes[uIndex].uNext;
+
+    link(uIndex);
+    uIndex = uNext;
+  }
+}
+
+//!
+//! advance the wheel
+//!
+
+std::uint64_t
+timer_wheel::get_next_event_tick(void) const {
+  std::uint64_t uNextTick = std::numeric_limits<std::uint64_t>::max();
+
+  if (!m_uNbTimers) { return uNextTick; }
+
+  for (std::size_t uLevel = 0; uLevel < __TACOPIE_TIMER_WHEEL_NB_LEVELS; ++uLevel) {
+    std::uint64_t uOccupiedSlots = m_arrOccupiedSlots[uLevel];
+
+    if (!uOccupiedSlots) { continue; }
+
+    //! slots are reached in order starting from the one following the current slot
+    std::size_t uShift       = g_uSlotBits * uLevel;
+    std::uint64_t uBase      = m_uCurrentTick >> uShift;
+    std::size_t uRotation    = static_cast<std::size_t>((uBase + 1) & g_uSlotMask);
+    std::uint64_t uRotated   = uRotation ? ((uOccupiedSlots >> uRotation) | (uOccupiedSlots << (64 - uRotation))) : uOccupiedSlots;
+    std::uint64_t uEventTick = (uBase + 1 + get_lowest_bit(uRotated)) << uShift;
+
+    if (uEventTick < uNextTick) { uNextTick = uEventTick; }
+  }
+
+  return uNextTick;
+}
+
+void
+timer_wheel::advance(std::uint64_t uTick, std::vector<expired_timer_t>& vctExpiredTimers) {
+  while (m_uNbTimers) {
+    std::uint64_t uEventTick = get_next_event_tick();
+
+    if (uEventTick > uTick) { break; }
+
+    m_uCurrentTick = uEventTick;
+
+    //! move down the timers of the upper levels whose slot has been reached
+    for (std::size_t uLevel = 1; uLevel < __TACOPIE_TIMER_WHEEL_NB_LEVELS; ++uLevel) {
+      std::size_t uShift = g_uSlotBits * uLevel;
+
+      if (m_uCurrentTick & ((static_cast<std::uint64_t>(1) << uShift) - 1)) { break; }
+
+      cascade(uLevel, static_cast<std::size_t>((m_uCurrentTick >> uShift) & g_uSlotMask));
+    }
+
+    //! expire the timers of the current slot
+    std::size_t uSlot = static_cast<std::size_t>(m_uCurrentTick & g_uSlotMask);
+
+    while (m_arrSlots[0][uSlot] != g_uInvalidNode) {
+      std::uint32_t uIndex = m_arrSlots[0][uSlot];
+      auto& timer          = m_vctNodes[uIndex];
+      handle_t handle      = (static_cast<handle_t>(timer.uGeneration) << 32) | uIndex;
+
+      unlink(uIndex);
+
+      if (timer.uPeriodTicks) {
+        vctExpiredTimers.push_back({handle, timer.callback});
+        timer.uExpiryTick += timer.uPeriodTicks;
+        link(uIndex);
+      } else {
+        vctExpiredTimers.push_back({handle, std::move(timer.callback)});
+        release(uIndex);
+        --m_uNbTimers;
+      }
+    }
+  }
+
+  if (uTick > m_uCurrentTick) { m_uCurrentTick = uTick; }
+}
+
+//!
+//! getters
+//!
+
+std::uint64_t
+timer_wheel::get_current_tick(void) const {
+  return m_uCurrentTick;
+}
+
+std::size_t
+timer_wheel::size(void) const {
+  return m_uNbTimers;
+}
+
+} // namespace utils
+
+} // namespace tacopie
@@ -0,0 +1,214 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <gtest/gtest.h>
+#include <tacopie/tacopie>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace {
+
+//!
+//! feed the bytes to the codec, decoding after each chunk of uChunkSize bytes
+//! returns false as soon as the stream is reported invalid
+//!
+bool
+feed_and_decode(tacopie::frame_codec& codec, const std::string& sBytes, std::size_t uChunkSize, std::vector<std::string>& vctFrames) {
+  std::vector<tacopie::frame_codec::frame> vctDecoded;
+
+  for (std::size_t i = 0; i < sBytes.size(); i += uChunkSize) {
+    std::size_t uSize = std::min(uChunkSize, sBytes.size() - i);
+    codec.feed(sBytes.data() + i, uSize);
+
+    if (!codec.decode(vctDecoded)) { return false; }
+
+    for (const auto& frame : vctDecoded) { vctFrames.push_back(std::string(frame.data, frame.size)); }
+    vctDecoded.clear();
+    codec.consume();
+  }
+
+  return true;
+}
+
+//!
+//! encode the frames back to back
+//!
+std::string
+encode_all(const tacopie::frame_codec& codec, const std::vector<std::string>& vctFrames) {
+  std::vector<char> vctBuffer;
+
+  for (const auto& sFrame : vctFrames) { codec.encode(sFrame.data(), sFrame.size(), vctBuffer); }
+
+  return std::string(vctBuffer.begin(), vctBuffer.end());
+}
+
+} // namespace
+
+TEST(TacopieFrameCodec, LengthPrefixedHeaderSplitAcrossFeeds) {
+  std::vector<std::string> vctExpected = {"hello", "", std::string(300, 'a'), "world"};
+
+  for (std::size_t uHeaderSize : {1, 2, 4, 8}) {
+    if (uHeaderSize == 1) { vctExpected[2].resize(255); }
+
+    //! every chunk size splits the headers at a different position
+    for (std::size_t uChunkSize = 1; uChunkSize <= 9; ++uChunkSize) {
+      auto codec = tacopie::frame_codec::length_prefixed(uHeaderSize);
+      std::vector<std::string> vctFrames;
+
+      ASSERT_TRUE(feed_and_decode(codec, encode_all(codec, vctExpected), uChunkSize, vctFrames));
+      EXPECT_EQ(vctFrames, vctExpected);
+      EXPECT_EQ(codec.get_buffered_size(), 0U);
+    }
+
+    vctExpected[2].resize(300, 'a');
+  }
+}
+
+TEST(TacopieFrameCodec, LengthPrefixedRejectsOversizedFrame) {
+  auto codec = tacopie::frame_codec::length_prefixed(4, 16);
+  std::vector<std::string> vctFrames;
+
+  //! exactly the maximum size is accepted
+  ASSERT_TRUE(feed_and_decode(codec, std::string("\x00\x00\x00\x10", 4) + std::string(16, 'a'), 3, vctFrames));
+  EXPECT_EQ(vctFrames, std::vector<std::string>{std::string(16, 'a')});
+
+  //! rejected as soon as the header is received, before the payload
+  EXPECT_FALSE(feed_and_decode(codec, std::string("\x00\x00\x00\x11", 4), 4, vctFrames));
+
+  auto codecEncoder = tacopie::frame_codec::length_prefixed(1);
+  std::vector<char> vctBuffer;
+  std::string sPayload(256, 'a');
+  EXPECT_THROW(codecEncoder.encode(sPayload.data(), sPayload.size(), vctBuffer), tacopie::tacopie_error);
+  EXPECT_THROW(codec.encode(sPayload.data(), 17, vctBuffer), tacopie::tacopie_error);
+}
+
+TEST(TacopieFrameCodec, VarintPrefixedHeaderSplitAcrossFeeds) {
+  //! 1, 2 and 3 bytes varints, on both sides of each boundary
+  std::vector<std::string> vctExpected = {"", std::string(127, 'a'), std::string(128, 'b'), std::string(300, 'c'),
+                                          std::string(16383, 'd'), std::string(16384, 'e')};
+
+  for (std::size_t uChunkSize : {1, 2, 3, 7}) {
+    auto codec = tacopie::frame_codec::varint_prefixed();
+    std::vector<std::string> vctFrames;
+
+    ASSERT_TRUE(feed_and_decode(codec, encode_all(codec, vctExpected), uChunkSize, vctFrames));
+    EXPECT_EQ(vctFrames, vctExpected);
+  }
+
+  std::vector<char> vctBuffer;
+  auto codec = tacopie::frame_codec::varint_prefixed();
+  codec.encode(vctExpected[3].data(), vctExpected[3].size(), vctBuffer);
+  EXPECT_EQ(std::string(vctBuffer.begin(), vctBuffer.begin() + 2), "\xAC\x02");
+}
+
+TEST(TacopieFrameCodec, VarintPrefixedRejectsOverflow) {
+  std::vector<std::string> vctFrames;
+
+  //! more than 10 bytes
+  auto codecTooLong = tacopie::frame_codec::varint_prefixed(static_cast<std::size_t>(-1));
+  EXPECT_FALSE(feed_and_decode(codecTooLong, std::string(10, '\x80') + '\x00', 1, vctFrames));
+
+  //! 10 bytes, but bits beyond the 64th: must not wrap around to a small size
+  auto codecOverflow = tacopie::frame_codec::varint_prefixed(static_cast<std::size_t>(-1));
+  EXPECT_FALSE(feed_and_decode(codecOverflow, std::string(9, '\x80') + '\x02', 10, vctFrames));
+
+  //! bigger than the maximum frame size
+  auto codecTooBig = tacopie::frame_codec::varint_prefixed(299);
+  EXPECT_FALSE(feed_and_decode(codecTooBig, "\xAC\x02", 2, vctFrames));
+
+  EXPECT_TRUE(vctFrames.empty());
+}
+
+TEST(TacopieFrameCodec, DelimiterSplitAcrossFeeds) {
+  //! long enough frames to be scanned by blocks, and partial delimiters inside the frames
+  std::vector<std::string> vctExpected = {"hello", "", std::string(100, 'a') + "\r\n\r" + std::string(50, 'b'),
+                                          "\r\n\rx", "world"};
+
+  for (const std::string& sDelimiter : {std::string("\r\n\r\n"), std::string("--")}) {
+    if (sDelimiter == "--") { vctExpected = {"a-b", "-c", std::string(40, 'c') + "-c", "", "d"}; }
+
+    for (std::size_t uChunkSize = 1; uChunkSize <= 5; ++uChunkSize) {
+      auto codec = tacopie::frame_codec::delimited(sDelimiter);
+      std::vector<std::string> vctFrames;
+
+      ASSERT_TRUE(feed_and_decode(codec, encode_all(codec, vctExpected), uChunkSize, vctFrames));
+      EXPECT_EQ(vctFrames, vctExpected);
+    }
+  }
+}
+
+TEST(TacopieFrameCodec, DelimiterRejectsOversizedFrame) {
+  std::vector<std::string> vctFrames;
+
+  //! exactly the maximum size is accepted, even when its delimiter is received separately
+  auto codec = tacopie::frame_codec::delimited("\r\n", 8);
+  ASSERT_TRUE(feed_and_decode(codec, "12345678\r\n", 9, vctFrames));
+  EXPECT_EQ(vctFrames, std::vector<std::string>{"12345678"});
+
+  //! the delimiter follows the maximum size
+  auto codecDelimited = tacopie::frame_codec::delimited("\r\n", 8);
+  EXPECT_FALSE(feed_and_decode(codecDelimited, "123456789\r\n", 11, vctFrames));
+
+  //! no delimiter: rejected once the maximum size is exceeded, without waiting for it
+  auto codecNoDelimiter = tacopie::frame_codec::delimited("\r\n", 8);
+  EXPECT_TRUE(feed_and_decode(codecNoDelimiter, "123456789", 9, vctFrames));
+  EXPECT_FALSE(feed_and_decode(codecNoDelimiter, "0", 1, vctFrames));
+
+  EXPECT_EQ(vctFrames.size(), 1U);
+}
+
+TEST(TacopieFrameCodec, PrepareKeepsIncompleteFrame) {
+  auto codec = tacopie::frame_codec::length_prefixed(2);
+  std::vector<tacopie::frame_codec::frame> vctFrames;
+
+  std::string sBytes = encode_all(codec, {"first", std::string(1000, 'x')});
+
+  //! the complete frame and the beginning of the next one
+  char* pBuffer = codec.prepare(16);
+  ASSERT_GE(codec.get_writable_size(), 16U);
+  std::copy(sBytes.begin(), sBytes.begin() + 16, pBuffer);
+  codec.commit(16);
+
+  ASSERT_TRUE(codec.decode(vctFrames));
+  ASSERT_EQ(vctFrames.size(), 1U);
+  EXPECT_EQ(std::string(vctFrames[0].data, vctFrames[0].size), "first");
+
+  codec.consume();
+  vctFrames.clear();
+  EXPECT_EQ(codec.get_buffered_size(), 9U);
+
+  //! more than the remaining space: the incomplete frame is moved along with the buffer
+  std::size_t uRemaining = sBytes.size() - 16;
+  pBuffer                = codec.prepare(uRemaining);
+  ASSERT_GE(codec.get_writable_size(), uRemaining);
+  std::copy(sBytes.begin() + 16, sBytes.end(), pBuffer);
+  codec.commit(uRemaining);
+
+  ASSERT_TRUE(codec.decode(vctFrames));
+  ASSERT_EQ(vctFrames.size(), 1U);
+  EXPECT_EQ(std::string(vctFrames[0].data, vctFrames[0].size), std::string(1000, 'x'));
+
+  codec.consume();
+  EXPECT_EQ(codec.get_buffered_size(), 0U);
+}
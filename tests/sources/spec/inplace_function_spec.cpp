@@ -0,0 +1,177 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <gtest/gtest.h>
+#include <tacopie/tacopie>
+
+#include <array>
+#include <functional>
+#include <memory>
+
+namespace {
+
+//!
+//! callable counting its live instances (copies and moved-from ones included)
+//!
+template <std::size_t uSize>
+struct counted_callable {
+  explicit counted_callable(int* pNbInstances)
+  : pNbInstances(pNbInstances) { ++*pNbInstances; }
+
+  counted_callable(const counted_callable& other)
+  : pNbInstances(other.pNbInstances) { ++*pNbInstances; }
+
+  counted_callable(counted_callable&& other) noexcept
+  : pNbInstances(other.pNbInstances) { ++*pNbInstances; }
+
+  ~counted_callable(void) { --*pNbInstances; }
+
+  int
+  operator()(int nValue) const {
+    return nValue + static_cast<int>(arrPadding.size());
+  }
+
+  int*                    pNbInstances;
+  std::array<char, uSize> arrPadding{};
+};
+
+typedef tacopie::utils::inplace_function<int(int)> function_t;
+
+} // namespace
+
+TEST(TacopieInplaceFunction, Empty) {
+  function_t fnDefault;
+  function_t fnNull(nullptr);
+  function_t fnEmptyStdFunction(std::function<int(int)>{});
+  int (*pFunction)(int) = nullptr;
+  function_t fnNullPointer(pFunction);
+
+  EXPECT_FALSE(fnDefault);
+  EXPECT_FALSE(fnNull);
+  EXPECT_FALSE(fnEmptyStdFunction);
+  EXPECT_FALSE(fnNullPointer);
+  EXPECT_TRUE(fnDefault.is_inplace());
+  EXPECT_THROW(fnDefault(1), std::bad_function_call);
+}
+
+TEST(TacopieInplaceFunction, InlineStorage) {
+  int nNbInstances = 0;
+
+  {
+    function_t fn{counted_callable<8>(&nNbInstances)};
+
+    EXPECT_TRUE(fn);
+    EXPECT_TRUE(fn.is_inplace());
+    EXPECT_EQ(fn(1), 9);
+    //! the temporary is gone, only the stored callable remains
+    EXPECT_EQ(nNbInstances, 1);
+  }
+
+  EXPECT_EQ(nNbInstances, 0);
+
+  //! the callables used by tacopie itself capture a few pointers
+  int nValue  = 0;
+  auto pValue = &nValue;
+  function_t fnPointers([pValue, &nValue](int n) { return *pValue + nValue + n; });
+  EXPECT_TRUE(fnPointers.is_inplace());
+}
+
+TEST(TacopieInplaceFunction, HeapStorage) {
+  int nNbInstances = 0;
+
+  {
+    function_t fn{counted_callable<2 * __TACOPIE_INPLACE_FUNCTION_CAPACITY>(&nNbInstances)};
+
+    EXPECT_TRUE(fn);
+    EXPECT_FALSE(fn.is_inplace());
+    EXPECT_EQ(fn(1), 2 * __TACOPIE_INPLACE_FUNCTION_CAPACITY + 1);
+    EXPECT_EQ(nNbInstances, 1);
+  }
+
+  EXPECT_EQ(nNbInstances, 0);
+
+  //! callables that may throw when moved are never stored inline
+  struct throwing_move {
+    throwing_move(void) = default;
+    throwing_move(throwing_move&&) {}
+
+    int
+    operator()(int nValue) const {
+      return nValue;
+    }
+  };
+
+  function_t fnThrowingMove{throwing_move()};
+  EXPECT_FALSE(fnThrowingMove.is_inplace());
+  EXPECT_EQ(fnThrowingMove(3), 3);
+}
+
+TEST(TacopieInplaceFunction, MoveSemantics) {
+  int nNbInlineInstances = 0;
+  int nNbHeapInstances   = 0;
+
+  function_t fnInline{counted_callable<8>(&nNbInlineInstances)};
+  function_t fnHeap{counted_callable<2 * __TACOPIE_INPLACE_FUNCTION_CAPACITY>(&nNbHeapInstances)};
+
+  //! moving leaves the source empty, without duplicating the callable
+  function_t fnMovedInline(std::move(fnInline));
+  EXPECT_FALSE(fnInline);
+  EXPECT_TRUE(fnMovedInline.is_inplace());
+  EXPECT_EQ(fnMovedInline(1), 9);
+  EXPECT_EQ(nNbInlineInstances, 1);
+
+  function_t fnMovedHeap(std::move(fnHeap));
+  EXPECT_FALSE(fnHeap);
+  EXPECT_FALSE(fnMovedHeap.is_inplace());
+  EXPECT_EQ(nNbHeapInstances, 1);
+
+  //! move assignment destroys the replaced callable
+  fnMovedInline = std::move(fnMovedHeap);
+  EXPECT_FALSE(fnMovedHeap);
+  EXPECT_EQ(nNbInlineInstances, 0);
+  EXPECT_EQ(nNbHeapInstances, 1);
+  EXPECT_EQ(fnMovedInline(1), 2 * __TACOPIE_INPLACE_FUNCTION_CAPACITY + 1);
+
+  fnMovedInline = nullptr;
+  EXPECT_FALSE(fnMovedInline);
+  EXPECT_EQ(nNbHeapInstances, 0);
+
+  //! move-only callables are accepted
+  struct move_only {
+    int
+    operator()(int nValue) const {
+      return *ptrValue + nValue;
+    }
+
+    std::unique_ptr<int> ptrValue;
+  };
+
+  function_t fnMoveOnly{move_only{std::unique_ptr<int>(new int(41))}};
+  function_t fnMovedMoveOnly = std::move(fnMoveOnly);
+  EXPECT_EQ(fnMovedMoveOnly(1), 42);
+}
+
+TEST(TacopieInplaceFunction, OneCacheLine) {
+  if (sizeof(void*) != 8 || __TACOPIE_INPLACE_FUNCTION_CAPACITY != 48) { return; }
+
+  EXPECT_EQ(sizeof(function_t), 64U);
+}
@@ -0,0 +1,53 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <gtest/gtest.h>
+#include <tacopie/tacopie>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+TEST(TacopieIOService, CancelQueuedTimerFromSingleWorker) {
+  tacopie::io_service service;
+  service.set_nb_workers(1);
+
+  std::atomic<bool> bQueuedExecuted(false);
+  std::atomic<bool> bCancelled(false);
+  std::atomic<bool> bCompleted(false);
+
+  auto uQueuedTimerId = service.schedule_after(std::chrono::milliseconds(10), [&]() { bQueuedExecuted = true; });
+
+  //! keep the only worker busy until the other timer expired and got queued behind it, then cancel it from there
+  service.schedule_after(std::chrono::milliseconds(1), [&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    bCancelled = service.cancel_timer(uQueuedTimerId, true);
+    bCompleted = true;
+  });
+
+  for (int i = 0; i < 200 && !bCompleted; ++i) { std::this_thread::sleep_for(std::chrono::milliseconds(10)); }
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+  EXPECT_TRUE(bCompleted);
+  EXPECT_TRUE(bCancelled);
+  EXPECT_FALSE(bQueuedExecuted);
+}
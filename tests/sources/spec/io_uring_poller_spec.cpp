@@ -0,0 +1,211 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <gtest/gtest.h>
+#include <tacopie/tacopie>
+
+#ifdef __TACOPIE_HAS_IO_URING
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+//!
+//! start the server on the first available port: the ports of the previous runs may still be in TIME_WAIT
+//!
+std::uint32_t
+start_server(tacopie::tcp_server& server, const tacopie::tcp_server::on_new_connection_callback_t& callback) {
+  for (std::uint32_t uPort = 3301;; ++uPort) {
+    try {
+      server.start("127.0.0.1", uPort, callback);
+      return uPort;
+    }
+    catch (const tacopie::tacopie_error&) {
+      if (uPort == 3400) { throw; }
+    }
+  }
+}
+
+//!
+//! bytes received by a client, and whether its stream ended
+//!
+struct received_bytes {
+  void
+  append(const tacopie::tcp_client::read_result& result) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (result.success) {
+      sBytes.append(result.buffer.data(), result.size);
+    } else {
+      bEnded = true;
+    }
+    cv.notify_all();
+  }
+
+  //! wait until uSize bytes have been received (or the stream ended, if bUntilEnd)
+  bool
+  wait_for(std::size_t uSize, bool bUntilEnd = false) {
+    std::unique_lock<std::mutex> lock(mtx);
+    return cv.wait_for(lock, std::chrono::seconds(5), [&]() { return sBytes.size() >= uSize && (!bUntilEnd || bEnded); });
+  }
+
+  std::mutex              mtx;
+  std::condition_variable cv;
+  std::string             sBytes;
+  bool                    bEnded = false;
+};
+
+} // namespace
+
+//!
+//! io_service on the io_uring backend, used by the clients and servers created by the test
+//!
+class TacopieIOUringPoller : public ::testing::Test {
+protected:
+  void
+  SetUp(void) {
+    try {
+      m_ptrService = std::make_shared<tacopie::io_service>(tacopie::poller_backend::io_uring);
+    }
+    catch (const tacopie::tacopie_error&) {
+      GTEST_SKIP();
+    }
+
+    m_ptrDefaultService = tacopie::get_default_io_service();
+    tacopie::set_default_io_service(m_ptrService);
+  }
+
+  void
+  TearDown(void) {
+    if (m_ptrDefaultService) { tacopie::set_default_io_service(m_ptrDefaultService); }
+  }
+
+  std::shared_ptr<tacopie::io_service> m_ptrService;
+  std::shared_ptr<tacopie::io_service> m_ptrDefaultService;
+};
+
+TEST_F(TacopieIOUringPoller, ContinuousReadReceivesAllBytesInOrder) {
+  ASSERT_TRUE(m_ptrService->supports_recv_completions());
+
+  std::vector<char> vctPayload(4 * 1024 * 1024);
+  for (std::size_t i = 0; i < vctPayload.size(); ++i) { vctPayload[i] = static_cast<char>(i % 251); }
+
+  tacopie::tcp_server server;
+  std::uint32_t uPort = start_server(server, [&](const std::shared_ptr<tacopie::tcp_client>& ptrClient) -> bool {
+    //! non-blocking: the writes must not block the io_service workers
+    ptrClient->start_continuous_read([](tacopie::tcp_client::read_result&) {});
+    for (std::size_t i = 0; i < vctPayload.size(); i += 64 * 1024) {
+      ptrClient->async_write({std::vector<char>(vctPayload.begin() + i, vctPayload.begin() + i + 64 * 1024), nullptr});
+    }
+    return false;
+  });
+
+  //! the callbacks of the reactor thread take the bytes as soon as they are received, the workers once dispatched
+  for (auto eMode : {tacopie::io_service::callback_execution_mode::worker_pool,
+                     tacopie::io_service::callback_execution_mode::reactor_thread}) {
+    received_bytes received;
+
+    tacopie::tcp_client client;
+    client.connect("127.0.0.1", uPort);
+    client.set_callback_execution_mode(eMode);
+    client.start_continuous_read([&](tacopie::tcp_client::read_result& result) { received.append(result); }, 4096);
+
+    ASSERT_TRUE(received.wait_for(vctPayload.size()));
+    EXPECT_EQ(received.sBytes.size(), vctPayload.size());
+    EXPECT_TRUE(received.sBytes == std::string(vctPayload.begin(), vctPayload.end()));
+
+    client.disconnect(true);
+  }
+
+  server.stop();
+}
+
+TEST_F(TacopieIOUringPoller, ContinuousReadReportsEndOfStream) {
+  tacopie::tcp_server server;
+  std::uint32_t uPort = start_server(server, [](const std::shared_ptr<tacopie::tcp_client>& ptrClient) -> bool {
+    std::weak_ptr<tacopie::tcp_client> ptrWeakClient = ptrClient;
+    ptrClient->async_write({{'h', 'e', 'l', 'l', 'o'}, [ptrWeakClient](tacopie::tcp_client::write_result&) {
+                              auto ptrClient = ptrWeakClient.lock();
+                              if (ptrClient) { ptrClient->disconnect(); }
+                            }});
+    return false;
+  });
+
+  received_bytes received;
+  std::mutex mtxDisconnected;
+  std::condition_variable cvDisconnected;
+  bool bDisconnected = false;
+
+  tacopie::tcp_client client;
+  client.connect("127.0.0.1", uPort);
+  client.set_on_disconnection_handler([&]() {
+    std::lock_guard<std::mutex> lock(mtxDisconnected);
+    bDisconnected = true;
+    cvDisconnected.notify_all();
+  });
+  client.start_continuous_read([&](tacopie::tcp_client::read_result& result) { received.append(result); });
+
+  ASSERT_TRUE(received.wait_for(5, true));
+  EXPECT_EQ(received.sBytes, "hello");
+
+  std::unique_lock<std::mutex> lock(mtxDisconnected);
+  EXPECT_TRUE(cvDisconnected.wait_for(lock, std::chrono::seconds(5), [&]() { return bDisconnected; }));
+  EXPECT_FALSE(client.is_connected());
+
+  server.stop();
+}
+
+TEST_F(TacopieIOUringPoller, StopContinuousReadKeepsByteOrder) {
+  tacopie::tcp_server server;
+  std::uint32_t uPort = start_server(server, [](const std::shared_ptr<tacopie::tcp_client>& ptrClient) -> bool {
+    ptrClient->async_write({{'a', 'b', 'c', 'd', 'e', 'f'}, nullptr});
+    return false;
+  });
+
+  received_bytes received;
+
+  tacopie::tcp_client client;
+  client.connect("127.0.0.1", uPort);
+
+  //! the first bytes are received by the io_service, the next ones read from the socket once switched to async_read
+  client.start_continuous_read([&](tacopie::tcp_client::read_result& result) {
+    if (!result.success || !client.is_continuous_read_enabled()) { return; }
+
+    received.append(result);
+    client.stop_continuous_read();
+    client.async_read({4, [&](tacopie::tcp_client::read_result& result) { received.append(result); }});
+  },
+      2);
+
+  ASSERT_TRUE(received.wait_for(6));
+  EXPECT_EQ(received.sBytes, "abcdef");
+
+  client.disconnect(true);
+  server.stop();
+}
+
+#endif /* __TACOPIE_HAS_IO_URING */
@@ -0,0 +1,237 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <gtest/gtest.h>
+#include <tacopie/tacopie>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+//!
+//! start the server on the first available port: the ports of the previous runs may still be in TIME_WAIT
+//!
+std::uint32_t
+start_server(tacopie::tcp_server& server, const tacopie::tcp_server::on_new_connection_callback_t& callback) {
+  for (std::uint32_t uPort = 3401;; ++uPort) {
+    try {
+      server.start("127.0.0.1", uPort, callback);
+      return uPort;
+    }
+    catch (const tacopie::tacopie_error&) {
+      if (uPort == 3500) { throw; }
+    }
+  }
+}
+
+//!
+//! server-side clients, in connection order
+//!
+struct accepted_clients {
+  tacopie::tcp_server::on_new_connection_callback_t
+  get_callback(void) {
+    return [this](const std::shared_ptr<tacopie::tcp_client>& ptrClient) -> bool {
+      std::lock_guard<std::mutex> lock(mtx);
+      vctClients.push_back(ptrClient);
+      return false;
+    };
+  }
+
+  std::size_t
+  size(void) {
+    std::lock_guard<std::mutex> lock(mtx);
+    return vctClients.size();
+  }
+
+  //! wait until uNbClients have been accepted
+  bool
+  wait_for(std::size_t uNbClients) {
+    for (int i = 0; i < 500; ++i) {
+      if (size() >= uNbClients) { return true; }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+  }
+
+  std::mutex                                        mtx;
+  std::vector<std::shared_ptr<tacopie::tcp_client>> vctClients;
+};
+
+//!
+//! checkout a connection, waiting for the pool to connect one
+//!
+tacopie::tcp_client_pool::lease
+wait_for_checkout(tacopie::tcp_client_pool& pool, std::uint32_t uPort) {
+  for (int i = 0; i < 500; ++i) {
+    auto lease = pool.checkout("127.0.0.1", uPort);
+    if (lease) { return lease; }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return tacopie::tcp_client_pool::lease();
+}
+
+} // namespace
+
+TEST(TacopieClientPool, CheckoutAndCheckin) {
+  tacopie::tcp_server server;
+  accepted_clients accepted;
+  std::uint32_t uPort = start_server(server, accepted.get_callback());
+
+  tacopie::tcp_client_pool pool(2, 2);
+
+  //! unknown endpoint
+  EXPECT_FALSE(pool.checkout("127.0.0.1", uPort));
+
+  pool.add_endpoint("127.0.0.1", uPort);
+
+  auto lease1 = wait_for_checkout(pool, uPort);
+  auto lease2 = wait_for_checkout(pool, uPort);
+  ASSERT_TRUE(lease1);
+  ASSERT_TRUE(lease2);
+  EXPECT_NE(&*lease1, &*lease2);
+  EXPECT_TRUE(lease1->is_connected());
+  EXPECT_TRUE(lease2->is_connected());
+
+  //! exhausted: no connection beyond the maximum
+  EXPECT_FALSE(pool.checkout("127.0.0.1", uPort));
+
+  //! the most recently returned connection is handed out first
+  tacopie::tcp_client* pClient1 = &*lease1;
+  tacopie::tcp_client* pClient2 = &*lease2;
+
+  lease2.release();
+  lease1.release();
+  EXPECT_FALSE(lease1);
+
+  auto lease3 = pool.checkout("127.0.0.1", uPort);
+  ASSERT_TRUE(lease3);
+  EXPECT_EQ(&*lease3, pClient1);
+
+  //! released by move assignment
+  lease3 = pool.checkout("127.0.0.1", uPort);
+  ASSERT_TRUE(lease3);
+  EXPECT_EQ(&*lease3, pClient2);
+
+  auto lease4 = pool.checkout("127.0.0.1", uPort);
+  ASSERT_TRUE(lease4);
+  EXPECT_EQ(&*lease4, pClient1);
+
+  lease3.release();
+  lease4.release();
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  EXPECT_EQ(accepted.size(), 2U);
+
+  server.stop();
+}
+
+TEST(TacopieClientPool, GrowsOnMissedCheckouts) {
+  tacopie::tcp_server server;
+  accepted_clients accepted;
+  std::uint32_t uPort = start_server(server, accepted.get_callback());
+
+  tacopie::tcp_client_pool pool(0, 2);
+  pool.add_endpoint("127.0.0.1", uPort);
+
+  //! nothing pre-warmed
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  EXPECT_EQ(accepted.size(), 0U);
+  EXPECT_FALSE(pool.checkout("127.0.0.1", uPort));
+
+  auto lease = wait_for_checkout(pool, uPort);
+  ASSERT_TRUE(lease);
+  EXPECT_TRUE(lease->is_connected());
+  EXPECT_LE(accepted.size(), 2U);
+
+  lease.release();
+  server.stop();
+}
+
+TEST(TacopieClientPool, ReconnectsFailedConnections) {
+  tacopie::tcp_server server;
+  accepted_clients accepted;
+  std::uint32_t uPort = start_server(server, accepted.get_callback());
+
+  tacopie::tcp_client_pool pool(1, 1);
+  pool.set_health_check_interval(50);
+  pool.add_endpoint("127.0.0.1", uPort);
+
+  ASSERT_TRUE(accepted.wait_for(1));
+  ASSERT_TRUE(wait_for_checkout(pool, uPort));
+
+  //! closed by the peer while idle: detected by the health check
+  accepted.vctClients[0]->disconnect(true);
+  ASSERT_TRUE(accepted.wait_for(2));
+
+  auto lease = wait_for_checkout(pool, uPort);
+  ASSERT_TRUE(lease);
+  EXPECT_TRUE(lease->is_connected());
+
+  //! returned disconnected: reconnected right away
+  lease->disconnect(true);
+  lease.release();
+  ASSERT_TRUE(accepted.wait_for(3));
+
+  lease = wait_for_checkout(pool, uPort);
+  ASSERT_TRUE(lease);
+  EXPECT_TRUE(lease->is_connected());
+  EXPECT_EQ(accepted.size(), 3U);
+
+  lease.release();
+  server.stop();
+}
+
+TEST(TacopieClientPool, ReconnectsWithBackoff) {
+  accepted_clients accepted;
+  tacopie::tcp_server server;
+
+  //! pick a free port, on which nothing listens until the server is restarted
+  std::uint32_t uPort = start_server(server, accepted.get_callback());
+  server.stop();
+
+  tacopie::tcp_client_pool pool(1, 1);
+  pool.set_reconnect_backoff(1000, 1000);
+
+  //! the first attempt and its immediate retry are refused, the next one happens between 500ms and 1s later
+  auto timeStart = std::chrono::steady_clock::now();
+  pool.add_endpoint("127.0.0.1", uPort);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  server.start("127.0.0.1", uPort, accepted.get_callback());
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(150));
+  EXPECT_EQ(accepted.size(), 0U);
+  EXPECT_FALSE(pool.checkout("127.0.0.1", uPort));
+
+  auto lease = wait_for_checkout(pool, uPort);
+  ASSERT_TRUE(lease);
+  EXPECT_GE(std::chrono::steady_clock::now() - timeStart, std::chrono::milliseconds(500));
+  EXPECT_EQ(accepted.size(), 1U);
+
+  lease.release();
+  server.stop();
+}
@@ -0,0 +1,175 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <gtest/gtest.h>
+#include <tacopie/tacopie>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+//!
+//! signals the destruction of the clients it deletes
+//!
+struct destruction_notifier {
+  void
+  operator()(tacopie::tcp_client* pClient) {
+    delete pClient;
+
+    std::lock_guard<std::mutex> lock(mtx);
+    bDestroyed = true;
+    cv.notify_all();
+  }
+
+  bool
+  wait_for_destruction(void) {
+    std::unique_lock<std::mutex> lock(mtx);
+    return cv.wait_for(lock, std::chrono::seconds(5), [&]() { return bDestroyed; });
+  }
+
+  std::mutex              mtx;
+  std::condition_variable cv;
+  bool                    bDestroyed = false;
+};
+
+//!
+//! the client only owns itself through its read callback: it is destroyed by it once the read completed
+//!
+void
+read_and_release(std::shared_ptr<tacopie::tcp_client> ptrClient, bool& bReadSucceeded) {
+  ptrClient->async_read({1024, [ptrClient, &bReadSucceeded](tacopie::tcp_client::read_result& result) {
+                           bReadSucceeded = result.success;
+                           if (!result.success) { ptrClient->disconnect(); }
+                         }});
+}
+
+//!
+//! keep a write pending until the client is disconnected
+//!
+void
+write_continuously(tacopie::tcp_client* pClient) {
+  pClient->async_write({std::vector<char>(4096, 'a'), [pClient](tacopie::tcp_client::write_result& result) {
+                          if (result.success) { write_continuously(pClient); }
+                        }});
+}
+
+//!
+//! start the server on the first available port: the ports of the previous runs may still be in TIME_WAIT
+//!
+std::uint32_t
+start_server(tacopie::tcp_server& server, const tacopie::tcp_server::on_new_connection_callback_t& callback) {
+  for (std::uint32_t uPort = 3101;; ++uPort) {
+    try {
+      server.start("127.0.0.1", uPort, callback);
+      return uPort;
+    }
+    catch (const tacopie::tacopie_error&) {
+      if (uPort == 3200) { throw; }
+    }
+  }
+}
+
+} // namespace
+
+TEST(TacopieClient, DestroyedByReadCallbackOnFailure) {
+  tacopie::tcp_server server;
+  std::uint32_t uPort = start_server(server, [](const std::shared_ptr<tacopie::tcp_client>&) -> bool {
+    //! handled by the callback, but none keeps the client: the connection is closed
+    return true;
+  });
+
+  destruction_notifier notifier;
+  bool bReadSucceeded = true;
+
+  {
+    std::shared_ptr<tacopie::tcp_client> ptrClient(new tacopie::tcp_client, std::ref(notifier));
+    ptrClient->connect("127.0.0.1", uPort);
+    read_and_release(ptrClient, bReadSucceeded);
+  }
+
+  EXPECT_TRUE(notifier.wait_for_destruction());
+  EXPECT_FALSE(bReadSucceeded);
+
+  server.stop();
+}
+
+TEST(TacopieClient, DestroyedByReadCallbackWhileConnected) {
+  tacopie::tcp_server server;
+  std::uint32_t uPort = start_server(server, [](const std::shared_ptr<tacopie::tcp_client>& ptrClient) -> bool {
+    ptrClient->async_write({{'h', 'e', 'l', 'l', 'o'}, nullptr});
+    return false;
+  });
+
+  destruction_notifier notifier;
+  bool bReadSucceeded = false;
+
+  {
+    std::shared_ptr<tacopie::tcp_client> ptrClient(new tacopie::tcp_client, std::ref(notifier));
+    ptrClient->connect("127.0.0.1", uPort);
+    read_and_release(ptrClient, bReadSucceeded);
+  }
+
+  EXPECT_TRUE(notifier.wait_for_destruction());
+  EXPECT_TRUE(bReadSucceeded);
+
+  server.stop();
+}
+
+TEST(TacopieClient, DestroyedByReadCallbackWithPendingWrites) {
+  tacopie::tcp_server server;
+  std::uint32_t uPort = start_server(server, [](const std::shared_ptr<tacopie::tcp_client>& ptrClient) -> bool {
+    //! keep the client writable, and only answer once it owns itself through its read callback
+    ptrClient->start_continuous_read([](tacopie::tcp_client::read_result&) {});
+
+    std::weak_ptr<tacopie::tcp_client> ptrWeakClient = ptrClient;
+    tacopie::get_default_io_service()->schedule_after(std::chrono::milliseconds(20), [ptrWeakClient]() {
+      auto ptrClient = ptrWeakClient.lock();
+      if (ptrClient) { ptrClient->async_write({{'h', 'e', 'l', 'l', 'o'}, nullptr}); }
+    });
+
+    return false;
+  });
+
+  //! the write events reported along with the read event destroying the client must not be dispatched to it
+  for (int i = 0; i < 10; ++i) {
+    destruction_notifier notifier;
+    bool bReadSucceeded = false;
+
+    {
+      std::shared_ptr<tacopie::tcp_client> ptrClient(new tacopie::tcp_client, std::ref(notifier));
+      ptrClient->connect("127.0.0.1", uPort);
+      write_continuously(ptrClient.get());
+      read_and_release(ptrClient, bReadSucceeded);
+    }
+
+    EXPECT_TRUE(notifier.wait_for_destruction());
+    EXPECT_TRUE(bReadSucceeded);
+  }
+
+  server.stop();
+}
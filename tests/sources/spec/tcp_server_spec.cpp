@@ -0,0 +1,247 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <gtest/gtest.h>
+#include <tacopie/tacopie>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+//!
+//! start the server on the first available port: the ports of the previous runs may still be in TIME_WAIT
+//!
+std::uint32_t
+start_server(tacopie::tcp_server& server, const tacopie::tcp_server::on_new_connection_callback_t& callback) {
+  for (std::uint32_t uPort = 3201;; ++uPort) {
+    try {
+      server.start("127.0.0.1", uPort, callback);
+      return uPort;
+    }
+    catch (const tacopie::tacopie_error&) {
+      if (uPort == 3300) { throw; }
+    }
+  }
+}
+
+//!
+//! server-side clients, in connection order
+//!
+struct accepted_clients {
+  //! wait until uNbClients have been accepted
+  bool
+  wait_for(std::size_t uNbClients) {
+    for (int i = 0; i < 200; ++i) {
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (vctClients.size() >= uNbClients) { return true; }
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+  }
+
+  std::mutex                                        mtx;
+  std::vector<std::shared_ptr<tacopie::tcp_client>> vctClients;
+};
+
+} // namespace
+
+TEST(TacopieServer, StopFromIOServiceThreadDoesNotDrain) {
+  tacopie::tcp_server server;
+  server.set_drain_timeout(5000);
+
+  //! the client never reads: the pending writes of the server can not be flushed
+  std::uint32_t uPort = 3201;
+  for (;; ++uPort) {
+    try {
+      server.start("127.0.0.1", uPort, [](const std::shared_ptr<tacopie::tcp_client>& ptrClient) -> bool {
+        for (int i = 0; i < 64; ++i) { ptrClient->async_write({std::vector<char>(1024 * 1024, 'a'), nullptr}); }
+        return false;
+      });
+      break;
+    }
+    catch (const tacopie::tacopie_error&) {
+      if (uPort == 3300) { throw; }
+    }
+  }
+
+  tacopie::tcp_client client;
+  client.connect("127.0.0.1", uPort);
+
+  for (int i = 0; i < 200 && server.get_clients().empty(); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  ASSERT_FALSE(server.get_clients().empty());
+
+  std::atomic<bool> bStopped(false);
+  auto timeStart = std::chrono::steady_clock::now();
+
+  tacopie::get_default_io_service()->schedule_after(std::chrono::milliseconds(0), [&]() {
+    server.stop();
+    bStopped = true;
+  });
+
+  for (int i = 0; i < 1000 && !bStopped; ++i) { std::this_thread::sleep_for(std::chrono::milliseconds(10)); }
+
+  EXPECT_TRUE(bStopped);
+  EXPECT_LT(std::chrono::steady_clock::now() - timeStart, std::chrono::seconds(2));
+
+  client.disconnect(true);
+}
+
+TEST(TacopieServer, BroadcastCompletionCounts) {
+  tacopie::tcp_server server;
+  accepted_clients accepted;
+
+  std::uint32_t uPort = start_server(server, [&](const std::shared_ptr<tacopie::tcp_client>& ptrClient) -> bool {
+    std::lock_guard<std::mutex> lock(accepted.mtx);
+    accepted.vctClients.push_back(ptrClient);
+    return false;
+  });
+
+  tacopie::tcp_client client1, client2, client3;
+  client1.connect("127.0.0.1", uPort);
+  client2.connect("127.0.0.1", uPort);
+  client3.connect("127.0.0.1", uPort);
+  ASSERT_TRUE(accepted.wait_for(3));
+
+  auto ptrBuffer = std::make_shared<const std::vector<char>>(1024, 'a');
+
+  //! all the clients but the first one
+  std::shared_ptr<tacopie::tcp_client> ptrExcluded = accepted.vctClients.front();
+  std::promise<tacopie::tcp_server::broadcast_result> promiseResult;
+
+  std::size_t uNbClients = server.broadcast(ptrBuffer,
+      [&](const std::shared_ptr<tacopie::tcp_client>& ptrClient) { return ptrClient != ptrExcluded; },
+      [&](tacopie::tcp_server::broadcast_result& result) { promiseResult.set_value(result); });
+
+  auto futureResult = promiseResult.get_future();
+  ASSERT_EQ(futureResult.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+  auto result = futureResult.get();
+
+  EXPECT_EQ(uNbClients, 2U);
+  EXPECT_EQ(result.nb_clients, 2U);
+  EXPECT_EQ(result.nb_succeeded, 2U);
+  EXPECT_EQ(result.nb_failed, 0U);
+
+  //! no client selected: completed right away
+  bool bCompleted = false;
+  uNbClients      = server.broadcast(ptrBuffer, [](const std::shared_ptr<tacopie::tcp_client>&) { return false; },
+      [&](tacopie::tcp_server::broadcast_result& result) {
+        bCompleted = result.nb_clients == 0 && result.nb_succeeded == 0 && result.nb_failed == 0;
+      });
+
+  EXPECT_EQ(uNbClients, 0U);
+  EXPECT_TRUE(bCompleted);
+
+  server.stop();
+}
+
+TEST(TacopieServer, BroadcastCompletedWhenReceiverDisconnected) {
+  tacopie::tcp_server server;
+  accepted_clients accepted;
+
+  std::uint32_t uPort = start_server(server, [&](const std::shared_ptr<tacopie::tcp_client>& ptrClient) -> bool {
+    //! non-blocking: the writes to a receiver which does not read must not block the io_service workers
+    ptrClient->start_continuous_read([](tacopie::tcp_client::read_result&) {});
+
+    std::lock_guard<std::mutex> lock(accepted.mtx);
+    accepted.vctClients.push_back(ptrClient);
+    return false;
+  });
+
+  //! the first receiver reads everything, the second one never reads: the broadcast can not complete on it
+  tacopie::tcp_client reader, idle;
+  reader.connect("127.0.0.1", uPort);
+  ASSERT_TRUE(accepted.wait_for(1));
+  idle.connect("127.0.0.1", uPort);
+  ASSERT_TRUE(accepted.wait_for(2));
+
+  reader.start_continuous_read([](tacopie::tcp_client::read_result&) {});
+
+  auto ptrBuffer = std::make_shared<const std::vector<char>>(32 * 1024 * 1024, 'a');
+  std::promise<tacopie::tcp_server::broadcast_result> promiseResult;
+
+  std::size_t uNbClients = server.broadcast(ptrBuffer, nullptr,
+      [&](tacopie::tcp_server::broadcast_result& result) { promiseResult.set_value(result); });
+  EXPECT_EQ(uNbClients, 2U);
+
+  auto futureResult = promiseResult.get_future();
+  EXPECT_EQ(futureResult.wait_for(std::chrono::milliseconds(200)), std::future_status::timeout);
+
+  //! the pending write of the idle receiver is dropped by its disconnection
+  accepted.vctClients[1]->disconnect(true);
+
+  ASSERT_EQ(futureResult.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+  auto result = futureResult.get();
+
+  EXPECT_EQ(result.nb_clients, 2U);
+  EXPECT_EQ(result.nb_succeeded, 1U);
+  EXPECT_EQ(result.nb_failed, 1U);
+
+  server.stop();
+}
+
+TEST(TacopieServer, StopDrainKeepsFlushHandler) {
+  tacopie::tcp_server server;
+  server.set_drain_timeout(5000);
+
+  std::atomic<int> nNbFlushes(0);
+
+  std::uint32_t uPort = start_server(server, [&](const std::shared_ptr<tacopie::tcp_client>& ptrClient) -> bool {
+    //! non-blocking: the writes to a receiver which does not read yet must not block the io_service workers
+    ptrClient->start_continuous_read([](tacopie::tcp_client::read_result&) {});
+    ptrClient->set_on_flush_handler([&nNbFlushes]() { ++nNbFlushes; });
+    ptrClient->async_write({std::vector<char>(32 * 1024 * 1024, 'a'), nullptr});
+    return false;
+  });
+
+  tacopie::tcp_client client;
+  client.connect("127.0.0.1", uPort);
+
+  for (int i = 0; i < 200 && server.get_clients().empty(); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  ASSERT_FALSE(server.get_clients().empty());
+
+  //! the client only reads once the server is draining
+  std::thread threadReader([&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    client.start_continuous_read([](tacopie::tcp_client::read_result&) {});
+  });
+
+  server.stop();
+  threadReader.join();
+
+  //! flushed during the drain: the handler of the user has been called
+  EXPECT_EQ(nNbFlushes, 1);
+
+  client.disconnect(true);
+}
@@ -0,0 +1,146 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <gtest/gtest.h>
+#include <tacopie/tacopie>
+#include <tacopie/utils/mpmc_queue.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+TEST(TacopieMPMCQueue, BoundedFifo) {
+  //! capacity is rounded up to the next power of 2
+  tacopie::utils::mpmc_queue<int> queue(5);
+  EXPECT_EQ(queue.capacity(), 8U);
+  EXPECT_TRUE(queue.empty());
+
+  //! pushed and popped across the end of the cells several times
+  for (int nRound = 0; nRound < 3; ++nRound) {
+    for (int i = 0; i < 8; ++i) {
+      int nValue = nRound * 8 + i;
+      EXPECT_TRUE(queue.try_push(nValue));
+    }
+
+    int nValue = -1;
+    EXPECT_FALSE(queue.try_push(nValue));
+    EXPECT_EQ(nValue, -1);
+    EXPECT_EQ(queue.size(), 8U);
+
+    for (int i = 0; i < 8; ++i) {
+      EXPECT_TRUE(queue.try_pop(nValue));
+      EXPECT_EQ(nValue, nRound * 8 + i);
+    }
+
+    EXPECT_FALSE(queue.try_pop(nValue));
+    EXPECT_TRUE(queue.empty());
+  }
+}
+
+TEST(TacopieMPMCQueue, ConcurrentProducersAndConsumers) {
+  tacopie::utils::mpmc_queue<std::size_t> queue(64);
+
+  const std::size_t uNbThreads         = 4;
+  const std::size_t uNbValuesPerThread = 20000;
+
+  std::atomic<std::size_t> uSum(0);
+  std::atomic<std::size_t> uNbPopped(0);
+  std::vector<std::thread> vctThreads;
+
+  for (std::size_t i = 0; i < uNbThreads; ++i) {
+    vctThreads.emplace_back([&, i]() {
+      for (std::size_t j = 0; j < uNbValuesPerThread; ++j) {
+        std::size_t uValue = i * uNbValuesPerThread + j + 1;
+        while (!queue.try_push(uValue)) { std::this_thread::yield(); }
+      }
+    });
+    vctThreads.emplace_back([&]() {
+      std::size_t uValue;
+      while (uNbPopped < uNbThreads * uNbValuesPerThread) {
+        if (!queue.try_pop(uValue)) {
+          std::this_thread::yield();
+          continue;
+        }
+        uSum += uValue;
+        ++uNbPopped;
+      }
+    });
+  }
+
+  for (auto& thread : vctThreads) { thread.join(); }
+
+  //! each value popped exactly once
+  std::size_t uNbValues = uNbThreads * uNbValuesPerThread;
+  EXPECT_EQ(uNbPopped, uNbValues);
+  EXPECT_EQ(uSum, uNbValues * (uNbValues + 1) / 2);
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(TacopieThreadPool, OverflowedTasksKeepFifoOrder) {
+  tacopie::utils::thread_pool pool(1);
+
+  const std::size_t uNbTasks = 4 * __TACOPIE_THREAD_POOL_QUEUE_SIZE;
+
+  std::vector<std::size_t> vctOrder;
+  vctOrder.reserve(uNbTasks);
+  std::atomic<std::size_t> uNbExecuted(0);
+
+  auto add_task = [&](std::size_t uIndex, std::shared_future<void> futureWait) {
+    pool << [&vctOrder, &uNbExecuted, uIndex, futureWait]() {
+      if (futureWait.valid()) { futureWait.wait(); }
+      vctOrder.push_back(uIndex);
+      ++uNbExecuted;
+    };
+  };
+
+  //! the only worker is blocked until the lock-free queue is full and tasks overflowed
+  std::promise<void> promiseUnblock;
+  pool << [&promiseUnblock]() { promiseUnblock.get_future().wait(); };
+
+  //! then by the first task, so that the following ones are added while slots of the lock-free queue are free
+  std::promise<void> promiseSecondHalfAdded;
+  add_task(0, promiseSecondHalfAdded.get_future().share());
+  for (std::size_t i = 1; i < uNbTasks / 2; ++i) { add_task(i, {}); }
+  EXPECT_GT(pool.get_nb_pending_tasks(), static_cast<std::size_t>(__TACOPIE_THREAD_POOL_QUEUE_SIZE));
+
+  promiseUnblock.set_value();
+  for (int i = 0; i < 500 && pool.get_nb_pending_tasks() == uNbTasks / 2; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  //! these must not overtake the overflowed tasks
+  for (std::size_t i = uNbTasks / 2; i < uNbTasks; ++i) { add_task(i, {}); }
+  promiseSecondHalfAdded.set_value();
+
+  for (int i = 0; i < 1000 && uNbExecuted < uNbTasks; ++i) { std::this_thread::sleep_for(std::chrono::milliseconds(10)); }
+  pool.stop();
+
+  ASSERT_EQ(uNbExecuted, uNbTasks);
+  for (std::size_t i = 0; i < uNbTasks; ++i) {
+    if (vctOrder[i] != i) {
+      ADD_FAILURE() << "task " << vctOrder[i] << " executed at position " << i;
+      break;
+    }
+  }
+}
@@ -0,0 +1,171 @@
+// MIT License
+//
+// Copyright (c) 2016-2017 Simon Ninon <simon.ninon@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <gtest/gtest.h>
+#include <tacopie/utils/timer_wheel.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace {
+
+//!
+//! advance the wheel one tick at a time, recording the tick at which each timer expired
+//!
+std::vector<std::uint64_t>
+advance_tick_by_tick(tacopie::utils::timer_wheel& wheel, std::uint64_t uLastTick) {
+  std::vector<std::uint64_t> vctExpiryTicks;
+  std::vector<tacopie::utils::timer_wheel::expired_timer_t> vctExpiredTimers;
+
+  for (std::uint64_t uTick = wheel.get_current_tick() + 1; uTick <= uLastTick; ++uTick) {
+    wheel.advance(uTick, vctExpiredTimers);
+    for (std::size_t i = 0; i < vctExpiredTimers.size(); ++i) { vctExpiryTicks.push_back(uTick); }
+    vctExpiredTimers.clear();
+  }
+
+  return vctExpiryTicks;
+}
+
+} // namespace
+
+TEST(TacopieTimerWheel, EmptyWheel) {
+  tacopie::utils::timer_wheel wheel;
+  std::vector<tacopie::utils::timer_wheel::expired_timer_t> vctExpiredTimers;
+
+  EXPECT_EQ(wheel.size(), 0U);
+  EXPECT_EQ(wheel.get_next_event_tick(), std::numeric_limits<std::uint64_t>::max());
+
+  wheel.advance(1000, vctExpiredTimers);
+
+  EXPECT_TRUE(vctExpiredTimers.empty());
+  EXPECT_EQ(wheel.get_current_tick(), 1000U);
+}
+
+TEST(TacopieTimerWheel, ExpiresAtDeadlineAcrossLevels) {
+  tacopie::utils::timer_wheel wheel;
+
+  //! lowest level, then the boundaries of the upper levels, which are cascaded down before expiring
+  std::vector<std::uint64_t> vctDeadlines = {1, 63, 64, 65, 127, 128, 4095, 4096, 4097, 262143, 262144, 262145};
+
+  for (auto uDeadline : vctDeadlines) { wheel.add(uDeadline, 0, nullptr); }
+
+  EXPECT_EQ(wheel.size(), vctDeadlines.size());
+  EXPECT_EQ(advance_tick_by_tick(wheel, 262145), vctDeadlines);
+  EXPECT_EQ(wheel.size(), 0U);
+}
+
+TEST(TacopieTimerWheel, ExpiresInDeadlineOrderOnLargeAdvance) {
+  tacopie::utils::timer_wheel wheel;
+  std::vector<int> vctOrder;
+
+  wheel.add(262145, 0, [&]() { vctOrder.push_back(3); });
+  wheel.add(70, 0, [&]() { vctOrder.push_back(1); });
+  wheel.add(4100, 0, [&]() { vctOrder.push_back(2); });
+  wheel.add(5, 0, [&]() { vctOrder.push_back(0); });
+
+  std::vector<tacopie::utils::timer_wheel::expired_timer_t> vctExpiredTimers;
+  wheel.advance(1000000, vctExpiredTimers);
+
+  for (auto& timer : vctExpiredTimers) { timer.second(); }
+
+  EXPECT_EQ(vctOrder, (std::vector<int>{0, 1, 2, 3}));
+  EXPECT_EQ(wheel.get_current_tick(), 1000000U);
+}
+
+TEST(TacopieTimerWheel, PastDeadlineExpiresOnNextAdvance) {
+  tacopie::utils::timer_wheel wheel;
+  std::vector<tacopie::utils::timer_wheel::expired_timer_t> vctExpiredTimers;
+
+  wheel.advance(100, vctExpiredTimers);
+  wheel.add(10, 0, nullptr);
+
+  wheel.advance(100, vctExpiredTimers);
+  EXPECT_TRUE(vctExpiredTimers.empty());
+
+  wheel.advance(101, vctExpiredTimers);
+  EXPECT_EQ(vctExpiredTimers.size(), 1U);
+}
+
+TEST(TacopieTimerWheel, DeadlineBeyondSpanIsClamped) {
+  tacopie::utils::timer_wheel wheel;
+  std::vector<tacopie::utils::timer_wheel::expired_timer_t> vctExpiredTimers;
+
+  //! the wheel spans 64^levels - 1 ticks
+  std::uint64_t uMaxDelay = (static_cast<std::uint64_t>(1) << (6 * __TACOPIE_TIMER_WHEEL_NB_LEVELS)) - 1;
+
+  wheel.add(std::numeric_limits<std::uint64_t>::max(), 0, nullptr);
+
+  wheel.advance(uMaxDelay - 1, vctExpiredTimers);
+  EXPECT_TRUE(vctExpiredTimers.empty());
+  EXPECT_EQ(wheel.size(), 1U);
+
+  wheel.advance(uMaxDelay, vctExpiredTimers);
+  EXPECT_EQ(vctExpiredTimers.size(), 1U);
+  EXPECT_EQ(wheel.size(), 0U);
+}
+
+TEST(TacopieTimerWheel, PeriodicTimerIsRescheduled) {
+  tacopie::utils::timer_wheel wheel;
+  int nNbCalls = 0;
+
+  auto handle = wheel.add(10, 10, [&]() { ++nNbCalls; });
+
+  EXPECT_EQ(advance_tick_by_tick(wheel, 45), (std::vector<std::uint64_t>{10, 20, 30, 40}));
+
+  //! one expiry per elapsed period, even when advancing past several of them at once
+  std::vector<tacopie::utils::timer_wheel::expired_timer_t> vctExpiredTimers;
+  wheel.advance(75, vctExpiredTimers);
+
+  EXPECT_EQ(vctExpiredTimers.size(), 3U);
+  for (auto& timer : vctExpiredTimers) {
+    EXPECT_EQ(timer.first, handle);
+    timer.second();
+  }
+  EXPECT_EQ(nNbCalls, 3);
+
+  //! the callback is copied: the timer keeps it
+  EXPECT_EQ(wheel.size(), 1U);
+  EXPECT_TRUE(wheel.cancel(handle));
+  EXPECT_EQ(wheel.size(), 0U);
+  EXPECT_TRUE(advance_tick_by_tick(wheel, 200).empty());
+}
+
+TEST(TacopieTimerWheel, CancelInvalidatesHandle) {
+  tacopie::utils::timer_wheel wheel;
+
+  auto handle = wheel.add(4096, 0, nullptr);
+
+  EXPECT_NE(handle, 0U);
+  EXPECT_TRUE(wheel.cancel(handle));
+  EXPECT_FALSE(wheel.cancel(handle));
+
+  //! the node is reused by the next timer, the stale handle must not cancel it
+  auto handleReused = wheel.add(4096, 0, nullptr);
+
+  EXPECT_NE(handleReused, handle);
+  EXPECT_FALSE(wheel.cancel(handle));
+  EXPECT_EQ(wheel.size(), 1U);
+
+  EXPECT_EQ(advance_tick_by_tick(wheel, 5000), (std::vector<std::uint64_t>{4096}));
+  EXPECT_FALSE(wheel.cancel(handleReused));
+}